@@ -0,0 +1,128 @@
+/*******************************************************************
+ * AllocTracker:  Counts the program's heap allocations, by the
+ * part of the program making them and by thread, so the frames
+ * can be held to none at all.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "alloctracker.h"
+
+//! Plain data, so they are ready before any constructor runs.
+static atomic<unsigned long> subsystemAllocs[AllocTracker::NUM_SUBSYSTEMS];
+static atomic<unsigned long> subsystemBytes[AllocTracker::NUM_SUBSYSTEMS];
+static thread_local int threadSubsystem = AllocTracker::SUBSYSTEM_OTHER;
+static thread_local unsigned long threadCount = 0;
+
+void AllocTracker::record(size_t bytes)
+{
+    subsystemAllocs[threadSubsystem].fetch_add(1, memory_order_relaxed);
+    subsystemBytes[threadSubsystem].fetch_add(bytes, memory_order_relaxed);
+    threadCount++;
+}
+
+void AllocTracker::snapshot(Counts &counts)
+{
+    for (int x = 0; x < NUM_SUBSYSTEMS; x++)
+    {
+        counts.allocs[x] = subsystemAllocs[x].load(memory_order_relaxed);
+        counts.bytes[x] = subsystemBytes[x].load(memory_order_relaxed);
+    }
+}
+
+unsigned long AllocTracker::threadAllocs()
+{
+    return threadCount;
+}
+
+AllocTracker::Alloc_Subsystem AllocTracker::current()
+{
+    return (Alloc_Subsystem) threadSubsystem;
+}
+
+AllocTracker::Alloc_Subsystem AllocTracker::enter(Alloc_Subsystem subsystem)
+{
+    Alloc_Subsystem previous = (Alloc_Subsystem) threadSubsystem;
+    threadSubsystem = subsystem;
+    return previous;
+}
+
+const char *AllocTracker::name(int subsystem)
+{
+    const char *names[NUM_SUBSYSTEMS] = { "other", "render", "cull", "sort",
+        "drift", "capture", "simulation", "metrics", "assets" };
+    return names[subsystem];
+}
+
+void AllocTracker::report(const Counts &before, const Counts &after, int frames)
+{
+    double count = (double) std::max(1, frames);
+    cout << fixed << setprecision(2) << "\tAllocations a frame:";
+    bool any = false;
+    for (int x = 0; x < NUM_SUBSYSTEMS; x++)
+    {
+        unsigned long allocs = after.allocs[x] - before.allocs[x];
+        if (allocs == 0)
+        {
+            continue;
+        }
+        any = true;
+        cout << "\n\t  " << left << setw(12) << name(x) << right
+        << allocs / count << ", " << (after.bytes[x] - before.bytes[x]) / count << " bytes";
+    }
+    if (!any)
+    {
+        cout << "  none";
+    }
+    cout << "\n";
+    cout.unsetf(ios_base::floatfield);
+}
+
+/** Every form of new and delete comes down to these,
+ * the array and nothrow forms of the library calling them.
+ */
+void *operator new(size_t bytes)
+{
+    AllocTracker::record(bytes);
+    void *memory = malloc(std::max(bytes, (size_t) 1));
+    if (memory == NULL)
+    {
+        throw bad_alloc();
+    }
+    return memory;
+}
+
+void *operator new(size_t bytes, align_val_t align)
+{
+    AllocTracker::record(bytes);
+    //! The size must be a whole number of alignments.
+    size_t alignment = std::max((size_t) align, sizeof(void*));
+    size_t rounded = (std::max(bytes, (size_t) 1) + alignment - 1) & ~(alignment - 1);
+    void *memory = aligned_alloc(alignment, rounded);
+    if (memory == NULL)
+    {
+        throw bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void *memory, align_val_t) noexcept
+{
+    free(memory);
+}
+
+//! The sized forms, which the compiler calls when it knows
+//! the size, free the same way.
+void operator delete(void *memory, size_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void *memory, size_t, align_val_t) noexcept
+{
+    free(memory);
+}
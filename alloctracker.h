@@ -0,0 +1,103 @@
+/*******************************************************************
+ * AllocTracker:  Counts the program's heap allocations, by the
+ * part of the program making them and by thread, so the frames
+ * can be held to none at all.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef ALLOCTRACKER_H
+#define ALLOCTRACKER_H
+
+#include "commonheader.h"
+
+/** \class AllocTracker
+ * alloctracker.cpp replaces the global operator new, so every
+ * allocation made through new, and so through the standard
+ * containers and strings, is counted against the subsystem
+ * the calling thread is in, and against the thread itself.
+ * Memory the driver or the libraries written in C take with
+ * malloc is not counted.
+ */
+class AllocTracker
+{
+public:
+    //! The parts of the program counted apart.
+    enum Alloc_Subsystem {
+        SUBSYSTEM_OTHER,
+        SUBSYSTEM_RENDER,
+        SUBSYSTEM_CULL,
+        SUBSYSTEM_SORT,
+        SUBSYSTEM_DRIFT,
+        SUBSYSTEM_CAPTURE,
+        SUBSYSTEM_SIMULATION,
+        SUBSYSTEM_METRICS,
+        SUBSYSTEM_ASSETS,
+        NUM_SUBSYSTEMS
+    };
+
+    //! Allocations and bytes so far, for each subsystem.
+    struct Counts {
+        unsigned long allocs[NUM_SUBSYSTEMS];
+        unsigned long bytes[NUM_SUBSYSTEMS];
+    };
+
+    /** \brief record
+     * Counts one allocation of the calling thread.  Called
+     * from operator new.
+     */
+    static void record(size_t bytes);
+
+    /** \brief snapshot
+     * The counts of the whole program so far.
+     */
+    static void snapshot(Counts &counts);
+
+    /** \brief threadAllocs
+     * The allocations the calling thread has made so far.
+     */
+    static unsigned long threadAllocs();
+
+    /** \brief current
+     * The subsystem the calling thread is in.
+     */
+    static Alloc_Subsystem current();
+
+    /** \brief enter
+     * Puts the calling thread in a subsystem, returning the
+     * one it was in.  AllocScope does this for a block.
+     */
+    static Alloc_Subsystem enter(Alloc_Subsystem subsystem);
+
+    /** \brief name
+     * The subsystem's name for the reports.
+     */
+    static const char *name(int subsystem);
+
+    /** \brief report
+     * Prints the allocations between two snapshots, per
+     * frame, by subsystem.
+     */
+    static void report(const Counts &before, const Counts &after, int frames);
+};
+
+/** \class AllocScope
+ * Counts the allocations of the calling thread against a
+ * subsystem until the end of the block.
+ */
+class AllocScope
+{
+public:
+    AllocScope(AllocTracker::Alloc_Subsystem subsystem)
+    {
+        previous = AllocTracker::enter(subsystem);
+    }
+    ~AllocScope()
+    {
+        AllocTracker::enter(previous);
+    }
+
+protected:
+    AllocTracker::Alloc_Subsystem previous;
+};
+
+#endif // ALLOCTRACKER_H
@@ -10,7 +10,7 @@
     //! Constructor with vectors
 Camera::Camera(int width, int height, vec3 position, vec3 up, float yaw, float pitch) 
 {
-    cout << "\n\n\tCreating Camera.\n\n";
+    LOG_DEBUG(STARTUP, "Creating Camera.");
     this->width = width;
     this->height = height;
     this->position = position;
@@ -28,7 +28,7 @@ Camera::Camera(int width, int height, vec3 position, vec3 up, float yaw, float p
 
 Camera::Camera(int width, int height, float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch)
 {
-    cout << "\n\n\tCreating Camera.\n\n";
+    LOG_DEBUG(STARTUP, "Creating Camera.");
     this->width = width;
     this->height = height;
     Front = vec3(0.0f, 0.0f, -1.0f);
@@ -46,7 +46,7 @@ Camera::Camera(int width, int height, float posX, float posY, float posZ, float
 
 Camera::~Camera()
 {
-    cout << "\n\n\tDestroying Camera.\n\n";
+    LOG_DEBUG(STARTUP, "Destroying Camera.");
 }
 
 vec3 Camera::GetPosition()
@@ -69,6 +69,55 @@ mat4 Camera::GetPerspective()
     return perspective(Zoom, (float)width / (float)height, 0.1f, 1000.0f);
 }
 
+void Camera::GetViews(int count, float spacing, mat4 *views, mat4 *projections, vec3 *positions)
+{
+    int columns, rows;
+    ViewGrid(count, columns, rows);
+    float aspect = ((float) width / (float) columns) / ((float) height / (float) rows);
+    mat4 centered = perspective(Zoom, aspect, 0.1f, 1000.0f);
+    for (int v = 0; v < count; v++)
+    {
+        //! The offset of the eye across and up, in grid steps
+        //! from the middle.
+        float across = ((float) (v % columns) - (columns - 1) * 0.5f) * spacing;
+        float up = ((rows - 1) * 0.5f - (float) (v / columns)) * spacing;
+        positions[v] = Position + Right * across + Up * up;
+        views[v] = lookAt(positions[v], positions[v] + Front, Up);
+        //! Skew the frustum so what lies CONVERGENCE ahead
+        //! of the camera falls in the middle of every view.
+        projections[v] = centered;
+        projections[v][2][0] = -centered[0][0] * across / CONVERGENCE;
+        projections[v][2][1] = -centered[1][1] * up / CONVERGENCE;
+    }
+}
+
+void Camera::ViewGrid(int count, int &columns, int &rows)
+{
+    columns = std::min(std::max(count, 1), 2);
+    rows = (std::max(count, 1) + columns - 1) / columns;
+}
+
+void Camera::SetOrientation(float yaw, float pitch)
+{
+    Yaw = yaw;
+    Pitch = pitch;
+    updateCameraVectors();
+}
+
+void Camera::LookAt(vec3 target)
+{
+    //! Turn the direction into Euler angles.
+    vec3 direction = target - Position;
+    if (length(direction) <= 0.0f)
+    {
+        return;
+    }
+    direction = normalize(direction);
+    Pitch = asin(direction.y) / onedegree;
+    Yaw = atan2(direction.z, direction.x) / onedegree;
+    updateCameraVectors();
+}
+
 void Camera::ProcessKeyboard(Camera_Movement direction, float deltaTime)
 {
     //! Move the camera around the scene.
@@ -146,7 +195,7 @@ void Camera::updateCameraVectors()
 
 void Camera::resetCamera()
 {
-    cout << "\n\n\tCreating Camera.\n\n";
+    LOG_DEBUG(STARTUP, "Creating Camera.");
     this->width = width;
     this->height = height;
     this->position = position;
@@ -9,6 +9,7 @@
 #define CAMERA_H
 
 #include "commonheader.h"
+#include "logger.h"
 
 /** \class Camera
  * An abstract camera class that processes input and 
@@ -43,6 +44,8 @@ public:
     constexpr static float SENSITIVITY =  0.3f;
     constexpr static float ZOOM        =  45.0f;
     constexpr static float onedegree = (float) acos(-1) / 180.0f;
+    //! How far ahead the views of GetViews meet.
+    constexpr static float CONVERGENCE = 15.0f;
 
     //! Camera Attributes
     vec3 Position;
@@ -88,6 +91,22 @@ public:
      */
     mat4 GetPerspective();
 
+    /** \brief GetViews
+     * For count views side by side in the window, two in a
+     * row for stereo or four in a square, the view and
+     * projection matrices and the position of each.  The
+     * eyes are spacing apart on a grid like the one on the
+     * screen, all looking the way the camera does, with
+     * frusta skewed to meet CONVERGENCE ahead.
+     */
+    void GetViews(int count, float spacing, mat4 *views, mat4 *projections, vec3 *positions);
+
+    /** \brief ViewGrid
+     * The columns and rows count views are laid out in,
+     * the first view at the top left.
+     */
+    static void ViewGrid(int count, int &columns, int &rows);
+
     /** \brief resetCamera
      * Resets the camera to the original position and zoom.
      */
@@ -103,6 +122,17 @@ public:
      */
     void SetPosition(vec3 position);
 
+    /** \brief SetOrientation
+     * Sets the yaw and pitch in degrees.
+     */
+    void SetOrientation(float yaw, float pitch);
+
+    /** \brief LookAt
+     * Points the camera at a target by setting the
+     * yaw and pitch.
+     */
+    void LookAt(vec3 target);
+
     /** \brief ProcessKeyboard
      * Processes input received from any keyboard-like input
      * system. Accepts input parameter in the form of camera
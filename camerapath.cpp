@@ -0,0 +1,64 @@
+/*******************************************************************
+ * CameraPath:  A class to move the camera along a scripted
+ * path so that every run sees the same frames.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "camerapath.h"
+
+CameraPath::CameraPath(Path_Type type)
+{
+    this->type = type;
+}
+
+CameraPath::~CameraPath()
+{
+}
+
+bool CameraPath::fromName(string name, Path_Type &type)
+{
+    if (name == "static")
+    {
+        type = STATIC;
+    }
+    else if (name == "orbit")
+    {
+        type = ORBIT;
+    }
+    else if (name == "flythrough")
+    {
+        type = FLYTHROUGH;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+void CameraPath::apply(Camera &camera, float t)
+{
+    t = glm::clamp(t, 0.0f, 1.0f);
+    if (type == STATIC)
+    {
+        camera.SetPosition(initPos);
+        camera.LookAt(initPos + vec3(0.0f, 0.0f, -1.0f));
+    }
+    else if (type == ORBIT)
+    {
+        //! One full circle, rising and falling a little.
+        float angle = t * twopi;
+        vec3 position = center + vec3(sin(angle) * radius,
+        sin(angle * 2.0f) * radius * 0.25f, cos(angle) * radius);
+        camera.SetPosition(position);
+        camera.LookAt(center);
+    }
+    else if (type == FLYTHROUGH)
+    {
+        //! From in front of the cloud to behind it with a slow weave.
+        float weave = sin(t * twopi) * 5.0f;
+        vec3 position = vec3(weave, weave * 0.5f, mix(initPos.z, center.z - 40.0f, t));
+        camera.SetPosition(position);
+        camera.LookAt(position + vec3(0.0f, 0.0f, -1.0f));
+    }
+}
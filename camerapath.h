@@ -0,0 +1,55 @@
+/*******************************************************************
+ * CameraPath:  A class to move the camera along a scripted
+ * path so that every run sees the same frames.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef CAMERAPATH_H
+#define CAMERAPATH_H
+
+#include "commonheader.h"
+#include "camera.h"
+
+/** \class CameraPath
+ * Places the camera for a point in time along one of
+ * a few fixed paths around and through the cloud.
+ */
+class CameraPath
+{
+public:
+    /** \brief Path_Type
+     * STATIC leaves the camera where it starts, ORBIT circles
+     * the cloud looking at its center, FLYTHROUGH travels
+     * straight through the middle of the cloud.
+     */
+    enum Path_Type {
+        STATIC,
+        ORBIT,
+        FLYTHROUGH
+    };
+
+    CameraPath(Path_Type type);
+    ~CameraPath();
+
+    /** \brief fromName
+     * Turns a name from the command line into a path type.
+     * Returns false if the name is not recognized.
+     */
+    static bool fromName(string name, Path_Type &type);
+
+    /** \brief apply
+     * Moves the camera to where it is at time t, where t
+     * goes from 0 at the start of the path to 1 at the end.
+     */
+    void apply(Camera &camera, float t);
+
+protected:
+    Path_Type type;
+    //! The cloud spans -25 to 25 and is moved back 15 on z.
+    const vec3 center = vec3(0.0f, 0.0f, -15.0f);
+    const vec3 initPos = vec3(0.0f, 0.0f, 20.0f);
+    const float radius = 35.0f;
+    const float twopi = 2.0f * (float) acos(-1);
+};
+
+#endif // CAMERAPATH_H
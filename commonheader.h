@@ -16,6 +16,8 @@
 #define NUM_INSTANCES 30
 #define NUM_IMAGES 16
 #define NUM_VERTICES 36
+//! The most views drawn in one pass, see camera.h.
+#define MAX_VIEWS 4
 
 //! GLEW The OpenGL library manager
 #define GLEW_STATIC
@@ -36,6 +38,10 @@
 #include <gtc/matrix_access.hpp> 
 #include <gtx/euler_angles.hpp>
 
+//! EGL for rendering without a window.
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
 //! ClanLib
 #include <ClanLib/core.h>
 #include <ClanLib/application.h>
@@ -49,14 +55,46 @@
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include <iomanip>
 #include <exception>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <climits>
+#include <cfloat>
+#include <cmath>
 #include <chrono>
 #include <random>
 #include <vector>
+#include <map>
+#include <unordered_map>
 #include <algorithm>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
+#include <ctime>
+#include <cstdarg>
+#include <new>
+
+//! POSIX file mapping
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//! POSIX processes, for the tile workers
+#include <sys/wait.h>
+#include <signal.h>
+
+//! POSIX sockets, for the metrics server
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
 
 //! Boost
 #include <filesystem.hpp>
@@ -68,6 +106,9 @@ using namespace boost::filesystem;
 //! Structures to manage the location and data associated
 //! with each object.
 struct PosOrient{
+    //! The cube's place in the order it was made in, which
+    //! the sorting by distance does not keep.
+    int id;
     vec3 locon;
     double dist;
     float index[6];
@@ -90,4 +131,48 @@ struct Lights {
     vec4 lightColor;
 };    
 
+//! How long a part of the startup took.
+struct StartupPhase {
+    const char *name;
+    double seconds;
+};
+
+//! The values that change from frame to frame, handed
+//! to the RenderCore class to draw one frame.
+struct FrameParams {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+    float degrees;
+    bool foggy;
+    float minfog;
+    float maxfog;
+    bool shLighting;
+    bool skybox;
+    bool reflection;
+    bool depthPrepass;
+    //! Whether the cubes drift, and the simulated time of
+    //! the frame in seconds, see cubedrift.h.
+    bool drift;
+    double seconds;
+    //! Draw only the cubes in view, see cubebvh.h.
+    bool cull;
+    /** The views drawn side by side in one pass, see
+     * Camera::GetViews.  With more than one, view,
+     * projection and viewPos are the camera between them,
+     * which the cubes are sorted from.
+     */
+    int viewCount;
+    mat4 views[MAX_VIEWS];
+    mat4 projections[MAX_VIEWS];
+    vec3 viewPositions[MAX_VIEWS];
+    //! The resolution and quality, see qualitygovernor.h.
+    float renderScale;
+    int lightCount;
+    float textureLod;
+    float fogScale;
+    //! Show the performance display, see hud.h.
+    bool hud;
+};
+
 #endif //! COMMONHEADER_H
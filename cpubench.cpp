@@ -0,0 +1,285 @@
+/*******************************************************************
+ * cpubench:  Times the per frame and start up CPU work of the
+ * cloud of cubes on its own, without a window or an OpenGL
+ * context, at several instance counts and image sizes.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "commonheader.h"
+#include "cubecloud.h"
+#include "randomstream.h"
+#include "createimage.h"
+#include "meshimport.h"
+#include "microbench.h"
+
+//! One generated cloud for each instance count, made on first use.
+static map<long, CubeCloud*> clouds;
+
+static CubeCloud *getCloud(long count)
+{
+    if (clouds.find(count) == clouds.end())
+    {
+        CubeCloud *cloud = new CubeCloud((int) count);
+        cloud->seed(1);
+        cloud->permLoc();
+        clouds[count] = cloud;
+    }
+    return clouds[count];
+}
+
+//! A sphere of rings by twice as many segments, its
+//! triangles shuffled as a careless exporter might leave
+//! them.
+static void makeSphere(MeshImport &mesh, int rings)
+{
+    int segments = rings * 2;
+    float pi = (float) acos(-1);
+    mesh.vertices.clear();
+    mesh.indices.clear();
+    for (int ring = 0; ring <= rings; ring++)
+    {
+        for (int segment = 0; segment <= segments; segment++)
+        {
+            float theta = pi * (float) ring / (float) rings;
+            float phi = 2.0f * pi * (float) segment / (float) segments;
+            MeshImport::Vertex vertex;
+            memset(&vertex, 0, sizeof(vertex));
+            vertex.position[0] = sin(theta) * cos(phi);
+            vertex.position[1] = cos(theta);
+            vertex.position[2] = sin(theta) * sin(phi);
+            mesh.vertices.push_back(vertex);
+        }
+    }
+    for (int ring = 0; ring < rings; ring++)
+    {
+        for (int segment = 0; segment < segments; segment++)
+        {
+            uint32_t a = (uint32_t) (ring * (segments + 1) + segment);
+            uint32_t b = a + (uint32_t) segments + 1;
+            mesh.indices.insert(mesh.indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+        }
+    }
+    RandomStream random(1, 0);
+    for (size_t x = mesh.indices.size() / 3; x > 1; x--)
+    {
+        size_t other = random.below((unsigned int) x);
+        for (int corner = 0; corner < 3; corner++)
+        {
+            swap(mesh.indices[(x - 1) * 3 + corner], mesh.indices[other * 3 + corner]);
+        }
+    }
+    mesh.hasNormals = false;
+    mesh.hasTexCoords = false;
+}
+
+int main(int argc, char **argv)
+{
+    MicroBench bench;
+    vector<long> sortCounts = { 480, 4800, 48000 };
+    vector<long> placeCounts = { 480, 4800, 48000 };
+    vector<long> fillCounts = { 256, 4096 };
+    vector<long> driftCounts = { 4800, 48000, 100000 };
+    vector<long> imageSizes = { 256, 512, 1024, 2048 };
+    vector<long> meshRings = { 16, 64, 256 };
+
+    bench.add("uniform", { 1 }, [](BenchState &state)
+    {
+        RandomStream random(1, (uint64_t) state.arg);
+        volatile float sink = 0.0f;
+        state.startTimer();
+        for (long x = 0; x < state.iterations; x++)
+        {
+            sink = random.uniform(-25.0f, 25.0f);
+        }
+        state.stopTimer();
+        //! Read once, so the stores are not for nothing.
+        (void) sink;
+        state.setItems((double) state.iterations);
+    });
+
+    bench.add("fillUniform", fillCounts, [](BenchState &state)
+    {
+        vector<float> values(state.arg);
+        state.startTimer();
+        for (long x = 0; x < state.iterations; x++)
+        {
+            RandomStream::fillUniform(&values[0], values.size(), 1, 0, (uint64_t) x, -25.0f, 25.0f);
+        }
+        state.stopTimer();
+        state.setItems((double) state.iterations * (double) state.arg);
+    });
+
+    bench.add("permLoc", placeCounts, [](BenchState &state)
+    {
+        CubeCloud *cloud = getCloud(state.arg);
+        state.startTimer();
+        for (long x = 0; x < state.iterations; x++)
+        {
+            cloud->seed(1);
+            cloud->permLoc();
+        }
+        state.stopTimer();
+        state.setItems((double) state.iterations * (double) state.arg);
+    });
+
+    bench.add("loadScene", placeCounts, [](BenchState &state)
+    {
+        //! Save a generated cloud once, then time reading it.
+        stringstream name;
+        name << temp_directory_path().string() << "/sidefogcube-bench-" << state.arg << ".scene";
+        CubeCloud *cloud = getCloud(state.arg);
+        cloud->saveScene(name.str());
+        CubeCloud loaded((int) state.arg);
+        state.startTimer();
+        for (long x = 0; x < state.iterations; x++)
+        {
+            loaded.loadScene(name.str());
+        }
+        state.stopTimer();
+        state.setItems((double) state.iterations * (double) state.arg);
+        remove(name.str());
+    });
+
+    bench.add("sortDists", sortCounts, [](BenchState &state)
+    {
+        CubeCloud *cloud = getCloud(state.arg);
+        //! Walk the camera around the cloud so every
+        //! iteration sorts a different order.
+        state.startTimer();
+        for (long x = 0; x < state.iterations; x++)
+        {
+            float angle = (float) (x % 360) * (float) acos(-1) / 180.0f;
+            vec3 viewPos = vec3(sin(angle) * 40.0f, 0.0f, cos(angle) * 40.0f - 15.0f);
+            cloud->sortDists(viewPos, (int) (x % 360));
+        }
+        state.stopTimer();
+        state.setItems((double) state.iterations * (double) state.arg);
+    });
+
+    //! The same without the sort, as for the weighted
+    //! blended transparency.
+    bench.add("packDists", sortCounts, [](BenchState &state)
+    {
+        CubeCloud *cloud = getCloud(state.arg);
+        state.startTimer();
+        for (long x = 0; x < state.iterations; x++)
+        {
+            float angle = (float) (x % 360) * (float) acos(-1) / 180.0f;
+            vec3 viewPos = vec3(sin(angle) * 40.0f, 0.0f, cos(angle) * 40.0f - 15.0f);
+            cloud->sortDists(viewPos, (int) (x % 360), false);
+        }
+        state.stopTimer();
+        state.setItems((double) state.iterations * (double) state.arg);
+    });
+
+    bench.add("cull", sortCounts, [](BenchState &state)
+    {
+        CubeCloud *cloud = getCloud(state.arg);
+        //! Walk the camera around the cloud, looking at the
+        //! middle, with the fog at the default distance.
+        mat4 projection = perspective(radians(45.0f), 1.25f, 0.1f, 100.0f);
+        state.startTimer();
+        for (long x = 0; x < state.iterations; x++)
+        {
+            float angle = (float) (x % 360) * (float) acos(-1) / 180.0f;
+            vec3 viewPos = vec3(sin(angle) * 40.0f, 0.0f, cos(angle) * 40.0f - 15.0f);
+            mat4 view = lookAt(viewPos, vec3(0.0f, 0.0f, -15.0f), vec3(0.0f, 1.0f, 0.0f));
+            cloud->cull(projection * view, viewPos, 25.0f);
+        }
+        state.stopTimer();
+        state.setItems((double) state.iterations * (double) state.arg);
+    });
+
+    bench.add("pick", sortCounts, [](BenchState &state)
+    {
+        CubeCloud *cloud = getCloud(state.arg);
+        //! Rays from around the cloud through its middle.
+        state.startTimer();
+        for (long x = 0; x < state.iterations; x++)
+        {
+            float angle = (float) (x % 360) * (float) acos(-1) / 180.0f;
+            vec3 viewPos = vec3(sin(angle) * 40.0f, 0.0f, cos(angle) * 40.0f - 15.0f);
+            float distance;
+            cloud->pick(viewPos, normalize(vec3(0.0f, 0.0f, -15.0f) - viewPos), (float) (x % 360), distance);
+        }
+        state.stopTimer();
+        state.setItems((double) state.iterations);
+    });
+
+    bench.add("genMatrices", { 1 }, [](BenchState &state)
+    {
+        CubeCloud *cloud = getCloud(NUM_IMAGES * NUM_INSTANCES);
+        state.startTimer();
+        for (long x = 0; x < state.iterations; x++)
+        {
+            cloud->genMatrices();
+        }
+        state.stopTimer();
+        state.setItems((double) state.iterations * NUM_VERTICES);
+    });
+
+    bench.add("driftStep", driftCounts, [](BenchState &state)
+    {
+        CubeCloud *cloud = getCloud(state.arg);
+        //! One step each iteration, on every processor.
+        cloud->advanceDrift(0.0);
+        state.startTimer();
+        for (long x = 0; x < state.iterations; x++)
+        {
+            cloud->advanceDrift((double) (x + 1) * CubeDrift::STEP);
+        }
+        state.stopTimer();
+        state.setItems((double) state.iterations * (double) state.arg);
+    });
+
+    bench.add("optimizeMesh", meshRings, [](BenchState &state)
+    {
+        //! The whole import after the parse, on a copy of
+        //! the shuffled sphere each iteration.
+        MeshImport source, mesh;
+        makeSphere(source, (int) state.arg);
+        for (long x = 0; x < state.iterations; x++)
+        {
+            mesh.vertices = source.vertices;
+            mesh.indices = source.indices;
+            mesh.hasNormals = false;
+            mesh.hasTexCoords = false;
+            state.startTimer();
+            mesh.prepare();
+            mesh.optimize();
+            state.stopTimer();
+        }
+        state.setItems((double) state.iterations * (double) (source.indices.size() / 3));
+    });
+
+    CreateImage *image = new CreateImage();
+    bench.add("setImage", imageSizes, [image](BenchState &state)
+    {
+        //! A 32 bit picture with varying color and alpha.
+        fipImage picture;
+        picture.setSize(FIT_BITMAP, (unsigned) state.arg, (unsigned) state.arg, 32);
+        for (unsigned int y = 0; y < (unsigned int) state.arg; y++)
+        {
+            BYTE *line = picture.getScanLine(y);
+            for (unsigned int x = 0; x < (unsigned int) state.arg * 4; x++)
+            {
+                line[x] = (BYTE) ((x * 7 + y * 13) & 0xff);
+            }
+        }
+        state.startTimer();
+        for (long x = 0; x < state.iterations; x++)
+        {
+            image->setImage(picture);
+        }
+        state.stopTimer();
+        state.setItems((double) state.iterations * (double) (state.arg * state.arg));
+    });
+
+    int result = bench.run(argc, argv);
+    delete image;
+    for (map<long, CubeCloud*>::iterator item = clouds.begin(); item != clouds.end(); item++)
+    {
+        delete item->second;
+    }
+    return result;
+}
@@ -11,48 +11,55 @@
 
 CreateImage::CreateImage()
 {
-    cout << "\n\n\tCreating CreateImage.\n\n";
+    LOG_DEBUG(STARTUP, "Creating CreateImage.");
 }
 
 CreateImage::~CreateImage()
 {
-    cout << "\n\n\tDestroying CreateImage.\n\n";
+    LOG_DEBUG(STARTUP, "Destroying CreateImage.");
     delete pixels;
 }
 
 void CreateImage::setImage(string(imagefile))
 {
+    TRACE_SCOPE_DETAIL("setImage", imagefile.c_str());
     //! all the image files are required to be in an
     //! images directory.
     imagefile = "/usr/share/openglresources/images/" + imagefile;
     try
     {
-        //!! Delete the item if it exists.
-        if (pixels)
-        {
-            delete(pixels);
-        }
         //!! Free Image Plus Image loads any standard picture.
         if (!txtImage.load(imagefile.c_str()))
         {
-            cout << "\n\n\tImage file " << imagefile << " failed to load in createimage.\n";
+            LOG_ERROR(FILE, "Image file {} failed to load in createimage.", imagefile);
             exit(0);
         }
         else
         {
-            cout << "\n\n\tImage file " << imagefile << " successfully loaded.\n\n";
+            LOG_INFO(FILE, "Image file {} successfully loaded.", imagefile);
         }
     }
     catch (exception exc)
     {
-        cout << "\n\n\tError loading file " << imagefile << " : " << exc.what() << "\n\n";
+        LOG_ERROR(FILE, "Error loading file {} : {}", imagefile, exc.what());
+    }
+    setImage(txtImage);
+}
+
+void CreateImage::setImage(fipImage &picture)
+{
+    //!! Delete the item if it exists.
+    if (pixels)
+    {
+        delete(pixels);
+        pixels = NULL;
     }
     size = 0;
     int counter = 0;
     //!! Convert image to four 8 bit fields RGBA.
-    txtImage.convertTo32Bits();
-    width = (GLsizei) txtImage.getWidth();
-    height = (GLsizei) txtImage.getHeight();
+    picture.convertTo32Bits();
+    width = (GLsizei) picture.getWidth();
+    height = (GLsizei) picture.getHeight();
     size = width * height * 4;
     line = width * 4;
     ivec4 test;
@@ -60,7 +67,7 @@ void CreateImage::setImage(string(imagefile))
     pixels = new unsigned char[size];
     for (unsigned int y = 0; y < height; y++)
     {
-        picLine = txtImage.getScanLine(y);
+        picLine = picture.getScanLine(y);
         for (unsigned int x = 0; x < line; x += 4)
         {
             if (counter > size)
@@ -85,6 +92,20 @@ void CreateImage::setImage(string(imagefile))
     }
 }
 
+bool CreateImage::imageSize(string imagefile, GLsizei &width, GLsizei &height)
+{
+    imagefile = "/usr/share/openglresources/images/" + imagefile;
+    fipImage header;
+    if (!header.load(imagefile.c_str(), FIF_LOAD_NOPIXELS))
+    {
+        LOG_ERROR(FILE, "Image file {} failed to load in createimage.", imagefile);
+        return false;
+    }
+    width = (GLsizei) header.getWidth();
+    height = (GLsizei) header.getHeight();
+    return true;
+}
+
 //!! Accessor functions to pass along the data.
 GLsizei CreateImage::getWidth()
 {
@@ -114,6 +135,7 @@ GLuint CreateImage::textureObject()
     glBindTexture(GL_TEXTURE_2D, textureID);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
     glGenerateMipmap(GL_TEXTURE_2D);    
+    textureBytes += (size_t) width * height * 4 * 4 / 3;
     //! Parameters
     glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );
     glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
@@ -125,6 +147,7 @@ GLuint CreateImage::textureObject()
 
 void CreateImage::createSkyBoxTex(GLuint &textureID, string filenames[6])
 {
+    TRACE_SCOPE("createSkyBoxTex");
     //! Loads a cubemap texture from 6 individual texture faces
     //! Order should be:
     //! +X (right)
@@ -145,6 +168,7 @@ void CreateImage::createSkyBoxTex(GLuint &textureID, string filenames[6])
         height = getHeight();
         pixel_data = getData();
         glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixel_data);
+        textureBytes += (size_t) width * height * 4 * 4 / 3;
     }
     glGenerateMipmap(GL_TEXTURE_CUBE_MAP);    
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -158,6 +182,7 @@ void CreateImage::createSkyBoxTex(GLuint &textureID, string filenames[6])
 }
 void CreateImage::create2DTexArray(GLuint &textureID, string filenames[16])
 {
+    TRACE_SCOPE("create2DTexArray");
     /** Loads a texture array that can be up to 256 pictures
      * in size.  The pictures should be of the same type.
      * and the same dimensions (pixel width and pixel height).
@@ -188,6 +213,7 @@ void CreateImage::create2DTexArray(GLuint &textureID, string filenames[16])
     }
     glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, width, height, 16, 0, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*) pixel_data);
     glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    textureBytes += (size_t) width * height * 4 * 16 * 4 / 3;
     glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -197,3 +223,8 @@ void CreateImage::create2DTexArray(GLuint &textureID, string filenames[16])
     
     return;
 }
+
+size_t CreateImage::getTextureBytes()
+{
+    return textureBytes;
+}
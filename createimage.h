@@ -11,6 +11,8 @@
 #ifndef CREATEIMAGE_H
 #define CREATEIMAGE_H
 #include "commonheader.h"
+#include "logger.h"
+#include "tracer.h"
 
 using namespace std;
 
@@ -37,6 +39,18 @@ public:
      */
     void setImage(string imagefile);
     
+    /** \brief setImage
+     *  Convert an image that is already in memory.
+     */
+    void setImage(fipImage &picture);
+    
+    /** \brief imageSize
+     *  Reads the size of an image in the images directory
+     *  from its header, without the pixels.  Returns false
+     *  if it cannot be read.
+     */
+    bool imageSize(string imagefile, GLsizei &width, GLsizei &height);
+
     /** \brief getWidth
      * Accessor function.
      */
@@ -68,6 +82,12 @@ public:
      * to a maximum picture array size of 256.
      */
     void create2DTexArray(GLuint &textureID, string filenames[16]);
+
+    /** \brief getTextureBytes
+     * The memory of the textures made so far, the mipmaps
+     * counted as a third more.
+     */
+    size_t getTextureBytes();
 protected:
     //! Class global variables.
     fipImage txtImage;
@@ -77,5 +97,7 @@ protected:
     int size = 0;
     unsigned char *pixels = NULL;
     int count, line;
+    //! What the textures made take on the GPU.
+    size_t textureBytes = 0;
 };
 #endif // CreateImage.h
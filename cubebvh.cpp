@@ -0,0 +1,483 @@
+/*******************************************************************
+ * CubeBvh:  A class to hold a bounding volume hierarchy over
+ * the cloud of cubes, four boxes to a node, for culling the
+ * cubes that cannot be seen and finding the cube under the
+ * mouse.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "cubebvh.h"
+
+CubeBvh::CubeBvh()
+{
+    radius = 0.0f;
+    builtArea = 0.0;
+    fogDistance = FLT_MAX;
+    visited = 0;
+}
+
+CubeBvh::~CubeBvh()
+{
+}
+
+void CubeBvh::build(const vector<vec3> &centers, float radius)
+{
+    this->radius = radius;
+    points = centers;
+    prims.resize(points.size());
+    for (unsigned int x = 0; x < prims.size(); x++)
+    {
+        prims[x] = x;
+    }
+    nodes.clear();
+    if (!prims.empty())
+    {
+        buildNode(0, (int) prims.size());
+    }
+    builtArea = fitNodes();
+    //! No walk holds more nodes than there are, so the
+    //! walks never grow their stacks frame to frame.
+    stack.reserve(nodes.size());
+    rayStack.reserve(nodes.size());
+}
+
+bool CubeBvh::refit(const vector<vec3> &centers)
+{
+    points = centers;
+    return fitNodes() <= builtArea * REBUILD_GROWTH;
+}
+
+int CubeBvh::buildNode(int first, int last)
+{
+    int index = (int) nodes.size();
+    nodes.push_back(Node());
+    //! Split the largest run until there are four or
+    //! every run fits in a leaf.
+    int begin[4], end[4];
+    int used = 1;
+    begin[0] = first;
+    end[0] = last;
+    while (used < 4)
+    {
+        int largest = -1;
+        for (int k = 0; k < used; k++)
+        {
+            if ((end[k] - begin[k] > LEAF_SIZE)
+            && ((largest < 0) || (end[k] - begin[k] > end[largest] - begin[largest])))
+            {
+                largest = k;
+            }
+        }
+        if (largest < 0)
+        {
+            break;
+        }
+        int middle = split(begin[largest], end[largest]);
+        begin[used] = middle;
+        end[used] = end[largest];
+        end[largest] = middle;
+        used++;
+    }
+    for (int k = 0; k < 4; k++)
+    {
+        int child = CHILD_EMPTY;
+        if (k < used)
+        {
+            child = (end[k] - begin[k] <= LEAF_SIZE) ? (int) CHILD_LEAF : buildNode(begin[k], end[k]);
+        }
+        //! The recursion may have moved the nodes.
+        Node &node = nodes[index];
+        node.child[k] = child;
+        node.first[k] = (k < used) ? begin[k] : 0;
+        node.last[k] = (k < used) ? end[k] : 0;
+    }
+    return index;
+}
+
+int CubeBvh::split(int first, int last)
+{
+    //! Bin the centers along the longest side of their box.
+    vec3 low = points[prims[first]], high = low;
+    for (int x = first + 1; x < last; x++)
+    {
+        low = glm::min(low, points[prims[x]]);
+        high = glm::max(high, points[prims[x]]);
+    }
+    vec3 size = high - low;
+    int axis = ((size.x >= size.y) && (size.x >= size.z)) ? 0 : ((size.y >= size.z) ? 1 : 2);
+    if (size[axis] <= 0.0f)
+    {
+        return (first + last) / 2;
+    }
+    float scale = (float) BINS / size[axis];
+    int counts[BINS];
+    vec3 binLow[BINS], binHigh[BINS];
+    for (int b = 0; b < BINS; b++)
+    {
+        counts[b] = 0;
+        binLow[b] = vec3(FLT_MAX);
+        binHigh[b] = vec3(-FLT_MAX);
+    }
+    for (int x = first; x < last; x++)
+    {
+        vec3 point = points[prims[x]];
+        int b = std::min(BINS - 1, (int) ((point[axis] - low[axis]) * scale));
+        counts[b]++;
+        binLow[b] = glm::min(binLow[b], point);
+        binHigh[b] = glm::max(binHigh[b], point);
+    }
+    //! The surface area of the boxes on each side of each
+    //! plane between bins, times the cubes on that side.
+    auto area = [this](vec3 low, vec3 high)
+    {
+        vec3 side = high - low + vec3(2.0f * radius);
+        return side.x * side.y + side.y * side.z + side.z * side.x;
+    };
+    float rightCost[BINS];
+    vec3 sideLow(FLT_MAX), sideHigh(-FLT_MAX);
+    int sideCount = 0;
+    for (int b = BINS - 1; b > 0; b--)
+    {
+        sideCount += counts[b];
+        sideLow = glm::min(sideLow, binLow[b]);
+        sideHigh = glm::max(sideHigh, binHigh[b]);
+        rightCost[b] = (sideCount > 0) ? area(sideLow, sideHigh) * sideCount : 0.0f;
+    }
+    float bestCost = FLT_MAX;
+    int bestBin = 1;
+    sideLow = vec3(FLT_MAX);
+    sideHigh = vec3(-FLT_MAX);
+    sideCount = 0;
+    for (int b = 1; b < BINS; b++)
+    {
+        sideCount += counts[b - 1];
+        sideLow = glm::min(sideLow, binLow[b - 1]);
+        sideHigh = glm::max(sideHigh, binHigh[b - 1]);
+        if ((sideCount == 0) || (sideCount == last - first))
+        {
+            continue;
+        }
+        float cost = area(sideLow, sideHigh) * sideCount + rightCost[b];
+        if (cost < bestCost)
+        {
+            bestCost = cost;
+            bestBin = b;
+        }
+    }
+    int *middle = std::partition(&prims[first], &prims[first] + (last - first), [&](int prim)
+    {
+        return std::min(BINS - 1, (int) ((points[prim][axis] - low[axis]) * scale)) < bestBin;
+    });
+    return (int) (middle - &prims[0]);
+}
+
+double CubeBvh::fitNodes()
+{
+    //! Every node comes after its parent, so going
+    //! backwards sets the children first.
+    double total = 0.0;
+    for (int n = (int) nodes.size() - 1; n >= 0; n--)
+    {
+        Node &node = nodes[n];
+        for (int k = 0; k < 4; k++)
+        {
+            vec3 low(FLT_MAX), high(-FLT_MAX);
+            if (node.child[k] == CHILD_LEAF)
+            {
+                for (int x = node.first[k]; x < node.last[k]; x++)
+                {
+                    low = glm::min(low, points[prims[x]]);
+                    high = glm::max(high, points[prims[x]]);
+                }
+                low -= vec3(radius);
+                high += vec3(radius);
+            }
+            else if (node.child[k] >= 0)
+            {
+                const Node &below = nodes[node.child[k]];
+                for (int j = 0; j < 4; j++)
+                {
+                    low = glm::min(low, vec3(below.minX[j], below.minY[j], below.minZ[j]));
+                    high = glm::max(high, vec3(below.maxX[j], below.maxY[j], below.maxZ[j]));
+                }
+            }
+            node.minX[k] = low.x;
+            node.minY[k] = low.y;
+            node.minZ[k] = low.z;
+            node.maxX[k] = high.x;
+            node.maxY[k] = high.y;
+            node.maxZ[k] = high.z;
+            if (node.child[k] != CHILD_EMPTY)
+            {
+                vec3 side = high - low;
+                total += side.x * side.y + side.y * side.z + side.z * side.x;
+            }
+        }
+    }
+    return total;
+}
+
+void CubeBvh::cull(const mat4 &viewProjection, vec3 eye, float fogDistance, vector<uint8_t> &visible,
+bool merge)
+{
+    if (!merge)
+    {
+        visible.assign(points.size(), 0);
+        visited = 0;
+    }
+    if (nodes.empty())
+    {
+        return;
+    }
+    //! The planes of the frustum from the rows of the
+    //! matrix, pointing in and scaled to unit normals.
+    vec4 rows[4];
+    for (int r = 0; r < 4; r++)
+    {
+        rows[r] = vec4(viewProjection[0][r], viewProjection[1][r],
+        viewProjection[2][r], viewProjection[3][r]);
+    }
+    for (int p = 0; p < 6; p++)
+    {
+        planes[p] = (p & 1) ? rows[3] - rows[p / 2] : rows[3] + rows[p / 2];
+        planes[p] /= length(vec3(planes[p]));
+    }
+    this->eye = eye;
+    this->fogDistance = fogDistance;
+    stack.clear();
+    stack.push_back(0);
+    while (!stack.empty())
+    {
+        const Node &node = nodes[stack.back()];
+        stack.pop_back();
+        visited++;
+        int inside = 0;
+        int keep = cullChildren(node, inside);
+        for (int k = 0; k < 4; k++)
+        {
+            if ((node.child[k] == CHILD_EMPTY) || !(keep & (1 << k)))
+            {
+                continue;
+            }
+            if (inside & (1 << k))
+            {
+                for (int x = node.first[k]; x < node.last[k]; x++)
+                {
+                    visible[prims[x]] = 1;
+                }
+            }
+            else if (node.child[k] >= 0)
+            {
+                stack.push_back(node.child[k]);
+            }
+            else
+            {
+                //! The leaf's own spheres, the fog by the center
+                //! as the shaders measure it.
+                for (int x = node.first[k]; x < node.last[k]; x++)
+                {
+                    vec3 center = points[prims[x]];
+                    bool seen = (distance(center, eye) < fogDistance);
+                    for (int p = 0; (p < 6) && seen; p++)
+                    {
+                        seen = (dot(vec3(planes[p]), center) + planes[p].w >= -radius);
+                    }
+                    //! Merged, a cube another view saw stays seen.
+                    if (seen)
+                    {
+                        visible[prims[x]] = 1;
+                    }
+                }
+            }
+        }
+    }
+}
+
+int CubeBvh::cullChildren(const Node &node, int &inside)
+{
+#ifdef __SSE2__
+    const __m128 minX = _mm_load_ps(node.minX), maxX = _mm_load_ps(node.maxX);
+    const __m128 minY = _mm_load_ps(node.minY), maxY = _mm_load_ps(node.maxY);
+    const __m128 minZ = _mm_load_ps(node.minZ), maxZ = _mm_load_ps(node.maxZ);
+    const __m128 zero = _mm_setzero_ps();
+    __m128 out = zero, in = _mm_cmpeq_ps(zero, zero);
+    for (int p = 0; p < 6; p++)
+    {
+        //! The corner furthest along the normal decides if
+        //! a box is out, the nearest if it is in.
+        vec4 plane = planes[p];
+        __m128 far = _mm_set1_ps(plane.w), near = far;
+        __m128 nx = _mm_set1_ps(plane.x), ny = _mm_set1_ps(plane.y), nz = _mm_set1_ps(plane.z);
+        far = _mm_add_ps(far, _mm_mul_ps(nx, (plane.x >= 0.0f) ? maxX : minX));
+        far = _mm_add_ps(far, _mm_mul_ps(ny, (plane.y >= 0.0f) ? maxY : minY));
+        far = _mm_add_ps(far, _mm_mul_ps(nz, (plane.z >= 0.0f) ? maxZ : minZ));
+        near = _mm_add_ps(near, _mm_mul_ps(nx, (plane.x >= 0.0f) ? minX : maxX));
+        near = _mm_add_ps(near, _mm_mul_ps(ny, (plane.y >= 0.0f) ? minY : maxY));
+        near = _mm_add_ps(near, _mm_mul_ps(nz, (plane.z >= 0.0f) ? minZ : maxZ));
+        out = _mm_or_ps(out, _mm_cmplt_ps(far, zero));
+        in = _mm_and_ps(in, _mm_cmpge_ps(near, zero));
+    }
+    //! The nearest and furthest points of each box from
+    //! the eye against the fog.
+    const __m128 fog2 = _mm_set1_ps(fogDistance * fogDistance);
+    __m128 nearest = zero, furthest = zero;
+    const __m128 mins[3] = { minX, minY, minZ };
+    const __m128 maxs[3] = { maxX, maxY, maxZ };
+    for (int a = 0; a < 3; a++)
+    {
+        __m128 e = _mm_set1_ps(eye[a]);
+        __m128 below = _mm_sub_ps(mins[a], e);
+        __m128 above = _mm_sub_ps(e, maxs[a]);
+        __m128 gap = _mm_max_ps(zero, _mm_max_ps(below, above));
+        __m128 reach = _mm_max_ps(_mm_sub_ps(e, mins[a]), _mm_sub_ps(maxs[a], e));
+        nearest = _mm_add_ps(nearest, _mm_mul_ps(gap, gap));
+        furthest = _mm_add_ps(furthest, _mm_mul_ps(reach, reach));
+    }
+    out = _mm_or_ps(out, _mm_cmpge_ps(nearest, fog2));
+    in = _mm_and_ps(in, _mm_cmplt_ps(furthest, fog2));
+    int outside = _mm_movemask_ps(out);
+    inside = _mm_movemask_ps(in) & ~outside;
+    return ~outside & 15;
+#else
+    int outside = 0;
+    inside = 0;
+    float fog2 = fogDistance * fogDistance;
+    for (int k = 0; k < 4; k++)
+    {
+        vec3 low(node.minX[k], node.minY[k], node.minZ[k]);
+        vec3 high(node.maxX[k], node.maxY[k], node.maxZ[k]);
+        bool out = false, in = true;
+        for (int p = 0; p < 6; p++)
+        {
+            vec3 normal = vec3(planes[p]);
+            vec3 far = mix(low, high, vec3(greaterThanEqual(normal, vec3(0.0f))));
+            vec3 near = low + high - far;
+            out = out || (dot(normal, far) + planes[p].w < 0.0f);
+            in = in && (dot(normal, near) + planes[p].w >= 0.0f);
+        }
+        vec3 gap = glm::max(vec3(0.0f), glm::max(low - eye, eye - high));
+        vec3 reach = glm::max(eye - low, high - eye);
+        out = out || (dot(gap, gap) >= fog2);
+        in = in && (dot(reach, reach) < fog2);
+        outside |= out ? (1 << k) : 0;
+        inside |= (in && !out) ? (1 << k) : 0;
+    }
+    return ~outside & 15;
+#endif
+}
+
+int CubeBvh::raycast(vec3 origin, vec3 direction, const function<float(int)> &hit, float &distance)
+{
+    distance = FLT_MAX;
+    int nearest = -1;
+    if (nodes.empty())
+    {
+        return nearest;
+    }
+    //! A flat direction would make the slabs divide by zero.
+    vec3 inverse;
+    for (int a = 0; a < 3; a++)
+    {
+        float d = (fabs(direction[a]) > 1.0e-20f) ? direction[a] : copysign(1.0e-20f, direction[a]);
+        inverse[a] = 1.0f / d;
+    }
+    rayStack.clear();
+    rayStack.push_back({ 0, 0.0f });
+    while (!rayStack.empty())
+    {
+        Entry entry = rayStack.back();
+        rayStack.pop_back();
+        if (entry.near >= distance)
+        {
+            continue;
+        }
+        const Node &node = nodes[entry.node];
+        float near[4];
+        int hits = rayChildren(node, origin, inverse, distance, near);
+        //! Nearest first:  the leaves are tested now, and
+        //! the nodes pushed so the nearest comes off first.
+        int order[4];
+        int found = 0;
+        for (int k = 0; k < 4; k++)
+        {
+            if ((hits & (1 << k)) && (node.child[k] != CHILD_EMPTY))
+            {
+                int j = found++;
+                for (; (j > 0) && (near[order[j - 1]] > near[k]); j--)
+                {
+                    order[j] = order[j - 1];
+                }
+                order[j] = k;
+            }
+        }
+        for (int j = 0; j < found; j++)
+        {
+            int k = order[j];
+            if ((node.child[k] != CHILD_LEAF) || (near[k] >= distance))
+            {
+                continue;
+            }
+            for (int x = node.first[k]; x < node.last[k]; x++)
+            {
+                float along = hit(prims[x]);
+                if (along < distance)
+                {
+                    distance = along;
+                    nearest = prims[x];
+                }
+            }
+        }
+        for (int j = found - 1; j >= 0; j--)
+        {
+            int k = order[j];
+            if ((node.child[k] >= 0) && (near[k] < distance))
+            {
+                rayStack.push_back({ node.child[k], near[k] });
+            }
+        }
+    }
+    return nearest;
+}
+
+int CubeBvh::rayChildren(const Node &node, vec3 origin, vec3 inverse, float limit, float near[4])
+{
+#ifdef __SSE2__
+    __m128 enter = _mm_setzero_ps();
+    __m128 leave = _mm_set1_ps(limit);
+    const float *mins[3] = { node.minX, node.minY, node.minZ };
+    const float *maxs[3] = { node.maxX, node.maxY, node.maxZ };
+    for (int a = 0; a < 3; a++)
+    {
+        __m128 o = _mm_set1_ps(origin[a]);
+        __m128 inv = _mm_set1_ps(inverse[a]);
+        __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(mins[a]), o), inv);
+        __m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(maxs[a]), o), inv);
+        enter = _mm_max_ps(enter, _mm_min_ps(t1, t2));
+        leave = _mm_min_ps(leave, _mm_max_ps(t1, t2));
+    }
+    _mm_storeu_ps(near, enter);
+    return _mm_movemask_ps(_mm_cmple_ps(enter, leave));
+#else
+    int hits = 0;
+    for (int k = 0; k < 4; k++)
+    {
+        vec3 t1 = (vec3(node.minX[k], node.minY[k], node.minZ[k]) - origin) * inverse;
+        vec3 t2 = (vec3(node.maxX[k], node.maxY[k], node.maxZ[k]) - origin) * inverse;
+        vec3 low = glm::min(t1, t2), high = glm::max(t1, t2);
+        near[k] = std::max(0.0f, std::max(low.x, std::max(low.y, low.z)));
+        float far = std::min(limit, std::min(high.x, std::min(high.y, high.z)));
+        hits |= (near[k] <= far) ? (1 << k) : 0;
+    }
+    return hits;
+#endif
+}
+
+int CubeBvh::getNodes()
+{
+    return (int) nodes.size();
+}
+
+int CubeBvh::getVisited()
+{
+    return visited;
+}
@@ -0,0 +1,160 @@
+/*******************************************************************
+ * CubeBvh:  A class to hold a bounding volume hierarchy over
+ * the cloud of cubes, four boxes to a node, for culling the
+ * cubes that cannot be seen and finding the cube under the
+ * mouse.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef CUBEBVH_H
+#define CUBEBVH_H
+
+#include "commonheader.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/** \class CubeBvh
+ * Each cube is bounded by the sphere its corners turn in,
+ * so the spin never changes the bounds and only a move
+ * does.  The tree is built top down with a binned surface
+ * area heuristic, splitting each node up to four ways.  A
+ * node keeps the boxes of its four children one array to
+ * an axis, so one node is tested against the view frustum
+ * or a ray with four wide SSE math.
+ *
+ * The cubes under a node are one run of the primitive
+ * array, so a node wholly in view adds its cubes without
+ * testing them.  When the cubes move the boxes are refit
+ * from the leaves up without changing the tree, and the
+ * caller rebuilds it once it has grown too loose.
+ */
+class CubeBvh
+{
+public:
+    CubeBvh();
+    ~CubeBvh();
+
+    /** \brief build
+     * Builds the tree over spheres of the given radius at
+     * the centers, indexed as the centers are.
+     */
+    void build(const vector<vec3> &centers, float radius);
+
+    /** \brief refit
+     * Moves the spheres to new centers and refits the
+     * boxes.  Returns false once the boxes have grown so
+     * much that a build would pay.
+     */
+    bool refit(const vector<vec3> &centers);
+
+    /** \brief cull
+     * Marks in visible each sphere that is at least partly
+     * inside the frustum of viewProjection with its center
+     * nearer to eye than fogDistance.  With merge the marks
+     * of an earlier cull are kept, so several views add up.
+     */
+    void cull(const mat4 &viewProjection, vec3 eye, float fogDistance, vector<uint8_t> &visible,
+    bool merge = false);
+
+    /** \brief raycast
+     * Finds the nearest primitive along a ray.  The tree
+     * only gives the candidates, hit gives the distance
+     * along the ray to the primitive itself, or FLT_MAX
+     * for a miss.  Returns the index of the primitive, or
+     * -1, and its distance.
+     */
+    int raycast(vec3 origin, vec3 direction, const function<float(int)> &hit, float &distance);
+
+    /** \brief getNodes
+     * Accessor function.
+     */
+    int getNodes();
+
+    /** \brief getVisited
+     * The nodes the last cull looked in.
+     */
+    int getVisited();
+
+    //! The most primitives in a leaf, the bins the split
+    //! is chosen from, and how much the boxes may grow
+    //! before refit asks for a new build.
+    const int LEAF_SIZE = 4;
+    static const int BINS = 16;
+    constexpr static float REBUILD_GROWTH = 1.5f;
+
+protected:
+    //! Four child boxes, the node or leaf under each and
+    //! the run of primitives under each.
+    struct alignas(16) Node {
+        float minX[4], minY[4], minZ[4];
+        float maxX[4], maxY[4], maxZ[4];
+        int child[4];
+        int first[4], last[4];
+    };
+
+    //! What a child is when it is not a node.
+    enum Child_Type {
+        CHILD_LEAF = -1,
+        CHILD_EMPTY = -2
+    };
+
+    //! A node waiting in the ray traversal, with the
+    //! distance to its box.
+    struct Entry {
+        int node;
+        float near;
+    };
+
+    /** \brief buildNode
+     * Builds the node over the primitives from first up to
+     * last and the nodes under it.  Returns its index.
+     */
+    int buildNode(int first, int last);
+
+    /** \brief split
+     * Orders the primitives from first up to last by the
+     * cheapest binned split, and returns where the second
+     * half starts.
+     */
+    int split(int first, int last);
+
+    /** \brief fitNodes
+     * Sets every box from the leaves up, and returns the
+     * total area of the boxes.
+     */
+    double fitNodes();
+
+    /** \brief cullChildren
+     * Tests the four boxes of a node against the frustum
+     * and the fog.  Returns a bit for each box not wholly
+     * outside, and sets a bit in inside for each box wholly
+     * inside.
+     */
+    int cullChildren(const Node &node, int &inside);
+
+    /** \brief rayChildren
+     * Tests the four boxes of a node against the ray up
+     * to limit.  Returns a bit for each box hit, and where
+     * the ray enters it in near.
+     */
+    int rayChildren(const Node &node, vec3 origin, vec3 inverse, float limit, float near[4]);
+
+    vector<Node> nodes;
+    //! The primitives in the order of the leaves, and the
+    //! center of each by its own index.
+    vector<int> prims;
+    vector<vec3> points;
+    float radius;
+    //! The area of the boxes when built.
+    double builtArea;
+    //! The frustum planes and the fog of the cull under way.
+    vec4 planes[6];
+    vec3 eye;
+    float fogDistance;
+    int visited;
+    vector<int> stack;
+    vector<Entry> rayStack;
+};
+
+#endif // CUBEBVH_H
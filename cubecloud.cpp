@@ -0,0 +1,779 @@
+/*******************************************************************
+ * CubeCloud:  A class to generate and order the cloud of
+ * randomly spaced, randomly spinning cubes.  It holds only
+ * CPU side data so it can be used without an OpenGL context.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "cubecloud.h"
+
+CubeCloud::CubeCloud(int count)
+{
+    LOG_DEBUG(STARTUP, "Creating CubeCloud.");
+    randomSeed = 1;
+    threads = 0;
+    drifting = false;
+    bvhBuilt = false;
+    moved = false;
+    resize(count);
+    genMatrices();
+}
+
+CubeCloud::~CubeCloud()
+{
+    LOG_DEBUG(STARTUP, "Destroying CubeCloud.");
+}
+
+void CubeCloud::resize(int count)
+{
+    this->count = count;
+    loc.resize(count);
+    xaxis.resize(count);
+    yaxis.resize(count);
+    angles.resize(count);
+    distVals.resize(count);
+    itemData.resize(getChunks());
+    drifting = false;
+    bvhBuilt = false;
+    culled = false;
+    drawn = count;
+}
+
+int CubeCloud::getCount()
+{
+    return count;
+}
+
+int CubeCloud::getChunks()
+{
+    const int chunk = NUM_IMAGES * NUM_INSTANCES;
+    return (count + chunk - 1) / chunk;
+}
+
+vec3 CubeCloud::getPosition(int id)
+{
+    return drifting ? drift.position(id) : loc[id];
+}
+
+float CubeCloud::getRadius()
+{
+    return CUBE_RADIUS;
+}
+
+int CubeCloud::getDrawn()
+{
+    return drawn;
+}
+
+int CubeCloud::getDrawnChunks()
+{
+    const int chunk = NUM_IMAGES * NUM_INSTANCES;
+    return (drawn + chunk - 1) / chunk;
+}
+
+float CubeCloud::getExtent()
+{
+    //! Keep the density of the default cloud as the count grows.
+    const float defaultCount = (float) (NUM_IMAGES * NUM_INSTANCES);
+    return MAXLOC * std::max(1.0f, cbrt((float) count / defaultCount));
+}
+
+void CubeCloud::seed(unsigned int value)
+{
+    //! Initialize the random number generator.
+    randomSeed = value;
+}
+
+void CubeCloud::setThreads(int threads)
+{
+    this->threads = threads;
+}
+
+void CubeCloud::debug()
+{
+    cout << "\n\n\t\tVertices\n\n\n\t";
+    for (int x = 0; x < 108; x++)
+    {
+        if (((x % 3) == 0) && (x > 0))
+        {
+            cout << "\n\t";
+            if (((x % 9) == 0) && (x > 0))
+            {
+                cout << "\n\t";
+            }
+        }
+        cout << calcCube[x] << ", "; 
+    }
+    cout << "\n\n\t\tNormals\n\n\n\t";
+    for (int x = 0; x < 108; x++)
+    {
+        if (((x % 3) == 0) && (x > 0))
+        {
+            cout << "\n\t";
+            if (((x % 9) == 0) && (x > 0))
+            {
+                cout << "\n\t";
+            }
+        }
+        cout << calcNorm[x] << ", "; 
+    }
+    cout << "\n\n\tTextures\n\n\n\t";
+    for (int x = 0; x < 72; x++)
+    {
+        if (((x % 2) == 0) && (x > 0))
+        {
+            cout << "\n\t";
+            if (((x % 6) == 0) && (x > 0))
+            {
+                cout << "\n\t";
+            }
+        }
+        cout << calcTex[x] << ", ";
+    }
+    cout << "\n\n";
+}
+
+void CubeCloud::permLoc()
+{
+    TRACE_SCOPE("permLoc");
+    //! Calculate the location and indices.
+    /** Every cube draws from its own random stream, so the
+     * cloud comes out the same whatever the number of threads.
+     */
+    int workers = threads;
+    if (workers <= 0)
+    {
+        workers = std::max(1, (int) thread::hardware_concurrency());
+    }
+    int step = (count + workers - 1) / workers;
+    vector<thread> pool;
+    for (int w = 0; w < workers; w++)
+    {
+        int begin = w * step;
+        int end = std::min(count, begin + step);
+        if (begin >= end)
+        {
+            break;
+        }
+        pool.push_back(thread(&CubeCloud::permRange, this, begin, end));
+    }
+    for (unsigned int w = 0; w < pool.size(); w++)
+    {
+        pool[w].join();
+    }
+    //! Check for collisions in order and correct if necessary.
+    placeCubes();
+    for (int x = 0; x < count; x++)
+    {
+        distVals[x].locon = loc[x];
+    }
+    drifting = false;
+    bvhBuilt = false;
+}
+
+bool CubeCloud::saveScene(string path)
+{
+    SceneFile file;
+    if (!file.create(path, randomSeed, true))
+    {
+        return false;
+    }
+    //! distVals holds everything about a cube together.
+    vector<SceneFile::Record> records(std::min((size_t) count, SCENE_CHUNK));
+    for (int first = 0; first < count; first += (int) records.size())
+    {
+        int n = std::min((int) records.size(), count - first);
+        for (int k = 0; k < n; k++)
+        {
+            const PosOrient &item = distVals[first + k];
+            SceneFile::Record &record = records[k];
+            memset(&record, 0, sizeof(record));
+            for (int axis = 0; axis < 3; axis++)
+            {
+                record.position[axis] = item.locon[axis];
+                record.xaxis[axis] = item.xaxis[axis];
+                record.yaxis[axis] = item.yaxis[axis];
+            }
+            record.rate = item.angles;
+            for (int side = 0; side < 6; side++)
+            {
+                record.faces[side] = (uint8_t) item.index[side];
+            }
+        }
+        if (!file.append(&records[0], n))
+        {
+            break;
+        }
+    }
+    return file.finish();
+}
+
+bool CubeCloud::loadScene(string path)
+{
+    TRACE_SCOPE_DETAIL("loadScene", path.c_str());
+    SceneFile file;
+    if (!file.open(path))
+    {
+        return false;
+    }
+    if ((file.getCount() < 1) || (file.getCount() > (uint64_t) (INT_MAX / 2)))
+    {
+        LOG_ERROR(SCENE, "Scene file {} holds {} cubes.", path, file.getCount());
+        return false;
+    }
+    resize((int) file.getCount());
+    randomSeed = file.isSeeded() ? file.getSeed() : 0;
+    vector<SceneFile::Record> records(std::min((size_t) count, SCENE_CHUNK));
+    for (int first = 0; first < count; first += (int) records.size())
+    {
+        size_t n = file.read(first, &records[0], records.size());
+        for (size_t k = 0; k < n; k++)
+        {
+            const SceneFile::Record &record = records[k];
+            int x = first + (int) k;
+            loc[x] = vec3(record.position[0], record.position[1], record.position[2]);
+            xaxis[x] = vec3(record.xaxis[0], record.xaxis[1], record.xaxis[2]);
+            yaxis[x] = vec3(record.yaxis[0], record.yaxis[1], record.yaxis[2]);
+            angles[x] = record.rate;
+            //! Anything not finite, or an axis too short to
+            //! turn around, would draw nothing at best.
+            bool good = std::isfinite(record.rate)
+            && (dot(xaxis[x], xaxis[x]) > 1.0e-8f) && (dot(yaxis[x], yaxis[x]) > 1.0e-8f);
+            for (int axis = 0; axis < 3; axis++)
+            {
+                good = good && std::isfinite(loc[x][axis]) && std::isfinite(xaxis[x][axis])
+                && std::isfinite(yaxis[x][axis]);
+            }
+            PosOrient &item = distVals[x];
+            for (int side = 0; side < 6; side++)
+            {
+                good = good && (record.faces[side] < NUM_IMAGES);
+                item.index[side] = (float) record.faces[side];
+            }
+            if (!good)
+            {
+                LOG_ERROR(SCENE, "Scene file {} has a bad cube at {}.", path, x);
+                return false;
+            }
+            item.id = x;
+            item.locon = loc[x];
+            item.xaxis = xaxis[x];
+            item.yaxis = yaxis[x];
+            item.angles = angles[x];
+            item.dist = 0;
+        }
+    }
+    drifting = false;
+    bvhBuilt = false;
+    return true;
+}
+
+void CubeCloud::advanceDrift(double seconds)
+{
+    if (!drifting)
+    {
+        //! The bounds permLoc places the cubes in, grown to
+        //! hold every cube of a scene file.
+        float extent = getExtent();
+        vec3 low(-extent, -extent, -extent - 15.0f);
+        vec3 high(extent, extent, extent - 15.0f);
+        for (int x = 0; x < count; x++)
+        {
+            low = glm::min(low, loc[x]);
+            high = glm::max(high, loc[x]);
+        }
+        drift.setThreads(threads);
+        drift.reset(loc, randomSeed, low, high);
+        drifting = true;
+    }
+    drift.advance(seconds);
+    moved = true;
+}
+
+void CubeCloud::updateBvh()
+{
+    if (bvhBuilt && !moved)
+    {
+        return;
+    }
+    centers.resize(count);
+    for (int x = 0; x < count; x++)
+    {
+        centers[x] = drifting ? drift.position(x) : loc[x];
+    }
+    //! Refit while the drift keeps the tree tight, and
+    //! build again when it has spread.
+    TRACE_SCOPE("updateBvh");
+    if (!bvhBuilt || !bvh.refit(centers))
+    {
+        bvh.build(centers, CUBE_RADIUS);
+    }
+    bvhBuilt = true;
+    moved = false;
+}
+
+void CubeCloud::cull(const mat4 &viewProjection, vec3 viewPos, float fogDistance)
+{
+    updateBvh();
+    bvh.cull(viewProjection, viewPos, fogDistance, visible);
+    culled = true;
+}
+
+void CubeCloud::cull(const mat4 *viewProjections, const vec3 *viewPositions, int views, float fogDistance)
+{
+    updateBvh();
+    for (int v = 0; v < views; v++)
+    {
+        bvh.cull(viewProjections[v], viewPositions[v], fogDistance, visible, v > 0);
+    }
+    culled = true;
+}
+
+const vector<uint8_t> &CubeCloud::getVisible()
+{
+    return visible;
+}
+
+int CubeCloud::pick(vec3 origin, vec3 direction, float degrees, float &distance)
+{
+    updateBvh();
+    return bvh.raycast(origin, direction, [&](int cube)
+    {
+        return hitCube(cube, origin, direction, degrees);
+    }, distance);
+}
+
+float CubeCloud::hitCube(int cube, vec3 origin, vec3 direction, float degrees)
+{
+    //! Turn the ray into the cube's own frame, where it is
+    //! a box from -0.5 to 0.5.
+    mat4 model = rotate(mat4(1.0f), degrees * angles[cube] * 2.0f, xaxis[cube])
+    * rotate(mat4(1.0f), degrees * angles[cube], yaxis[cube]);
+    mat3 turn = transpose(mat3(model));
+    vec3 start = turn * (origin - centers[cube]);
+    vec3 way = turn * direction;
+    float enter = 0.0f, leave = FLT_MAX;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (fabs(way[axis]) < 1.0e-12f)
+        {
+            if (fabs(start[axis]) > 0.5f)
+            {
+                return FLT_MAX;
+            }
+            continue;
+        }
+        float t1 = (-0.5f - start[axis]) / way[axis];
+        float t2 = (0.5f - start[axis]) / way[axis];
+        enter = std::max(enter, std::min(t1, t2));
+        leave = std::min(leave, std::max(t1, t2));
+    }
+    return (enter <= leave) ? enter : FLT_MAX;
+}
+
+CubeBvh &CubeCloud::getBvh()
+{
+    return bvh;
+}
+
+void CubeCloud::permRange(int begin, int end)
+{
+    TRACE_SCOPE("permRange");
+    //! Work in blocks so each value is filled for many cubes
+    //! at once.
+    const int block = 256;
+    const uint64_t rseed = randomSeed;
+    float values[block];
+    float extent = getExtent();
+    for (int first = begin; first < end; first += block)
+    {
+        int n = std::min(block, end - first);
+        //! The first location to try for each cube.
+        for (int axis = 0; axis < 3; axis++)
+        {
+            RandomStream::fillUniform(values, n, rseed, first, SLOT_LOC + axis, -extent, extent);
+            for (int k = 0; k < n; k++)
+            {
+                loc[first + k][axis] = values[k];
+            }
+        }
+        //! Find the spin axis.
+        for (int axis = 0; axis < 3; axis++)
+        {
+            RandomStream::fillUniform(values, n, rseed, first, SLOT_XAXIS + axis, -1.0f, 1.0f);
+            for (int k = 0; k < n; k++)
+            {
+                xaxis[first + k][axis] = values[k];
+            }
+            RandomStream::fillUniform(values, n, rseed, first, SLOT_YAXIS + axis, -1.0f, 1.0f);
+            for (int k = 0; k < n; k++)
+            {
+                yaxis[first + k][axis] = values[k];
+            }
+        }
+        //! The spin rate, one to four degrees.
+        RandomStream::fillUniform(values, n, rseed, first, SLOT_RATE, 1.0f, 5.0f);
+        for (int k = 0; k < n; k++)
+        {
+            angles[first + k] = floor(values[k]) * onedegree;
+        }
+        for (int k = 0; k < n; k++)
+        {
+            PosOrient &item = distVals[first + k];
+            loc[first + k].z -= 15.0f;
+            item.id = first + k;
+            item.angles = angles[first + k];
+            item.xaxis = xaxis[first + k];
+            item.yaxis = yaxis[first + k];
+            item.dist = 0;
+        }
+        //! Calculate six image indices.
+        for (int side = 0; side < 6; side++)
+        {
+            RandomStream::fillUniform(values, n, rseed, first, SLOT_FACE + side, 0.0f, (float) NUM_IMAGES);
+            for (int k = 0; k < n; k++)
+            {
+                distVals[first + k].index[side] = std::min(floor(values[k]), (float) (NUM_IMAGES - 1));
+            }
+        }
+    }
+}
+
+void CubeCloud::placeCubes()
+{
+    TRACE_SCOPE("placeCubes");
+    //! A hash table of grid cells two minimum spacings wide,
+    //! each holding a linked list of the cubes placed in it.
+    size_t tableSize = 16;
+    while (tableSize < (size_t) count * 2)
+    {
+        tableSize *= 2;
+    }
+    gridKeys.assign(tableSize, EMPTY_CELL);
+    gridHeads.assign(tableSize, -1);
+    gridNext.assign(count, -1);
+    float extent = getExtent();
+    int crowded = 0;
+    for (int x = 0; x < count; x++)
+    {
+        //! Retries come from a second stream for the cube.
+        RandomStream retry(randomSeed, (uint64_t) x | (1ULL << 63));
+        int attempts = 0;
+        while (tooClose(loc[x]) && (attempts < MAX_ATTEMPTS))
+        {
+            loc[x] = vec3(retry.uniform(-extent, extent), retry.uniform(-extent, extent),
+            retry.uniform(-extent, extent) - 15.0f);
+            attempts++;
+        }
+        if (attempts >= MAX_ATTEMPTS)
+        {
+            crowded++;
+        }
+        //! Add the cube to its cell.
+        size_t slot = gridSlot(cellKey(loc[x]), true);
+        gridNext[x] = gridHeads[slot];
+        gridHeads[slot] = x;
+    }
+    if (crowded > 0)
+    {
+        LOG_WARN(SCENE, "{} cubes could not be spaced apart.", crowded);
+    }
+}
+
+int64_t CubeCloud::cellKey(vec3 position)
+{
+    //! Twenty one bits for each axis.
+    int64_t x = (int64_t) floor(position.x / CELL) + (1 << 20);
+    int64_t y = (int64_t) floor(position.y / CELL) + (1 << 20);
+    int64_t z = (int64_t) floor(position.z / CELL) + (1 << 20);
+    return (x << 42) | (y << 21) | z;
+}
+
+size_t CubeCloud::gridSlot(int64_t key, bool insert)
+{
+    //! Open addressing with linear probing.
+    size_t mask = gridKeys.size() - 1;
+    size_t slot = (size_t) RandomStream::mix(0, (uint64_t) key, 0) & mask;
+    while ((gridKeys[slot] != key) && (gridKeys[slot] != EMPTY_CELL))
+    {
+        slot = (slot + 1) & mask;
+    }
+    if ((gridKeys[slot] == EMPTY_CELL) && insert)
+    {
+        gridKeys[slot] = key;
+    }
+    return slot;
+}
+
+bool CubeCloud::tooClose(vec3 position)
+{
+    /** The cells are twice as wide as the spacing, so anything
+     * within the spacing is in this cell or in the neighbor on
+     * the side of the cell the position is closest to, on
+     * each axis.
+     */
+    vec3 cell = position / CELL;
+    vec3 side;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        side[axis] = ((cell[axis] - floor(cell[axis])) < 0.5f) ? -CELL : CELL;
+    }
+    for (int corner = 0; corner < 8; corner++)
+    {
+        vec3 neighbor = position;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (corner & (1 << axis))
+            {
+                neighbor[axis] += side[axis];
+            }
+        }
+        size_t slot = gridSlot(cellKey(neighbor), false);
+        for (int y = gridHeads[slot]; y >= 0; y = gridNext[y])
+        {
+            if (distance(position, loc[y]) < SPACING)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void CubeCloud::genMatrices()
+{
+    //! We generate three matrices:  the vertices of the cube,
+    //! the normals and the texture coordinates.
+    vec3 triangle[3];
+    vec3 normal[3];
+    vec2 texture[3];
+    int countTex = 0, countNorm = 0;
+    for (int x = 0; x < 36; x+= 3)
+    {
+        for (int y = 0; y < 3; y++)
+        {
+            triangle[y] = vec3(0.0f);
+            normal[y] = vec3(0.0f);
+            texture[y] = vec2(0.0f);
+        }
+        for (int y = 0; y < 3; y++)
+        {
+            triangle[0][y] = cube[(indices[x] * 3) + y];
+            triangle[1][y] = cube[((indices[x + 1] * 3) + y)];
+            triangle[2][y] = cube[((indices[x + 2]* 3) + y)];
+        }
+
+        if (((triangle[0].x == triangle[1].x)
+        && (triangle[0].x == triangle[2].x)
+        && (triangle[1].x == triangle[2].x)) 
+        && (triangle[0].x > 0.0f))
+        {
+            for (int y = 0; y < 3; y++)
+            {
+                normal[y] = normals[0];
+                texture[y] = genTexture(normal[y], triangle[y]);
+            }
+        }
+        else if (((triangle[0].x == triangle[1].x)
+        && (triangle[0].x == triangle[2].x)
+        && (triangle[1].x == triangle[2].x)) 
+        && (triangle[0].x < 0.0f))
+        {
+            for (int y = 0; y < 3; y++)
+            {
+                normal[y] = normals[3];
+                texture[y] = genTexture(normal[y], triangle[y]);
+            }
+        }
+        else if (((triangle[0].y == triangle[1].y)
+        && (triangle[0].y == triangle[2].y)
+        && (triangle[1].y == triangle[2].y)) 
+        && (triangle[0].y > 0.0f))
+        {
+            for (int y = 0; y < 3; y++)
+            {
+                normal[y] = normals[1];
+                texture[y] = genTexture(normal[y], triangle[y]);
+            }
+        }
+        else if (((triangle[0].y == triangle[1].y)
+        && (triangle[0].y == triangle[2].y)
+        && (triangle[1].y == triangle[2].y)) 
+        && (triangle[0].y < 0.0f))
+        {
+            for (int y = 0; y < 3; y++)
+            {
+                normal[y] = normals[4];
+                texture[y] = genTexture(normal[y], triangle[y]);
+            }
+        }
+        else if (((triangle[0].z == triangle[1].z)
+        && (triangle[0].z == triangle[2].z)
+        && (triangle[1].z == triangle[2].z)) 
+        && (triangle[0].z > 0.0f))
+        {
+            for (int y = 0; y < 3; y++)
+            {
+                normal[y] = normals[2];
+                texture[y] = genTexture(normal[y], triangle[y]);
+            }
+        }
+        else if (((triangle[0].z == triangle[1].z)
+        && (triangle[0].z == triangle[2].z)
+        && (triangle[1].z == triangle[2].z)) 
+        && (triangle[0].z < 0.0f))
+        {
+            for (int y = 0; y < 3; y++)
+            {
+                normal[y] = normals[5];
+                texture[y] = genTexture(normal[y], triangle[y]);
+            }
+        }
+/*
+        cout << "\n\n\t\tTriangle Vertices\n\n\t";
+        for (int z = 0; z < 3; z++)
+        {
+            cout << "\n\tTriangle " << z << " : " << triangle[z].x
+            << ", " << triangle[z].y << ", " << triangle[z].z;
+        }
+*/
+        int count = 0;
+        for (int z = 0; z < 3; z++)
+        {
+            //!cout << "\n\tTriangle x,y,z ";
+            //!cout << "\n\tNormal x,y,z  + Echo x,y,z ";
+            for (int y = 0; y < 3; y++)
+            {
+                calcNorm[countNorm] = normal[z][y];
+                calcCube[countNorm] = triangle[z][y];
+                //!cout << triangle[z][y] << ", ";
+                //!cout << normal[z][y] << ", " << calcNorm[countNorm] 
+                //!<< " : " << countNorm << " : ";
+                countNorm++;
+            }
+            for (int y = 0; y < 2; y++)
+            {
+                calcTex[countTex] = texture[z][y];
+                countTex++;
+            }
+        }
+        //!cout << "\n\n";
+    }
+}
+vec2 CubeCloud::genTexture(vec3 normal, vec3 triangle)
+{
+    //!Texture coordinates are generated seperately.
+    vec2 texture;
+    if (normal.x != 0.0f)
+    {
+        if (triangle.y > 0.0f)
+        {   
+            texture.x = 1.0f;
+        }
+        else
+        {
+            texture.x = 0.0f;
+        }
+        if (triangle.z > 0.0f)
+        {   
+            texture.y = 1.0f;
+        }
+        else
+        {
+            texture.y = 0.0f;
+        }
+    }
+    else if (normal.y != 0.0f)
+    {
+    
+        if (triangle.x > 0.0f)
+        {   
+            texture.x = 1.0f;
+        }
+        else
+        {
+            texture.x = 0.0f;
+        }
+        if (triangle.z > 0.0f)
+        {   
+            texture.y = 1.0f;
+        }
+        else
+        {
+            texture.y = 0.0f;
+        }
+    }
+    else if (normal.z != 0.0f)
+    {
+        if (triangle.x > 0.0f)
+        {   
+            texture.x = 1.0f;
+        }
+        else
+        {
+            texture.x = 0.0f;
+        }
+        if (triangle.y > 0.0f)
+        {   
+            texture.y = 1.0f;
+        }
+        else
+        {
+            texture.y = 0.0f;
+        }
+    }
+    return texture;
+}
+
+//! Less than operator for stable_sort.
+bool CubeCloud::cmp(const PosOrient &a, const PosOrient &b)
+{   
+    return a.dist > b.dist;
+}
+
+
+void CubeCloud::sortDists(vec3 viewPos, float degrees, bool sorted)
+{
+    //! The cubes the cull kept go to the front, and only
+    //! they are sorted and packed.
+    drawn = count;
+    if (culled)
+    {
+        drawn = (int) (partition(distVals.begin(), distVals.end(), [this](const PosOrient &item)
+        {
+            return visible[item.id] != 0;
+        }) - distVals.begin());
+        culled = false;
+    }
+    for (int x = 0; x < drawn; x++)
+    {
+        if (drifting)
+        {
+            distVals[x].locon = drift.position(distVals[x].id);
+        }
+        distVals[x].dist = distance(distVals[x].locon, viewPos);
+        //!cout << "\n\n\tDistance: " << x << " : " << distVals[x].dist;
+    }
+    //! Sort uses the algorithm library.
+    if (sorted)
+    {
+        sort(distVals.begin(), distVals.begin() + drawn, cmp);
+    }
+    //! Create the data for the distVals data structure.
+    const int chunk = NUM_IMAGES * NUM_INSTANCES;
+    for (int x = 0; x < drawn; x++)
+    {
+        InstData &block = itemData[x / chunk];
+        int slot = x % chunk;
+        mat4 model = mat4(1.0f);
+        model = translate(model, distVals[x].locon)
+        * rotate(model, degrees * distVals[x].angles * 2.0f, distVals[x].xaxis) 
+        * rotate(model, degrees * distVals[x].angles, distVals[x].yaxis);
+        block.instModel[slot] = model;
+        //! Pass the uniform buffer data to the 
+        //! itemData data structure.
+        block.instIndex1[slot] = vec4(distVals[x].index[0], distVals[x].index[1], distVals[x].index[2], distVals[x].index[3]);
+        block.instIndex2[slot] = vec2(distVals[x].index[4], distVals[x].index[5]);
+        block.distance[slot].x = distVals[x].dist;
+    }
+}
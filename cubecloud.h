@@ -0,0 +1,335 @@
+/*******************************************************************
+ * CubeCloud:  A class to generate and order the cloud of
+ * randomly spaced, randomly spinning cubes.  It holds only
+ * CPU side data so it can be used without an OpenGL context.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef CUBECLOUD_H
+#define CUBECLOUD_H
+
+#include "commonheader.h"
+#include "randomstream.h"
+#include "scenefile.h"
+#include "cubedrift.h"
+#include "cubebvh.h"
+#include "logger.h"
+#include "tracer.h"
+
+/** \class CubeCloud
+ * Creates the cube geometry, the location, orientation, spin
+ * and image index information for every cube, and packs the
+ * sorted per-instance data that goes to the shaders.
+ */
+class CubeCloud
+{
+public:
+    /** \brief CubeCloud
+     * The number of cubes defaults to what fits in one
+     * uniform block, NUM_IMAGES * NUM_INSTANCES.
+     */
+    CubeCloud(int count = NUM_IMAGES * NUM_INSTANCES);
+    ~CubeCloud();
+
+    /** \brief getCount
+     * Accessor function.
+     */
+    int getCount();
+
+    /** \brief getChunks
+     * Returns the number of uniform blocks needed to
+     * hold every cube.
+     */
+    int getChunks();
+
+    /** \brief getPosition
+     * Where a cube is now, by its place in the order it
+     * was made in, drifted or not.
+     */
+    vec3 getPosition(int id);
+
+    /** \brief getRadius
+     * The radius that bounds a cube however it turns.
+     */
+    float getRadius();
+
+    /** \brief getDrawn
+     * The number of cubes the last sortDists packed, all
+     * of them unless a cull came before it.
+     */
+    int getDrawn();
+
+    /** \brief getDrawnChunks
+     * Returns the number of uniform blocks the packed
+     * cubes fill.
+     */
+    int getDrawnChunks();
+
+    /** \brief getExtent
+     * Half the width of the cloud.  The default cloud goes
+     * from -25 to 25, larger clouds grow to keep the density.
+     */
+    float getExtent();
+
+    /** \brief seed
+     * Seeds the random number generator so the
+     * same cloud can be generated again.
+     */
+    void seed(unsigned int value);
+
+    /** \brief setThreads
+     * The number of threads permLoc uses, zero for one
+     * per processor.  The cloud is the same for any number.
+     */
+    void setThreads(int threads);
+
+    /** \brief debug
+     * Allows for examination of the generated
+     * cube data.
+     */
+    void debug();
+
+    /** \brief permLoc
+     * Creates the location, orientation, spin and
+     * image index information.
+     */
+    void permLoc();
+
+    /** \brief saveScene
+     * Writes the cubes to a scene file.
+     */
+    bool saveScene(string path);
+
+    /** \brief loadScene
+     * Replaces the cubes with those in a scene file, in
+     * place of permLoc.  The count becomes the number of
+     * cubes in the file.  Returns false if the file cannot
+     * be read or holds a bad cube.
+     */
+    bool loadScene(string path);
+
+    /** \brief advanceDrift
+     * Lets the cubes drift, bouncing off each other and
+     * the bounds of the cloud, up to the given number of
+     * seconds of simulated time.  The first call starts
+     * them from where permLoc or loadScene put them, and
+     * from then on sortDists draws them where they drifted
+     * to, moving or not.
+     */
+    void advanceDrift(double seconds);
+
+    /** \brief cull
+     * Finds the cubes at least partly inside the frustum
+     * of viewProjection, with their centers nearer to
+     * viewPos than fogDistance, through the bounding volume
+     * hierarchy.  The next sortDists sorts and packs only
+     * those.
+     */
+    void cull(const mat4 &viewProjection, vec3 viewPos, float fogDistance);
+
+    /** \brief cull
+     * The same for several views at once, keeping the cubes
+     * any of them sees, so they are sorted and packed once
+     * for all the views.
+     */
+    void cull(const mat4 *viewProjections, const vec3 *viewPositions, int views, float fogDistance);
+
+    /** \brief getVisible
+     * The marks of the last cull, one for each cube in the
+     * order they were made in.
+     */
+    const vector<uint8_t> &getVisible();
+
+    /** \brief pick
+     * Finds the nearest cube along a ray, with the cubes
+     * turned by degrees as sortDists turns them.  Returns
+     * the cube's place in the order it was made in, or -1,
+     * and how far along the ray it is.
+     */
+    int pick(vec3 origin, vec3 direction, float degrees, float &distance);
+
+    /** \brief getBvh
+     * Accessor function.
+     */
+    CubeBvh &getBvh();
+
+    /** \brief genMatrices
+     * Generates the cube object.
+     */
+    void genMatrices();
+
+    /** \brief genTexture
+     * Generates the texture coodinates.
+     */
+    vec2 genTexture(vec3 normal, vec3 triangle);
+
+    /** \brief sortDists
+     * Sorts the distances from the camera so the furthest
+     * are drawn first and the nearest are drawn last.
+     * Also packs the data arrays going to the shaders.
+     * With sorted false the cubes are packed in the order
+     * they are in, for drawing in any order, as the
+     * weighted blended transparency does.
+     */
+    void sortDists(vec3 viewPos, float degrees, bool sorted = true);
+
+    /** \brief cmp
+     * A function to define what is greater than and
+     * what is less than for our data structure (sorted
+     * on distance).
+     */
+    static bool cmp(const PosOrient &a, const PosOrient &b);
+
+    //! The data for the shader uniform, one block for each
+    //! NUM_IMAGES * NUM_INSTANCES cubes. For it's definition
+    //! see commonheader.h.
+    vector<InstData> itemData;
+    //! The calculated information for the cube.
+    float calcTex[72];
+    float calcNorm[108];
+    float calcCube[108];
+    //! A vector to hold the array of location data.
+    vector<PosOrient>distVals;
+
+protected:
+    /** The individual arrays that go into distVals.
+     * The items must all be moved together for
+     * each cube, which is why they are placed in
+     * distVals.
+     */
+    vector<vec3> loc;
+    vector<vec3> xaxis;
+    vector<vec3> yaxis;
+    vector<float> angles;
+    //! The number of cubes.
+    int count;
+    //! The random seed and the threads for permLoc.
+    uint64_t randomSeed;
+    int threads;
+    //! The cubes drifting, once advanceDrift is called.
+    CubeDrift drift;
+    bool drifting;
+    //! The hierarchy over the cubes, the center of each
+    //! by its place, whether the cubes have moved since it
+    //! was fit, and the cubes the last cull kept.
+    CubeBvh bvh;
+    vector<vec3> centers;
+    bool bvhBuilt, moved, culled;
+    vector<uint8_t> visible;
+    int drawn;
+    //! The hash table of grid cells for placing the cubes.
+    vector<int64_t> gridKeys;
+    vector<int> gridHeads;
+    vector<int> gridNext;
+
+    //! The default half width of the cloud, the closest
+    //! two cubes may be and the width of a grid cell.
+    constexpr static float MAXLOC = 25.0f;
+    constexpr static float SPACING = 1.50f;
+    constexpr static float CELL = 2.0f * SPACING;
+    constexpr static int MAX_ATTEMPTS = 10000;
+    constexpr static int64_t EMPTY_CELL = -1;
+    constexpr static float onedegree = 3.14159f / 180.0f;
+    //! Half the diagonal of a cube, which bounds it however
+    //! it turns.
+    constexpr static float CUBE_RADIUS = 0.8660254f;
+    //! Where each value comes from in a cube's random stream.
+    enum Random_Slot {
+        SLOT_LOC = 0,
+        SLOT_XAXIS = 3,
+        SLOT_YAXIS = 6,
+        SLOT_RATE = 9,
+        SLOT_FACE = 10
+    };
+
+    //! Cubes converted to or from a scene file at a time.
+    const size_t SCENE_CHUNK = 65536;
+
+    /** \brief resize
+     * Sets the number of cubes and sizes the arrays.
+     */
+    void resize(int count);
+
+    /** \brief permRange
+     * Draws the first location, the spin and the image
+     * indices for the cubes from begin up to end.
+     */
+    void permRange(int begin, int end);
+
+    /** \brief placeCubes
+     * Accepts the locations in order, drawing new ones for
+     * any cube too close to one already placed.
+     */
+    void placeCubes();
+
+    /** \brief updateBvh
+     * Builds the hierarchy, or refits it to where the cubes
+     * have drifted.
+     */
+    void updateBvh();
+
+    /** \brief hitCube
+     * How far along a ray it meets a cube, or FLT_MAX if
+     * it misses.
+     */
+    float hitCube(int cube, vec3 origin, vec3 direction, float degrees);
+
+    /** \brief cellKey
+     * The hash key of the grid cell holding a position.
+     */
+    int64_t cellKey(vec3 position);
+
+    /** \brief gridSlot
+     * Finds the table slot for a key, claiming an empty
+     * one if insert is true.
+     */
+    size_t gridSlot(int64_t key, bool insert);
+
+    /** \brief tooClose
+     * Checks whether a placed cube is within the spacing.
+     */
+    bool tooClose(vec3 position);
+
+    //!---------------------------------------------------------
+    //! set up vertex data (and buffer(s)) and configure
+    //! vertex attributes
+    //!---------------------------------------------------------
+            // Vertex        //Color
+    float cube[56] = {
+         0.5f,  0.5f,  0.5f, //0
+        -0.5f,  0.5f,  0.5f, //1
+        -0.5f, -0.5f,  0.5f, //2
+         0.5f, -0.5f,  0.5f, //3
+         0.5f, -0.5f, -0.5f, //4
+         0.5f,  0.5f, -0.5f, //5
+        -0.5f,  0.5f, -0.5f, //6
+        -0.5f, -0.5f, -0.5f  //7
+    };
+    vec3 normals[6] {
+         vec3( 1.0f,   0.0f,  0.0f),
+         vec3( 0.0f,   1.0f,  0.0f),
+         vec3( 0.0f,   0.0f,  1.0f),
+         vec3(-1.0f,   0.0f,  0.0f),
+         vec3( 0.0f,  -1.0f,  0.0f),
+         vec3( 0.0f,   0.0f, -1.0f)
+    };
+
+    /** This array shows the order of processing
+     * for each vertex in the cube array.  The cube
+     * array defines each corner of the cube.  The
+     * indices array allows the genMatrices function
+     * to generate a cube from the eight vertices.
+     * Each face of the cube has two triangles
+     * or six vertices and there are six faces.
+     */
+    unsigned int indices[NUM_VERTICES] = {
+        0, 1, 2, 0, 2, 3,
+        0, 3, 4, 0, 4, 5,
+        0, 5, 6, 0, 6, 1,
+        7, 1, 6, 7, 2, 1,
+        7, 5, 4, 7, 6, 5,
+        7, 3, 2, 7, 4, 3
+    };
+};
+
+#endif // CUBECLOUD_H
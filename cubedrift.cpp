@@ -0,0 +1,471 @@
+/*******************************************************************
+ * CubeDrift:  A class to let the cloud of cubes drift, bouncing
+ * off each other and off the bounds of the cloud, at a fixed
+ * step over as many threads as there are processors.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "cubedrift.h"
+
+CubeDrift::CubeDrift()
+{
+    count = 0;
+    threads = 0;
+    bucketMask = 0;
+    epoch = 0.0;
+    steps = 0;
+    lead = 0.0;
+    started = false;
+    workers = 1;
+    range = 0;
+    job = NULL;
+    generation = 0;
+    pending = 0;
+    stopping = false;
+}
+
+CubeDrift::~CubeDrift()
+{
+    stopPool();
+}
+
+void CubeDrift::reset(const vector<vec3> &positions, uint64_t seed, vec3 low, vec3 high)
+{
+    count = (int) positions.size();
+    this->low = low;
+    this->high = high;
+    px.resize(count);
+    py.resize(count);
+    pz.resize(count);
+    vx.resize(count);
+    vy.resize(count);
+    vz.resize(count);
+    for (int x = 0; x < count; x++)
+    {
+        px[x] = positions[x].x;
+        py[x] = positions[x].y;
+        pz[x] = positions[x].z;
+    }
+    RandomStream::fillUniform(&vx[0], count, seed, 0, SLOT_VELOCITY, -SPEED, SPEED);
+    RandomStream::fillUniform(&vy[0], count, seed, 0, SLOT_VELOCITY + 1, -SPEED, SPEED);
+    RandomStream::fillUniform(&vz[0], count, seed, 0, SLOT_VELOCITY + 2, -SPEED, SPEED);
+    //! Padded for the four wide loads in collideRange.
+    sx.resize(count + 3);
+    sy.resize(count + 3);
+    sz.resize(count + 3);
+    svx.resize(count);
+    svy.resize(count);
+    svz.resize(count);
+    order.resize(count);
+    bucketOf.resize(count);
+    //! About one bucket for each cube.
+    int buckets = 16;
+    while (buckets < count)
+    {
+        buckets *= 2;
+    }
+    bucketMask = buckets - 1;
+    cellStart.resize(buckets + 1);
+    epoch = 0.0;
+    steps = 0;
+    lead = 0.0;
+    started = false;
+    startPool();
+}
+
+void CubeDrift::setThreads(int threads)
+{
+    this->threads = threads;
+    startPool();
+}
+
+void CubeDrift::advance(double seconds)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    //! Start, or start again after a pause, from now.
+    double clock = epoch + (double) steps * STEP;
+    if ((!started) || (seconds < clock) || (seconds - clock > STEP * MAX_STEPS))
+    {
+        epoch = seconds;
+        steps = 0;
+        started = true;
+    }
+    //! Counting the steps from the epoch keeps them from
+    //! drifting against the frames.
+    while (epoch + (double) (steps + 1) * STEP <= seconds)
+    {
+        step();
+        steps++;
+    }
+    lead = seconds - (epoch + (double) steps * STEP);
+}
+
+vec3 CubeDrift::position(int cube)
+{
+    //! Carry the cube on past the step to the frame.
+    float ahead = (float) lead;
+    return glm::clamp(vec3(px[cube] + vx[cube] * ahead, py[cube] + vy[cube] * ahead,
+    pz[cube] + vz[cube] * ahead), low, high);
+}
+
+int CubeDrift::getCount()
+{
+    return count;
+}
+
+float CubeDrift::getClosest()
+{
+    float least = SPACING;
+    for (unsigned int x = 0; x < closest.size(); x++)
+    {
+        least = std::min(least, closest[x]);
+    }
+    return least;
+}
+
+void CubeDrift::step()
+{
+    TRACE_SCOPE("drift step");
+    parallel(&CubeDrift::integrateRange);
+    sortCells();
+    parallel(&CubeDrift::collideRange);
+}
+
+void CubeDrift::parallel(void (CubeDrift::*work)(int, int, int))
+{
+    if (!pool.empty())
+    {
+        unique_lock<mutex> guard(poolLock);
+        job = work;
+        pending = (int) pool.size();
+        generation++;
+        wake.notify_all();
+    }
+    //! The calling thread takes the first range.
+    (this->*work)(0, std::min(count, range), 0);
+    if (!pool.empty())
+    {
+        unique_lock<mutex> guard(poolLock);
+        finished.wait(guard, [this] { return pending == 0; });
+    }
+}
+
+void CubeDrift::startPool()
+{
+    stopPool();
+    workers = threads;
+    if (workers <= 0)
+    {
+        workers = std::max(1, (int) thread::hardware_concurrency());
+    }
+    if (count < THREAD_MIN)
+    {
+        workers = 1;
+    }
+    //! Ranges a multiple of four keep the SSE loads whole.
+    range = (((count + workers - 1) / workers) + 3) & ~3;
+    closest.assign(workers, SPACING);
+    for (int w = 1; w < workers; w++)
+    {
+        pool.push_back(thread(&CubeDrift::poolLoop, this, w, generation));
+    }
+}
+
+void CubeDrift::stopPool()
+{
+    {
+        unique_lock<mutex> guard(poolLock);
+        stopping = true;
+        wake.notify_all();
+    }
+    for (unsigned int w = 0; w < pool.size(); w++)
+    {
+        pool[w].join();
+    }
+    pool.clear();
+    stopping = false;
+}
+
+void CubeDrift::poolLoop(int worker, long seen)
+{
+    Tracer::nameThread("drift");
+    while (true)
+    {
+        void (CubeDrift::*work)(int, int, int);
+        {
+            unique_lock<mutex> guard(poolLock);
+            wake.wait(guard, [this, seen] { return stopping || (generation != seen); });
+            if (stopping)
+            {
+                return;
+            }
+            seen = generation;
+            work = job;
+        }
+        int begin = worker * range;
+        int end = std::min(count, begin + range);
+        if (begin < end)
+        {
+            (this->*work)(begin, end, worker);
+        }
+        unique_lock<mutex> guard(poolLock);
+        if (--pending == 0)
+        {
+            finished.notify_one();
+        }
+    }
+}
+
+void CubeDrift::integrateRange(int begin, int end, int)
+{
+    TRACE_SCOPE("integrateRange");
+    float *position[3] = { &px[0], &py[0], &pz[0] };
+    float *velocity[3] = { &vx[0], &vy[0], &vz[0] };
+    const float dt = (float) STEP;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float *p = position[axis];
+        float *v = velocity[axis];
+        const float lo = low[axis];
+        const float hi = high[axis];
+        int x = begin;
+#ifdef __SSE2__
+        //! Past a wall, the cube is reflected back inside and
+        //! its speed on the axis turned away from the wall.
+        const __m128 step4 = _mm_set1_ps(dt);
+        const __m128 lo4 = _mm_set1_ps(lo);
+        const __m128 hi4 = _mm_set1_ps(hi);
+        const __m128 sign = _mm_set1_ps(-0.0f);
+        for (; x + 4 <= end; x += 4)
+        {
+            __m128 p4 = _mm_loadu_ps(p + x);
+            __m128 v4 = _mm_loadu_ps(v + x);
+            p4 = _mm_add_ps(p4, _mm_mul_ps(v4, step4));
+            __m128 under = _mm_cmplt_ps(p4, lo4);
+            __m128 over = _mm_cmpgt_ps(p4, hi4);
+            __m128 speed = _mm_andnot_ps(sign, v4);
+            __m128 bounced = _mm_or_ps(_mm_and_ps(under, _mm_sub_ps(_mm_add_ps(lo4, lo4), p4)),
+            _mm_and_ps(over, _mm_sub_ps(_mm_add_ps(hi4, hi4), p4)));
+            __m128 wall = _mm_or_ps(under, over);
+            p4 = _mm_or_ps(_mm_and_ps(wall, bounced), _mm_andnot_ps(wall, p4));
+            v4 = _mm_or_ps(_mm_and_ps(under, speed), _mm_andnot_ps(under, v4));
+            v4 = _mm_or_ps(_mm_and_ps(over, _mm_or_ps(speed, sign)), _mm_andnot_ps(over, v4));
+            _mm_storeu_ps(p + x, p4);
+            _mm_storeu_ps(v + x, v4);
+        }
+#endif
+        for (; x < end; x++)
+        {
+            p[x] += v[x] * dt;
+            if (p[x] < lo)
+            {
+                p[x] = lo + lo - p[x];
+                v[x] = fabs(v[x]);
+            }
+            else if (p[x] > hi)
+            {
+                p[x] = hi + hi - p[x];
+                v[x] = -fabs(v[x]);
+            }
+        }
+    }
+}
+
+int CubeDrift::bucket(int cx, int cy, int cz)
+{
+    /** Each row of cells along x is hashed to a place in a
+     * table about the size of the cloud, and the cells of
+     * the row follow it in order, so two cells side by side
+     * in x are two buckets side by side.  The grid has no
+     * bounds to keep, and cells far apart that share a
+     * bucket are told apart by the distance check.
+     */
+    uint32_t row = ((uint32_t) cy * 73856093u) ^ ((uint32_t) cz * 19349663u);
+    return (int) ((row + (uint32_t) cx) & (uint32_t) bucketMask);
+}
+
+void CubeDrift::sortCells()
+{
+    TRACE_SCOPE("sortCells");
+    std::fill(cellStart.begin(), cellStart.end(), 0);
+    for (int x = 0; x < count; x++)
+    {
+        bucketOf[x] = bucket((int) floor(px[x] / CELL), (int) floor(py[x] / CELL),
+        (int) floor(pz[x] / CELL));
+        cellStart[bucketOf[x] + 1]++;
+    }
+    for (unsigned int b = 1; b < cellStart.size(); b++)
+    {
+        cellStart[b] += cellStart[b - 1];
+    }
+    //! Copy the cubes to their sorted places, so the cubes
+    //! of a cell sit together in memory.
+    for (int x = 0; x < count; x++)
+    {
+        int place = cellStart[bucketOf[x]]++;
+        order[place] = x;
+        sx[place] = px[x];
+        sy[place] = py[x];
+        sz[place] = pz[x];
+        svx[place] = vx[x];
+        svy[place] = vy[x];
+        svz[place] = vz[x];
+    }
+    //! The scatter moved each start to the next bucket's.
+    for (int b = (int) cellStart.size() - 1; b > 0; b--)
+    {
+        cellStart[b] = cellStart[b - 1];
+    }
+    cellStart[0] = 0;
+}
+
+void CubeDrift::collideRange(int begin, int end, int worker)
+{
+    TRACE_SCOPE("collideRange");
+    //! Plain floats in here, it is the inner loop of the
+    //! step.
+    Contact contact;
+    contact.least2 = SPACING * SPACING;
+    for (int s = begin; s < end; s++)
+    {
+        contact.x = sx[s];
+        contact.y = sy[s];
+        contact.z = sz[s];
+        contact.pushX = contact.pushY = contact.pushZ = 0.0f;
+        contact.turnX = contact.turnY = contact.turnZ = 0.0f;
+        //! Anything within the spacing is in this cell or in
+        //! the neighbor on the nearer side, on each axis.
+        float fx = floor(contact.x / CELL), fy = floor(contact.y / CELL), fz = floor(contact.z / CELL);
+        int cx = (int) fx, cy = (int) fy, cz = (int) fz;
+        int sideX = ((contact.x / CELL - fx) < 0.5f) ? -1 : 1;
+        int sideY = ((contact.y / CELL - fy) < 0.5f) ? -1 : 1;
+        int sideZ = ((contact.z / CELL - fz) < 0.5f) ? -1 : 1;
+        //! The two cells along x are side by side in the table,
+        //! so the eight cells make four runs of places at most.
+        int runs[8][2];
+        int numRuns = 0;
+        int seen[8];
+        int found = 0;
+        int first = std::min(cx, cx + sideX);
+        for (int cell = 0; cell < 8; cell++)
+        {
+            //! Cells far apart can share a bucket; look once.
+            int b = bucket(first + (cell & 1), (cell & 2) ? cy + sideY : cy,
+            (cell & 4) ? cz + sideZ : cz);
+            bool repeat = false;
+            for (int k = 0; k < found; k++)
+            {
+                repeat = repeat || (seen[k] == b);
+            }
+            if (repeat)
+            {
+                continue;
+            }
+            seen[found++] = b;
+            if ((numRuns > 0) && (runs[numRuns - 1][1] == cellStart[b]) && (cell & 1))
+            {
+                runs[numRuns - 1][1] = cellStart[b + 1];
+            }
+            else
+            {
+                runs[numRuns][0] = cellStart[b];
+                runs[numRuns][1] = cellStart[b + 1];
+                numRuns++;
+            }
+        }
+#ifdef __SSE2__
+        /** Four places are checked at a time, so a run, most
+         * often no more than three cubes, is one pass with a
+         * branch that is nearly always taken.  The arrays are
+         * padded so the loads may run past the last cube.
+         */
+        const __m128 x4 = _mm_set1_ps(contact.x);
+        const __m128 y4 = _mm_set1_ps(contact.y);
+        const __m128 z4 = _mm_set1_ps(contact.z);
+        const __m128 spacing4 = _mm_set1_ps(SPACING * SPACING);
+        for (int run = 0; run < numRuns; run++)
+        {
+            for (int t = runs[run][0]; t < runs[run][1]; t += 4)
+            {
+                __m128 dx = _mm_sub_ps(x4, _mm_loadu_ps(&sx[t]));
+                __m128 dy = _mm_sub_ps(y4, _mm_loadu_ps(&sy[t]));
+                __m128 dz = _mm_sub_ps(z4, _mm_loadu_ps(&sz[t]));
+                __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                _mm_mul_ps(dz, dz));
+                int hits = _mm_movemask_ps(_mm_cmplt_ps(d2, spacing4));
+                //! Not past the run, and not the cube itself.
+                hits &= (1 << std::min(4, runs[run][1] - t)) - 1;
+                if ((unsigned int) (s - t) < 4)
+                {
+                    hits &= ~(1 << (s - t));
+                }
+                for (int k = 0; hits != 0; k++, hits >>= 1)
+                {
+                    if (hits & 1)
+                    {
+                        meet(s, t + k, contact);
+                    }
+                }
+            }
+        }
+#else
+        for (int run = 0; run < numRuns; run++)
+        {
+            for (int t = runs[run][0]; t < runs[run][1]; t++)
+            {
+                float dx = contact.x - sx[t];
+                float dy = contact.y - sy[t];
+                float dz = contact.z - sz[t];
+                if ((dx * dx + dy * dy + dz * dz < SPACING * SPACING) && (t != s))
+                {
+                    meet(s, t, contact);
+                }
+            }
+        }
+#endif
+        int cube = order[s];
+        px[cube] = glm::clamp(contact.x + contact.pushX, low.x, high.x);
+        py[cube] = glm::clamp(contact.y + contact.pushY, low.y, high.y);
+        pz[cube] = glm::clamp(contact.z + contact.pushZ, low.z, high.z);
+        vx[cube] = svx[s] + contact.turnX;
+        vy[cube] = svy[s] + contact.turnY;
+        vz[cube] = svz[s] + contact.turnZ;
+    }
+    closest[worker] = sqrt(contact.least2);
+}
+
+void CubeDrift::meet(int s, int t, Contact &contact)
+{
+    float dx = contact.x - sx[t];
+    float dy = contact.y - sy[t];
+    float dz = contact.z - sz[t];
+    float d2 = dx * dx + dy * dy + dz * dz;
+    contact.least2 = std::min(contact.least2, d2);
+    float d = sqrt(d2);
+    float back = (SPACING - d) * 0.5f;
+    //! Two cubes in one place part along x, the lower
+    //! numbered one first.
+    if (d < 1.0e-6f)
+    {
+        dx = (order[s] < order[t]) ? -1.0f : 1.0f;
+        dy = dz = 0.0f;
+        d = 1.0f;
+    }
+    float nx = dx / d, ny = dy / d, nz = dz / d;
+    //! Each cube moves back half of the overlap.
+    contact.pushX += nx * back;
+    contact.pushY += ny * back;
+    contact.pushZ += nz * back;
+    //! Equal masses meeting trade their speeds along the
+    //! line between them.
+    float closing = (svx[s] - svx[t]) * nx + (svy[s] - svy[t]) * ny + (svz[s] - svz[t]) * nz;
+    if (closing < 0.0f)
+    {
+        contact.turnX -= nx * closing;
+        contact.turnY -= ny * closing;
+        contact.turnZ -= nz * closing;
+    }
+}
@@ -0,0 +1,198 @@
+/*******************************************************************
+ * CubeDrift:  A class to let the cloud of cubes drift, bouncing
+ * off each other and off the bounds of the cloud, at a fixed
+ * step over as many threads as there are processors.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef CUBEDRIFT_H
+#define CUBEDRIFT_H
+
+#include "commonheader.h"
+#include "randomstream.h"
+#include "tracer.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/** \class CubeDrift
+ * Keeps the position and velocity of every cube one array
+ * to an axis, so the step moves four cubes at a time with
+ * SSE.  Each step:
+ *
+ *     moves the cubes and bounces them off the bounds,
+ *     sorts them by grid cell with a counting sort,
+ *     pushes apart and bounces any two within the spacing.
+ *
+ * The cells are twice as wide as the spacing, so each cube
+ * looks in eight cells as CubeCloud does when placing them.
+ * Every cube works out its own push from the positions
+ * before the step and writes only its own, so the threads
+ * need no locks and the result is the same for any number
+ * of them.  The steps are a fixed length of simulated time,
+ * so a recorded session drifts the same when played back.
+ */
+class CubeDrift
+{
+public:
+    CubeDrift();
+    ~CubeDrift();
+
+    /** \brief reset
+     * Starts the cubes at the positions given, inside the
+     * box from low to high, each moving at a speed drawn
+     * from its own random stream.
+     */
+    void reset(const vector<vec3> &positions, uint64_t seed, vec3 low, vec3 high);
+
+    /** \brief setThreads
+     * The number of threads a step uses, zero for one per
+     * processor.
+     */
+    void setThreads(int threads);
+
+    /** \brief advance
+     * Runs every step due by the given number of seconds
+     * of simulated time.  After a pause the time missed is
+     * skipped, not caught up.
+     */
+    void advance(double seconds);
+
+    /** \brief position
+     * Where a cube is at the time of the last advance.
+     */
+    vec3 position(int cube);
+
+    /** \brief getCount
+     * Accessor function.
+     */
+    int getCount();
+
+    /** \brief getClosest
+     * The closest two cubes came in the last step, before
+     * they were pushed apart, or the spacing if none came
+     * that close.
+     */
+    float getClosest();
+
+    //! Seconds in a step, the fastest a cube starts out in
+    //! units a second, the closest two cubes may be and the
+    //! width of a grid cell.
+    constexpr static double STEP = 1.0 / 60.0;
+    constexpr static float SPEED = 1.0f;
+    constexpr static float SPACING = 1.50f;
+    constexpr static float CELL = 2.0f * SPACING;
+    //! Steps run in one advance at most.
+    const int MAX_STEPS = 4;
+    //! Fewer cubes than this are stepped on one thread.
+    const int THREAD_MIN = 4096;
+
+protected:
+    //! Where each velocity comes from in a cube's random
+    //! stream, past the slots CubeCloud uses.
+    enum Random_Slot {
+        SLOT_VELOCITY = 16
+    };
+
+    //! One cube and the cubes it meets in a step.
+    struct Contact {
+        float x, y, z;
+        float pushX, pushY, pushZ;
+        float turnX, turnY, turnZ;
+        float least2;
+    };
+
+    /** \brief step
+     * Runs one step.
+     */
+    void step();
+
+    /** \brief parallel
+     * Runs a part of the step over the cubes, split into a
+     * range for each thread.
+     */
+    void parallel(void (CubeDrift::*work)(int, int, int));
+
+    /** \brief startPool
+     * Starts the threads for the number of cubes and the
+     * threads asked for, one less than the ranges, as the
+     * calling thread takes the first.  Stops those there
+     * were before.
+     */
+    void startPool();
+
+    /** \brief stopPool
+     * Stops the threads and waits for them.
+     */
+    void stopPool();
+
+    /** \brief poolLoop
+     * The body of a thread of the pool, running its range
+     * of each part of the step after the generation seen.
+     */
+    void poolLoop(int worker, long seen);
+
+    /** \brief integrateRange
+     * Moves the cubes from begin up to end and bounces
+     * them off the bounds.
+     */
+    void integrateRange(int begin, int end, int worker);
+
+    /** \brief sortCells
+     * Sorts the cubes by the bucket of their grid cell.
+     */
+    void sortCells();
+
+    /** \brief collideRange
+     * Pushes apart the sorted cubes from begin up to end
+     * and any cube within the spacing.
+     */
+    void collideRange(int begin, int end, int worker);
+
+    /** \brief meet
+     * Adds the push and the bounce from the sorted cube at
+     * t to the sorted cube at s, which are within the
+     * spacing.
+     */
+    void meet(int s, int t, Contact &contact);
+
+    /** \brief bucket
+     * The bucket of a grid cell.
+     */
+    int bucket(int cx, int cy, int cz);
+
+    //! The cubes in the order CubeCloud keeps them.
+    vector<float> px, py, pz, vx, vy, vz;
+    //! The cubes sorted by bucket, the cube at each sorted
+    //! place and the first place of each bucket.
+    vector<float> sx, sy, sz, svx, svy, svz;
+    vector<int> order;
+    vector<int> cellStart;
+    vector<int> bucketOf;
+    int bucketMask;
+    vec3 low, high;
+    int count, threads;
+    //! The simulated time the steps are counted from, the
+    //! steps since, and how far the last advance was past
+    //! the last step.
+    double epoch;
+    long steps;
+    double lead;
+    bool started;
+    //! The closest two cubes came, for each thread.
+    vector<float> closest;
+    //! The threads, kept from step to step, the ranges a
+    //! part is split into and the part they are running.
+    //! Each part counts the generation up, and the calling
+    //! thread waits for pending to come to zero.
+    vector<thread> pool;
+    int workers, range;
+    void (CubeDrift::*job)(int, int, int);
+    mutex poolLock;
+    condition_variable wake, finished;
+    long generation;
+    int pending;
+    bool stopping;
+};
+
+#endif // CUBEDRIFT_H
@@ -0,0 +1,92 @@
+/*******************************************************************
+ * FrameArena:  A class to hand out memory for the temporaries of
+ * one frame from a block kept between frames.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "framearena.h"
+
+FrameArena::FrameArena(size_t size)
+{
+    this->size = std::max(size, (size_t) 64);
+    block = new char[this->size];
+    used = 0;
+    overflowBytes = 0;
+}
+
+FrameArena::~FrameArena()
+{
+    reset();
+    delete [] block;
+}
+
+void *FrameArena::allocate(size_t bytes, size_t align)
+{
+    size_t start = (used + align - 1) & ~(align - 1);
+    if (start + bytes <= size)
+    {
+        used = start + bytes;
+        return &block[start];
+    }
+    //! Kept to the end of the frame like the rest.
+    char *memory = new char[bytes + align];
+    overflow.push_back(memory);
+    overflowBytes += bytes + align;
+    uintptr_t address = ((uintptr_t) memory + align - 1) & ~((uintptr_t) align - 1);
+    return (void*) address;
+}
+
+const char *FrameArena::print(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    size_t room = size - used;
+    int length = vsnprintf(&block[used], room, format, args);
+    va_end(args);
+    if (length < 0)
+    {
+        return "";
+    }
+    if ((size_t) length < room)
+    {
+        const char *text = &block[used];
+        used += length + 1;
+        return text;
+    }
+    //! Too long for what is left, so write it again where
+    //! it fits.
+    char *text = (char*) allocate(length + 1, 1);
+    va_start(args, format);
+    vsnprintf(text, length + 1, format, args);
+    va_end(args);
+    return text;
+}
+
+void FrameArena::reset()
+{
+    if (!overflow.empty())
+    {
+        for (unsigned int x = 0; x < overflow.size(); x++)
+        {
+            delete [] overflow[x];
+        }
+        overflow.clear();
+        //! Room for all of the frame just done.
+        size_t grown = used + overflowBytes;
+        delete [] block;
+        size = std::max(grown, size * 2);
+        block = new char[size];
+        overflowBytes = 0;
+    }
+    used = 0;
+}
+
+size_t FrameArena::getSize()
+{
+    return size;
+}
+
+size_t FrameArena::getUsed()
+{
+    return used + overflowBytes;
+}
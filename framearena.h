@@ -0,0 +1,60 @@
+/*******************************************************************
+ * FrameArena:  A class to hand out memory for the temporaries of
+ * one frame from a block kept between frames.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+
+#include "commonheader.h"
+
+/** \class FrameArena
+ * Memory is taken from the front of the block and never given
+ * back on its own; reset() at the start of a frame frees all
+ * of it at once.  What does not fit goes on the heap for the
+ * frame, and the next reset() grows the block to hold the
+ * whole frame, so after the first few frames there are no
+ * allocations at all.
+ */
+class FrameArena
+{
+public:
+    FrameArena(size_t size = 16 * 1024);
+    ~FrameArena();
+
+    /** \brief allocate
+     * Memory for the rest of the frame.
+     */
+    void *allocate(size_t bytes, size_t align = alignof(max_align_t));
+
+    /** \brief print
+     * Formatted text, in the manner of printf, for the rest
+     * of the frame, as for the name of a uniform.
+     */
+    const char *print(const char *format, ...);
+
+    /** \brief reset
+     * Frees everything handed out, for the next frame.
+     */
+    void reset();
+
+    /** \brief getSize
+     * The size of the block.
+     */
+    size_t getSize();
+
+    /** \brief getUsed
+     * The bytes handed out since the last reset.
+     */
+    size_t getUsed();
+
+protected:
+    char *block;
+    size_t size, used;
+    //! What did not fit in the block this frame.
+    vector<char*> overflow;
+    size_t overflowBytes;
+};
+
+#endif // FRAMEARENA_H
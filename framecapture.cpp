@@ -0,0 +1,256 @@
+/*******************************************************************
+ * FrameCapture:  A class to save a range of drawn frames to
+ * disk without stalling the drawing, by reading them back
+ * through a ring of pixel buffers and writing them out on a
+ * thread of its own.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "framecapture.h"
+
+FrameCapture::FrameCapture(string prefix, Capture_Format format, long first, long count)
+{
+    LOG_DEBUG(STARTUP, "Creating FrameCapture.");
+    this->prefix = prefix;
+    this->format = format;
+    this->first = first;
+    last = first + count - 1;
+    nextSlot = 0;
+    for (int x = 0; x < RING; x++)
+    {
+        glGenBuffers(1, &slots[x].buffer);
+        slots[x].fence = 0;
+        slots[x].size = 0;
+        slots[x].frame = -1;
+        slots[x].width = slots[x].height = 0;
+        slots[x].busy = false;
+    }
+    for (int x = 0; x < POOL; x++)
+    {
+        pool.push_back(&frames[x]);
+    }
+    stopping = false;
+    finished = false;
+    rawWidth = rawHeight = 0;
+    captured = written = failed = fenceWaits = poolWaits = 0;
+    writer = thread(&FrameCapture::writerLoop, this);
+}
+
+FrameCapture::~FrameCapture()
+{
+    LOG_DEBUG(STARTUP, "Destroying FrameCapture.");
+    finish();
+    for (int x = 0; x < RING; x++)
+    {
+        glDeleteBuffers(1, &slots[x].buffer);
+    }
+}
+
+void FrameCapture::frameDone(long frame, int width, int height)
+{
+    AllocScope scope(AllocTracker::SUBSYSTEM_CAPTURE);
+    TRACE_SCOPE("capture");
+    if (finished)
+    {
+        return;
+    }
+    bool wanted = (frame >= first) && (frame <= last);
+    Slot &slot = slots[nextSlot];
+    if (slot.busy)
+    {
+        collect(slot);
+    }
+    if (wanted)
+    {
+        //! Start the read; it lands in the buffer while
+        //! the next frames are drawn.
+        size_t size = (size_t) width * height * 4;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        if (slot.size != size)
+        {
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+            slot.size = size;
+        }
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.frame = frame;
+        slot.width = width;
+        slot.height = height;
+        slot.busy = true;
+        captured++;
+    }
+    nextSlot = (nextSlot + 1) % RING;
+    //! The read started LAG frames ago should be in by now.
+    Slot &old = slots[(nextSlot + RING - 1 - LAG) % RING];
+    if (old.busy && (old.frame <= frame - LAG))
+    {
+        collect(old);
+    }
+}
+
+void FrameCapture::collect(Slot &slot)
+{
+    //! Waiting here means the ring is too short for the
+    //! driver, which is worth knowing.
+    if (glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+    {
+        fenceWaits++;
+        glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = 0;
+    slot.busy = false;
+    Frame *frame;
+    {
+        unique_lock<mutex> hold(lock);
+        if (pool.empty())
+        {
+            poolWaits++;
+            space.wait(hold, [this] { return !pool.empty(); });
+        }
+        frame = pool.back();
+        pool.pop_back();
+    }
+    frame->number = slot.frame;
+    frame->width = slot.width;
+    frame->height = slot.height;
+    //! The pool frames keep their memory from one frame to
+    //! the next, so this only allocates at the start.
+    frame->pixels.resize(slot.size);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    void *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.size, GL_MAP_READ_BIT);
+    bool good = (mapped != NULL);
+    if (good)
+    {
+        memcpy(&frame->pixels[0], mapped, slot.size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    unique_lock<mutex> hold(lock);
+    if (good)
+    {
+        pending.push_back(frame);
+        ready.notify_one();
+    }
+    else
+    {
+        failed++;
+        pool.push_back(frame);
+    }
+}
+
+void FrameCapture::finish()
+{
+    if (finished)
+    {
+        return;
+    }
+    //! The frames still in the ring, oldest first.
+    for (int x = 0; x < RING; x++)
+    {
+        Slot &slot = slots[(nextSlot + x) % RING];
+        if (slot.busy)
+        {
+            collect(slot);
+        }
+    }
+    {
+        unique_lock<mutex> hold(lock);
+        stopping = true;
+        ready.notify_one();
+    }
+    writer.join();
+    finished = true;
+    if (raw.is_open())
+    {
+        raw.close();
+    }
+    cout << "\n\n\tCaptured " << written << " of " << captured << " frames"
+    << ((format == FORMAT_RAW) ? " to " + prefix + ".rgba" : " to " + prefix + "-*.png");
+    if (format == FORMAT_RAW)
+    {
+        cout << ", RGBA " << rawWidth << "x" << rawHeight << " top row first";
+    }
+    cout << "\n\tFailed:                  " << failed
+    << "\n\tWaits for the driver:    " << fenceWaits
+    << "\n\tWaits for the writer:    " << poolWaits << "\n\n";
+}
+
+void FrameCapture::writerLoop()
+{
+    Tracer::nameThread("capture");
+    AllocScope scope(AllocTracker::SUBSYSTEM_CAPTURE);
+    while (true)
+    {
+        Frame *frame;
+        {
+            unique_lock<mutex> hold(lock);
+            ready.wait(hold, [this] { return stopping || !pending.empty(); });
+            if (pending.empty())
+            {
+                return;
+            }
+            frame = pending.front();
+            pending.pop_front();
+        }
+        bool good = write(*frame);
+        unique_lock<mutex> hold(lock);
+        if (good)
+        {
+            written++;
+        }
+        else
+        {
+            failed++;
+        }
+        pool.push_back(frame);
+        space.notify_one();
+    }
+}
+
+bool FrameCapture::write(Frame &frame)
+{
+    TRACE_SCOPE("write frame");
+    size_t line = (size_t) frame.width * 4;
+    if (format == FORMAT_RAW)
+    {
+        if (!raw.is_open())
+        {
+            raw.open((prefix + ".rgba").c_str(), ios::out | ios::binary | ios::trunc);
+            rawWidth = frame.width;
+            rawHeight = frame.height;
+        }
+        //! One size per stream.
+        if ((!raw) || (frame.width != rawWidth) || (frame.height != rawHeight))
+        {
+            return false;
+        }
+        //! OpenGL reads the bottom row first.
+        for (int y = frame.height - 1; y >= 0; y--)
+        {
+            raw.write((const char*) &frame.pixels[y * line], line);
+        }
+        return (bool) raw;
+    }
+    //! FreeImage also keeps the bottom row first, in blue,
+    //! green, red and alpha order.
+    fipImage picture;
+    picture.setSize(FIT_BITMAP, (unsigned) frame.width, (unsigned) frame.height, 32);
+    for (int y = 0; y < frame.height; y++)
+    {
+        const uint8_t *source = &frame.pixels[y * line];
+        BYTE *target = picture.getScanLine((unsigned) y);
+        for (size_t x = 0; x < line; x += 4)
+        {
+            target[x] = source[x + 2];
+            target[x + 1] = source[x + 1];
+            target[x + 2] = source[x];
+            target[x + 3] = source[x + 3];
+        }
+    }
+    stringstream name;
+    name << prefix << "-" << setw(6) << setfill('0') << frame.number << ".png";
+    return picture.save(name.str().c_str());
+}
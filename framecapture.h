@@ -0,0 +1,122 @@
+/*******************************************************************
+ * FrameCapture:  A class to save a range of drawn frames to
+ * disk without stalling the drawing, by reading them back
+ * through a ring of pixel buffers and writing them out on a
+ * thread of its own.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include "commonheader.h"
+#include "logger.h"
+#include "alloctracker.h"
+#include "tracer.h"
+
+/** \class FrameCapture
+ * A plain glReadPixels waits for the frame to finish drawing
+ * before it returns.  Here each wanted frame is read into a
+ * pixel pack buffer, which returns at once, with a fence
+ * behind it.  Two frames later the buffer is mapped, by then
+ * long since filled, and copied to a frame from a fixed pool,
+ * which goes to the writer thread.  The writer saves each
+ * frame as a PNG file, or appends it to one raw stream of
+ * RGBA frames, top row first, that a video tool can read:
+ *
+ *     ffmpeg -f rawvideo -pixel_format rgba -video_size 1280x1024
+ *     -framerate 60 -i capture.rgba capture.mp4
+ *
+ * If the writer falls behind by the whole pool the drawing
+ * waits for it, and the waits are counted and reported.
+ */
+class FrameCapture
+{
+public:
+    //! How the frames are written.
+    enum Capture_Format {
+        FORMAT_PNG,
+        FORMAT_RAW
+    };
+
+    /** \brief FrameCapture
+     * Captures count frames from frame number first, to
+     * files named from prefix.
+     */
+    FrameCapture(string prefix, Capture_Format format, long first, long count);
+    ~FrameCapture();
+
+    /** \brief frameDone
+     * Call after each frame is drawn, before the buffers
+     * are swapped, with the number of the frame and the
+     * size of the framebuffer it was drawn in.
+     */
+    void frameDone(long frame, int width, int height);
+
+    /** \brief finish
+     * Reads back the frames still in the ring, waits for
+     * the writer and reports what was written.
+     */
+    void finish();
+
+protected:
+    //! A pixel pack buffer and the frame read into it.
+    struct Slot {
+        GLuint buffer;
+        GLsync fence;
+        size_t size;
+        long frame;
+        int width, height;
+        bool busy;
+    };
+
+    //! A frame copied out for the writer.
+    struct Frame {
+        long number;
+        int width, height;
+        vector<uint8_t> pixels;
+    };
+
+    /** \brief collect
+     * Maps the buffer of a slot and hands its frame to the
+     * writer.
+     */
+    void collect(Slot &slot);
+
+    /** \brief writerLoop
+     * The body of the writer thread.
+     */
+    void writerLoop();
+
+    /** \brief write
+     * Writes one frame to disk.  Returns false if it
+     * cannot.
+     */
+    bool write(Frame &frame);
+
+    //! The number of buffers in the ring, frames a buffer
+    //! is left before it is mapped, and the frames waiting
+    //! for the writer.
+    static const int RING = 3;
+    static const int LAG = 2;
+    static const int POOL = 8;
+    string prefix;
+    Capture_Format format;
+    long first, last;
+    Slot slots[RING];
+    int nextSlot;
+    //! The writer thread and the frames going to it.
+    thread writer;
+    mutex lock;
+    condition_variable ready, space;
+    deque<Frame*> pending;
+    vector<Frame*> pool;
+    Frame frames[POOL];
+    bool stopping, finished;
+    std::ofstream raw;
+    int rawWidth, rawHeight;
+    //! What happened, for the report.
+    long captured, written, failed, fenceWaits, poolWaits;
+};
+
+#endif // FRAMECAPTURE_H
@@ -0,0 +1,97 @@
+/*******************************************************************
+ * FrameStats:  A class to collect frame times and report
+ * percentiles and throughput.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "framestats.h"
+
+FrameStats::FrameStats()
+{
+    sum = 0.0;
+    dirty = false;
+}
+
+FrameStats::~FrameStats()
+{
+}
+
+void FrameStats::reset(size_t expected)
+{
+    samples.clear();
+    samples.reserve(expected);
+    sorted.clear();
+    sum = 0.0;
+    dirty = false;
+}
+
+void FrameStats::addFrame(double ms)
+{
+    samples.push_back(ms);
+    sum += ms;
+    dirty = true;
+}
+
+double FrameStats::percentile(double p)
+{
+    if (samples.empty())
+    {
+        return 0.0;
+    }
+    //! Only sort again when frames have been added.
+    if (dirty || (sorted.size() != samples.size()))
+    {
+        sorted = samples;
+        sort(sorted.begin(), sorted.end());
+        dirty = false;
+    }
+    p = std::min(std::max(p, 0.0), 100.0);
+    size_t rank = (size_t) ceil(p / 100.0 * (double) sorted.size());
+    if (rank > 0)
+    {
+        rank--;
+    }
+    return sorted[rank];
+}
+
+double FrameStats::mean()
+{
+    if (samples.empty())
+    {
+        return 0.0;
+    }
+    return sum / (double) samples.size();
+}
+
+double FrameStats::total()
+{
+    return sum;
+}
+
+size_t FrameStats::count()
+{
+    return samples.size();
+}
+
+void FrameStats::report(string title, unsigned long instances)
+{
+    double seconds = sum / 1000.0;
+    double fps = 0.0;
+    if (seconds > 0.0)
+    {
+        fps = (double) samples.size() / seconds;
+    }
+    cout << fixed << setprecision(3)
+    << "\n\n\t" << title
+    << "\n\tFrames:       " << samples.size()
+    << "\n\tMean ms:      " << mean()
+    << "\n\tp50 ms:       " << percentile(50.0)
+    << "\n\tp90 ms:       " << percentile(90.0)
+    << "\n\tp95 ms:       " << percentile(95.0)
+    << "\n\tp99 ms:       " << percentile(99.0)
+    << "\n\tMax ms:       " << percentile(100.0)
+    << "\n\tFrames/s:     " << fps
+    << "\n\tCubes/s:      " << fps * (double) instances
+    << "\n\n";
+    cout.unsetf(ios_base::floatfield);
+}
@@ -0,0 +1,67 @@
+/*******************************************************************
+ * FrameStats:  A class to collect frame times and report
+ * percentiles and throughput.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include "commonheader.h"
+
+/** \class FrameStats
+ * Keeps every frame time in milliseconds so the percentiles
+ * are exact.  Reserve the number of frames up front so
+ * adding a frame does not allocate.
+ */
+class FrameStats
+{
+public:
+    FrameStats();
+    ~FrameStats();
+
+    /** \brief reset
+     * Clears the samples and reserves room for the
+     * expected number of frames.
+     */
+    void reset(size_t expected);
+
+    /** \brief addFrame
+     * Adds the time for one frame in milliseconds.
+     */
+    void addFrame(double ms);
+
+    /** \brief percentile
+     * Returns the nearest rank percentile, p from 0 to 100.
+     */
+    double percentile(double p);
+
+    /** \brief mean
+     * Returns the average frame time.
+     */
+    double mean();
+
+    /** \brief total
+     * Returns the sum of the frame times.
+     */
+    double total();
+
+    /** \brief count
+     * Returns the number of frames.
+     */
+    size_t count();
+
+    /** \brief report
+     * Prints the percentiles and the throughput in frames
+     * and cubes per second.
+     */
+    void report(string title, unsigned long instances);
+
+protected:
+    vector<double> samples;
+    vector<double> sorted;
+    double sum;
+    bool dirty;
+};
+
+#endif // FRAMESTATS_H
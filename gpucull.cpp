@@ -0,0 +1,173 @@
+/*******************************************************************
+ * GpuCull:  A class to cull, turn and pack the cubes on the GPU
+ * with a compute shader, and draw the ones kept with a single
+ * indirect draw the GPU fills in.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "gpucull.h"
+
+GpuCull::GpuCull()
+{
+    LOG_DEBUG(STARTUP, "Creating GpuCull.");
+    program = NULL;
+    for (int x = 0; x < NUM_BUFFERS; x++)
+    {
+        buffers[x] = 0;
+    }
+    count = 0;
+    viewCount = 1;
+    indexCount = 0;
+    radius = 0.0f;
+}
+
+GpuCull::~GpuCull()
+{
+    LOG_DEBUG(STARTUP, "Destroying GpuCull.");
+    delete program;
+}
+
+bool GpuCull::supported()
+{
+    //! The shaders are ES 3.1, which 4.5 takes as it is.
+    if (!(GLEW_VERSION_4_5 || (GLEW_VERSION_4_3 && GLEW_ARB_ES3_1_compatibility)))
+    {
+        return false;
+    }
+    //! The least a driver may give the vertex shader is none.
+    GLint blocks = 0;
+    glGetIntegerv(GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS, &blocks);
+    return blocks > 0;
+}
+
+void GpuCull::create(CubeCloud *cloud, int viewCount, int indexCount)
+{
+    this->viewCount = viewCount;
+    this->indexCount = indexCount;
+    count = cloud->getCount();
+    radius = cloud->getRadius();
+    stringstream defines;
+    defines << "#define VIEW_COUNT " << viewCount << "\n"
+    << "#define GROUP_SIZE " << GROUP_SIZE << "\n";
+    program = new Shader();
+    program->initCompute("cullcomp.glsl", defines.str());
+    //! The spins and pictures by the order the cubes were
+    //! made in, as the places are.
+    vector<Spin> spins(count);
+    for (int x = 0; x < count; x++)
+    {
+        const PosOrient &item = cloud->distVals[x];
+        Spin &spin = spins[item.id];
+        spin.xaxis = vec4(item.xaxis, item.angles);
+        spin.yaxis = vec4(item.yaxis, 0.0f);
+        spin.index1 = vec4(item.index[0], item.index[1], item.index[2], item.index[3]);
+        spin.index2 = vec4(item.index[4], item.index[5], 0.0f, 0.0f);
+    }
+    positions.resize(count);
+    for (int x = 0; x < count; x++)
+    {
+        positions[x] = vec4(cloud->getPosition(x), 1.0f);
+    }
+    //! Each side is six vertices in a row, see fogvec.glsl,
+    //! or the mesh's sides follow each other.
+    DrawCommand command = { 36, 0, 0, 0 };
+    ElementsCommand elements = { (GLuint) indexCount, 0, 0, 0, 0 };
+    glGenBuffers(NUM_BUFFERS, buffers);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[BUFFER_POSITIONS]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, count * sizeof(vec4), positions.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[BUFFER_SPINS]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, count * sizeof(Spin), spins.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[BUFFER_VISIBLE]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, count * sizeof(Kept), NULL, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[BUFFER_COMMAND]);
+    if (indexCount > 0)
+    {
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(ElementsCommand), &elements, GL_DYNAMIC_COPY);
+    }
+    else
+    {
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(DrawCommand), &command, GL_DYNAMIC_COPY);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    LOG_INFO(RENDER, "Culling {} cubes on the GPU in {} KB of buffers.", count,
+    count * (sizeof(vec4) + sizeof(Spin) + sizeof(Kept)) / 1024);
+}
+
+size_t GpuCull::uploadPositions(CubeCloud *cloud)
+{
+    for (int x = 0; x < count; x++)
+    {
+        positions[x] = vec4(cloud->getPosition(x), 1.0f);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[BUFFER_POSITIONS]);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, count * sizeof(vec4), positions.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return count * sizeof(vec4);
+}
+
+void GpuCull::cull(const FrameParams &params, float fogDistance, bool frustum)
+{
+    //! The count starts again from none.
+    const GLuint zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[BUFFER_COMMAND]);
+    glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, offsetof(DrawCommand, instanceCount),
+    sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    for (int x = 0; x < NUM_BUFFERS; x++)
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, x, buffers[x]);
+    }
+    mat4 viewProjections[MAX_VIEWS];
+    if (viewCount > 1)
+    {
+        for (int v = 0; v < viewCount; v++)
+        {
+            viewProjections[v] = params.projections[v] * params.views[v];
+        }
+    }
+    else
+    {
+        viewProjections[0] = params.projection * params.view;
+    }
+    //! The caller's program is put back after.
+    GLint previous = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+    program->Use();
+    program->setInt("cubeCount", count);
+    program->setMat4Array("viewProjections", viewProjections, viewCount);
+    program->setVec3Array("viewPositions", (viewCount > 1) ? params.viewPositions : &params.viewPos,
+    viewCount);
+    program->setFloat("fogDistance", fogDistance);
+    program->setBool("frustum", frustum);
+    program->setFloat("degrees", params.degrees);
+    program->setFloat("radius", radius);
+    glDispatchCompute((count + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+    //! The vertex shader reads the cubes and the draw reads
+    //! the count, both written above.
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+    glUseProgram(previous);
+}
+
+void GpuCull::draw()
+{
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffers[BUFFER_COMMAND]);
+    if (indexCount > 0)
+    {
+        glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*) 0);
+    }
+    else
+    {
+        glDrawArraysIndirect(GL_TRIANGLES, (void*) 0);
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+int GpuCull::readDrawn()
+{
+    DrawCommand command;
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_COPY_READ_BUFFER, buffers[BUFFER_COMMAND]);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(DrawCommand), &command);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    return (int) (command.instanceCount / viewCount);
+}
@@ -0,0 +1,132 @@
+/*******************************************************************
+ * GpuCull:  A class to cull, turn and pack the cubes on the GPU
+ * with a compute shader, and draw the ones kept with a single
+ * indirect draw the GPU fills in.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef GPUCULL_H
+#define GPUCULL_H
+
+#include "commonheader.h"
+#include "shader.h"
+#include "cubecloud.h"
+#include "logger.h"
+
+/** \class GpuCull
+ * Every cube's place, spin and pictures go to storage
+ * buffers once.  Each frame cullcomp.glsl tests every cube
+ * against the views and the fog, each group of cubes adds
+ * up the ones it keeps so they can be written side by side
+ * with one atomic for the group, and the count goes into
+ * the draw command.  The CPU sends only the camera, and the
+ * places again when the cubes drift, and never reads the
+ * count back to draw.  Needs OpenGL 4.5, or 4.3 with the ES
+ * 3.1 shaders, and storage buffers in the vertex shader.
+ */
+class GpuCull
+{
+public:
+    GpuCull();
+    ~GpuCull();
+
+    /** \brief supported
+     * Whether the current context can run the compute cull
+     * and read its buffer in the vertex shader.
+     */
+    static bool supported();
+
+    /** \brief create
+     * Builds the compute program for the number of views
+     * and fills the buffers from the cloud.  With indexCount
+     * the cubes are drawn as that many indices of the bound
+     * element buffer, a mesh, in place of the cube's 36
+     * vertices.
+     */
+    void create(CubeCloud *cloud, int viewCount, int indexCount = 0);
+
+    /** \brief uploadPositions
+     * Sends where the cubes are now, after they drift.
+     * Returns the bytes sent.
+     */
+    size_t uploadPositions(CubeCloud *cloud);
+
+    /** \brief cull
+     * Keeps the cubes any view sees nearer than fogDistance,
+     * or all of them when frustum is false, turned by the
+     * degrees in params, for the next draw.  The program
+     * in use is left in use.
+     */
+    void cull(const FrameParams &params, float fogDistance, bool frustum);
+
+    /** \brief draw
+     * Draws every side of the cubes kept, each once for
+     * every view, with the program and vertex array bound.
+     */
+    void draw();
+
+    /** \brief readDrawn
+     * The cubes the last cull kept.  It waits for the cull,
+     * so it is for the reports and not the frame.
+     */
+    int readDrawn();
+
+    //! The cubes each group of the compute shader culls.
+    static const int GROUP_SIZE = 64;
+
+protected:
+    //! The buffers, by their binding in cullcomp.glsl.
+    enum Buffer_Binding {
+        BUFFER_POSITIONS,
+        BUFFER_SPINS,
+        BUFFER_VISIBLE,
+        BUFFER_COMMAND,
+        NUM_BUFFERS
+    };
+
+    //! A cube's spin and pictures, as cullcomp.glsl reads
+    //! them.  The spin rate is in the w of the x axis.
+    struct Spin {
+        vec4 xaxis;
+        vec4 yaxis;
+        vec4 index1;
+        vec4 index2;
+    };
+
+    //! A cube kept, as fogvec.glsl reads it.
+    struct Kept {
+        mat4 model;
+        vec4 index1;
+        vec4 index2;
+    };
+
+    //! The DrawArraysIndirectCommand.
+    struct DrawCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint first;
+        GLuint baseInstance;
+    };
+
+    //! The DrawElementsIndirectCommand, for a mesh.  The
+    //! count of instances is in the same place, so the
+    //! compute shader and readDrawn serve both.
+    struct ElementsCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    Shader *program;
+    unsigned int buffers[NUM_BUFFERS];
+    int count, viewCount;
+    //! The indices of the mesh drawn, or zero for the cube.
+    int indexCount;
+    float radius;
+    //! Kept from frame to frame for the drifting places.
+    vector<vec4> positions;
+};
+
+#endif // GPUCULL_H
@@ -0,0 +1,336 @@
+/*******************************************************************
+ * HeadlessBench:  A class to run the cloud of cubes without a
+ * window for a fixed number of frames along a scripted camera
+ * path and report the frame times.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "headlessbench.h"
+
+HeadlessBench::HeadlessBench(Options &options)
+{
+    LOG_DEBUG(STARTUP, "Creating HeadlessBench.");
+    this->options = options;
+    governor = QualityGovernor(options.budget);
+    context = NULL;
+    loaderContext = NULL;
+    core = NULL;
+    camera = NULL;
+    path = NULL;
+    sim = NULL;
+    capture = NULL;
+    metrics = NULL;
+}
+
+HeadlessBench::~HeadlessBench()
+{
+    LOG_DEBUG(STARTUP, "Destroying HeadlessBench.");
+    delete metrics;
+    delete capture;
+    delete sim;
+    delete path;
+    delete camera;
+    //! The OpenGL objects go before the contexts, and the
+    //! shared one before the display.
+    delete core;
+    delete loaderContext;
+    delete context;
+}
+
+int HeadlessBench::run()
+{
+    CameraPath::Path_Type type;
+    if (!CameraPath::fromName(options.cameraPath, type))
+    {
+        LOG_ERROR(STARTUP, "Unknown camera path {}.", options.cameraPath);
+        return 1;
+    }
+    //! A play back starts from the recorded settings and
+    //! lasts as long as the session did.
+    if (!options.replay.empty())
+    {
+        if (!recording.open(options.replay))
+        {
+            return 1;
+        }
+        options.useRecording(recording.getHeader());
+        double seconds = (double) recording.getHeader().ticks / options.tickRate;
+        options.frames = std::max(1, (int) ceil(seconds * 1000.0 / frameMs));
+    }
+    context = new HeadlessContext();
+    chrono::steady_clock::time_point since = chrono::steady_clock::now();
+    {
+        TRACE_SCOPE("eglContext");
+        if (!context->create(options.width, options.height))
+        {
+            return 1;
+        }
+        if (options.streaming)
+        {
+            loaderContext = new HeadlessContext();
+            if (!loaderContext->createShared(*context))
+            {
+                delete loaderContext;
+                loaderContext = NULL;
+            }
+        }
+    }
+    if (options.metricsPort > 0)
+    {
+        metrics = new MetricsServer();
+        metrics->addPhase({ "egl", chrono::duration<double>(
+        chrono::steady_clock::now() - since).count() });
+    }
+    core = new RenderCore(options.count);
+    if (!core->initGL())
+    {
+        return 1;
+    }
+    if (!context->createFramebuffer())
+    {
+        return 1;
+    }
+    core->framebufferSize(options.width, options.height);
+    core->configureShaders(options.dynamicShaders, options.highPrecision);
+    core->configureViews(options.views);
+    core->configureTransparency(options.oit);
+    core->configureGpuCull(options.gpuCull);
+    core->configureMesh(options.mesh);
+    core->configureStreaming(options.streaming, since, loaderContext);
+    core->enableSkybox(options.skybox);
+    if (!core->createScene(options.seed, options.threads, options.loadScene))
+    {
+        return 1;
+    }
+    if ((!options.saveScene.empty()) && (!core->cloud->saveScene(options.saveScene)))
+    {
+        return 1;
+    }
+    if (metrics != NULL)
+    {
+        const vector<StartupPhase> &phases = core->getPhases();
+        for (unsigned int x = 0; x < phases.size(); x++)
+        {
+            metrics->addPhase(phases[x]);
+        }
+        if (!metrics->start(options.metricsPort))
+        {
+            return 1;
+        }
+    }
+    camera = new Camera(options.width, options.height);
+    path = new CameraPath(type);
+    if (!options.replay.empty())
+    {
+        const float *start = recording.getHeader().start;
+        sim = new Simulation(options.width, options.height,
+        vec3(start[0], start[1], start[2]), options.tickRate);
+        sim->setFeatures(options.shLighting, options.skybox, options.reflection,
+        options.depthPrepass, options.drift, options.hud);
+        sim->setViews(options.views, options.viewSpacing);
+        sim->setPlayer(&recording);
+        sim->startStepped();
+    }
+    //! Let the driver settle before anything is measured.
+    for (int x = 0; x < options.warmup; x++)
+    {
+        TRACE_SCOPE("warmup");
+        chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+        //! A play back warms up on its first frame.
+        renderAt((sim != NULL) ? 0 : x, options.warmup);
+        glFinish();
+        governor.frameDone(chrono::duration<double, milli>(
+        chrono::steady_clock::now() - begin).count());
+    }
+    glFinish();
+    //! The measured frames all show every picture, so they
+    //! are the same from run to run.
+    core->finishLoading();
+    if (!options.capture.empty())
+    {
+        capture = new FrameCapture(options.capture, options.captureRaw
+        ? FrameCapture::FORMAT_RAW : FrameCapture::FORMAT_PNG,
+        options.captureFirst, options.captureCount);
+    }
+    stats.reset(options.frames);
+    double drawn = 0.0;
+    //! The allocations of the measured frames, and how many
+    //! frames allocated on this thread at all.
+    AllocTracker::Counts allocBefore, allocAfter;
+    AllocTracker::snapshot(allocBefore);
+    int allocFrames = 0;
+    int lastDrawn = 0;
+    for (int x = 0; x < options.frames; x++)
+    {
+        unsigned long allocs = AllocTracker::threadAllocs();
+        chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+        TRACE_SCOPE("frame");
+        renderAt(x, options.frames);
+        //! The capture counts in the frame time, so the
+        //! cost of it shows.
+        if (capture != NULL)
+        {
+            capture->frameDone(x, options.width, options.height);
+        }
+        {
+            TRACE_SCOPE("glFinish");
+            glFinish();
+        }
+        chrono::steady_clock::time_point end = chrono::steady_clock::now();
+        double ms = chrono::duration<double, milli>(end - begin).count();
+        stats.addFrame(ms);
+        governor.frameDone(ms);
+        //! Counted after the frame is timed, since the GPU
+        //! cull has to finish to be counted.
+        int frameDrawn = core->getDrawn();
+        drawn += frameDrawn;
+        lastDrawn = frameDrawn;
+        if (metrics != NULL)
+        {
+            metrics->loadTimes(core->getFirstFrameSeconds(), core->getLoadedSeconds());
+            metrics->frameDone(ms, core->getCpuMs(), frameDrawn, core->cloud->getCount(),
+            core->getDrawCalls(), core->getUploadBytes(), core->getTextureBytes());
+        }
+        if (AllocTracker::threadAllocs() != allocs)
+        {
+            allocFrames++;
+        }
+    }
+    AllocTracker::snapshot(allocAfter);
+    if (metrics != NULL)
+    {
+        metrics->stop();
+    }
+    //! The reports follow the messages before them.
+    Logger::instance().flush();
+    if (capture != NULL)
+    {
+        capture->finish();
+    }
+    stringstream title;
+    title << "Headless " << options.width << "x" << options.height
+    << " cubes " << core->cloud->getCount() << " path "
+    << ((sim != NULL) ? "replay " + options.replay : options.cameraPath);
+    if (options.loadScene.empty())
+    {
+        title << " seed " << options.seed;
+    }
+    else
+    {
+        title << " scene " << options.loadScene;
+    }
+    if (!options.mesh.empty())
+    {
+        title << " mesh " << options.mesh;
+    }
+    if (options.budget > 0.0)
+    {
+        title << " budget " << options.budget << " ms ended at scale "
+        << governor.getScale() << " quality " << governor.getLevel();
+    }
+    title << " lighting " << (options.shLighting ? "sh" : "lights")
+    << " shaders " << (options.dynamicShaders ? "dynamic" : "variants")
+    << " skybox " << (options.reflection ? "reflect" : (options.skybox ? "on" : "off"))
+    << " prepass " << (options.depthPrepass ? "on" : "off")
+    << " drift " << (options.drift ? "on" : "off")
+    << " cull " << (options.gpuCull ? "gpu" : (options.cull ? "on" : "off"))
+    << " views " << options.views
+    << " transparency " << (options.oit ? "oit" : "opaque")
+    << " streaming " << (options.streaming ? "on" : "off")
+    << " capture " << (options.capture.empty() ? "off" : (options.captureRaw ? "raw" : "png"))
+    << " renderer " << glGetString(GL_RENDERER);
+    stats.report(title.str(), core->cloud->getCount());
+    //! Pick through the middle of the last frame, so the
+    //! picking can be timed without a window.
+    float distance = 0.0f;
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    int cube = core->pick(last, options.width / 2.0f, options.height / 2.0f, distance);
+    double us = chrono::duration<double, micro>(chrono::steady_clock::now() - begin).count();
+    cout << fixed << setprecision(3)
+    << "\tCubes drawn:  " << drawn / std::max(1, options.frames) << " a frame"
+    << "\n\tBVH nodes:    " << core->cloud->getBvh().getNodes()
+    << "\n\tPick us:      " << us << ", cube " << cube;
+    if (cube >= 0)
+    {
+        cout << " " << distance << " away";
+    }
+    cout << "\n\tFirst frame:  " << core->getFirstFrameSeconds() << " s after launch"
+    << "\n\tLoaded:       " << core->getLoadedSeconds() << " s after launch";
+    MeshImport *mesh = core->getMesh();
+    if (mesh != NULL)
+    {
+        cout << "\n\tMesh:         " << mesh->indices.size() / 3 << " triangles, "
+        << mesh->vertices.size() << " vertices, ACMR " << mesh->acmrBefore
+        << " before, " << mesh->acmrAfter << " after, " << mesh->clusters << " clusters";
+    }
+    cout << "\n";
+    cout.unsetf(ios_base::floatfield);
+    AllocTracker::report(allocBefore, allocAfter, options.frames);
+    cout << "\tFrames allocating:  " << allocFrames << " of " << options.frames << "\n\n";
+    if (options.assertZeroAlloc && (allocFrames > 0))
+    {
+        cout << "\tThe frames after the warm up must not allocate.\n\n";
+        return 1;
+    }
+    //! The views culled at once must keep every cube one
+    //! of them sees on its own, in the last frame.
+    if ((options.views > 1) && last.cull && !options.gpuCull && (options.frames > 0))
+    {
+        int seen = core->cullUnion(last);
+        cout << "\tViews culled:  " << lastDrawn << " drawn, " << seen
+        << " seen by one view or another\n\n";
+        if (seen != lastDrawn)
+        {
+            cout << "\tThe views together must draw every cube each one sees.\n\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void HeadlessBench::renderAt(int frame, int total)
+{
+    //! Time runs at sixty frames a second whatever the frame rate.
+    double ms = (double) frame * frameMs;
+    FrameParams params;
+    if (sim != NULL)
+    {
+        //! The recorded session, at simulated times.
+        sim->advance(ms / 1000.0);
+        sim->interpolate(sim->simulatedTime(ms / 1000.0), params);
+        params.cull = options.cull;
+        governor.apply(params);
+        core->renderFrame(params);
+        last = params;
+        return;
+    }
+    pathParams(options, *camera, *path, frame, total, params);
+    governor.apply(params);
+    core->renderFrame(params);
+    last = params;
+}
+
+void HeadlessBench::pathParams(const Options &options, Camera &camera, CameraPath &path,
+int frame, int total, FrameParams &params)
+{
+    double ms = (double) frame * frameMs;
+    path.apply(camera, (float) frame / (float) total);
+    params.projection = camera.GetPerspective();
+    params.view = camera.GetViewMatrix();
+    params.viewPos = camera.GetPosition();
+    params.viewCount = options.views;
+    camera.GetViews(options.views, options.viewSpacing, params.views, params.projections,
+    params.viewPositions);
+    params.degrees = (float) fmod(ms / 10.0, 360.0);
+    params.foggy = true;
+    params.minfog = 0.1f;
+    params.maxfog = 25.0f;
+    params.shLighting = options.shLighting;
+    params.skybox = options.skybox;
+    params.reflection = options.reflection;
+    params.depthPrepass = options.depthPrepass;
+    params.drift = options.drift;
+    params.hud = options.hud;
+    params.seconds = ms / 1000.0;
+    params.cull = options.cull;
+}
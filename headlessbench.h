@@ -0,0 +1,89 @@
+/*******************************************************************
+ * HeadlessBench:  A class to run the cloud of cubes without a
+ * window for a fixed number of frames along a scripted camera
+ * path and report the frame times.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef HEADLESSBENCH_H
+#define HEADLESSBENCH_H
+
+#include "commonheader.h"
+#include "options.h"
+#include "headlesscontext.h"
+#include "rendercore.h"
+#include "camera.h"
+#include "camerapath.h"
+#include "framestats.h"
+#include "qualitygovernor.h"
+#include "simulation.h"
+#include "framecapture.h"
+#include "metricsserver.h"
+#include "logger.h"
+#include "tracer.h"
+
+/** \class HeadlessBench
+ * Drives the RenderCore class from an EGL context into an
+ * offscreen framebuffer.  Animation time advances a fixed
+ * amount per frame instead of following the clock, so a
+ * given seed and camera path always renders the same frames.
+ * In place of a camera path it can play back a recorded
+ * session through a stepped simulation, which also renders
+ * the same frames every time.  Each frame is finished with
+ * glFinish before it is timed.
+ */
+class HeadlessBench
+{
+public:
+    HeadlessBench(Options &options);
+    ~HeadlessBench();
+
+    /** \brief run
+     * Runs the warm up and measured frames and prints the
+     * results.  Returns the program exit code.
+     */
+    int run();
+
+    /** \brief pathParams
+     * Fills params for the frame with the given number out
+     * of total, with the camera on its path and the
+     * features of options.  Animation time runs at sixty
+     * frames a second whatever the frame rate.
+     */
+    static void pathParams(const Options &options, Camera &camera, CameraPath &path,
+    int frame, int total, FrameParams &params);
+
+    //! Simulated milliseconds per frame, sixty frames a second.
+    constexpr static double frameMs = 1000.0 / 60.0;
+
+protected:
+    /** \brief renderAt
+     * Places the camera and draws the frame with the
+     * given number.
+     */
+    void renderAt(int frame, int total);
+
+    Options options;
+    HeadlessContext *context;
+    //! The context sharing context's objects that the
+    //! pictures are sent on, when they load in the
+    //! background.
+    HeadlessContext *loaderContext;
+    RenderCore *core;
+    Camera *camera;
+    CameraPath *path;
+    //! The simulation playing back a recorded session.
+    Simulation *sim;
+    InputRecord recording;
+    FrameStats stats;
+    QualityGovernor governor;
+    //! Saves the frames asked for with --capture.
+    FrameCapture *capture;
+    //! Serves the render statistics asked for with
+    //! --metrics-port.
+    MetricsServer *metrics;
+    //! The values the last frame was drawn with.
+    FrameParams last;
+};
+
+#endif // HEADLESSBENCH_H
@@ -0,0 +1,170 @@
+/*******************************************************************
+ * HeadlessContext:  A class to create an OpenGL context without
+ * a window using EGL, and an offscreen framebuffer to draw in.
+ * With no GPU present Mesa provides the llvmpipe software
+ * rasterizer.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "headlesscontext.h"
+
+HeadlessContext::HeadlessContext()
+{
+    LOG_DEBUG(STARTUP, "Creating HeadlessContext.");
+    display = EGL_NO_DISPLAY;
+    context = EGL_NO_CONTEXT;
+    config = NULL;
+    fbo = colorRB = depthRB = 0;
+    width = height = 0;
+    shared = false;
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    LOG_DEBUG(STARTUP, "Destroying HeadlessContext.");
+    destroy();
+}
+
+bool HeadlessContext::create(int width, int height)
+{
+    this->width = width;
+    this->height = height;
+    /** The surfaceless platform needs neither X nor a GPU.
+     * The function has to be looked up as it is an extension.
+     */
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+    (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay)
+    {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+    if (display == EGL_NO_DISPLAY)
+    {
+        LOG_WARN(STARTUP, "Surfaceless platform unavailable, using the default display.");
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    EGLint major = 0, minor = 0;
+    if ((display == EGL_NO_DISPLAY) || (!eglInitialize(display, &major, &minor)))
+    {
+        LOG_ERROR(STARTUP, "Unable to initialize EGL.");
+        return false;
+    }
+    LOG_INFO(STARTUP, "Using EGL Version: {}.{}", major, minor);
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        LOG_ERROR(STARTUP, "EGL does not provide desktop OpenGL.");
+        return false;
+    }
+    //! Nothing is drawn to an EGL surface, only to the framebuffer object.
+    EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_DONT_CARE,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLint numConfigs = 0;
+    if ((!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs))
+    || (numConfigs < 1))
+    {
+        LOG_ERROR(STARTUP, "No EGL configuration supports OpenGL.");
+        return false;
+    }
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+    if (context == EGL_NO_CONTEXT)
+    {
+        LOG_ERROR(STARTUP, "Unable to create the EGL context.");
+        return false;
+    }
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+    {
+        LOG_ERROR(STARTUP, "Unable to make the EGL context current.");
+        return false;
+    }
+    return true;
+}
+
+bool HeadlessContext::createShared(HeadlessContext &parent)
+{
+    display = parent.display;
+    config = parent.config;
+    shared = true;
+    context = eglCreateContext(display, config, parent.context, NULL);
+    if (context == EGL_NO_CONTEXT)
+    {
+        LOG_WARN(STARTUP, "Unable to create a shared EGL context.");
+        return false;
+    }
+    return true;
+}
+
+bool HeadlessContext::makeCurrent()
+{
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+    {
+        LOG_ERROR(STARTUP, "Unable to make the EGL context current.");
+        return false;
+    }
+    return true;
+}
+
+void HeadlessContext::release()
+{
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+bool HeadlessContext::createFramebuffer()
+{
+    //! Color and depth go to renderbuffers, nothing is sampled.
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glGenRenderbuffers(1, &colorRB);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRB);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRB);
+    glGenRenderbuffers(1, &depthRB);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRB);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRB);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        LOG_ERROR(RENDER, "The offscreen framebuffer is not complete.");
+        return false;
+    }
+    return true;
+}
+
+void HeadlessContext::destroy()
+{
+    if (display == EGL_NO_DISPLAY)
+    {
+        return;
+    }
+    if (context != EGL_NO_CONTEXT)
+    {
+        if (fbo)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glDeleteRenderbuffers(1, &colorRB);
+            glDeleteRenderbuffers(1, &depthRB);
+            glDeleteFramebuffers(1, &fbo);
+            fbo = colorRB = depthRB = 0;
+        }
+        //! A shared context is current on no thread here.
+        if (!shared)
+        {
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        }
+        eglDestroyContext(display, context);
+        context = EGL_NO_CONTEXT;
+    }
+    if (!shared)
+    {
+        eglTerminate(display);
+    }
+    display = EGL_NO_DISPLAY;
+}
+
+GLuint HeadlessContext::getFramebuffer()
+{
+    return fbo;
+}
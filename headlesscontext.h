@@ -0,0 +1,79 @@
+/*******************************************************************
+ * HeadlessContext:  A class to create an OpenGL context without
+ * a window using EGL, and an offscreen framebuffer to draw in.
+ * With no GPU present Mesa provides the llvmpipe software
+ * rasterizer.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef HEADLESSCONTEXT_H
+#define HEADLESSCONTEXT_H
+
+#include "commonheader.h"
+#include "logger.h"
+
+/** \class HeadlessContext
+ * Creates an EGL display on the Mesa surfaceless platform
+ * (or the default display if that is not available), a
+ * desktop OpenGL context made current without a surface,
+ * and a framebuffer object with color and depth
+ * renderbuffers the size of the requested image.  A second
+ * context sharing the textures and buffers of the first can
+ * be made for another thread to load with.
+ */
+class HeadlessContext
+{
+public:
+    HeadlessContext();
+    ~HeadlessContext();
+
+    /** \brief create
+     * Creates the context and makes it current.
+     * Returns false on failure.
+     */
+    bool create(int width, int height);
+
+    /** \brief createShared
+     * Creates a context on the display of parent that shares
+     * its objects, not made current.  The parent must
+     * outlive it.  Returns false on failure.
+     */
+    bool createShared(HeadlessContext &parent);
+
+    /** \brief makeCurrent
+     * Makes the context current on the calling thread.
+     */
+    bool makeCurrent();
+
+    /** \brief release
+     * Leaves the calling thread without a context.
+     */
+    void release();
+
+    /** \brief createFramebuffer
+     * Creates the framebuffer object and leaves it bound.
+     * Must be called after GLEW has been initialized.
+     */
+    bool createFramebuffer();
+
+    /** \brief destroy
+     * Releases the framebuffer, the context and the display.
+     */
+    void destroy();
+
+    /** \brief getFramebuffer
+     * Accessor function.
+     */
+    GLuint getFramebuffer();
+
+protected:
+    EGLDisplay display;
+    EGLContext context;
+    EGLConfig config;
+    GLuint fbo, colorRB, depthRB;
+    int width, height;
+    //! A shared context leaves the display to its parent.
+    bool shared;
+};
+
+#endif // HEADLESSCONTEXT_H
@@ -0,0 +1,362 @@
+/*******************************************************************
+ * Hud:  A class to show how the drawing is doing over the
+ * frame:  the frame rate, the CPU and GPU time of a frame,
+ * the cubes drawn and culled, the draw calls and the bytes
+ * sent, and a graph of the last frame times.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "hud.h"
+
+//! The characters of the font after the solid cell, and
+//! their rows of five pixels from the top, the leftmost
+//! in the highest bit.
+static const char FONT_CHARS[] = " 0123456789.:/%-ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+static const unsigned char FONT_ROWS[][7] =
+{
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+    { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E },
+    { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E },
+    { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F },
+    { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E },
+    { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 },
+    { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E },
+    { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E },
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 },
+    { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E },
+    { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C },
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C },
+    { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 },
+    { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 },
+    { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 },
+    { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 },
+    { 0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11 },
+    { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E },
+    { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E },
+    { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C },
+    { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F },
+    { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 },
+    { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F },
+    { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 },
+    { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E },
+    { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C },
+    { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 },
+    { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F },
+    { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 },
+    { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 },
+    { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E },
+    { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 },
+    { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D },
+    { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 },
+    { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E },
+    { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 },
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E },
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 },
+    { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A },
+    { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 },
+    { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 },
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F }
+};
+static_assert(sizeof(FONT_ROWS) / sizeof(FONT_ROWS[0]) == sizeof(FONT_CHARS) - 1,
+"A row for every character of the font.");
+
+Hud::Hud()
+{
+    LOG_DEBUG(STARTUP, "Creating Hud.");
+    program = NULL;
+    VAO = quadBuffer = fontTexture = 0;
+    glyphCount = 1;
+    memset(cells, 1, sizeof(cells));
+    quadCount = 0;
+    memset(lines, 0, sizeof(lines));
+    for (int x = 0; x < GRAPH_FRAMES; x++)
+    {
+        graph[x] = 0.0f;
+    }
+    graphNext = 0;
+    frames = gpuFrames = 0;
+    cpuSum = gpuSum = hudSum = 0.0;
+    last.cpuMs = 0.0;
+    last.drawn = last.total = last.drawCalls = 0;
+    last.uploadBytes = 0;
+    started = false;
+    hudMs = 0.0;
+    timing = false;
+    queryActive = false;
+    queryNext = queryPending = 0;
+}
+
+Hud::~Hud()
+{
+    LOG_DEBUG(STARTUP, "Destroying Hud.");
+    delete program;
+}
+
+void Hud::create()
+{
+    program = new Shader();
+    program->initShader("hudvec.glsl", "hudfrag.glsl", "hudshader.bin");
+    createFont();
+    //! The corners come from the vertex number and the rest
+    //! from the quads, one per instance.
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &quadBuffer);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, quadBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quads), NULL, GL_STREAM_DRAW);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Quad), (void*) offsetof(Quad, rect));
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Quad), (void*) offsetof(Quad, color));
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(Quad), (void*) offsetof(Quad, glyph));
+    for (int x = 0; x < 3; x++)
+    {
+        glEnableVertexAttribArray(x);
+        glVertexAttribDivisor(x, 1);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    //! Timer queries are not in OpenGL ES 3.0.
+    timing = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+    if (timing)
+    {
+        glGenQueries(QUERIES, queries);
+    }
+    else
+    {
+        LOG_INFO(RENDER, "No timer queries, the display shows no GPU time.");
+    }
+}
+
+void Hud::createFont()
+{
+    //! Cell zero is solid for the panel and the bars.
+    glyphCount = 1 + (int) strlen(FONT_CHARS);
+    for (int x = 1; x < glyphCount; x++)
+    {
+        char c = FONT_CHARS[x - 1];
+        cells[(int) c] = (unsigned char) x;
+        if ((c >= 'A') && (c <= 'Z'))
+        {
+            cells[c - 'A' + 'a'] = (unsigned char) x;
+        }
+    }
+    int width = glyphCount * CELL_WIDTH;
+    vector<unsigned char> pixels(width * CELL_HEIGHT, 0);
+    for (int y = 0; y < CELL_HEIGHT; y++)
+    {
+        for (int x = 0; x < CELL_WIDTH; x++)
+        {
+            pixels[y * width + x] = 255;
+        }
+    }
+    //! The rows go up from the bottom of the texture, with
+    //! a blank row below and a blank column to the right.
+    for (int g = 1; g < glyphCount; g++)
+    {
+        for (int row = 0; row < 7; row++)
+        {
+            unsigned char bits = FONT_ROWS[g - 1][row];
+            for (int column = 0; column < 5; column++)
+            {
+                if (bits & (0x10 >> column))
+                {
+                    pixels[(CELL_HEIGHT - 1 - row) * width + g * CELL_WIDTH + column] = 255;
+                }
+            }
+        }
+    }
+    glGenTextures(1, &fontTexture);
+    glBindTexture(GL_TEXTURE_2D, fontTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, CELL_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE,
+    pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Hud::beginGpu()
+{
+    //! With every query still waiting on the GPU the frame
+    //! goes untimed.
+    queryActive = timing && (queryPending < QUERIES);
+    if (queryActive)
+    {
+        glBeginQuery(GL_TIME_ELAPSED, queries[queryNext]);
+    }
+}
+
+void Hud::endGpu()
+{
+    if (queryActive)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        queryNext = (queryNext + 1) % QUERIES;
+        queryPending++;
+        queryActive = false;
+    }
+    //! The oldest first, as far as the GPU has got.
+    while (queryPending > 0)
+    {
+        unsigned int query = queries[(queryNext - queryPending + QUERIES) % QUERIES];
+        GLuint available = 0;
+        glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            break;
+        }
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+        gpuSum += (double) ns / 1000000.0;
+        gpuFrames++;
+        queryPending--;
+    }
+}
+
+bool Hud::countsDue()
+{
+    return !started || (chrono::duration<double, milli>(
+    chrono::steady_clock::now() - lastRefresh).count() >= REFRESH_MS);
+}
+
+void Hud::frameDone(const Stats &stats)
+{
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    //! After the display was off it starts over.
+    if (started && (chrono::duration<double, milli>(now - lastFrame).count() > RESTART_MS))
+    {
+        started = false;
+        frames = gpuFrames = 0;
+        cpuSum = gpuSum = hudSum = 0.0;
+    }
+    if (started)
+    {
+        graph[graphNext] = (float) chrono::duration<double, milli>(now - lastFrame).count();
+        graphNext = (graphNext + 1) % GRAPH_FRAMES;
+    }
+    else
+    {
+        started = true;
+        lastRefresh = now;
+    }
+    lastFrame = now;
+    frames++;
+    cpuSum += stats.cpuMs;
+    hudSum += hudMs;
+    last.total = stats.total;
+    last.drawCalls = stats.drawCalls;
+    last.uploadBytes = stats.uploadBytes;
+    if (stats.drawn >= 0)
+    {
+        last.drawn = stats.drawn;
+        double seconds = chrono::duration<double>(now - lastRefresh).count();
+        writeLines(seconds);
+        lastRefresh = now;
+    }
+}
+
+void Hud::writeLines(double seconds)
+{
+    double count = (double) std::max(1, frames);
+    snprintf(lines[0], LINE_LENGTH, "FPS    %.1f", (seconds > 0.0) ? frames / seconds : 0.0);
+    snprintf(lines[1], LINE_LENGTH, "CPU    %.2f MS", cpuSum / count);
+    if (gpuFrames > 0)
+    {
+        snprintf(lines[2], LINE_LENGTH, "GPU    %.2f MS", gpuSum / gpuFrames);
+    }
+    else
+    {
+        snprintf(lines[2], LINE_LENGTH, "GPU    %s", timing ? "-" : "N/A");
+    }
+    snprintf(lines[3], LINE_LENGTH, "CUBES  %d", last.drawn);
+    snprintf(lines[4], LINE_LENGTH, "CULLED %d", std::max(0, last.total - last.drawn));
+    snprintf(lines[5], LINE_LENGTH, "DRAWS  %d", last.drawCalls);
+    snprintf(lines[6], LINE_LENGTH, "UPLOAD %.1f KB", last.uploadBytes / 1024.0);
+    snprintf(lines[7], LINE_LENGTH, "HUD    %.3f MS", hudSum / count);
+    frames = gpuFrames = 0;
+    cpuSum = gpuSum = hudSum = 0.0;
+}
+
+void Hud::addQuad(float x, float y, float width, float height, vec4 color, int glyph)
+{
+    if (quadCount >= MAX_QUADS)
+    {
+        return;
+    }
+    Quad &quad = quads[quadCount++];
+    quad.rect = vec4(x, y, width, height);
+    quad.color = color;
+    quad.glyph = (float) glyph;
+}
+
+void Hud::addText(float x, float y, const char *text, vec4 color)
+{
+    const float advance = (float) (CELL_WIDTH * SCALE);
+    for (const char *c = text; *c != '\0'; c++)
+    {
+        if (*c != ' ')
+        {
+            addQuad(x, y, advance, (float) (CELL_HEIGHT * SCALE), color, cells[*c & 0x7F]);
+        }
+        x += advance;
+    }
+}
+
+void Hud::draw(int width, int height)
+{
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    const float margin = 8.0f, pad = 6.0f, bar = 2.0f, graphHeight = 60.0f;
+    const float lineHeight = (float) (CELL_HEIGHT * SCALE);
+    float left = margin + pad;
+    float top = margin + pad;
+    float panelWidth = std::max((float) (LINE_LENGTH * CELL_WIDTH * SCALE), GRAPH_FRAMES * bar)
+    + 2.0f * pad;
+    float panelHeight = LINES * lineHeight + graphHeight + 3.0f * pad;
+    quadCount = 0;
+    addQuad(margin, margin, panelWidth, panelHeight, vec4(0.0f, 0.0f, 0.0f, 0.6f), 0);
+    for (int x = 0; x < LINES; x++)
+    {
+        addText(left, top + x * lineHeight, lines[x], vec4(1.0f, 1.0f, 1.0f, 1.0f));
+    }
+    //! The oldest frame on the left, green within sixty
+    //! frames a second, yellow within thirty, else red.
+    float bottom = top + LINES * lineHeight + pad + graphHeight;
+    for (int x = 0; x < GRAPH_FRAMES; x++)
+    {
+        float ms = graph[(graphNext + x) % GRAPH_FRAMES];
+        float barHeight = std::min(ms / (float) GRAPH_MS, 1.0f) * graphHeight;
+        if (barHeight <= 0.0f)
+        {
+            continue;
+        }
+        vec4 color = (ms <= 16.7f) ? vec4(0.2f, 0.9f, 0.2f, 0.9f)
+        : ((ms <= 33.3f) ? vec4(0.9f, 0.9f, 0.2f, 0.9f) : vec4(0.9f, 0.2f, 0.2f, 0.9f));
+        addQuad(left + x * bar, bottom - barHeight, bar, barHeight, color, 0);
+    }
+    addQuad(left, bottom - 16.7f / (float) GRAPH_MS * graphHeight, GRAPH_FRAMES * bar, 1.0f,
+    vec4(1.0f, 1.0f, 1.0f, 0.5f), 0);
+    //! A new store each frame, so the last frame's draw is
+    //! not waited for.
+    glBindBuffer(GL_ARRAY_BUFFER, quadBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quads), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, quadCount * sizeof(Quad), quads);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    //! Over everything, blended.
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    program->Use();
+    program->setVec2("screen", vec2((float) width, (float) height));
+    program->setFloat("glyphs", (float) glyphCount);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, fontTexture);
+    program->setInt("font", 0);
+    glBindVertexArray(VAO);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, quadCount);
+    glBindVertexArray(0);
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+    hudMs = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+}
@@ -0,0 +1,138 @@
+/*******************************************************************
+ * Hud:  A class to show how the drawing is doing over the
+ * frame:  the frame rate, the CPU and GPU time of a frame,
+ * the cubes drawn and culled, the draw calls and the bytes
+ * sent, and a graph of the last frame times.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef HUD_H
+#define HUD_H
+
+#include "commonheader.h"
+#include "shader.h"
+#include "logger.h"
+
+/** \class Hud
+ * Every letter, bar and the panel behind them is a quad
+ * with a rectangle, a color and a cell of a small font
+ * built in, cell zero solid, all drawn in one instanced
+ * draw.  The numbers are written a few times a second,
+ * averaged since the last time, so they can be read; the
+ * graph moves every frame.  The GPU time comes from timer
+ * queries read a few frames later, so the frame never
+ * waits for them, and shows as n/a without them.  Nothing
+ * is allocated after create.
+ */
+class Hud
+{
+public:
+    //! What a frame cost, as the renderer counted it.
+    struct Stats {
+        double cpuMs;
+        int drawn, total;
+        int drawCalls;
+        size_t uploadBytes;
+    };
+
+    Hud();
+    ~Hud();
+
+    /** \brief create
+     * Builds the program, the font and the quad buffer.
+     */
+    void create();
+
+    /** \brief beginGpu
+     * Starts timing the GPU work of a frame, if it can.
+     */
+    void beginGpu();
+
+    /** \brief endGpu
+     * Stops timing the frame and takes the time of any
+     * earlier frame the GPU has finished.
+     */
+    void endGpu();
+
+    /** \brief countsDue
+     * Whether the numbers are written this frame, so the
+     * cubes drawn are wanted, which the GPU cull has to
+     * wait for.
+     */
+    bool countsDue();
+
+    /** \brief frameDone
+     * Adds a frame, with drawn taken only when countsDue.
+     */
+    void frameDone(const Stats &stats);
+
+    /** \brief draw
+     * Draws the display over the top left of a window
+     * width by height, into the bound framebuffer.
+     */
+    void draw(int width, int height);
+
+protected:
+    //! A quad as hudvec.glsl reads it.
+    struct Quad {
+        vec4 rect;
+        vec4 color;
+        float glyph;
+    };
+
+    //! Frame times in the graph, and the quads it can take.
+    static const int GRAPH_FRAMES = 120;
+    static const int MAX_QUADS = 512;
+    //! Lines of numbers, and the letters in a line.
+    static const int LINES = 8;
+    static const int LINE_LENGTH = 24;
+    //! The size of a font cell, and how much it is blown up.
+    static const int CELL_WIDTH = 6;
+    static const int CELL_HEIGHT = 8;
+    static const int SCALE = 2;
+    //! Timer queries in flight.
+    static const int QUERIES = 4;
+    //! How often the numbers are written, in milliseconds,
+    //! and the frame time at the top of the graph.
+    constexpr static double REFRESH_MS = 250.0;
+    constexpr static double GRAPH_MS = 33.3;
+    //! A gap between frames that starts the numbers over.
+    constexpr static double RESTART_MS = 1000.0;
+
+    //! Adds a quad, if there is room.
+    void addQuad(float x, float y, float width, float height, vec4 color, int glyph);
+    //! Adds the letters of a line.
+    void addText(float x, float y, const char *text, vec4 color);
+    //! Writes the lines from the sums of the seconds since
+    //! the last time.
+    void writeLines(double seconds);
+    //! Makes the font texture.
+    void createFont();
+
+    Shader *program;
+    unsigned int VAO, quadBuffer, fontTexture;
+    int glyphCount;
+    //! The cell of each character, the unknown ones blank.
+    unsigned char cells[128];
+    Quad quads[MAX_QUADS];
+    int quadCount;
+    char lines[LINES][LINE_LENGTH];
+    //! The graph, a ring of frame times.
+    float graph[GRAPH_FRAMES];
+    int graphNext;
+    //! The sums since the numbers were last written.
+    int frames, gpuFrames;
+    double cpuSum, gpuSum, hudSum;
+    Stats last;
+    chrono::steady_clock::time_point lastFrame, lastRefresh;
+    bool started;
+    //! The CPU time of the last draw of the display.
+    double hudMs;
+    //! The timer queries, the next one to start and those
+    //! waiting for the GPU.
+    bool timing, queryActive;
+    unsigned int queries[QUERIES];
+    int queryNext, queryPending;
+};
+
+#endif // HUD_H
@@ -0,0 +1,158 @@
+/*******************************************************************
+ * InputRecord:  A class to write and read the input of a session
+ * as a compact binary file, keyed by simulation tick, so the
+ * session can be played back and measured as often as needed.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "inputrecord.h"
+
+static_assert(sizeof(InputRecord::Header) == 80, "The input header must be 80 bytes.");
+static_assert(sizeof(InputRecord::Record) == 16, "An input record must be 16 bytes.");
+
+InputRecord::InputRecord()
+{
+    written = 0;
+    cursor = 0;
+    memset(&outHeader, 0, sizeof(outHeader));
+    memset(&header, 0, sizeof(header));
+}
+
+InputRecord::~InputRecord()
+{
+    if (out.is_open())
+    {
+        out.close();
+    }
+}
+
+bool InputRecord::create(string path, const Header &settings)
+{
+    out.open(path.c_str(), ios::out | ios::binary | ios::trunc);
+    if (!out)
+    {
+        LOG_ERROR(FILE, "Error creating input file {}.", path);
+        return false;
+    }
+    outPath = path;
+    outHeader = settings;
+    written = 0;
+    //! The counts are filled in by finish.
+    Header blank;
+    memset(&blank, 0, sizeof(blank));
+    out.write((const char*) &blank, sizeof(blank));
+    return (bool) out;
+}
+
+void InputRecord::append(const Record &record)
+{
+    out.write((const char*) &record, sizeof(Record));
+    written++;
+}
+
+bool InputRecord::finish(uint64_t ticks)
+{
+    if (!out.is_open())
+    {
+        return false;
+    }
+    Header head = outHeader;
+    memcpy(head.magic, "SFCINPUT", 8);
+    head.byteOrder = BYTE_ORDER_MARK;
+    head.version = VERSION;
+    head.headerSize = sizeof(Header);
+    head.recordSize = sizeof(Record);
+    head.count = written;
+    head.ticks = ticks;
+    memset(head.reserved, 0, sizeof(head.reserved));
+    out.seekp(0);
+    out.write((const char*) &head, sizeof(head));
+    out.close();
+    if (!out)
+    {
+        LOG_ERROR(FILE, "Error writing input file {}.", outPath);
+        return false;
+    }
+    LOG_INFO(INPUT, "Recorded {} input events over {} ticks to {}.", written, ticks, outPath);
+    return true;
+}
+
+bool InputRecord::open(string path)
+{
+    records.clear();
+    cursor = 0;
+    std::ifstream in(path.c_str(), ios::in | ios::binary);
+    if (!in)
+    {
+        LOG_ERROR(FILE, "Error opening input file {}.", path);
+        return false;
+    }
+    //! The files are small, so read the whole thing.
+    vector<char> data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    string problem;
+    if (data.size() < sizeof(Header))
+    {
+        problem = "is too short";
+    }
+    else
+    {
+        memcpy(&header, &data[0], sizeof(Header));
+        if (memcmp(header.magic, "SFCINPUT", 8) != 0)
+        {
+            problem = "is not an input file";
+        }
+        else if (header.byteOrder != BYTE_ORDER_MARK)
+        {
+            problem = "was written with the other byte order";
+        }
+        else if ((header.version < 1) || (header.version > VERSION))
+        {
+            problem = "has a version this program does not read";
+        }
+        else if ((header.headerSize < sizeof(Header)) || (header.recordSize < sizeof(Record)))
+        {
+            problem = "has a header or record smaller than version 1";
+        }
+        else if ((header.headerSize > data.size())
+        || (header.count > (data.size() - header.headerSize) / header.recordSize))
+        {
+            problem = "is shorter than its record count";
+        }
+        else if (header.tickRate <= 0.0)
+        {
+            problem = "has no tick rate";
+        }
+    }
+    if (!problem.empty())
+    {
+        LOG_ERROR(FILE, "Input file {} {}.", path, problem);
+        return false;
+    }
+    records.resize(header.count);
+    for (uint64_t x = 0; x < header.count; x++)
+    {
+        memcpy(&records[x], &data[header.headerSize + x * header.recordSize], sizeof(Record));
+        //! The events must be in tick order to play back.
+        if ((x > 0) && (records[x].tick < records[x - 1].tick))
+        {
+            LOG_ERROR(FILE, "Input file {} has events out of order.", path);
+            records.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+const InputRecord::Record *InputRecord::next(uint64_t tick)
+{
+    if ((cursor < records.size()) && (records[cursor].tick <= tick))
+    {
+        return &records[cursor++];
+    }
+    return NULL;
+}
+
+const InputRecord::Header &InputRecord::getHeader()
+{
+    return header;
+}
@@ -0,0 +1,150 @@
+/*******************************************************************
+ * InputRecord:  A class to write and read the input of a session
+ * as a compact binary file, keyed by simulation tick, so the
+ * session can be played back and measured as often as needed.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef INPUTRECORD_H
+#define INPUTRECORD_H
+
+#include "commonheader.h"
+#include "logger.h"
+
+/** \class InputRecord
+ * The file is an 80 byte header followed by one 16 byte
+ * record per input event, in the byte order of the machine
+ * that wrote it:
+ *
+ *     offset  size  header field
+ *          0     8  magic "SFCINPUT"
+ *          8     4  byte order mark 0x01020304
+ *         12     4  version, 1
+ *         16     4  header size, 80 or more
+ *         20     4  record size, 16 or more
+ *         24     8  number of records
+ *         32     8  simulation ticks the session lasted
+ *         40     8  simulation ticks per second
+ *         48     4  seed the cubes were generated from
+ *         52     4  number of cubes
+ *         56     4  flags, see the FLAG constants
+ *         60    12  camera start x, y, z
+ *         72     1  views, 0 in files from before it was kept
+ *         73     3  reserved, zero
+ *         76     4  view spacing
+ *
+ *     offset  size  record field
+ *          0     4  tick the event was applied in
+ *          4     1  event type, see Simulation::Event_Type
+ *          5     1  action, see Simulation::Sim_Action
+ *          6     2  reserved, zero
+ *          8     8  mouse x and y offsets
+ *
+ * An event is kept with the tick the simulation applied it
+ * in, not the time it arrived, so playing it back at the
+ * same tick moves the simulation exactly as before whatever
+ * the frame rate.  The header holds what else the session
+ * started from.  Readers skip header or record bytes past
+ * the ones they know.
+ */
+class InputRecord
+{
+public:
+    //! One input event as it is stored in the file.
+    struct Record {
+        uint32_t tick;
+        uint8_t type;
+        uint8_t action;
+        uint8_t reserved[2];
+        float xoffset, yoffset;
+    };
+
+    //! The start of the file.
+    struct Header {
+        char magic[8];
+        uint32_t byteOrder;
+        uint32_t version;
+        uint32_t headerSize;
+        uint32_t recordSize;
+        uint64_t count;
+        uint64_t ticks;
+        double tickRate;
+        uint32_t seed;
+        uint32_t cubes;
+        uint32_t flags;
+        float start[3];
+        uint8_t views;
+        uint8_t reserved[3];
+        float viewSpacing;
+    };
+
+    constexpr static uint32_t VERSION = 1;
+    constexpr static uint32_t BYTE_ORDER_MARK = 0x01020304;
+    //! The features the session started with, and whether
+    //! the cubes came from a scene file in place of the seed
+    //! or were replaced by a mesh.  The cull is on unless
+    //! FLAG_NO_CULL is set.
+    constexpr static uint32_t FLAG_SH_LIGHTING = 1;
+    constexpr static uint32_t FLAG_SKYBOX = 2;
+    constexpr static uint32_t FLAG_REFLECTION = 4;
+    constexpr static uint32_t FLAG_PREPASS = 8;
+    constexpr static uint32_t FLAG_SCENE_FILE = 16;
+    constexpr static uint32_t FLAG_DRIFT = 32;
+    constexpr static uint32_t FLAG_OIT = 64;
+    constexpr static uint32_t FLAG_GPU_CULL = 128;
+    constexpr static uint32_t FLAG_NO_CULL = 256;
+    constexpr static uint32_t FLAG_DYNAMIC_SHADERS = 512;
+    constexpr static uint32_t FLAG_HIGH_PRECISION = 1024;
+    constexpr static uint32_t FLAG_MESH = 2048;
+
+    InputRecord();
+    ~InputRecord();
+
+    /** \brief create
+     * Starts a new file for a session with the settings in
+     * the header given; the counts are filled in by finish.
+     * Returns false if the file cannot be opened.
+     */
+    bool create(string path, const Header &settings);
+
+    /** \brief append
+     * Writes one event to the end of a file being created.
+     */
+    void append(const Record &record);
+
+    /** \brief finish
+     * Writes the event count and the length of the session
+     * in ticks to the header and closes the file.
+     */
+    bool finish(uint64_t ticks);
+
+    /** \brief open
+     * Reads a whole file and checks it.  Returns false,
+     * saying why, if it cannot be played back.
+     */
+    bool open(string path);
+
+    /** \brief next
+     * The next event to play back in the given tick, or
+     * NULL when there are no more for that tick.
+     */
+    const Record *next(uint64_t tick);
+
+    /** \brief getHeader
+     * The header of an open file.
+     */
+    const Header &getHeader();
+
+protected:
+    //! The file being written.
+    std::ofstream out;
+    string outPath;
+    Header outHeader;
+    uint64_t written;
+    //! The file being played back.
+    Header header;
+    vector<Record> records;
+    size_t cursor;
+};
+
+#endif // INPUTRECORD_H
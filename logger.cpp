@@ -0,0 +1,194 @@
+/*******************************************************************
+ * Logger:  A class to write the program's messages on a thread
+ * of its own, so the threads drawing and simulating never wait
+ * on the terminal.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "logger.h"
+
+atomic<int> Logger::threshold(Logger::LEVEL_INFO);
+
+Logger &Logger::instance()
+{
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+{
+    queued.store(0);
+    printed.store(0);
+    dropped.store(0);
+    stopping.store(false);
+    start = chrono::steady_clock::now();
+    writer = thread(&Logger::writerLoop, this);
+}
+
+Logger::~Logger()
+{
+    stopping.store(true);
+    writer.join();
+    //! Anything logged from here on is left out.
+    threshold.store(LEVEL_OFF);
+    if (dropped.load() > 0)
+    {
+        cout << "\n\n\t" << dropped.load() << " log messages were dropped.\n\n";
+    }
+}
+
+void Logger::setLevel(Log_Level level)
+{
+    threshold.store((int) level, memory_order_relaxed);
+}
+
+bool Logger::levelFromName(string name, Log_Level &level)
+{
+    const char *names[] = { "trace", "debug", "info", "warn", "error", "off" };
+    for (int x = 0; x <= LEVEL_OFF; x++)
+    {
+        if (name == names[x])
+        {
+            level = (Log_Level) x;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Logger::flush()
+{
+    unsigned long target = queued.load(memory_order_relaxed);
+    while (printed.load(memory_order_acquire) < target)
+    {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+}
+
+void Logger::pack(Record &record, bool value)
+{
+    if (Arg *arg = nextArg(record, ARG_BOOL))
+    {
+        arg->u = value ? 1 : 0;
+    }
+}
+
+void Logger::pack(Record &record, const char *value)
+{
+    Arg *arg = nextArg(record, ARG_TEXT);
+    if (arg == NULL)
+    {
+        return;
+    }
+    //! What does not fit is cut off, always leaving room
+    //! for the terminating zero.
+    arg->offset = record.used;
+    size_t room = TEXT_SIZE - record.used - 1;
+    size_t length = (value != NULL) ? std::min(strlen(value), room) : 0;
+    if (length > 0)
+    {
+        memcpy(&record.text[record.used], value, length);
+    }
+    record.text[record.used + length] = 0;
+    record.used += (uint16_t) std::min(length + 1, room);
+}
+
+void Logger::pack(Record &record, const unsigned char *value)
+{
+    pack(record, (const char*) value);
+}
+
+void Logger::pack(Record &record, const string &value)
+{
+    pack(record, value.c_str());
+}
+
+void Logger::pack(Record &record, vec3 value)
+{
+    if (Arg *arg = nextArg(record, ARG_VEC3))
+    {
+        arg->v[0] = value.x;
+        arg->v[1] = value.y;
+        arg->v[2] = value.z;
+    }
+}
+
+Logger::Arg *Logger::nextArg(Record &record, Arg_Kind kind)
+{
+    if (record.count >= MAX_ARGS)
+    {
+        return NULL;
+    }
+    Arg *arg = &record.args[record.count++];
+    arg->kind = (uint8_t) kind;
+    return arg;
+}
+
+uint8_t Logger::threadNumber()
+{
+    static atomic<int> threads(0);
+    thread_local uint8_t number = (uint8_t) threads.fetch_add(1);
+    return number;
+}
+
+void Logger::writerLoop()
+{
+    stringstream lines;
+    Record record;
+    while (true)
+    {
+        //! Print what has come in as one block.
+        unsigned long count = 0;
+        while (queue.pop(record))
+        {
+            format(record, lines);
+            count++;
+        }
+        if (count > 0)
+        {
+            cout << lines.str() << std::flush;
+            lines.str("");
+            printed.fetch_add(count, memory_order_release);
+            continue;
+        }
+        if (stopping.load())
+        {
+            return;
+        }
+        this_thread::sleep_for(chrono::milliseconds(IDLE_MS));
+    }
+}
+
+void Logger::format(const Record &record, ostream &out)
+{
+    const char *levels[] = { "TRACE", "DEBUG", "INFO", "WARN", "ERROR" };
+    const char *categories[NUM_CATEGORIES] = { "startup", "render", "input", "shader", "scene", "file" };
+    double seconds = chrono::duration<double>(record.stamp - start).count();
+    out << "\t" << fixed << setprecision(3) << setw(9) << seconds << " s  t" << (int) record.thread
+    << "  " << left << setw(6) << levels[record.level] << setw(8) << categories[record.category]
+    << right;
+    out.unsetf(ios_base::floatfield);
+    out << setprecision(6);
+    //! Each {} takes the next value.
+    int next = 0;
+    for (const char *c = record.format; *c != 0; c++)
+    {
+        if ((c[0] != '{') || (c[1] != '}') || (next >= record.count))
+        {
+            out << *c;
+            continue;
+        }
+        const Arg &arg = record.args[next++];
+        switch (arg.kind)
+        {
+            case ARG_SIGNED: out << arg.i; break;
+            case ARG_UNSIGNED: out << arg.u; break;
+            case ARG_DOUBLE: out << arg.d; break;
+            case ARG_BOOL: out << (arg.u ? "true" : "false"); break;
+            case ARG_TEXT: out << &record.text[arg.offset]; break;
+            case ARG_VEC3: out << "(" << arg.v[0] << ", " << arg.v[1] << ", " << arg.v[2] << ")"; break;
+        }
+        c++;
+    }
+    out << "\n";
+}
@@ -0,0 +1,264 @@
+/*******************************************************************
+ * Logger:  A class to write the program's messages on a thread
+ * of its own, so the threads drawing and simulating never wait
+ * on the terminal.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include "commonheader.h"
+#include "mpscqueue.h"
+
+/** The lowest level compiled in, 0 for trace up to 5 for
+ * none.  Set it with cmake -DLOG_LEVEL=N.  The messages
+ * below it are not compiled, so they cost nothing at all;
+ * those above it cost a compare when the --log-level at run
+ * time leaves them out.
+ */
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 1
+#endif
+
+#define LOG_AT(level, category, ...) \
+    do \
+    { \
+        if (Logger::enabled(Logger::level)) \
+        { \
+            Logger::instance().write(Logger::level, Logger::CATEGORY_##category, __VA_ARGS__); \
+        } \
+    } while (0)
+
+#if LOG_COMPILE_LEVEL <= 0
+#define LOG_TRACE(category, ...) LOG_AT(LEVEL_TRACE, category, __VA_ARGS__)
+#else
+#define LOG_TRACE(category, ...) do { } while (0)
+#endif
+#if LOG_COMPILE_LEVEL <= 1
+#define LOG_DEBUG(category, ...) LOG_AT(LEVEL_DEBUG, category, __VA_ARGS__)
+#else
+#define LOG_DEBUG(category, ...) do { } while (0)
+#endif
+#if LOG_COMPILE_LEVEL <= 2
+#define LOG_INFO(category, ...) LOG_AT(LEVEL_INFO, category, __VA_ARGS__)
+#else
+#define LOG_INFO(category, ...) do { } while (0)
+#endif
+#if LOG_COMPILE_LEVEL <= 3
+#define LOG_WARN(category, ...) LOG_AT(LEVEL_WARN, category, __VA_ARGS__)
+#else
+#define LOG_WARN(category, ...) do { } while (0)
+#endif
+#if LOG_COMPILE_LEVEL <= 4
+#define LOG_ERROR(category, ...) LOG_AT(LEVEL_ERROR, category, __VA_ARGS__)
+#else
+#define LOG_ERROR(category, ...) do { } while (0)
+#endif
+
+/** \class Logger
+ * The LOG_ macros hand a message to the logger as a format
+ * string, which must be a literal, and up to eight values,
+ * each put in place of a {} in the format.  The values are
+ * copied into a fixed record, strings cut short if they
+ * must be, and the record goes through a lock free ring to
+ * the logger's thread, which formats and prints it:
+ *
+ *     LOG_INFO(SCENE, "Scene of {} cubes loaded in {} ms.", count, ms);
+ *
+ *     0.412 s  t0  INFO  scene   Scene of 4800 cubes loaded in 12.5 ms.
+ *
+ * If the ring is full the message is dropped and counted,
+ * never waited for.
+ */
+class Logger
+{
+public:
+    //! How much a message matters.
+    enum Log_Level {
+        LEVEL_TRACE,
+        LEVEL_DEBUG,
+        LEVEL_INFO,
+        LEVEL_WARN,
+        LEVEL_ERROR,
+        LEVEL_OFF
+    };
+
+    //! What part of the program a message comes from.
+    enum Log_Category {
+        CATEGORY_STARTUP,
+        CATEGORY_RENDER,
+        CATEGORY_INPUT,
+        CATEGORY_SHADER,
+        CATEGORY_SCENE,
+        CATEGORY_FILE,
+        NUM_CATEGORIES
+    };
+
+    /** \brief instance
+     * The one logger, started on first use.
+     */
+    static Logger &instance();
+
+    /** \brief enabled
+     * Whether messages of a level are printed now.
+     */
+    static bool enabled(Log_Level level)
+    {
+        return (int) level >= threshold.load(memory_order_relaxed);
+    }
+
+    /** \brief setLevel
+     * The least level printed from now on.
+     */
+    static void setLevel(Log_Level level);
+
+    /** \brief levelFromName
+     * Reads trace, debug, info, warn, error or off.
+     * Returns false for any other name.
+     */
+    static bool levelFromName(string name, Log_Level &level);
+
+    /** \brief write
+     * Queues a message.  Use the LOG_ macros rather than
+     * calling this, so the message can be compiled out.
+     */
+    template <class... Args>
+    void write(Log_Level level, Log_Category category, const char *format, const Args&... args)
+    {
+        Record record;
+        record.level = (uint8_t) level;
+        record.category = (uint8_t) category;
+        record.count = 0;
+        record.used = 0;
+        record.format = format;
+        record.stamp = chrono::steady_clock::now();
+        record.thread = threadNumber();
+        (pack(record, args), ...);
+        if (queue.push(record))
+        {
+            queued.fetch_add(1, memory_order_relaxed);
+        }
+        else
+        {
+            dropped.fetch_add(1, memory_order_relaxed);
+        }
+    }
+
+    /** \brief flush
+     * Waits until every message queued so far is printed,
+     * so a report printed next comes after them.
+     */
+    void flush();
+
+protected:
+    Logger();
+    ~Logger();
+
+    //! The values a message can carry.
+    enum Arg_Kind {
+        ARG_SIGNED,
+        ARG_UNSIGNED,
+        ARG_DOUBLE,
+        ARG_BOOL,
+        ARG_TEXT,
+        ARG_VEC3
+    };
+
+    //! One value, strings kept in the record's text.
+    struct Arg {
+        uint8_t kind;
+        union {
+            int64_t i;
+            uint64_t u;
+            double d;
+            float v[3];
+            uint16_t offset;
+        };
+    };
+
+    static const int MAX_ARGS = 8;
+    static const int TEXT_SIZE = 96;
+    static const size_t RING_SIZE = 1024;
+
+    //! One message as it goes through the ring.
+    struct Record {
+        chrono::steady_clock::time_point stamp;
+        const char *format;
+        uint8_t level, category, count, thread;
+        uint16_t used;
+        Arg args[MAX_ARGS];
+        char text[TEXT_SIZE];
+    };
+
+    /** \brief pack
+     * Copies one value into a record.
+     */
+    template <class T>
+    typename enable_if<is_integral<T>::value && is_signed<T>::value>::type
+    pack(Record &record, T value)
+    {
+        if (Arg *arg = nextArg(record, ARG_SIGNED))
+        {
+            arg->i = value;
+        }
+    }
+    template <class T>
+    typename enable_if<is_integral<T>::value && !is_signed<T>::value>::type
+    pack(Record &record, T value)
+    {
+        if (Arg *arg = nextArg(record, ARG_UNSIGNED))
+        {
+            arg->u = value;
+        }
+    }
+    template <class T>
+    typename enable_if<is_floating_point<T>::value>::type
+    pack(Record &record, T value)
+    {
+        if (Arg *arg = nextArg(record, ARG_DOUBLE))
+        {
+            arg->d = value;
+        }
+    }
+    void pack(Record &record, bool value);
+    void pack(Record &record, const char *value);
+    void pack(Record &record, const unsigned char *value);
+    void pack(Record &record, const string &value);
+    void pack(Record &record, vec3 value);
+
+    /** \brief nextArg
+     * The next free value of a record, or NULL if it has
+     * MAX_ARGS already.
+     */
+    Arg *nextArg(Record &record, Arg_Kind kind);
+
+    /** \brief threadNumber
+     * A small number for the calling thread, in the order
+     * the threads first log.
+     */
+    static uint8_t threadNumber();
+
+    /** \brief writerLoop
+     * The body of the logger's thread.
+     */
+    void writerLoop();
+
+    /** \brief format
+     * Writes a record out as one line.
+     */
+    void format(const Record &record, ostream &out);
+
+    static atomic<int> threshold;
+    MpscQueue<Record, RING_SIZE> queue;
+    //! Messages queued, printed and dropped.
+    atomic<unsigned long> queued, printed, dropped;
+    chrono::steady_clock::time_point start;
+    atomic<bool> stopping;
+    thread writer;
+    //! How long the thread sleeps when there is nothing
+    //! to print.
+    const int IDLE_MS = 2;
+};
+
+#endif // LOGGER_H
@@ -0,0 +1,1036 @@
+/*******************************************************************
+ * MeshImport:  A class to load a mesh from an OBJ or PLY file
+ * to draw in place of the cube, ordered for the vertex cache
+ * and against overdraw, and cached in a binary file.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "meshimport.h"
+
+static_assert(sizeof(MeshImport::CacheHeader) == 128, "The mesh cache header must be 128 bytes.");
+static_assert(sizeof(MeshImport::Vertex) == 32, "A mesh vertex must be 32 bytes.");
+
+//! Three numbers that name a vertex:  the position, texture
+//! and normal of an OBJ corner, or the bits of a position.
+struct VertexKey {
+    uint32_t a, b, c;
+    bool operator==(const VertexKey &other) const
+    {
+        return (a == other.a) && (b == other.b) && (c == other.c);
+    }
+};
+
+struct VertexKeyHash {
+    size_t operator()(const VertexKey &key) const
+    {
+        uint64_t hash = key.a * 0x9E3779B97F4A7C15ULL;
+        hash ^= (hash >> 29) + key.b * 0xBF58476D1CE4E5B9ULL;
+        hash ^= (hash >> 31) + key.c * 0x94D049BB133111EBULL;
+        return (size_t) (hash ^ (hash >> 32));
+    }
+};
+
+//! Forsyth's scores for a vertex by its place in the cache
+//! and the triangles it has left, worked out once.
+struct ForsythScores {
+    static const int VALENCES = 64;
+    float cache[MeshImport::FORSYTH_CACHE];
+    float valence[VALENCES];
+    ForsythScores()
+    {
+        //! The last triangle's three vertices score the same,
+        //! a little lower, so a strip is not favored.
+        for (int x = 0; x < MeshImport::FORSYTH_CACHE; x++)
+        {
+            cache[x] = (x < 3) ? 0.75f : powf(1.0f - (float) (x - 3)
+            / (float) (MeshImport::FORSYTH_CACHE - 3), 1.5f);
+        }
+        //! Vertices with few triangles left are finished off
+        //! first, so they do not linger.
+        for (int x = 1; x < VALENCES; x++)
+        {
+            valence[x] = 2.0f * powf((float) x, -0.5f);
+        }
+        valence[0] = 0.0f;
+    }
+    float score(int position, uint32_t remaining) const
+    {
+        if (remaining == 0)
+        {
+            return -1.0f;
+        }
+        float value = (position >= 0) ? cache[position] : 0.0f;
+        return value + ((remaining < VALENCES) ? valence[remaining]
+        : 2.0f * powf((float) remaining, -0.5f));
+    }
+};
+static const ForsythScores forsyth;
+
+//! The PLY types, by their sizes in a binary file.
+enum Ply_Type {
+    PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16,
+    PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64,
+    PLY_UNKNOWN
+};
+
+//! The bytes of each type in a binary file.
+static const size_t plySizes[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+
+static int plyType(const string &name)
+{
+    const char *names[] = { "char", "uchar", "short", "ushort", "int", "uint", "float", "double" };
+    const char *sized[] = { "int8", "uint8", "int16", "uint16", "int32", "uint32", "float32", "float64" };
+    for (int x = 0; x < PLY_UNKNOWN; x++)
+    {
+        if ((name == names[x]) || (name == sized[x]))
+        {
+            return x;
+        }
+    }
+    return PLY_UNKNOWN;
+}
+
+//! Reads one value, as text or little endian binary.
+static bool plyValue(const char *&p, const char *end, int type, bool binary, double &value)
+{
+    if (!binary)
+    {
+        char *next = NULL;
+        value = strtod(p, &next);
+        if (next == p)
+        {
+            return false;
+        }
+        p = next;
+        return true;
+    }
+    size_t size = plySizes[type];
+    if ((size_t) (end - p) < size)
+    {
+        return false;
+    }
+    switch (type)
+    {
+        case PLY_INT8:   { int8_t v;   memcpy(&v, p, size); value = v; break; }
+        case PLY_UINT8:  { uint8_t v;  memcpy(&v, p, size); value = v; break; }
+        case PLY_INT16:  { int16_t v;  memcpy(&v, p, size); value = v; break; }
+        case PLY_UINT16: { uint16_t v; memcpy(&v, p, size); value = v; break; }
+        case PLY_INT32:  { int32_t v;  memcpy(&v, p, size); value = v; break; }
+        case PLY_UINT32: { uint32_t v; memcpy(&v, p, size); value = v; break; }
+        case PLY_FLOAT32: { float v;   memcpy(&v, p, size); value = v; break; }
+        default:         { double v;   memcpy(&v, p, size); value = v; break; }
+    }
+    p += size;
+    return true;
+}
+
+MeshImport::MeshImport()
+{
+    LOG_DEBUG(SCENE, "Creating MeshImport.");
+    hasNormals = hasTexCoords = false;
+    memset(sideFirst, 0, sizeof(sideFirst));
+    memset(sideVertex, 0, sizeof(sideVertex));
+    acmrBefore = acmrAfter = 0.0f;
+    clusters = 0;
+}
+
+MeshImport::~MeshImport()
+{
+    LOG_DEBUG(SCENE, "Destroying MeshImport.");
+}
+
+bool MeshImport::load(string path)
+{
+    TRACE_SCOPE("loadMesh");
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    std::ifstream in(path.c_str(), ios::in | ios::binary);
+    if (!in)
+    {
+        LOG_ERROR(FILE, "Cannot read the mesh {}.", path);
+        return false;
+    }
+    stringstream contents;
+    contents << in.rdbuf();
+    string text = contents.str();
+    //! FNV-1a, so a changed source is made again.
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t x = 0; x < text.size(); x++)
+    {
+        hash = (hash ^ (uint8_t) text[x]) * 0x100000001B3ULL;
+    }
+    string cachePath = path + ".sfcmesh";
+    if (loadCache(cachePath, hash))
+    {
+        LOG_INFO(SCENE, "Mesh {} read from {}:  {} triangles, {} vertices, "
+        "ACMR {} before and {} after, in {} ms.", path, cachePath, indices.size() / 3,
+        vertices.size(), acmrBefore, acmrAfter,
+        chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count());
+        return true;
+    }
+    string extension = boost::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    bool loaded = false;
+    if (extension == ".obj")
+    {
+        loaded = loadObj(text, path);
+    }
+    else if (extension == ".ply")
+    {
+        loaded = loadPly(text, path);
+    }
+    else
+    {
+        LOG_ERROR(FILE, "The mesh {} must be an .obj or a .ply file.", path);
+    }
+    if (!loaded)
+    {
+        return false;
+    }
+    prepare();
+    optimize();
+    if (indices.empty())
+    {
+        LOG_ERROR(FILE, "The mesh {} has no triangles.", path);
+        return false;
+    }
+    saveCache(cachePath, hash);
+    LOG_INFO(SCENE, "Mesh {}:  {} triangles, {} vertices, {} overdraw clusters, "
+    "ACMR {} before and {} after, in {} ms.", path, indices.size() / 3, vertices.size(),
+    clusters, acmrBefore, acmrAfter,
+    chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count());
+    return true;
+}
+
+bool MeshImport::loadObj(const string &text, const string &path)
+{
+    TRACE_SCOPE("loadObj");
+    vector<vec3> positions, normals;
+    vector<vec2> texCoords;
+    unordered_map<VertexKey, uint32_t, VertexKeyHash> corners;
+    vertices.clear();
+    indices.clear();
+    hasNormals = hasTexCoords = true;
+    vector<uint32_t> face;
+    const char *p = text.c_str();
+    const char *end = p + text.size();
+    int line = 0;
+    while (p < end)
+    {
+        line++;
+        const char *next = (const char*) memchr(p, '\n', end - p);
+        const char *lineEnd = (next != NULL) ? next : end;
+        while ((p < lineEnd) && ((*p == ' ') || (*p == '\t')))
+        {
+            p++;
+        }
+        if ((lineEnd - p > 2) && (p[0] == 'v') && (p[1] == ' '))
+        {
+            vec3 value;
+            char *after = (char*) p + 2;
+            for (int x = 0; x < 3; x++)
+            {
+                value[x] = strtof(after, &after);
+            }
+            positions.push_back(value);
+        }
+        else if ((lineEnd - p > 3) && (p[0] == 'v') && (p[1] == 't') && (p[2] == ' '))
+        {
+            char *after = (char*) p + 3;
+            float u = strtof(after, &after);
+            float v = strtof(after, &after);
+            texCoords.push_back(vec2(u, v));
+        }
+        else if ((lineEnd - p > 3) && (p[0] == 'v') && (p[1] == 'n') && (p[2] == ' '))
+        {
+            vec3 value;
+            char *after = (char*) p + 3;
+            for (int x = 0; x < 3; x++)
+            {
+                value[x] = strtof(after, &after);
+            }
+            normals.push_back(value);
+        }
+        else if ((lineEnd - p > 2) && (p[0] == 'f') && (p[1] == ' '))
+        {
+            //! Each corner is v, v/vt, v//vn or v/vt/vn, counted
+            //! from one, or back from the last when negative.
+            face.clear();
+            char *q = (char*) p + 2;
+            while (q < lineEnd)
+            {
+                while ((q < lineEnd) && ((*q == ' ') || (*q == '\t') || (*q == '\r')))
+                {
+                    q++;
+                }
+                if (q >= lineEnd)
+                {
+                    break;
+                }
+                long number[3] = { 0, 0, 0 };
+                for (int part = 0; part < 3; part++)
+                {
+                    if ((part > 0) && ((q >= lineEnd) || (*q != '/')))
+                    {
+                        break;
+                    }
+                    if (part > 0)
+                    {
+                        q++;
+                    }
+                    char *after = q;
+                    number[part] = strtol(q, &after, 10);
+                    q = after;
+                }
+                long sizes[3] = { (long) positions.size(), (long) texCoords.size(),
+                (long) normals.size() };
+                for (int part = 0; part < 3; part++)
+                {
+                    number[part] = (number[part] < 0) ? sizes[part] + number[part]
+                    : number[part] - 1;
+                }
+                if ((number[0] < 0) || (number[0] >= sizes[0]) || (number[1] >= sizes[1])
+                || (number[2] >= sizes[2]))
+                {
+                    LOG_ERROR(FILE, "The mesh {} has a bad face on line {}.", path, line);
+                    return false;
+                }
+                hasTexCoords = hasTexCoords && (number[1] >= 0);
+                hasNormals = hasNormals && (number[2] >= 0);
+                VertexKey key = { (uint32_t) number[0], (uint32_t) number[1], (uint32_t) number[2] };
+                auto found = corners.find(key);
+                if (found == corners.end())
+                {
+                    Vertex vertex;
+                    memset(&vertex, 0, sizeof(vertex));
+                    memcpy(vertex.position, &positions[number[0]][0], 3 * sizeof(float));
+                    if (number[1] >= 0)
+                    {
+                        memcpy(vertex.texCoord, &texCoords[number[1]][0], 2 * sizeof(float));
+                    }
+                    if (number[2] >= 0)
+                    {
+                        memcpy(vertex.normal, &normals[number[2]][0], 3 * sizeof(float));
+                    }
+                    found = corners.insert(make_pair(key, (uint32_t) vertices.size())).first;
+                    vertices.push_back(vertex);
+                }
+                face.push_back(found->second);
+            }
+            //! A polygon is cut into a fan.
+            for (size_t x = 2; x < face.size(); x++)
+            {
+                indices.push_back(face[0]);
+                indices.push_back(face[x - 1]);
+                indices.push_back(face[x]);
+            }
+        }
+        p = lineEnd + 1;
+    }
+    return true;
+}
+
+bool MeshImport::loadPly(const string &text, const string &path)
+{
+    TRACE_SCOPE("loadPly");
+    vertices.clear();
+    indices.clear();
+    size_t headerEnd = text.find("end_header");
+    if ((text.compare(0, 3, "ply") != 0) || (headerEnd == string::npos))
+    {
+        LOG_ERROR(FILE, "The mesh {} is not a PLY file.", path);
+        return false;
+    }
+    istringstream header(text.substr(0, headerEnd));
+    vector<PlyElement> elements;
+    bool binary = false;
+    string line;
+    while (getline(header, line))
+    {
+        istringstream words(line);
+        string word;
+        words >> word;
+        if (word == "format")
+        {
+            string format;
+            words >> format;
+            if (format == "binary_little_endian")
+            {
+                binary = true;
+            }
+            else if (format != "ascii")
+            {
+                LOG_ERROR(FILE, "The mesh {} is {}, only ascii and binary_little_endian "
+                "are read.", path, format);
+                return false;
+            }
+        }
+        else if (word == "element")
+        {
+            PlyElement element;
+            words >> element.name >> element.count;
+            elements.push_back(element);
+        }
+        else if ((word == "property") && !elements.empty())
+        {
+            PlyProperty property;
+            string type;
+            words >> type;
+            property.list = (type == "list");
+            property.countType = PLY_UNKNOWN;
+            if (property.list)
+            {
+                string countType;
+                words >> countType >> type;
+                property.countType = plyType(countType);
+            }
+            property.type = plyType(type);
+            words >> property.name;
+            if ((property.type == PLY_UNKNOWN) || (property.list && (property.countType == PLY_UNKNOWN)))
+            {
+                LOG_ERROR(FILE, "The mesh {} has a property {} of unknown type.", path, property.name);
+                return false;
+            }
+            elements.back().properties.push_back(property);
+        }
+    }
+    const char *p = text.c_str() + headerEnd;
+    const char *end = text.c_str() + text.size();
+    p = (const char*) memchr(p, '\n', end - p);
+    if (p == NULL)
+    {
+        LOG_ERROR(FILE, "The mesh {} ends in its header.", path);
+        return false;
+    }
+    p++;
+    hasNormals = hasTexCoords = false;
+    vector<uint32_t> face;
+    for (unsigned int e = 0; e < elements.size(); e++)
+    {
+        const PlyElement &element = elements[e];
+        bool isVertex = (element.name == "vertex");
+        bool isFace = (element.name == "face");
+        /** Every item takes some bytes, a list at least its
+         * count, and a value as text a digit and a space, so
+         * a file that cannot hold the count given is cut
+         * short or corrupt, and nothing is made for it.
+         */
+        size_t least = 0;
+        for (unsigned int x = 0; x < element.properties.size(); x++)
+        {
+            const PlyProperty &property = element.properties[x];
+            least += binary ? plySizes[property.list ? property.countType : property.type] : 2;
+        }
+        //! The last value as text may have no space after it.
+        if (element.count > ((size_t) (end - p) + 1) / std::max((size_t) 1, least))
+        {
+            LOG_ERROR(FILE, "The mesh {} ends early in its {}s.", path, element.name);
+            return false;
+        }
+        //! Where each property goes in a vertex, if it does.
+        vector<int> slots(element.properties.size(), -1);
+        if (isVertex)
+        {
+            const char *names[] = { "x", "y", "z", "nx", "ny", "nz" };
+            for (unsigned int x = 0; x < element.properties.size(); x++)
+            {
+                const string &name = element.properties[x].name;
+                for (int y = 0; y < 6; y++)
+                {
+                    if (name == names[y])
+                    {
+                        slots[x] = y;
+                    }
+                }
+                if ((name == "u") || (name == "s") || (name == "texture_u") || (name == "texture_s"))
+                {
+                    slots[x] = 6;
+                }
+                if ((name == "v") || (name == "t") || (name == "texture_v") || (name == "texture_t"))
+                {
+                    slots[x] = 7;
+                }
+                hasNormals = hasNormals || (slots[x] == 3);
+                hasTexCoords = hasTexCoords || (slots[x] == 6);
+            }
+            vertices.resize(element.count);
+            memset(vertices.data(), 0, vertices.size() * sizeof(Vertex));
+        }
+        for (size_t item = 0; item < element.count; item++)
+        {
+            for (unsigned int x = 0; x < element.properties.size(); x++)
+            {
+                const PlyProperty &property = element.properties[x];
+                double value = 0.0;
+                if (!property.list)
+                {
+                    if (!plyValue(p, end, property.type, binary, value))
+                    {
+                        LOG_ERROR(FILE, "The mesh {} ends early in its {}s.", path, element.name);
+                        return false;
+                    }
+                    //! The other elements' values are read past.
+                    if ((!isVertex) || (slots[x] < 0))
+                    {
+                        continue;
+                    }
+                    Vertex &vertex = vertices[item];
+                    if (slots[x] < 3)
+                    {
+                        vertex.position[slots[x]] = (float) value;
+                    }
+                    else if (slots[x] < 6)
+                    {
+                        vertex.normal[slots[x] - 3] = (float) value;
+                    }
+                    else
+                    {
+                        vertex.texCoord[slots[x] - 6] = (float) value;
+                    }
+                    continue;
+                }
+                if (!plyValue(p, end, property.countType, binary, value))
+                {
+                    LOG_ERROR(FILE, "The mesh {} ends early in its {}s.", path, element.name);
+                    return false;
+                }
+                size_t corners = (size_t) value;
+                bool isCorners = isFace && ((property.name == "vertex_indices")
+                || (property.name == "vertex_index"));
+                face.clear();
+                for (size_t y = 0; y < corners; y++)
+                {
+                    if (!plyValue(p, end, property.type, binary, value))
+                    {
+                        LOG_ERROR(FILE, "The mesh {} ends early in its {}s.", path, element.name);
+                        return false;
+                    }
+                    if (isCorners)
+                    {
+                        if ((value < 0.0) || (value >= (double) vertices.size()))
+                        {
+                            LOG_ERROR(FILE, "The mesh {} has a face past its vertices.", path);
+                            return false;
+                        }
+                        face.push_back((uint32_t) value);
+                    }
+                }
+                for (size_t y = 2; y < face.size(); y++)
+                {
+                    indices.push_back(face[0]);
+                    indices.push_back(face[y - 1]);
+                    indices.push_back(face[y]);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void MeshImport::prepare()
+{
+    TRACE_SCOPE("prepareMesh");
+    if (vertices.empty())
+    {
+        return;
+    }
+    //! Into the cube, from -0.5 to 0.5 along the longest side.
+    vec3 low = vec3(FLT_MAX), high = vec3(-FLT_MAX);
+    for (size_t x = 0; x < vertices.size(); x++)
+    {
+        vec3 position = make_vec3(vertices[x].position);
+        low = glm::min(low, position);
+        high = glm::max(high, position);
+    }
+    vec3 center = (low + high) * 0.5f;
+    float extent = std::max(high.x - low.x, std::max(high.y - low.y, high.z - low.z));
+    float scale = (extent > 0.0f) ? 1.0f / extent : 1.0f;
+    for (size_t x = 0; x < vertices.size(); x++)
+    {
+        for (int y = 0; y < 3; y++)
+        {
+            vertices[x].position[y] = (vertices[x].position[y] - center[y]) * scale;
+        }
+    }
+    if (!hasNormals)
+    {
+        //! The faces around each position, weighted by their
+        //! area, whatever texture coordinates the corners
+        //! have, so the seams do not show.
+        unordered_map<VertexKey, uint32_t, VertexKeyHash> places;
+        vector<uint32_t> place(vertices.size());
+        for (size_t x = 0; x < vertices.size(); x++)
+        {
+            VertexKey key;
+            memcpy(&key, vertices[x].position, sizeof(key));
+            place[x] = places.insert(make_pair(key, (uint32_t) places.size())).first->second;
+        }
+        vector<vec3> sums(places.size(), vec3(0.0f));
+        for (size_t x = 0; x + 2 < indices.size(); x += 3)
+        {
+            vec3 a = make_vec3(vertices[indices[x]].position);
+            vec3 b = make_vec3(vertices[indices[x + 1]].position);
+            vec3 c = make_vec3(vertices[indices[x + 2]].position);
+            vec3 normal = cross(b - a, c - a);
+            for (int y = 0; y < 3; y++)
+            {
+                sums[place[indices[x + y]]] += normal;
+            }
+        }
+        for (size_t x = 0; x < vertices.size(); x++)
+        {
+            vec3 sum = sums[place[x]];
+            vec3 normal = (dot(sum, sum) > 0.0f) ? normalize(sum) : vec3(0.0f, 0.0f, 1.0f);
+            memcpy(vertices[x].normal, &normal[0], sizeof(vertices[x].normal));
+        }
+        hasNormals = true;
+    }
+    if (!hasTexCoords)
+    {
+        //! Across the side each corner faces, as genTexture
+        //! maps the cube's sides.
+        for (size_t x = 0; x < vertices.size(); x++)
+        {
+            vec3 normal = glm::abs(make_vec3(vertices[x].normal));
+            const float *position = vertices[x].position;
+            int u = 1, v = 2;
+            if ((normal.y >= normal.x) && (normal.y >= normal.z))
+            {
+                u = 0;
+            }
+            else if ((normal.z >= normal.x) && (normal.z >= normal.y))
+            {
+                u = 0;
+                v = 1;
+            }
+            vertices[x].texCoord[0] = position[u] + 0.5f;
+            vertices[x].texCoord[1] = position[v] + 0.5f;
+        }
+        hasTexCoords = true;
+    }
+}
+
+int MeshImport::sideOf(const uint32_t *triangle)
+{
+    vec3 a = make_vec3(vertices[triangle[0]].position);
+    vec3 b = make_vec3(vertices[triangle[1]].position);
+    vec3 c = make_vec3(vertices[triangle[2]].position);
+    vec3 normal = cross(b - a, c - a);
+    if (dot(normal, normal) <= 0.0f)
+    {
+        return -1;
+    }
+    //! The cube's sides, by axis and whether it faces
+    //! along it or back, see CubeCloud::indices.
+    const int sides[3][2] = { { 1, 3 }, { 2, 5 }, { 0, 4 } };
+    vec3 size = glm::abs(normal);
+    int axis = (size.x >= size.y) ? ((size.x >= size.z) ? 0 : 2) : ((size.y >= size.z) ? 1 : 2);
+    return sides[axis][(normal[axis] < 0.0f) ? 1 : 0];
+}
+
+void MeshImport::optimize()
+{
+    TRACE_SCOPE("optimizeMesh");
+    acmrBefore = (float) acmr(indices.data(), indices.size(), vertices.size(), FIFO_SIZE);
+    //! The middle of the mesh, by area, that the clusters
+    //! face out from.
+    vec3 center = vec3(0.0f);
+    float area = 0.0f;
+    vector<uint32_t> bySide[SIDES];
+    for (size_t x = 0; x + 2 < indices.size(); x += 3)
+    {
+        int side = sideOf(&indices[x]);
+        //! A triangle with no area draws nothing.
+        if (side < 0)
+        {
+            continue;
+        }
+        bySide[side].insert(bySide[side].end(), &indices[x], &indices[x] + 3);
+        vec3 a = make_vec3(vertices[indices[x]].position);
+        vec3 b = make_vec3(vertices[indices[x + 1]].position);
+        vec3 c = make_vec3(vertices[indices[x + 2]].position);
+        float weight = length(cross(b - a, c - a));
+        center += (a + b + c) * (weight / 3.0f);
+        area += weight;
+    }
+    if (area > 0.0f)
+    {
+        center /= area;
+    }
+    vector<Vertex> outVertices;
+    vector<uint32_t> outIndices;
+    outVertices.reserve(vertices.size());
+    outIndices.reserve(indices.size());
+    //! Each side's vertices counted from zero, and back.
+    vector<uint32_t> local(vertices.size(), UINT32_MAX);
+    vector<uint32_t> global, ordered, first;
+    vector<vec3> positions;
+    clusters = 0;
+    for (int side = 0; side < SIDES; side++)
+    {
+        sideFirst[side] = (uint32_t) outIndices.size();
+        sideVertex[side] = (uint32_t) outVertices.size();
+        vector<uint32_t> &group = bySide[side];
+        if (group.empty())
+        {
+            continue;
+        }
+        global.clear();
+        for (size_t x = 0; x < group.size(); x++)
+        {
+            uint32_t vertex = group[x];
+            if (local[vertex] == UINT32_MAX)
+            {
+                local[vertex] = (uint32_t) global.size();
+                global.push_back(vertex);
+            }
+            group[x] = local[vertex];
+        }
+        positions.resize(global.size());
+        for (size_t x = 0; x < global.size(); x++)
+        {
+            positions[x] = make_vec3(vertices[global[x]].position);
+            local[global[x]] = UINT32_MAX;
+        }
+        ordered.resize(group.size());
+        orderForCache(group.data(), group.size(), global.size(), ordered.data());
+        clusters += (uint32_t) orderForOverdraw(ordered.data(), ordered.size(), global.size(),
+        positions, center);
+        //! The vertices in the order they are first used.
+        first.assign(global.size(), UINT32_MAX);
+        for (size_t x = 0; x < ordered.size(); x++)
+        {
+            uint32_t vertex = ordered[x];
+            if (first[vertex] == UINT32_MAX)
+            {
+                first[vertex] = (uint32_t) outVertices.size();
+                outVertices.push_back(vertices[global[vertex]]);
+            }
+            outIndices.push_back(first[vertex]);
+        }
+    }
+    sideFirst[SIDES] = (uint32_t) outIndices.size();
+    sideVertex[SIDES] = (uint32_t) outVertices.size();
+    vertices.swap(outVertices);
+    indices.swap(outIndices);
+    acmrAfter = (float) acmr(indices.data(), indices.size(), vertices.size(), FIFO_SIZE);
+}
+
+double MeshImport::acmr(const uint32_t *indices, size_t count, size_t vertexCount, int cacheSize)
+{
+    if (count < 3)
+    {
+        return 0.0;
+    }
+    //! A vertex is in the cache until cacheSize others have
+    //! gone in after it.
+    vector<uint32_t> stamp(vertexCount, 0);
+    uint32_t time = (uint32_t) cacheSize + 1;
+    size_t misses = 0;
+    for (size_t x = 0; x < count; x++)
+    {
+        uint32_t vertex = indices[x];
+        if (time - stamp[vertex] > (uint32_t) cacheSize)
+        {
+            stamp[vertex] = time++;
+            misses++;
+        }
+    }
+    return (double) misses / (double) (count / 3);
+}
+
+void MeshImport::orderForCache(const uint32_t *in, size_t count, size_t vertexCount, uint32_t *out)
+{
+    TRACE_SCOPE("orderForCache");
+    size_t triangles = count / 3;
+    //! The triangles of each vertex, the ones not yet drawn
+    //! first.
+    vector<uint32_t> remaining(vertexCount, 0), offsets(vertexCount + 1, 0);
+    for (size_t x = 0; x < count; x++)
+    {
+        remaining[in[x]]++;
+    }
+    for (size_t x = 0; x < vertexCount; x++)
+    {
+        offsets[x + 1] = offsets[x] + remaining[x];
+    }
+    vector<uint32_t> adjacency(count), fill(offsets.begin(), offsets.end() - 1);
+    for (size_t x = 0; x < count; x++)
+    {
+        adjacency[fill[in[x]]++] = (uint32_t) (x / 3);
+    }
+    vector<int> position(vertexCount, -1);
+    vector<float> vertexScores(vertexCount), triangleScores(triangles);
+    vector<uint8_t> drawn(triangles, 0);
+    for (size_t x = 0; x < vertexCount; x++)
+    {
+        vertexScores[x] = forsyth.score(-1, remaining[x]);
+    }
+    long best = -1;
+    float bestScore = -FLT_MAX;
+    for (size_t x = 0; x < triangles; x++)
+    {
+        triangleScores[x] = vertexScores[in[3 * x]] + vertexScores[in[3 * x + 1]]
+        + vertexScores[in[3 * x + 2]];
+        if (triangleScores[x] > bestScore)
+        {
+            bestScore = triangleScores[x];
+            best = (long) x;
+        }
+    }
+    uint32_t cache[FORSYTH_CACHE + 3], next[FORSYTH_CACHE + 3];
+    int cached = 0;
+    size_t cursor = 0;
+    for (size_t n = 0; n < triangles; n++)
+    {
+        //! Nothing in the cache has a triangle left, so
+        //! start again from the next one not drawn.
+        if (best < 0)
+        {
+            while (drawn[cursor])
+            {
+                cursor++;
+            }
+            best = (long) cursor;
+        }
+        const uint32_t *triangle = in + 3 * best;
+        memcpy(out + 3 * n, triangle, 3 * sizeof(uint32_t));
+        drawn[best] = 1;
+        for (int x = 0; x < 3; x++)
+        {
+            uint32_t vertex = triangle[x];
+            uint32_t *list = &adjacency[offsets[vertex]];
+            uint32_t live = remaining[vertex];
+            for (uint32_t y = 0; y < live; y++)
+            {
+                if (list[y] == (uint32_t) best)
+                {
+                    list[y] = list[live - 1];
+                    break;
+                }
+            }
+            remaining[vertex]--;
+        }
+        //! The triangle's vertices go to the front of the
+        //! cache and push the rest back.
+        int filled = 0;
+        for (int x = 0; x < 3; x++)
+        {
+            next[filled++] = triangle[x];
+        }
+        for (int x = 0; x < cached; x++)
+        {
+            uint32_t vertex = cache[x];
+            if ((vertex != triangle[0]) && (vertex != triangle[1]) && (vertex != triangle[2]))
+            {
+                next[filled++] = vertex;
+            }
+        }
+        for (int x = 0; x < filled; x++)
+        {
+            uint32_t vertex = next[x];
+            position[vertex] = (x < FORSYTH_CACHE) ? x : -1;
+            vertexScores[vertex] = forsyth.score(position[vertex], remaining[vertex]);
+        }
+        //! Only the triangles of the vertices that moved
+        //! change their score, and the best is among them.
+        best = -1;
+        bestScore = -FLT_MAX;
+        for (int x = 0; x < filled; x++)
+        {
+            uint32_t vertex = next[x];
+            const uint32_t *list = &adjacency[offsets[vertex]];
+            for (uint32_t y = 0; y < remaining[vertex]; y++)
+            {
+                uint32_t t = list[y];
+                float score = vertexScores[in[3 * t]] + vertexScores[in[3 * t + 1]]
+                + vertexScores[in[3 * t + 2]];
+                triangleScores[t] = score;
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    best = (long) t;
+                }
+            }
+        }
+        cached = std::min(filled, (int) FORSYTH_CACHE);
+        memcpy(cache, next, cached * sizeof(uint32_t));
+    }
+}
+
+size_t MeshImport::orderForOverdraw(uint32_t *triangles, size_t count, size_t vertexCount,
+const vector<vec3> &positions, vec3 center)
+{
+    TRACE_SCOPE("orderForOverdraw");
+    struct Cluster {
+        uint32_t first, count;
+        float key;
+    };
+    //! A cluster starts where a triangle finds none of its
+    //! vertices in the cache, so moving it costs nothing.
+    vector<Cluster> found;
+    vector<uint32_t> stamp(vertexCount, 0);
+    uint32_t time = FIFO_SIZE + 1;
+    size_t total = count / 3;
+    for (size_t t = 0; t < total; t++)
+    {
+        int misses = 0;
+        for (int x = 0; x < 3; x++)
+        {
+            uint32_t vertex = triangles[3 * t + x];
+            if (time - stamp[vertex] > (uint32_t) FIFO_SIZE)
+            {
+                stamp[vertex] = time++;
+                misses++;
+            }
+        }
+        if ((misses == 3) || found.empty())
+        {
+            Cluster cluster = { (uint32_t) t, 0, 0.0f };
+            found.push_back(cluster);
+        }
+        found.back().count++;
+    }
+    //! Clusters out in front of the middle, facing away from
+    //! it, hide the most, so they go first.
+    for (size_t c = 0; c < found.size(); c++)
+    {
+        Cluster &cluster = found[c];
+        vec3 middle = vec3(0.0f), normal = vec3(0.0f);
+        float area = 0.0f;
+        for (uint32_t t = cluster.first; t < cluster.first + cluster.count; t++)
+        {
+            vec3 a = positions[triangles[3 * t]];
+            vec3 b = positions[triangles[3 * t + 1]];
+            vec3 c = positions[triangles[3 * t + 2]];
+            vec3 face = cross(b - a, c - a);
+            float weight = length(face);
+            middle += (a + b + c) * (weight / 3.0f);
+            normal += face;
+            area += weight;
+        }
+        if ((area > 0.0f) && (dot(normal, normal) > 0.0f))
+        {
+            cluster.key = dot(middle / area - center, normalize(normal));
+        }
+    }
+    stable_sort(found.begin(), found.end(), [](const Cluster &a, const Cluster &b)
+    {
+        return a.key > b.key;
+    });
+    vector<uint32_t> sorted;
+    sorted.reserve(count);
+    for (size_t c = 0; c < found.size(); c++)
+    {
+        sorted.insert(sorted.end(), triangles + 3 * found[c].first,
+        triangles + 3 * (found[c].first + found[c].count));
+    }
+    memcpy(triangles, sorted.data(), count * sizeof(uint32_t));
+    return found.size();
+}
+
+string MeshImport::sideStarts()
+{
+    stringstream text;
+    for (int side = 0; side < SIDES; side++)
+    {
+        text << ((side > 0) ? ", " : "") << sideVertex[side];
+    }
+    return text.str();
+}
+
+bool MeshImport::loadCache(string path, uint64_t sourceHash)
+{
+    std::ifstream in(path.c_str(), ios::in | ios::binary);
+    if (!in)
+    {
+        return false;
+    }
+    CacheHeader head;
+    in.read((char*) &head, sizeof(head));
+    if (!in || (memcmp(head.magic, "SFCMESH", 8) != 0) || (head.byteOrder != BYTE_ORDER_MARK)
+    || (head.version != VERSION) || (head.headerSize < sizeof(CacheHeader))
+    || (head.vertexSize != sizeof(Vertex)) || (head.indexCount % 3 != 0))
+    {
+        LOG_WARN(FILE, "The mesh cache {} cannot be read, the mesh is made again.", path);
+        return false;
+    }
+    if (head.sourceHash != sourceHash)
+    {
+        LOG_DEBUG(FILE, "The mesh cache {} is out of date.", path);
+        return false;
+    }
+    for (int side = 0; side < SIDES; side++)
+    {
+        if ((head.sideFirst[side] > head.sideFirst[side + 1])
+        || (head.sideVertex[side] > head.sideVertex[side + 1]))
+        {
+            LOG_WARN(FILE, "The mesh cache {} has bad sides, the mesh is made again.", path);
+            return false;
+        }
+    }
+    if ((head.sideFirst[SIDES] != head.indexCount) || (head.sideVertex[SIDES] != head.vertexCount))
+    {
+        LOG_WARN(FILE, "The mesh cache {} has bad sides, the mesh is made again.", path);
+        return false;
+    }
+    vertices.resize(head.vertexCount);
+    indices.resize(head.indexCount);
+    in.seekg(head.headerSize);
+    in.read((char*) vertices.data(), vertices.size() * sizeof(Vertex));
+    in.read((char*) indices.data(), indices.size() * sizeof(uint32_t));
+    if (!in)
+    {
+        LOG_WARN(FILE, "The mesh cache {} is cut short, the mesh is made again.", path);
+        return false;
+    }
+    for (size_t x = 0; x < indices.size(); x++)
+    {
+        if (indices[x] >= head.vertexCount)
+        {
+            LOG_WARN(FILE, "The mesh cache {} has a bad index, the mesh is made again.", path);
+            return false;
+        }
+    }
+    memcpy(sideFirst, head.sideFirst, sizeof(sideFirst));
+    memcpy(sideVertex, head.sideVertex, sizeof(sideVertex));
+    acmrBefore = head.acmrBefore;
+    acmrAfter = head.acmrAfter;
+    clusters = head.clusters;
+    hasNormals = hasTexCoords = true;
+    return true;
+}
+
+bool MeshImport::saveCache(string path, uint64_t sourceHash)
+{
+    CacheHeader head;
+    memset(&head, 0, sizeof(head));
+    memcpy(head.magic, "SFCMESH", 8);
+    head.byteOrder = BYTE_ORDER_MARK;
+    head.version = VERSION;
+    head.headerSize = sizeof(CacheHeader);
+    head.vertexSize = sizeof(Vertex);
+    head.vertexCount = (uint32_t) vertices.size();
+    head.indexCount = (uint32_t) indices.size();
+    head.sourceHash = sourceHash;
+    memcpy(head.sideFirst, sideFirst, sizeof(sideFirst));
+    memcpy(head.sideVertex, sideVertex, sizeof(sideVertex));
+    head.acmrBefore = acmrBefore;
+    head.acmrAfter = acmrAfter;
+    head.clusters = clusters;
+    //! Written aside and renamed, so the tile workers
+    //! loading the same mesh never read half a cache.
+    string partPath = path + "." + to_string(getpid());
+    std::ofstream out(partPath.c_str(), ios::out | ios::binary | ios::trunc);
+    out.write((const char*) &head, sizeof(head));
+    out.write((const char*) vertices.data(), vertices.size() * sizeof(Vertex));
+    out.write((const char*) indices.data(), indices.size() * sizeof(uint32_t));
+    out.close();
+    if ((!out) || (std::rename(partPath.c_str(), path.c_str()) != 0))
+    {
+        //! The mesh is still drawn, only made again next time.
+        LOG_WARN(FILE, "Cannot write the mesh cache {}.", path);
+        std::remove(partPath.c_str());
+        return false;
+    }
+    return true;
+}
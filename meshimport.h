@@ -0,0 +1,181 @@
+/*******************************************************************
+ * MeshImport:  A class to load a mesh from an OBJ or PLY file
+ * to draw in place of the cube, ordered for the vertex cache
+ * and against overdraw, and cached in a binary file.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef MESHIMPORT_H
+#define MESHIMPORT_H
+
+#include "commonheader.h"
+#include "logger.h"
+#include "tracer.h"
+
+/** \class MeshImport
+ * The mesh is moved and scaled to fit the cube, from -0.5 to
+ * 0.5, so the spacing, the culling and the picking of the
+ * cubes hold for it.  Missing normals are made from the
+ * faces around each corner, and missing texture coordinates
+ * are projected along the side each corner faces.  Each
+ * triangle goes with the side of the cube it faces most,
+ * +z, +x, +y, -x, -z, -y as the cube's are, so it shows the
+ * picture of that side, and the triangles and the vertices
+ * of each side are kept together.  Within a side:
+ *
+ *     The triangles are put in the order that reuses the
+ *     most vertices from the post transform cache, by Tom
+ *     Forsyth's linear speed vertex cache optimization.
+ *
+ *     That order is cut into clusters where the cache starts
+ *     over anyway, and the clusters facing out from the
+ *     middle of the mesh go first, so they hide the ones
+ *     behind them, after Sander, Nehab and Barczak's fast
+ *     triangle reordering.
+ *
+ *     The vertices are put in the order the triangles first
+ *     use them, and those never used are dropped.
+ *
+ * The average cache miss ratio, the vertices transformed for
+ * each triangle with a 16 entry FIFO cache, is measured
+ * before and after.  The result is written next to the
+ * source as FILE.sfcmesh and read in place of it while the
+ * source is unchanged:
+ *
+ *     offset  size  header field
+ *          0     8  magic "SFCMESH\0"
+ *          8     4  byte order mark 0x01020304
+ *         12     4  version, 1
+ *         16     4  header size, 128 or more
+ *         20     4  vertex size, 32
+ *         24     4  number of vertices
+ *         28     4  number of indices
+ *         32     8  FNV-1a hash of the source file
+ *         40    28  first index of each side and the end
+ *         68    28  first vertex of each side and the end
+ *         96     4  cache miss ratio before, float
+ *        100     4  cache miss ratio after, float
+ *        104     4  overdraw clusters
+ *        108    20  reserved, zero
+ *
+ * followed by the vertices, position, normal and texture
+ * coordinates as floats, and the indices as 32 bit integers.
+ */
+class MeshImport
+{
+public:
+    //! A vertex as the cube programs read it.
+    struct Vertex {
+        float position[3];
+        float normal[3];
+        float texCoord[2];
+    };
+
+    //! The start of the cache file.
+    struct CacheHeader {
+        char magic[8];
+        uint32_t byteOrder;
+        uint32_t version;
+        uint32_t headerSize;
+        uint32_t vertexSize;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint64_t sourceHash;
+        uint32_t sideFirst[7];
+        uint32_t sideVertex[7];
+        float acmrBefore;
+        float acmrAfter;
+        uint32_t clusters;
+        char reserved[20];
+    };
+
+    static const int SIDES = 6;
+    //! The cache the cache miss ratio is measured with, and
+    //! the one Forsyth's scores are tuned for.
+    static const int FIFO_SIZE = 16;
+    static const int FORSYTH_CACHE = 32;
+    constexpr static uint32_t VERSION = 1;
+    constexpr static uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    MeshImport();
+    ~MeshImport();
+
+    /** \brief load
+     * Reads the cache of an OBJ or PLY file, or the file
+     * itself, then fits, orders and caches it.  Returns
+     * false, saying why, if it cannot be read or has no
+     * triangles.
+     */
+    bool load(string path);
+
+    /** \brief prepare
+     * Fits the vertices to the cube and makes any normals
+     * and texture coordinates missing.
+     */
+    void prepare();
+
+    /** \brief optimize
+     * Sorts the triangles into the sides and orders each
+     * side for the vertex cache and against overdraw, then
+     * the vertices by first use.
+     */
+    void optimize();
+
+    /** \brief acmr
+     * The vertices a FIFO cache of cacheSize transforms
+     * for each triangle, drawing the indices in order.
+     */
+    static double acmr(const uint32_t *indices, size_t count, size_t vertexCount, int cacheSize);
+
+    /** \brief sideStarts
+     * The first vertex of each side, separated by commas,
+     * for the shaders to tell the side from the vertex.
+     */
+    string sideStarts();
+
+    //! The mesh, and what optimize did to it.
+    vector<Vertex> vertices;
+    vector<uint32_t> indices;
+    bool hasNormals, hasTexCoords;
+    //! Where the triangles and the vertices of each side
+    //! start, with the end last.
+    uint32_t sideFirst[SIDES + 1];
+    uint32_t sideVertex[SIDES + 1];
+    float acmrBefore, acmrAfter;
+    uint32_t clusters;
+
+protected:
+    //! A PLY property, or a list of them.
+    struct PlyProperty {
+        string name;
+        int type;
+        int countType;
+        bool list;
+    };
+
+    //! A PLY element and its properties.
+    struct PlyElement {
+        string name;
+        size_t count;
+        vector<PlyProperty> properties;
+    };
+
+    //! Reads an OBJ or a PLY file already in memory.
+    bool loadObj(const string &text, const string &path);
+    bool loadPly(const string &text, const string &path);
+    //! Reads and checks the cache.
+    bool loadCache(string path, uint64_t sourceHash);
+    //! Writes the cache.
+    bool saveCache(string path, uint64_t sourceHash);
+    //! The side of the cube a triangle faces most.
+    int sideOf(const uint32_t *triangle);
+    //! Orders triangles, by vertices counted from zero, for
+    //! the vertex cache.
+    void orderForCache(const uint32_t *in, size_t count, size_t vertexCount, uint32_t *out);
+    //! Orders the clusters of triangles in a cache order so
+    //! those facing out go first.  Returns the clusters.
+    size_t orderForOverdraw(uint32_t *triangles, size_t count, size_t vertexCount,
+    const vector<vec3> &positions, vec3 center);
+};
+
+#endif // MESHIMPORT_H
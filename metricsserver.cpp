@@ -0,0 +1,278 @@
+/*******************************************************************
+ * MetricsServer:  A class to serve the render statistics over
+ * HTTP on localhost, in the Prometheus text format, from a
+ * thread of its own.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "metricsserver.h"
+
+//! The bucket bounds in milliseconds, and as Prometheus
+//! writes them, in seconds.
+static const double BOUNDS_MS[MetricsServer::BUCKETS] =
+{
+    1.0, 2.0, 4.0, 8.0, 16.7, 33.3, 50.0, 100.0, 250.0, 1000.0
+};
+static const char *BOUNDS_LABEL[MetricsServer::BUCKETS] =
+{
+    "0.001", "0.002", "0.004", "0.008", "0.0167", "0.0333", "0.05", "0.1", "0.25", "1"
+};
+
+MetricsServer::MetricsServer()
+{
+    LOG_DEBUG(STARTUP, "Creating MetricsServer.");
+    memset(&totals, 0, sizeof(totals));
+    totals.firstFrame = totals.loaded = -1.0;
+    lastCount = chrono::steady_clock::time_point();
+    listener = -1;
+    port = 0;
+    running.store(false);
+}
+
+MetricsServer::~MetricsServer()
+{
+    LOG_DEBUG(STARTUP, "Destroying MetricsServer.");
+    stop();
+}
+
+void MetricsServer::addPhase(const StartupPhase &phase)
+{
+    phases.push_back(phase);
+}
+
+bool MetricsServer::start(int port)
+{
+    this->port = port;
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0)
+    {
+        LOG_ERROR(STARTUP, "Cannot open a socket for the metrics:  {}", strerror(errno));
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    //! Only this machine may scrape.
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t) port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if ((::bind(listener, (sockaddr*) &address, sizeof(address)) < 0) || (listen(listener, 8) < 0))
+    {
+        LOG_ERROR(STARTUP, "Cannot serve the metrics on port {}:  {}", port, strerror(errno));
+        close(listener);
+        listener = -1;
+        return false;
+    }
+    //! A scrape before the first frame reads zeros.
+    snapshots.writeBuffer() = totals;
+    snapshots.publish();
+    running.store(true);
+    worker = thread(&MetricsServer::serve, this);
+    LOG_INFO(STARTUP, "Serving metrics on http://127.0.0.1:{}/metrics", port);
+    return true;
+}
+
+void MetricsServer::stop()
+{
+    running.store(false);
+    if (worker.joinable())
+    {
+        worker.join();
+    }
+    if (listener >= 0)
+    {
+        close(listener);
+        listener = -1;
+    }
+}
+
+bool MetricsServer::countsDue()
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - lastCount).count()
+    >= COUNT_MS;
+}
+
+void MetricsServer::addTime(Histogram &histogram, double ms)
+{
+    int bucket = 0;
+    while ((bucket < BUCKETS) && (ms > BOUNDS_MS[bucket]))
+    {
+        bucket++;
+    }
+    histogram.counts[bucket]++;
+    histogram.sum += ms / 1000.0;
+}
+
+void MetricsServer::frameDone(double frameMs, double cpuMs, int drawn, int cubes, int drawCalls,
+size_t uploadBytes, size_t textureBytes)
+{
+    totals.frames++;
+    addTime(totals.frameTimes, frameMs);
+    addTime(totals.cpuTimes, cpuMs);
+    if (drawn >= 0)
+    {
+        totals.drawn = drawn;
+        lastCount = chrono::steady_clock::now();
+    }
+    totals.cubes = cubes;
+    totals.drawCalls = drawCalls;
+    totals.uploadBytes += uploadBytes;
+    totals.textureBytes = textureBytes;
+    //! A copy of a few hundred bytes, and no waiting.
+    snapshots.writeBuffer() = totals;
+    snapshots.publish();
+}
+
+void MetricsServer::loadTimes(double firstFrame, double loaded)
+{
+    totals.firstFrame = firstFrame;
+    totals.loaded = loaded;
+}
+
+void MetricsServer::serve()
+{
+    Tracer::nameThread("metrics");
+    AllocScope scope(AllocTracker::SUBSYSTEM_METRICS);
+    //! Wake now and then to see if it is time to stop.
+    pollfd waiting;
+    waiting.fd = listener;
+    waiting.events = POLLIN;
+    while (running.load())
+    {
+        waiting.revents = 0;
+        if (poll(&waiting, 1, 100) <= 0)
+        {
+            continue;
+        }
+        int client = accept(listener, NULL, NULL);
+        if (client < 0)
+        {
+            continue;
+        }
+        answer(client);
+        close(client);
+    }
+}
+
+void MetricsServer::answer(int client)
+{
+    TRACE_SCOPE("scrape");
+    //! A slow client does not hold the thread for long.
+    timeval timeout = { 1, 0 };
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    char request[REQUEST_LENGTH + 1];
+    int length = 0;
+    while (length < REQUEST_LENGTH)
+    {
+        ssize_t got = recv(client, request + length, REQUEST_LENGTH - length, 0);
+        if (got <= 0)
+        {
+            break;
+        }
+        length += (int) got;
+        request[length] = '\0';
+        if (strstr(request, "\r\n\r\n") != NULL)
+        {
+            break;
+        }
+    }
+    request[length] = '\0';
+    string status = "200 OK";
+    stringstream body;
+    const char *path = "GET /metrics";
+    size_t pathLength = strlen(path);
+    if ((strncmp(request, path, pathLength) == 0)
+    && ((request[pathLength] == ' ') || (request[pathLength] == '?')))
+    {
+        writeMetrics(body);
+    }
+    else
+    {
+        status = "404 Not Found";
+        body << "Only GET /metrics is served.\n";
+    }
+    string text = body.str();
+    stringstream response;
+    response << "HTTP/1.1 " << status << "\r\n"
+    << "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+    << "Content-Length: " << text.size() << "\r\n"
+    << "Connection: close\r\n\r\n" << text;
+    string out = response.str();
+    size_t sent = 0;
+    while (sent < out.size())
+    {
+        ssize_t wrote = send(client, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+        if (wrote <= 0)
+        {
+            break;
+        }
+        sent += (size_t) wrote;
+    }
+}
+
+void MetricsServer::writeHistogram(ostream &out, const char *name, const char *help,
+const Histogram &histogram)
+{
+    out << "# HELP " << name << " " << help << "\n"
+    << "# TYPE " << name << " histogram\n";
+    unsigned long count = 0;
+    for (int x = 0; x < BUCKETS; x++)
+    {
+        count += histogram.counts[x];
+        out << name << "_bucket{le=\"" << BOUNDS_LABEL[x] << "\"} " << count << "\n";
+    }
+    count += histogram.counts[BUCKETS];
+    out << name << "_bucket{le=\"+Inf\"} " << count << "\n"
+    << name << "_sum " << histogram.sum << "\n"
+    << name << "_count " << count << "\n";
+}
+
+void MetricsServer::writeMetrics(ostream &out)
+{
+    snapshots.update();
+    const Snapshot &snap = snapshots.readBuffer();
+    out << setprecision(10);
+    writeHistogram(out, "sidefogcube_frame_seconds",
+    "Time from the start of one frame to the next.", snap.frameTimes);
+    writeHistogram(out, "sidefogcube_frame_cpu_seconds",
+    "Time the CPU spends drawing a frame.", snap.cpuTimes);
+    out << "# HELP sidefogcube_cubes Cubes in the cloud.\n"
+    << "# TYPE sidefogcube_cubes gauge\n"
+    << "sidefogcube_cubes " << snap.cubes << "\n"
+    << "# HELP sidefogcube_cubes_drawn Cubes drawn, counted a few times a second.\n"
+    << "# TYPE sidefogcube_cubes_drawn gauge\n"
+    << "sidefogcube_cubes_drawn " << snap.drawn << "\n"
+    << "# HELP sidefogcube_cubes_culled Cubes left out as out of view or in the fog.\n"
+    << "# TYPE sidefogcube_cubes_culled gauge\n"
+    << "sidefogcube_cubes_culled " << std::max(0, snap.cubes - snap.drawn) << "\n"
+    << "# HELP sidefogcube_draw_calls Draw calls in the last frame.\n"
+    << "# TYPE sidefogcube_draw_calls gauge\n"
+    << "sidefogcube_draw_calls " << snap.drawCalls << "\n"
+    << "# HELP sidefogcube_upload_bytes_total Bytes sent to buffers while drawing.\n"
+    << "# TYPE sidefogcube_upload_bytes_total counter\n"
+    << "sidefogcube_upload_bytes_total " << snap.uploadBytes << "\n"
+    << "# HELP sidefogcube_texture_bytes Memory of the textures and offscreen targets.\n"
+    << "# TYPE sidefogcube_texture_bytes gauge\n"
+    << "sidefogcube_texture_bytes " << snap.textureBytes << "\n"
+    << "# HELP sidefogcube_first_frame_seconds Time from launch to the first frame.\n"
+    << "# TYPE sidefogcube_first_frame_seconds gauge\n";
+    if (snap.firstFrame >= 0.0)
+    {
+        out << "sidefogcube_first_frame_seconds " << snap.firstFrame << "\n";
+    }
+    out << "# HELP sidefogcube_loaded_seconds Time from launch to every picture in place.\n"
+    << "# TYPE sidefogcube_loaded_seconds gauge\n";
+    if (snap.loaded >= 0.0)
+    {
+        out << "sidefogcube_loaded_seconds " << snap.loaded << "\n";
+    }
+    out << "# HELP sidefogcube_startup_seconds Time each part of the startup took.\n"
+    << "# TYPE sidefogcube_startup_seconds gauge\n";
+    for (unsigned int x = 0; x < phases.size(); x++)
+    {
+        out << "sidefogcube_startup_seconds{phase=\"" << phases[x].name << "\"} "
+        << phases[x].seconds << "\n";
+    }
+}
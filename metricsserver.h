@@ -0,0 +1,119 @@
+/*******************************************************************
+ * MetricsServer:  A class to serve the render statistics over
+ * HTTP on localhost, in the Prometheus text format, from a
+ * thread of its own.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include "commonheader.h"
+#include "triplebuffer.h"
+#include "alloctracker.h"
+#include "tracer.h"
+#include "logger.h"
+
+/** \class MetricsServer
+ * The drawing thread adds each frame to totals of its own
+ * and publishes a copy through a triple buffer, so it never
+ * waits on a scrape and a scrape never sees half a frame.
+ * The server thread takes the newest copy for each request
+ * to /metrics on 127.0.0.1.  The startup phases are given
+ * before the thread starts and do not change after.
+ */
+class MetricsServer
+{
+public:
+    //! The upper bounds of the frame time buckets, in
+    //! milliseconds, below the last one for all.
+    static const int BUCKETS = 10;
+
+    MetricsServer();
+    ~MetricsServer();
+
+    /** \brief addPhase
+     * Adds a part of the startup to report.  Call it before
+     * start.
+     */
+    void addPhase(const StartupPhase &phase);
+
+    /** \brief start
+     * Listens on 127.0.0.1 at port and starts the thread.
+     * Returns false if the port cannot be had.
+     */
+    bool start(int port);
+
+    /** \brief stop
+     * Stops the thread and closes the port.
+     */
+    void stop();
+
+    /** \brief countsDue
+     * Whether the cubes drawn are wanted with this frame,
+     * a few times a second, since the GPU cull has to be
+     * waited for to count them.
+     */
+    bool countsDue();
+
+    /** \brief frameDone
+     * Adds a frame:  the time since the last one and the
+     * CPU time of it in milliseconds, the cubes drawn, or
+     * -1 for the last count, out of cubes, the draw calls,
+     * the bytes sent and the texture memory.
+     */
+    void frameDone(double frameMs, double cpuMs, int drawn, int cubes, int drawCalls,
+    size_t uploadBytes, size_t textureBytes);
+
+    /** \brief loadTimes
+     * The seconds from launch to the first frame and to
+     * every picture in place, -1 for not yet, published
+     * with the next frame.
+     */
+    void loadTimes(double firstFrame, double loaded);
+
+protected:
+    //! A histogram of times in milliseconds.
+    struct Histogram {
+        unsigned long counts[BUCKETS + 1];
+        double sum;
+    };
+
+    //! Everything a scrape reports but the startup.
+    struct Snapshot {
+        unsigned long frames;
+        Histogram frameTimes, cpuTimes;
+        int drawn, cubes, drawCalls;
+        unsigned long long uploadBytes;
+        size_t textureBytes;
+        double firstFrame, loaded;
+    };
+
+    //! How often the cubes drawn are counted.
+    constexpr static double COUNT_MS = 250.0;
+    //! The most bytes of a request read.
+    static const int REQUEST_LENGTH = 2048;
+
+    //! Adds a time to a histogram.
+    void addTime(Histogram &histogram, double ms);
+    //! Writes a histogram in seconds.
+    void writeHistogram(ostream &out, const char *name, const char *help,
+    const Histogram &histogram);
+    //! Writes every metric of the newest snapshot.
+    void writeMetrics(ostream &out);
+    //! The body of the server thread.
+    void serve();
+    //! Answers one connection.
+    void answer(int client);
+
+    //! The drawing thread's totals, and the hand off.
+    Snapshot totals;
+    TripleBuffer<Snapshot> snapshots;
+    chrono::steady_clock::time_point lastCount;
+    vector<StartupPhase> phases;
+    int listener, port;
+    atomic<bool> running;
+    thread worker;
+};
+
+#endif // METRICSSERVER_H
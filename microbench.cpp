@@ -0,0 +1,212 @@
+/*******************************************************************
+ * MicroBench:  A small harness to time functions on their own,
+ * in the manner of Google Benchmark, and write the results
+ * as JSON for comparison between builds.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "microbench.h"
+
+BenchState::BenchState(long arg, long iterations)
+{
+    this->arg = arg;
+    this->iterations = iterations;
+    elapsedNs = 0.0;
+    items = 0.0;
+}
+
+BenchState::~BenchState()
+{
+}
+
+void BenchState::startTimer()
+{
+    begin = chrono::steady_clock::now();
+}
+
+void BenchState::stopTimer()
+{
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+    elapsedNs += chrono::duration<double, nano>(end - begin).count();
+}
+
+void BenchState::setItems(double items)
+{
+    this->items = items;
+}
+
+MicroBench::MicroBench()
+{
+    minTime = 0.5;
+    repetitions = 5;
+}
+
+MicroBench::~MicroBench()
+{
+}
+
+void MicroBench::add(string name, vector<long> args, BenchFunc func)
+{
+    Entry entry;
+    entry.name = name;
+    entry.args = args;
+    entry.func = func;
+    entries.push_back(entry);
+}
+
+int MicroBench::run(int argc, char **argv)
+{
+    for (int x = 1; x < argc; x++)
+    {
+        string arg = argv[x];
+        if ((arg == "--help") || (x + 1 >= argc))
+        {
+            cout << "\n\n\tUsage:  " << argv[0] << " [options]\n"
+            << "\n\t--filter TEXT       run benchmarks whose name contains TEXT"
+            << "\n\t--min-time S        seconds each timed run lasts (0.5)"
+            << "\n\t--repetitions N     timed runs of each benchmark (5)"
+            << "\n\t--json FILE         write the results as JSON, - for stdout"
+            << "\n\n";
+            return 1;
+        }
+        string value = argv[++x];
+        if (arg == "--filter")
+        {
+            filter = value;
+        }
+        else if (arg == "--min-time")
+        {
+            minTime = stod(value);
+        }
+        else if (arg == "--repetitions")
+        {
+            repetitions = std::max(1, stoi(value));
+        }
+        else if (arg == "--json")
+        {
+            jsonFile = value;
+        }
+        else
+        {
+            cout << "\n\n\tUnknown argument " << arg << ".\n\n";
+            return 1;
+        }
+    }
+    cout << "\n" << left << setw(32) << "Benchmark" << right << setw(14) << "Median ns"
+    << setw(14) << "Min ns" << setw(12) << "Iterations" << setw(16) << "Items/s" << "\n";
+    for (unsigned int x = 0; x < entries.size(); x++)
+    {
+        for (unsigned int y = 0; y < entries[x].args.size(); y++)
+        {
+            stringstream name;
+            name << entries[x].name << "/" << entries[x].args[y];
+            if ((!filter.empty()) && (name.str().find(filter) == string::npos))
+            {
+                continue;
+            }
+            Result result = measure(entries[x], entries[x].args[y]);
+            result.name = name.str();
+            results.push_back(result);
+            cout << left << setw(32) << result.name << right << fixed << setprecision(1)
+            << setw(14) << result.medianNs << setw(14) << result.minNs
+            << setw(12) << result.iterations << setprecision(0)
+            << setw(16) << result.itemsPerSecond << "\n";
+            cout.unsetf(ios_base::floatfield);
+        }
+    }
+    if (jsonFile == "-")
+    {
+        writeJson(cout);
+    }
+    else if (!jsonFile.empty())
+    {
+        std::ofstream out(jsonFile.c_str());
+        if (!out)
+        {
+            cout << "\n\n\tError opening file " << jsonFile << ".\n\n";
+            return 1;
+        }
+        writeJson(out);
+    }
+    return 0;
+}
+
+MicroBench::Result MicroBench::measure(Entry &entry, long arg)
+{
+    Result result;
+    //! Double the iterations until a run is long enough to
+    //! estimate, then scale to the minimum time.
+    long iterations = 1;
+    double targetNs = minTime * 1.0e9;
+    while (true)
+    {
+        BenchState state(arg, iterations);
+        entry.func(state);
+        if ((state.elapsedNs >= targetNs * 0.1) || (iterations >= 1000000000L))
+        {
+            double perIter = std::max(state.elapsedNs / (double) iterations, 1.0);
+            iterations = std::max(1L, (long) (targetNs / perIter));
+            break;
+        }
+        iterations *= 2;
+    }
+    vector<double> times;
+    double items = 0.0;
+    for (int x = 0; x < repetitions; x++)
+    {
+        BenchState state(arg, iterations);
+        entry.func(state);
+        times.push_back(state.elapsedNs / (double) iterations);
+        if (state.elapsedNs > 0.0)
+        {
+            items += state.items / (state.elapsedNs / 1.0e9);
+        }
+    }
+    sort(times.begin(), times.end());
+    double sum = 0.0;
+    for (unsigned int x = 0; x < times.size(); x++)
+    {
+        sum += times[x];
+    }
+    result.iterations = iterations;
+    result.medianNs = times[times.size() / 2];
+    result.minNs = times[0];
+    result.meanNs = sum / (double) times.size();
+    result.itemsPerSecond = items / (double) repetitions;
+    return result;
+}
+
+void MicroBench::writeJson(ostream &out)
+{
+    time_t now = time(NULL);
+    char date[64];
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+    out << "{\n  \"context\": {\n"
+    << "    \"date\": \"" << date << "\",\n"
+    << "    \"num_cpus\": " << thread::hardware_concurrency() << ",\n"
+    << "    \"repetitions\": " << repetitions << ",\n"
+    << "    \"min_time\": " << minTime << "\n"
+    << "  },\n  \"benchmarks\": [\n";
+    out << fixed << setprecision(3);
+    for (unsigned int x = 0; x < results.size(); x++)
+    {
+        out << "    {\n"
+        << "      \"name\": \"" << results[x].name << "\",\n"
+        << "      \"run_name\": \"" << results[x].name << "\",\n"
+        << "      \"iterations\": " << results[x].iterations << ",\n"
+        << "      \"real_time\": " << results[x].medianNs << ",\n"
+        << "      \"cpu_time\": " << results[x].medianNs << ",\n"
+        << "      \"min_time_ns\": " << results[x].minNs << ",\n"
+        << "      \"mean_time_ns\": " << results[x].meanNs << ",\n"
+        << "      \"time_unit\": \"ns\",\n"
+        << "      \"items_per_second\": " << results[x].itemsPerSecond << "\n"
+        << "    }";
+        if (x + 1 < results.size())
+        {
+            out << ",";
+        }
+        out << "\n";
+    }
+    out << "  ]\n}\n";
+    out.unsetf(ios_base::floatfield);
+}
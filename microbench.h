@@ -0,0 +1,109 @@
+/*******************************************************************
+ * MicroBench:  A small harness to time functions on their own,
+ * in the manner of Google Benchmark, and write the results
+ * as JSON for comparison between builds.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+#include "commonheader.h"
+
+/** \class BenchState
+ * Handed to each benchmark function.  The function does its
+ * set up, then runs the work getIterations() times between
+ * startTimer() and stopTimer().
+ */
+class BenchState
+{
+public:
+    BenchState(long arg, long iterations);
+    ~BenchState();
+
+    /** \brief startTimer
+     * Starts timing the work.
+     */
+    void startTimer();
+
+    /** \brief stopTimer
+     * Stops timing the work.
+     */
+    void stopTimer();
+
+    /** \brief setItems
+     * The number of items processed in all the iterations,
+     * used to report items per second.
+     */
+    void setItems(double items);
+
+    //! The argument, an instance count or an image size.
+    long arg;
+    long iterations;
+    double elapsedNs;
+    double items;
+
+protected:
+    chrono::steady_clock::time_point begin;
+};
+
+/** \class MicroBench
+ * Holds the registered benchmarks.  For each benchmark and
+ * argument it raises the iteration count until a run takes
+ * the minimum time, repeats the run and reports the median,
+ * the minimum and the mean time per iteration.
+ */
+class MicroBench
+{
+public:
+    MicroBench();
+    ~MicroBench();
+
+    typedef function<void(BenchState &)> BenchFunc;
+
+    /** \brief add
+     * Registers a benchmark to be run once for each argument.
+     */
+    void add(string name, vector<long> args, BenchFunc func);
+
+    /** \brief run
+     * Reads the command line, runs the benchmarks and writes
+     * the results.  Returns the program exit code.
+     */
+    int run(int argc, char **argv);
+
+protected:
+    //! A registered benchmark.
+    struct Entry {
+        string name;
+        vector<long> args;
+        BenchFunc func;
+    };
+    //! The result of one benchmark and argument.
+    struct Result {
+        string name;
+        long iterations;
+        double medianNs;
+        double minNs;
+        double meanNs;
+        double itemsPerSecond;
+    };
+
+    /** \brief measure
+     * Calibrates and runs one benchmark with one argument.
+     */
+    Result measure(Entry &entry, long arg);
+
+    /** \brief writeJson
+     * Writes the results in the Google Benchmark JSON layout.
+     */
+    void writeJson(ostream &out);
+
+    vector<Entry> entries;
+    vector<Result> results;
+    double minTime;
+    int repetitions;
+    string filter, jsonFile;
+};
+
+#endif // MICROBENCH_H
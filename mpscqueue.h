@@ -0,0 +1,100 @@
+/*******************************************************************
+ * MpscQueue:  A lock free, fixed size queue from any number of
+ * producing threads to one consuming thread.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include "commonheader.h"
+
+/** \class MpscQueue
+ * A ring of SIZE slots, SIZE a power of two, each with a
+ * sequence number saying whose turn the slot is.  A producer
+ * claims the next place with a compare and swap on the tail,
+ * fills the slot and bumps its sequence; the consumer takes
+ * a slot once its sequence shows it filled.  No thread waits
+ * on a lock, and a producer that finds the ring full drops
+ * the item rather than wait.
+ */
+template <class T, size_t SIZE>
+class MpscQueue
+{
+    static_assert((SIZE & (SIZE - 1)) == 0, "MpscQueue size must be a power of two.");
+public:
+    MpscQueue()
+    {
+        for (size_t x = 0; x < SIZE; x++)
+        {
+            slots[x].sequence.store(x, memory_order_relaxed);
+        }
+        head = 0;
+        tail.store(0);
+    }
+    ~MpscQueue()
+    {
+    }
+
+    /** \brief push
+     * Adds an item from any thread.  Returns false,
+     * dropping the item, if the queue is full.
+     */
+    bool push(const T &item)
+    {
+        size_t place = tail.load(memory_order_relaxed);
+        Slot *slot;
+        while (true)
+        {
+            slot = &slots[place & (SIZE - 1)];
+            size_t sequence = slot->sequence.load(memory_order_acquire);
+            intptr_t turn = (intptr_t) sequence - (intptr_t) place;
+            if (turn == 0)
+            {
+                if (tail.compare_exchange_weak(place, place + 1, memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (turn < 0)
+            {
+                return false;
+            }
+            else
+            {
+                place = tail.load(memory_order_relaxed);
+            }
+        }
+        slot->item = item;
+        slot->sequence.store(place + 1, memory_order_release);
+        return true;
+    }
+
+    /** \brief pop
+     * Takes the oldest item, from the one consuming
+     * thread.  Returns false if the queue is empty.
+     */
+    bool pop(T &item)
+    {
+        Slot &slot = slots[head & (SIZE - 1)];
+        if (slot.sequence.load(memory_order_acquire) != head + 1)
+        {
+            return false;
+        }
+        item = slot.item;
+        slot.sequence.store(head + SIZE, memory_order_release);
+        head++;
+        return true;
+    }
+
+protected:
+    struct Slot {
+        atomic<size_t> sequence;
+        T item;
+    };
+    Slot slots[SIZE];
+    alignas(64) size_t head;
+    alignas(64) atomic<size_t> tail;
+};
+
+#endif // MPSCQUEUE_H
@@ -0,0 +1,169 @@
+/**********************************************************
+ *   cullcomp.glsl:  A shader to keep the cubes in view and
+ *   out of the fog, turn them, and pack them together for
+ *   fogvec.glsl, counting them into the indirect draw.
+ *   Created by: Edward Charles Eberle <eberdeed@eberdeed.net>
+ *   01/2020 San Diego, California USA
+ * ********************************************************/
+#version 310 es
+
+precision highp float;
+precision highp int;
+
+// GpuCull defines these.  The defaults let the file compile
+// on its own.
+#ifndef VIEW_COUNT
+#define VIEW_COUNT 1
+#endif
+#ifndef GROUP_SIZE
+#define GROUP_SIZE 64
+#endif
+
+layout (local_size_x = GROUP_SIZE) in;
+
+// The spin and the pictures of each cube, which never change.
+struct Spin {
+    vec4 xaxis;
+    vec4 yaxis;
+    vec4 index1;
+    vec4 index2;
+};
+
+// As fogvec.glsl reads them.
+struct Cube {
+    mat4 model;
+    vec4 index1;
+    vec4 index2;
+};
+
+// Where each cube is, which changes only when they drift.
+layout (std430, binding = 0) readonly buffer positionData
+{
+    vec4 positions[];
+};
+layout (std430, binding = 1) readonly buffer spinData
+{
+    Spin spins[];
+};
+layout (std430, binding = 2) writeonly buffer visibleCubes
+{
+    Cube visible[];
+};
+// The DrawArraysIndirectCommand, with the instances counted
+// here, each cube once for every view.  A mesh's
+// DrawElementsIndirectCommand has one more field, after the
+// instances, so the same count serves it.
+layout (std430, binding = 3) buffer drawCommand
+{
+    uint vertexCount;
+    uint instanceCount;
+    uint firstVertex;
+    uint baseInstance;
+};
+
+uniform int cubeCount;
+uniform mat4 viewProjections[VIEW_COUNT];
+uniform vec3 viewPositions[VIEW_COUNT];
+uniform float fogDistance;
+// False to keep every cube.
+uniform bool frustum;
+uniform float degrees;
+uniform float radius;
+
+// The running count of the cubes kept in the group, and
+// where the group's cubes start in visible.
+shared uint kept[GROUP_SIZE];
+shared uint base;
+
+bool inView(mat4 viewProjection, vec3 eye, vec3 center);
+mat4 rotation(float angle, vec3 axis);
+
+void main()
+{
+    uint id = gl_GlobalInvocationID.x;
+    uint local = gl_LocalInvocationID.x;
+    bool keep = false;
+    if (int(id) < cubeCount)
+    {
+        keep = !frustum;
+        for (int v = 0; (v < VIEW_COUNT) && !keep; v++)
+        {
+            keep = inView(viewProjections[v], viewPositions[v], positions[id].xyz);
+        }
+    }
+    kept[local] = keep ? 1u : 0u;
+    memoryBarrierShared();
+    barrier();
+    // The sum of the cubes kept up to each one, doubling
+    // the reach each step.
+    for (uint reach = 1u; reach < uint(GROUP_SIZE); reach <<= 1)
+    {
+        uint before = (local >= reach) ? kept[local - reach] : 0u;
+        memoryBarrierShared();
+        barrier();
+        kept[local] += before;
+        memoryBarrierShared();
+        barrier();
+    }
+    // One atomic for the whole group.
+    if (local == uint(GROUP_SIZE - 1))
+    {
+        base = atomicAdd(instanceCount, kept[local] * uint(VIEW_COUNT)) / uint(VIEW_COUNT);
+    }
+    memoryBarrierShared();
+    barrier();
+    if (!keep)
+    {
+        return;
+    }
+    // Turned as CubeCloud::sortDists turns them.
+    vec3 center = positions[id].xyz;
+    Spin spin = spins[id];
+    mat4 model = mat4(1.0);
+    model[3] = vec4(center, 1.0);
+    model = model * rotation(degrees * spin.xaxis.w * 2.0, spin.xaxis.xyz)
+    * rotation(degrees * spin.xaxis.w, spin.yaxis.xyz);
+    uint slot = base + kept[local] - 1u;
+    visible[slot].model = model;
+    visible[slot].index1 = spin.index1;
+    visible[slot].index2 = vec4(spin.index2.xy, distance(center, viewPositions[0]), 0.0);
+}
+
+// Inside every plane of the frustum by the radius, and
+// nearer the eye than the fog.
+bool inView(mat4 viewProjection, vec3 eye, vec3 center)
+{
+    if (distance(center, eye) >= fogDistance)
+    {
+        return false;
+    }
+    vec4 w = vec4(viewProjection[0][3], viewProjection[1][3],
+    viewProjection[2][3], viewProjection[3][3]);
+    for (int axis = 0; axis < 3; axis++)
+    {
+        vec4 row = vec4(viewProjection[0][axis], viewProjection[1][axis],
+        viewProjection[2][axis], viewProjection[3][axis]);
+        vec4 low = w + row;
+        vec4 high = w - row;
+        if ((dot(low.xyz, center) + low.w < -radius * length(low.xyz))
+        || (dot(high.xyz, center) + high.w < -radius * length(high.xyz)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The same matrix as glm::rotate.
+mat4 rotation(float angle, vec3 axis)
+{
+    float c = cos(angle);
+    float s = sin(angle);
+    vec3 a = normalize(axis);
+    vec3 t = (1.0 - c) * a;
+    return mat4(
+        c + t.x * a.x, t.x * a.y + s * a.z, t.x * a.z - s * a.y, 0.0,
+        t.y * a.x - s * a.z, c + t.y * a.y, t.y * a.z + s * a.x, 0.0,
+        t.z * a.x + s * a.y, t.z * a.y - s * a.x, c + t.z * a.z, 0.0,
+        0.0, 0.0, 0.0, 1.0);
+}
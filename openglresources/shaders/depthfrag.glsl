@@ -0,0 +1,28 @@
+/**********************************************************
+ *   depthfrag.glsl:  The fragment shader for the depth
+ *   pass, which writes no color at all.
+ *   Created by: Edward Charles Eberle <eberdeed@eberdeed.net>
+ *   01/2020 San Diego, California USA
+ * ********************************************************/
+#version 300 es
+
+precision lowp float;
+
+#ifndef VIEW_COUNT
+#define VIEW_COUNT 1
+#endif
+
+#if VIEW_COUNT > 1
+in vec4 viewClip;
+#endif
+
+void main()
+{
+#if VIEW_COUNT > 1
+    // Nothing outside the view's own part of the frame.
+    if (any(lessThan(viewClip, vec4(0.0))))
+    {
+        discard;
+    }
+#endif
+}
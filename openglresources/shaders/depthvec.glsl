@@ -0,0 +1,86 @@
+/**********************************************************
+ *   depthvec.glsl:  A shader to lay down the depth of the
+ *   cubes before they are shaded, so the fogfrag.glsl
+ *   shader runs once for each pixel that can be seen.
+ *   Created by: Edward Charles Eberle <eberdeed@eberdeed.net>
+ *   01/2020 San Diego, California USA
+ * ********************************************************/
+#version 300 es
+
+precision highp float;
+
+// ShaderVariants defines these from commonheader.h.  The
+// defaults let the file compile on its own.
+#ifndef NUM_IMAGES
+#define NUM_IMAGES 16
+#endif
+#ifndef NUM_INSTANCES
+#define NUM_INSTANCES 30
+#endif
+#ifndef VIEW_COUNT
+#define VIEW_COUNT 1
+#endif
+#ifndef GPU_CULL
+#define GPU_CULL 0
+#endif
+
+// The depth must match fogvec.glsl to the last bit for the
+// equal depth test in the shading pass.
+invariant gl_Position;
+
+// The same attribute the vertex array gives fogvec.glsl.
+layout (location = 0) in vec3 position;
+
+#if VIEW_COUNT > 1
+// The views as fogvec.glsl draws them.
+uniform mat4 projections[VIEW_COUNT];
+uniform mat4 views[VIEW_COUNT];
+uniform vec4 viewRects[VIEW_COUNT];
+out vec4 viewClip;
+#else
+uniform mat4 projection;
+uniform mat4 view;
+#endif
+
+#if GPU_CULL
+// The same buffer as fogvec.glsl.
+struct Cube {
+    mat4 model;
+    vec4 index1;
+    vec4 index2;
+};
+layout (std430, binding = 2) readonly buffer visibleCubes
+{
+    Cube visible[];
+};
+#define FIRST_CUBE 0
+#define CUBE_MODEL(cube) visible[cube].model
+#else
+uniform int repetition;
+// The same block as fogvec.glsl, so both read one buffer.
+layout (packed) uniform itemData 
+{
+    vec4 instIndex1[NUM_IMAGES * NUM_INSTANCES];
+    vec2 instIndex2[NUM_IMAGES * NUM_INSTANCES];
+    vec2 instDist[NUM_IMAGES * NUM_INSTANCES];
+    mat4 instModel[NUM_IMAGES * NUM_INSTANCES];
+};
+#define FIRST_CUBE (repetition * NUM_INSTANCES)
+#define CUBE_MODEL(cube) instModel[cube]
+#endif
+mat4 model;
+void main( void )
+{
+#if VIEW_COUNT > 1
+    int viewIndex = gl_InstanceID % VIEW_COUNT;
+    model = CUBE_MODEL(gl_InstanceID / VIEW_COUNT + FIRST_CUBE);
+    vec4 world = model * vec4(position, 1.0f);
+    vec4 clip = projections[viewIndex] * views[viewIndex] * world;
+    viewClip = vec4(clip.w + clip.x, clip.w - clip.x, clip.w + clip.y, clip.w - clip.y);
+    gl_Position = vec4(clip.xy * viewRects[viewIndex].xy + clip.w * viewRects[viewIndex].zw, clip.zw);
+#else
+    model = CUBE_MODEL(gl_InstanceID + FIRST_CUBE);
+    vec4 world = model * vec4(position, 1.0f);
+    gl_Position = projection * view * world;
+#endif
+}
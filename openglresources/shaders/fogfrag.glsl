@@ -9,9 +9,36 @@
 
 #version 300 es
 
-precision mediump float;
+// ShaderVariants defines these from the C++ side.  The
+// defaults let the file compile on its own.
+#ifndef NUM_LIGHTS
+#define NUM_LIGHTS 8
+#endif
+#ifndef FLOAT_PRECISION
+#define FLOAT_PRECISION mediump
+#endif
+#ifndef USE_FOG
+#define USE_FOG 1
+#endif
+#ifndef SH_LIGHTING
+#define SH_LIGHTING 0
+#endif
+#ifndef REFLECTION
+#define REFLECTION 0
+#endif
+#ifndef VIEW_COUNT
+#define VIEW_COUNT 1
+#endif
+#ifndef OIT
+#define OIT 0
+#endif
+#ifndef GPU_CULL
+#define GPU_CULL 0
+#endif
 
-const int numlights = 8;
+precision FLOAT_PRECISION float;
+
+const int numlights = NUM_LIGHTS;
 
 struct Lights {
     vec3 lightPos;
@@ -29,21 +56,69 @@ struct TexIO {
 
 in TexIO texData;
 
+#if OIT
+// Weighted blended transparency, see RenderCore::drawTranslucent.
+// The weighted sum of the colors, with what the cubes leave
+// of the background in the alpha, and the sum of the weights.
+layout (location = 0) out vec4 outColor;
+layout (location = 1) out float outWeight;
+uniform float opacity;
+#else
 out vec4 outColor;
+#endif
 
 uniform Lights lighting[numlights];
+// How many of the lights to use, see qualitygovernor.h.
+uniform int lightCount;
+#if VIEW_COUNT > 1
+// The eye of each view, and the view and its edges as
+// fogvec.glsl passes them.  A uniform in both shaders must
+// have the same precision in both.
+uniform highp vec3 viewPositions[VIEW_COUNT];
+flat in int viewIndex;
+in vec4 viewClip;
+vec3 viewPos;
+#else
 uniform vec3 viewPos;
+#endif
 uniform vec4 fogColor;
 uniform float fogMaxDist;
 uniform float fogMinDist;
 
 uniform sampler2D cratetex;
 uniform highp sampler2DArray tex;
+#if GPU_CULL
+// Every side in one draw, see fogvec.glsl.
+flat in int side;
+#else
 uniform int side;
+#endif
+// A variant has the features fixed, so the compiler drops
+// the branches it does not take.  The dynamic program
+// reads them from uniforms.
+#ifdef DYNAMIC_BRANCHES
 uniform bool foggy;
+uniform bool shLighting;
+uniform bool reflection;
+#else
+const bool foggy = (USE_FOG != 0);
+const bool shLighting = (SH_LIGHTING != 0);
+const bool reflection = (REFLECTION != 0);
+#endif
+// The skybox reflected in the cubes.
+uniform samplerCube skybox;
+uniform float reflectivity;
+// The lights projected into spherical harmonics, see
+// sphericalharmonics.h, and the one light standing in
+// for them in the highlight.
+uniform vec3 shCoeffs[9];
+uniform vec3 domLightDir;
+uniform vec3 domLightColor;
 
 vec4 CalcDirLight(vec3 light, vec3 normal, vec3 lightDir, vec3 viewDir);
+vec4 CalcSHLight(vec3 normal, vec3 viewDir);
 float computeLinearFogFactor();
+void writeColor(vec4 color, float coverage);
 vec4 texVal;
 vec4 tmpVal;
 vec3 texVec;
@@ -54,6 +129,14 @@ float sideIndex[6];
 
 void main()
 {
+#if VIEW_COUNT > 1
+    // Nothing outside the view's own part of the frame.
+    if (any(lessThan(viewClip, vec4(0.0))))
+    {
+        discard;
+    }
+    viewPos = viewPositions[viewIndex];
+#endif
     for (int x = 0; x < 4; x++)
     {
         sideIndex[x] = texData.index1[x];
@@ -62,31 +145,76 @@ void main()
     sideIndex[5] = texData.index2.y;  
     float fogFactor = computeLinearFogFactor();
     texVec = vec3(texData.TexCoord.x, texData.TexCoord.y, sideIndex[side]);
+    vec4 picture = texture(tex, texVec);
+    // A cube lost in the fog needs no lighting.
+    if (foggy && (fogFactor <= 0.0))
+    {
+        writeColor(fogColor, picture.a);
+        return;
+    }
     normal = normalize(texData.Normal);
-    texVal = mix(texture(cratetex, texData.TexCoord), texture(tex, texVec), 0.3);
+    texVal = mix(texture(cratetex, texData.TexCoord), picture, 0.3);
     //texVal = texture(cratetex, texData.TexCoord);
     rescolor = vec4(0.0f, 0.0f, 0.0f, 0.0f);
-    for (int x = 0; x < numlights; x++)
+    if (shLighting)
     {
-        vec3 I = -normalize(lighting[x].lightPos - texData.Position);
-        vec3 viewDir = normalize(viewPos - texData.Position);
-        vec3 R = reflect(I, normal);
-        //vec3 R = vec3(-5.0, 10.0, 10.0);
-        //skyLight = vec3(texture(skybox, R));
-        vec4 result = CalcDirLight(lighting[x].lightColor.xyz, normal, R, viewDir);
-        rescolor += result;
+        rescolor = CalcSHLight(normal, normalize(viewPos - texData.Position));
+    }
+    else
+    {
+        for (int x = 0; x < numlights; x++)
+        {
+            if (x >= lightCount)
+            {
+                break;
+            }
+            vec3 I = -normalize(lighting[x].lightPos - texData.Position);
+            vec3 viewDir = normalize(viewPos - texData.Position);
+            vec3 R = reflect(I, normal);
+            //vec3 R = vec3(-5.0, 10.0, 10.0);
+            //skyLight = vec3(texture(skybox, R));
+            vec4 result = CalcDirLight(lighting[x].lightColor.xyz, normal, R, viewDir);
+            rescolor += result;
+        }
+        // Fewer lights, each brighter.
+        rescolor *= float(numlights) / float(lightCount);
     }
     rescolor *= 0.6;
+    if (reflection)
+    {
+        vec3 R = reflect(normalize(texData.Position - viewPos), normal);
+        rescolor = mix(rescolor, vec4(texture(skybox, R).rgb, 1.0), reflectivity);
+    }
     if (!foggy)
     {
-        outColor =rescolor;
+        writeColor(rescolor, picture.a);
     }
     else
     {
-        outColor = (rescolor * fogFactor) + (fogColor * (1.0 - fogFactor)); 
+        writeColor((rescolor * fogFactor) + (fogColor * (1.0 - fogFactor)), picture.a);
     } 
 }  
 
+// Drawn see through, the cube is less opaque where the
+// picture on the side is.
+void writeColor(vec4 color, float coverage)
+{
+#if OIT
+    float alpha = opacity * mix(0.5, 1.0, coverage);
+    // Nearer surfaces weigh more, so the nearest show
+    // through the sum most, as in a sorted blend.  The
+    // weight falls with the distance the fog uses, as the
+    // depth is packed too near 1 to tell the cubes apart.
+    float d = texData.dist1;
+    float weight = alpha * clamp(10.0 / (1e-5 + pow(d / 5.0, 2.0) + pow(d / 200.0, 6.0)),
+    0.01, 3000.0);
+    outColor = vec4(color.rgb * alpha * weight, alpha);
+    outWeight = alpha * weight;
+#else
+    outColor = color;
+#endif
+}
+
 vec4 CalcDirLight(vec3 light, vec3 normal, vec3 lightDir, vec3 viewDir)
 {
     // Diffuse shading
@@ -103,6 +231,25 @@ vec4 CalcDirLight(vec3 light, vec3 normal, vec3 lightDir, vec3 viewDir)
     //return vec4((ambient + diffuse), 1.0) * 0.8;
     //return vec4(diff, 0.0, 0.0, 1.0);
 } 
+
+vec4 CalcSHLight(vec3 normal, vec3 viewDir)
+{
+    // Diffuse from every light at once.
+    vec3 n = normal;
+    vec3 irradiance = shCoeffs[0] + shCoeffs[1] * n.y + shCoeffs[2] * n.z
+    + shCoeffs[3] * n.x + shCoeffs[4] * (n.x * n.y) + shCoeffs[5] * (n.y * n.z)
+    + shCoeffs[6] * (3.0 * n.z * n.z - 1.0) + shCoeffs[7] * (n.x * n.z)
+    + shCoeffs[8] * (n.x * n.x - n.y * n.y);
+    irradiance = max(irradiance, vec3(0.0));
+    // Specular from the dominant light.
+    vec3 reflectDir = reflect(-domLightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+    vec3 ambient  = 0.2 * texVal.xyz;
+    vec3 diffuse  = irradiance * texVal.xyz;
+    vec3 specular = domLightColor * spec * texVal.xyz;
+    return vec4(ambient + diffuse + specular, 1.0);
+}
+
 float computeLinearFogFactor()
 {
    float factor;
@@ -11,8 +11,20 @@
 
 precision highp float;
 
-const int NUM_IMAGES = 16;
-const int NUM_INSTANCES = 30;
+// ShaderVariants defines these from commonheader.h.  The
+// defaults let the file compile on its own.
+#ifndef NUM_IMAGES
+#define NUM_IMAGES 16
+#endif
+#ifndef NUM_INSTANCES
+#define NUM_INSTANCES 30
+#endif
+#ifndef VIEW_COUNT
+#define VIEW_COUNT 1
+#endif
+#ifndef GPU_CULL
+#define GPU_CULL 0
+#endif
 
 struct TexIO {
     vec3 Normal;
@@ -28,11 +40,46 @@ in vec3 normal;
 in vec2 texCoord;
 
 out TexIO texData;
+// The depth must match depthvec.glsl to the last bit for
+// the equal depth test after the depth pass.
+invariant gl_Position;
 
-uniform int repetition;
+#if VIEW_COUNT > 1
+// Each cube is drawn once for every view, which goes to its
+// own part of the frame, see RenderCore::configureViews.
+uniform mat4 projections[VIEW_COUNT];
+uniform mat4 views[VIEW_COUNT];
+uniform vec3 viewPositions[VIEW_COUNT];
+uniform vec4 viewRects[VIEW_COUNT];
+flat out int viewIndex;
+// How far inside each edge of its part of the frame the
+// vertex is, for the fragment shader to cut along.
+out vec4 viewClip;
+#else
 uniform mat4 projection;
 uniform mat4 view;
+#endif
 
+#if GPU_CULL
+// The cubes cullcomp.glsl kept, all of them in one draw with
+// every side, so the side comes from the vertex.
+struct Cube {
+    mat4 model;
+    vec4 index1;
+    vec4 index2;
+};
+layout (std430, binding = 2) readonly buffer visibleCubes
+{
+    Cube visible[];
+};
+flat out int side;
+#define FIRST_CUBE 0
+#define CUBE_MODEL(cube) visible[cube].model
+#define CUBE_INDEX1(cube) visible[cube].index1
+#define CUBE_INDEX2(cube) visible[cube].index2.xy
+#define CUBE_DIST(cube) visible[cube].index2.z
+#else
+uniform int repetition;
 layout (packed) uniform itemData 
 {
     vec4 instIndex1[NUM_IMAGES * NUM_INSTANCES];
@@ -40,14 +87,50 @@ layout (packed) uniform itemData
     vec2 instDist[NUM_IMAGES * NUM_INSTANCES];
     mat4 instModel[NUM_IMAGES * NUM_INSTANCES];
 };
+#define FIRST_CUBE (repetition * NUM_INSTANCES)
+#define CUBE_MODEL(cube) instModel[cube]
+#define CUBE_INDEX1(cube) instIndex1[cube]
+#define CUBE_INDEX2(cube) instIndex2[cube]
+#define CUBE_DIST(cube) instDist[cube].x
+#endif
 mat4 model;
 void main( void )
 {
-    model = instModel[gl_InstanceID + (repetition * NUM_INSTANCES)];
-    gl_Position = projection * view * model * vec4(position, 1.0f);
-    texData.Normal = normal;
-    texData.index1 = instIndex1[gl_InstanceID + (repetition * NUM_INSTANCES)];
-    texData.index2 = instIndex2[gl_InstanceID + (repetition * NUM_INSTANCES)];
-    texData.dist1 = instDist[gl_InstanceID + (repetition * NUM_INSTANCES)].x;
+#if GPU_CULL
+#ifdef SIDE_STARTS
+    // The vertices of a mesh's sides follow each other.
+    const int sideStarts[6] = int[6](SIDE_STARTS);
+    side = 0;
+    for (int s = 1; s < 6; s++)
+    {
+        side += int(gl_VertexID >= sideStarts[s]);
+    }
+#else
+    side = gl_VertexID / 6;
+#endif
+#endif
+#if VIEW_COUNT > 1
+    int cube = gl_InstanceID / VIEW_COUNT + FIRST_CUBE;
+    viewIndex = gl_InstanceID % VIEW_COUNT;
+    model = CUBE_MODEL(cube);
+    vec4 world = model * vec4(position, 1.0f);
+    vec4 clip = projections[viewIndex] * views[viewIndex] * world;
+    viewClip = vec4(clip.w + clip.x, clip.w - clip.x, clip.w + clip.y, clip.w - clip.y);
+    gl_Position = vec4(clip.xy * viewRects[viewIndex].xy + clip.w * viewRects[viewIndex].zw, clip.zw);
+    // The fog goes by the distance from this view's eye.
+    texData.dist1 = distance(model[3].xyz, viewPositions[viewIndex]);
+#else
+    int cube = gl_InstanceID + FIRST_CUBE;
+    model = CUBE_MODEL(cube);
+    vec4 world = model * vec4(position, 1.0f);
+    gl_Position = projection * view * world;
+    texData.dist1 = CUBE_DIST(cube);
+#endif
+    // The model only turns and moves the cube, so the
+    // normal turns with it.
+    texData.Normal = mat3(model) * normal;
+    texData.Position = world.xyz;
+    texData.index1 = CUBE_INDEX1(cube);
+    texData.index2 = CUBE_INDEX2(cube);
     texData.TexCoord = texCoord;
 }
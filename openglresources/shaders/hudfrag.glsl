@@ -0,0 +1,26 @@
+/**********************************************************
+ *   hudfrag.glsl:  A shader to color the letters and bars
+ *   of the performance display from the font.
+ *   Created by: Edward Charles Eberle <eberdeed@eberdeed.net>
+ *   01/2020 San Diego, California USA
+ * ********************************************************/
+#version 300 es
+
+precision mediump float;
+
+in vec2 texCoord;
+in vec4 quadColor;
+
+out vec4 outColor;
+
+uniform sampler2D font;
+
+void main()
+{
+    float coverage = texture(font, texCoord).r;
+    if (coverage == 0.0)
+    {
+        discard;
+    }
+    outColor = vec4(quadColor.rgb, quadColor.a * coverage);
+}
@@ -0,0 +1,32 @@
+/**********************************************************
+ *   hudvec.glsl:  A shader to place the quads of the
+ *   performance display, letters and bars alike, each one
+ *   an instance with its own rectangle in pixels.
+ *   Created by: Edward Charles Eberle <eberdeed@eberdeed.net>
+ *   01/2020 San Diego, California USA
+ * ********************************************************/
+#version 300 es
+
+precision highp float;
+
+// Left, top, width and height in pixels from the top left.
+layout (location = 0) in vec4 rect;
+layout (location = 1) in vec4 color;
+// The cell of the font, zero for solid.
+layout (location = 2) in float glyph;
+
+out vec2 texCoord;
+out vec4 quadColor;
+
+uniform vec2 screen;
+uniform float glyphs;
+
+void main( void )
+{
+    // A strip of four corners with no vertex buffer.
+    vec2 corner = vec2(float(gl_VertexID & 1), float((gl_VertexID & 2) >> 1));
+    vec2 pixel = vec2(rect.x + corner.x * rect.z, rect.y + (1.0 - corner.y) * rect.w);
+    gl_Position = vec4(pixel.x / screen.x * 2.0 - 1.0, 1.0 - pixel.y / screen.y * 2.0, 0.0, 1.0);
+    texCoord = vec2((glyph + corner.x) / glyphs, corner.y);
+    quadColor = color;
+}
@@ -0,0 +1,32 @@
+/**********************************************************
+ *   oitfrag.glsl:  A shader to turn the weighted sums of the
+ *   translucent cubes into one color and blend it over the
+ *   background by what the cubes leave of it.
+ *   Created by: Edward Charles Eberle <eberdeed@eberdeed.net>
+ *   01/2020 San Diego, California USA
+ * ********************************************************/
+#version 300 es
+
+precision mediump float;
+
+out vec4 outColor;
+
+// The sums from fogfrag.glsl, pixel for pixel.
+uniform sampler2D accum;
+uniform sampler2D weights;
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec4 sum = texelFetch(accum, pixel, 0);
+    float reveal = sum.a;
+    // Nothing drawn here, leave the background alone.
+    if (reveal >= 1.0)
+    {
+        discard;
+    }
+    float weight = texelFetch(weights, pixel, 0).r;
+    // The average color, with the background showing
+    // through by the alpha.
+    outColor = vec4(sum.rgb / max(weight, 0.00001), reveal);
+}
@@ -0,0 +1,18 @@
+/**********************************************************
+ *   oitvec.glsl:  A shader to cover the frame with one
+ *   triangle, for putting the translucent cubes over the
+ *   background.
+ *   Created by: Edward Charles Eberle <eberdeed@eberdeed.net>
+ *   01/2020 San Diego, California USA
+ * ********************************************************/
+#version 300 es
+
+precision highp float;
+
+void main( void )
+{
+    // Corners at (-1, -1), (3, -1) and (-1, 3), with no
+    // vertex buffer.
+    vec2 corner = vec2(float((gl_VertexID & 1) << 2), float((gl_VertexID & 2) << 1));
+    gl_Position = vec4(corner - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,32 @@
+/**********************************************************
+ *   skyboxfrag.glsl:  A shader to color the skybox from the
+ *   cube map, seen faintly through the fog when it is on.
+ *   Created by: Edward Charles Eberle <eberdeed@eberdeed.net>
+ *   01/2020 San Diego, California USA
+ * ********************************************************/
+#version 300 es
+
+precision mediump float;
+
+in vec3 texDir;
+
+out vec4 outColor;
+
+uniform samplerCube skybox;
+uniform bool foggy;
+uniform vec4 fogColor;
+// How much of the fog color covers the sky.
+uniform float skyFog;
+
+void main()
+{
+    vec4 sky = vec4(texture(skybox, texDir).rgb, 1.0);
+    if (foggy)
+    {
+        outColor = mix(sky, fogColor, skyFog);
+    }
+    else
+    {
+        outColor = sky;
+    }
+}
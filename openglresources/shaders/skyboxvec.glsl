@@ -0,0 +1,26 @@
+/**********************************************************
+ *   skyboxvec.glsl:  A shader to place the skybox around
+ *   the viewer at the far plane, so it is drawn only where
+ *   nothing else has been.
+ *   Created by: Edward Charles Eberle <eberdeed@eberdeed.net>
+ *   01/2020 San Diego, California USA
+ * ********************************************************/
+#version 300 es
+
+precision highp float;
+
+layout (location = 0) in vec3 position;
+
+out vec3 texDir;
+
+uniform mat4 projection;
+// The view without its translation, so the sky stays put.
+uniform mat4 view;
+
+void main( void )
+{
+    texDir = position;
+    vec4 pos = projection * view * vec4(position, 1.0);
+    // A depth of w over w puts every sky fragment at 1.0.
+    gl_Position = pos.xyww;
+}
@@ -0,0 +1,447 @@
+/*******************************************************************
+ * Options:  A class to read the command line arguments.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "options.h"
+
+Options::Options()
+{
+    headless = false;
+    frames = 600;
+    warmup = 30;
+    seed = 1;
+    seedSet = false;
+    count = NUM_IMAGES * NUM_INSTANCES;
+    threads = 0;
+    width = 1280;
+    height = 1024;
+    cameraPath = "orbit";
+    tickRate = 120.0;
+    shLighting = false;
+    dynamicShaders = false;
+    highPrecision = false;
+    skybox = true;
+    reflection = false;
+    depthPrepass = false;
+    oit = false;
+    drift = false;
+    hud = false;
+    streaming = true;
+    metricsPort = 0;
+    tiles = 0;
+    tileWorker = -1;
+    tileCommands = tileResults = tileFrame = -1;
+    cull = true;
+    gpuCull = false;
+    logLevel = Logger::LEVEL_INFO;
+    assertZeroAlloc = false;
+    views = 1;
+    viewSpacing = 0.5f;
+    budget = 0.0;
+    captureRaw = false;
+    captureFirst = 0;
+    captureCount = 60;
+}
+
+Options::~Options()
+{
+}
+
+bool Options::parse(int argc, char **argv)
+{
+    arguments.assign(argv + 1, argv + argc);
+    for (int x = 1; x < argc; x++)
+    {
+        string arg = argv[x];
+        //! Every argument but --headless, --assert-zero-alloc
+        //! and --help takes a value.
+        if (arg == "--headless")
+        {
+            headless = true;
+            continue;
+        }
+        if (arg == "--assert-zero-alloc")
+        {
+            assertZeroAlloc = true;
+            continue;
+        }
+        if ((arg == "--help") || (arg == "-h"))
+        {
+            return false;
+        }
+        if (x + 1 >= argc)
+        {
+            cout << "\n\n\tMissing value for " << arg << ".\n\n";
+            return false;
+        }
+        string value = argv[++x];
+        try
+        {
+            if (arg == "--frames")
+            {
+                frames = stoi(value);
+            }
+            else if (arg == "--warmup")
+            {
+                warmup = stoi(value);
+            }
+            else if (arg == "--seed")
+            {
+                seed = (unsigned int) stoul(value);
+                seedSet = true;
+            }
+            else if (arg == "--count")
+            {
+                count = stoi(value);
+            }
+            else if (arg == "--threads")
+            {
+                threads = stoi(value);
+            }
+            else if (arg == "--width")
+            {
+                width = stoi(value);
+            }
+            else if (arg == "--height")
+            {
+                height = stoi(value);
+            }
+            else if (arg == "--path")
+            {
+                cameraPath = value;
+            }
+            else if (arg == "--tick-rate")
+            {
+                tickRate = stod(value);
+            }
+            else if (arg == "--load-scene")
+            {
+                loadScene = value;
+            }
+            else if (arg == "--save-scene")
+            {
+                saveScene = value;
+            }
+            else if (arg == "--mesh")
+            {
+                mesh = value;
+            }
+            else if (arg == "--lighting")
+            {
+                if ((value != "lights") && (value != "sh"))
+                {
+                    cout << "\n\n\tLighting must be lights or sh.\n\n";
+                    return false;
+                }
+                shLighting = (value == "sh");
+            }
+            else if (arg == "--shaders")
+            {
+                if ((value != "variants") && (value != "dynamic"))
+                {
+                    cout << "\n\n\tShaders must be variants or dynamic.\n\n";
+                    return false;
+                }
+                dynamicShaders = (value == "dynamic");
+            }
+            else if (arg == "--precision")
+            {
+                if ((value != "medium") && (value != "high"))
+                {
+                    cout << "\n\n\tPrecision must be medium or high.\n\n";
+                    return false;
+                }
+                highPrecision = (value == "high");
+            }
+            else if (arg == "--skybox")
+            {
+                if ((value != "off") && (value != "on") && (value != "reflect"))
+                {
+                    cout << "\n\n\tSkybox must be off, on or reflect.\n\n";
+                    return false;
+                }
+                skybox = (value != "off");
+                reflection = (value == "reflect");
+            }
+            else if (arg == "--record")
+            {
+                record = value;
+            }
+            else if (arg == "--replay")
+            {
+                replay = value;
+            }
+            else if (arg == "--budget")
+            {
+                budget = stod(value);
+            }
+            else if (arg == "--drift")
+            {
+                if ((value != "off") && (value != "on"))
+                {
+                    cout << "\n\n\tDrift must be off or on.\n\n";
+                    return false;
+                }
+                drift = (value == "on");
+            }
+            else if (arg == "--hud")
+            {
+                if ((value != "off") && (value != "on"))
+                {
+                    cout << "\n\n\tThe display must be off or on.\n\n";
+                    return false;
+                }
+                hud = (value == "on");
+            }
+            else if (arg == "--streaming")
+            {
+                if ((value != "off") && (value != "on"))
+                {
+                    cout << "\n\n\tStreaming must be off or on.\n\n";
+                    return false;
+                }
+                streaming = (value == "on");
+            }
+            else if (arg == "--cull")
+            {
+                if ((value != "off") && (value != "on") && (value != "gpu"))
+                {
+                    cout << "\n\n\tCull must be off, on or gpu.\n\n";
+                    return false;
+                }
+                cull = (value != "off");
+                gpuCull = (value == "gpu");
+            }
+            else if (arg == "--views")
+            {
+                views = stoi(value);
+                if ((views != 1) && (views != 2) && (views != 4))
+                {
+                    cout << "\n\n\tViews must be 1, 2 or 4.\n\n";
+                    return false;
+                }
+            }
+            else if (arg == "--view-spacing")
+            {
+                viewSpacing = stof(value);
+            }
+            else if (arg == "--log-level")
+            {
+                if (!Logger::levelFromName(value, logLevel))
+                {
+                    cout << "\n\n\tLog level must be trace, debug, info, warn, error or off.\n\n";
+                    return false;
+                }
+            }
+            else if (arg == "--trace")
+            {
+                trace = value;
+            }
+            else if (arg == "--metrics-port")
+            {
+                metricsPort = stoi(value);
+                if ((metricsPort < 0) || (metricsPort > 65535))
+                {
+                    cout << "\n\n\tThe metrics port must be from 0 to 65535.\n\n";
+                    return false;
+                }
+            }
+            else if (arg == "--tiles")
+            {
+                tiles = stoi(value);
+                if ((tiles < 0) || (tiles > 64))
+                {
+                    cout << "\n\n\tThe tiles must be from 0 to 64.\n\n";
+                    return false;
+                }
+            }
+            else if (arg == "--tile-worker")
+            {
+                if (sscanf(value.c_str(), "%d,%d,%d,%d", &tileWorker, &tileCommands,
+                &tileResults, &tileFrame) != 4)
+                {
+                    cout << "\n\n\tA tile worker needs its number and three descriptors.\n\n";
+                    return false;
+                }
+            }
+            else if (arg == "--capture")
+            {
+                capture = value;
+            }
+            else if (arg == "--capture-format")
+            {
+                if ((value != "png") && (value != "raw"))
+                {
+                    cout << "\n\n\tCapture format must be png or raw.\n\n";
+                    return false;
+                }
+                captureRaw = (value == "raw");
+            }
+            else if (arg == "--capture-frames")
+            {
+                //! Either a count from the first frame, or a
+                //! range of frames A-B, both included.
+                size_t dash = value.find('-');
+                if (dash == string::npos)
+                {
+                    captureFirst = 0;
+                    captureCount = stol(value);
+                }
+                else
+                {
+                    captureFirst = stol(value.substr(0, dash));
+                    captureCount = stol(value.substr(dash + 1)) - captureFirst + 1;
+                }
+            }
+            else if (arg == "--prepass")
+            {
+                if ((value != "off") && (value != "on"))
+                {
+                    cout << "\n\n\tPrepass must be off or on.\n\n";
+                    return false;
+                }
+                depthPrepass = (value == "on");
+            }
+            else if (arg == "--transparency")
+            {
+                if ((value != "opaque") && (value != "oit"))
+                {
+                    cout << "\n\n\tTransparency must be opaque or oit.\n\n";
+                    return false;
+                }
+                oit = (value == "oit");
+            }
+            else
+            {
+                cout << "\n\n\tUnknown argument " << arg << ".\n\n";
+                return false;
+            }
+        }
+        catch (exception &exc)
+        {
+            cout << "\n\n\tBad value " << value << " for " << arg << ".\n\n";
+            return false;
+        }
+    }
+    if ((frames < 1) || (warmup < 0) || (count < 1) || (width < 1) || (height < 1)
+    || (tickRate <= 0.0) || (budget < 0.0) || (captureFirst < 0) || (captureCount < 1))
+    {
+        cout << "\n\n\tFrames, count, width, height, tick rate and frames captured "
+        << "must be positive, and the budget may not be negative.\n\n";
+        return false;
+    }
+    if ((!record.empty()) && (!replay.empty()))
+    {
+        cout << "\n\n\tGive --record or --replay, not both.\n\n";
+        return false;
+    }
+    return true;
+}
+
+void Options::useRecording(const InputRecord::Header &header)
+{
+    seed = header.seed;
+    seedSet = true;
+    count = (int) header.cubes;
+    tickRate = header.tickRate;
+    shLighting = (header.flags & InputRecord::FLAG_SH_LIGHTING) != 0;
+    skybox = (header.flags & InputRecord::FLAG_SKYBOX) != 0;
+    reflection = (header.flags & InputRecord::FLAG_REFLECTION) != 0;
+    depthPrepass = (header.flags & InputRecord::FLAG_PREPASS) != 0;
+    drift = (header.flags & InputRecord::FLAG_DRIFT) != 0;
+    //! Older files kept none of what follows, and are left
+    //! to the arguments.
+    if (header.views > 0)
+    {
+        views = header.views;
+        viewSpacing = header.viewSpacing;
+        oit = (header.flags & InputRecord::FLAG_OIT) != 0;
+        gpuCull = (header.flags & InputRecord::FLAG_GPU_CULL) != 0;
+        cull = (header.flags & InputRecord::FLAG_NO_CULL) == 0;
+        dynamicShaders = (header.flags & InputRecord::FLAG_DYNAMIC_SHADERS) != 0;
+        highPrecision = (header.flags & InputRecord::FLAG_HIGH_PRECISION) != 0;
+        if (((header.flags & InputRecord::FLAG_MESH) != 0) && mesh.empty())
+        {
+            cout << "\n\n\tThe session was recorded with a mesh.  Give the "
+            << "same --mesh to see the same cubes.\n\n";
+        }
+    }
+    if (((header.flags & InputRecord::FLAG_SCENE_FILE) != 0) && loadScene.empty())
+    {
+        cout << "\n\n\tThe session was recorded with a scene file.  Give the "
+        << "same --load-scene to see the same cubes.\n\n";
+    }
+}
+
+InputRecord::Header Options::recordingHeader(vec3 start)
+{
+    InputRecord::Header header;
+    memset(&header, 0, sizeof(header));
+    header.tickRate = tickRate;
+    header.seed = seed;
+    header.cubes = (uint32_t) count;
+    header.flags = (shLighting ? InputRecord::FLAG_SH_LIGHTING : 0)
+    | (skybox ? InputRecord::FLAG_SKYBOX : 0)
+    | (reflection ? InputRecord::FLAG_REFLECTION : 0)
+    | (depthPrepass ? InputRecord::FLAG_PREPASS : 0)
+    | (drift ? InputRecord::FLAG_DRIFT : 0)
+    | (loadScene.empty() ? 0 : InputRecord::FLAG_SCENE_FILE)
+    | (oit ? InputRecord::FLAG_OIT : 0)
+    | (gpuCull ? InputRecord::FLAG_GPU_CULL : 0)
+    | (cull ? 0 : InputRecord::FLAG_NO_CULL)
+    | (dynamicShaders ? InputRecord::FLAG_DYNAMIC_SHADERS : 0)
+    | (highPrecision ? InputRecord::FLAG_HIGH_PRECISION : 0)
+    | (mesh.empty() ? 0 : InputRecord::FLAG_MESH);
+    header.start[0] = start.x;
+    header.start[1] = start.y;
+    header.start[2] = start.z;
+    header.views = (uint8_t) views;
+    header.viewSpacing = viewSpacing;
+    return header;
+}
+
+void Options::usage()
+{
+    cout << "\n\n\tUsage:  sidefogcube [options]\n"
+    << "\n\t--headless          render offscreen and print frame timings"
+    << "\n\t--frames N          frames measured in headless mode (600)"
+    << "\n\t--warmup N          frames run before measuring (30)"
+    << "\n\t--seed N            seed for the cloud of cubes (clock)"
+    << "\n\t--count N           number of cubes (" << NUM_IMAGES * NUM_INSTANCES << ")"
+    << "\n\t--threads N         threads generating the cubes (one per processor)"
+    << "\n\t--width N           offscreen width (1280)"
+    << "\n\t--height N          offscreen height (1024)"
+    << "\n\t--path NAME         camera path:  static, orbit or flythrough"
+    << "\n\t--tick-rate HZ      simulation ticks per second (120)"
+    << "\n\t--load-scene FILE   read the cubes from a scene file"
+    << "\n\t--save-scene FILE   write the cubes to a scene file"
+    << "\n\t--mesh FILE         draw an OBJ or PLY mesh in place of each cube"
+    << "\n\t--lighting NAME     lights, one by one, or sh, spherical harmonics"
+    << "\n\t--shaders NAME      variants, a program per feature set, or dynamic"
+    << "\n\t--precision NAME    fragment shader precision, medium or high"
+    << "\n\t--skybox NAME       off, on, or reflect to show it in the cubes (on)"
+    << "\n\t--prepass NAME      on to lay down the depth before shading (off)"
+    << "\n\t--transparency NAME opaque, or oit for see through cubes, unsorted (opaque)"
+    << "\n\t--drift NAME        on to let the cubes drift and bounce (off)"
+    << "\n\t--hud NAME          on to show the performance display, h toggles it (off)"
+    << "\n\t--streaming NAME    off to load every picture before the first frame (on)"
+    << "\n\t--cull NAME         off to draw the cubes out of view too, gpu to cull\n"
+    << "\t                    with a compute shader and draw indirect (on)"
+    << "\n\t--budget MS         frame time to hold to by lowering quality (off)"
+    << "\n\t--record FILE       record the input of the session"
+    << "\n\t--replay FILE       play a recorded session back, headless or not"
+    << "\n\t--capture PREFIX    save frames to PREFIX-NNNNNN.png or PREFIX.rgba"
+    << "\n\t--capture-format F  png files or a raw RGBA stream (png)"
+    << "\n\t--capture-frames N  the first N frames, or a range A-B (60)"
+    << "\n\t--views N           1, 2 side by side for stereo, or 4 in a square (1)"
+    << "\n\t--view-spacing D    how far apart the eyes of the views are (0.5)"
+    << "\n\t--log-level NAME    trace, debug, info, warn, error or off (info)"
+    << "\n\t--trace FILE        write where the startup and frames spend their\n"
+    << "\t                    time to FILE, for chrome://tracing or Perfetto"
+    << "\n\t--metrics-port N    serve Prometheus metrics on 127.0.0.1:N (off)"
+    << "\n\t--tiles N           draw the headless frame in N bands, each in a worker\n"
+    << "\t                    process of its own, and put them together (off)"
+    << "\n\t--assert-zero-alloc fail the headless run if a measured frame allocates"
+    << "\n\n";
+}
@@ -0,0 +1,134 @@
+/*******************************************************************
+ * Options:  A class to read the command line arguments.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include "commonheader.h"
+#include "inputrecord.h"
+#include "logger.h"
+
+/** \class Options
+ * Reads the command line into a set of public values.
+ * Anything not given on the command line keeps the
+ * default set in the constructor.
+ */
+class Options
+{
+public:
+    Options();
+    ~Options();
+
+    /** \brief parse
+     * Reads the arguments.  Returns false if an argument
+     * is not recognized or is missing its value.
+     */
+    bool parse(int argc, char **argv);
+
+    /** \brief usage
+     * Prints the recognized arguments.
+     */
+    void usage();
+
+    /** \brief useRecording
+     * Takes the seed, cube count, tick rate and features
+     * from a recorded session, so it plays back the same.
+     */
+    void useRecording(const InputRecord::Header &header);
+
+    /** \brief recordingHeader
+     * The settings of this session for the header of a
+     * recording, with the camera starting at start.
+     */
+    InputRecord::Header recordingHeader(vec3 start);
+
+    //! Render into an offscreen framebuffer without a window.
+    bool headless;
+    //! Number of frames measured and frames run first
+    //! to warm up the caches in headless mode.
+    int frames, warmup;
+    //! The seed for the cloud of cubes, and whether it was
+    //! given or should be taken from the clock.
+    unsigned int seed;
+    bool seedSet;
+    //! The number of cubes in the cloud and the threads
+    //! used to generate it, zero for one per processor.
+    int count, threads;
+    //! The size of the offscreen framebuffer.
+    int width, height;
+    //! The scripted camera path:  static, orbit or flythrough.
+    string cameraPath;
+    //! Simulation ticks per second.
+    double tickRate;
+    //! Scene files to read the cubes from in place of
+    //! generating them, and to write the cubes to.
+    string loadScene, saveScene;
+    //! An OBJ or PLY file to draw in place of each cube,
+    //! or empty for the cube.
+    string mesh;
+    //! Light with spherical harmonics in place of the
+    //! eight lights one by one.
+    bool shLighting;
+    //! One dynamic shader program that branches on the
+    //! features in place of one program per combination,
+    //! and high precision in the fragment shader.
+    bool dynamicShaders, highPrecision;
+    //! Draw the skybox behind the cubes, and reflect it
+    //! in them.
+    bool skybox, reflection;
+    //! Lay down the depth of the cubes before shading them.
+    bool depthPrepass;
+    //! Draw the cubes see through, with weighted blended
+    //! transparency in place of the sort.
+    bool oit;
+    //! Let the cubes drift and bounce off each other.
+    bool drift;
+    //! Show the performance display from the start.
+    bool hud;
+    //! Load the pictures in the background while the
+    //! first frames are drawn.
+    bool streaming;
+    //! Draw only the cubes in view and not lost in the fog,
+    //! and find them on the GPU in place of the CPU.
+    bool cull, gpuCull;
+    //! The least level of message printed.
+    Logger::Log_Level logLevel;
+    //! Fail if a measured frame allocates on the heap.
+    bool assertZeroAlloc;
+    //! The views drawn side by side in one pass, and how
+    //! far apart their eyes are.
+    int views;
+    float viewSpacing;
+    //! The frame time to hold to in milliseconds, by
+    //! lowering the resolution and quality, or zero for
+    //! full quality always.
+    double budget;
+    //! Files to record the input to, and to play it back
+    //! from in place of the keyboard and mouse.
+    string record, replay;
+    //! The prefix of the files to capture frames to, or
+    //! empty for none, whether to write a raw stream in
+    //! place of PNG files, and the frames to capture.
+    string capture;
+    bool captureRaw;
+    long captureFirst, captureCount;
+    //! The file to write a Chrome trace of the startup and
+    //! the frames to, or empty for none.
+    string trace;
+    //! The localhost port to serve the metrics on, or zero
+    //! for none.
+    int metricsPort;
+    //! The worker processes drawing a band of the frame
+    //! each in headless mode, or zero to draw it whole.
+    int tiles;
+    //! Set only in a worker:  its number and the file
+    //! descriptors of its commands, its results and the
+    //! shared frame, see TileRenderer.
+    int tileWorker, tileCommands, tileResults, tileFrame;
+    //! The arguments as given, for the workers.
+    vector<string> arguments;
+};
+
+#endif // OPTIONS_H
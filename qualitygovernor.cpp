@@ -0,0 +1,101 @@
+/*******************************************************************
+ * QualityGovernor:  A class to hold the frame time to a budget
+ * by drawing the frame at a lower resolution, and under load
+ * that lasts, with fewer lights, coarser textures and nearer
+ * fog.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "qualitygovernor.h"
+
+//! From the cheapest to full quality.  The texture detail
+//! goes first since it shows the least.
+const QualityGovernor::Level QualityGovernor::levels[NUM_LEVELS] =
+{
+    { 4, 2.0f, 0.6f },
+    { 4, 1.0f, 1.0f },
+    { 8, 1.0f, 1.0f },
+    { 8, 0.0f, 1.0f }
+};
+
+QualityGovernor::QualityGovernor(double budgetMs)
+{
+    budget = budgetMs;
+    average = 0.0;
+    scale = 1.0f;
+    level = NUM_LEVELS - 1;
+    settle = 0;
+    overFrames = 0;
+    underFrames = 0;
+    started = false;
+}
+
+QualityGovernor::~QualityGovernor()
+{
+}
+
+void QualityGovernor::frameDone(double ms)
+{
+    if (budget <= 0.0)
+    {
+        return;
+    }
+    if (!started)
+    {
+        average = ms;
+        started = true;
+    }
+    average += (ms - average) * 0.1;
+    double ratio = average / budget;
+    if (settle > 0)
+    {
+        settle--;
+    }
+    //! The cost goes with the pixels, the square of the scale.
+    else if ((ratio > 1.05) && (scale > MIN_SCALE))
+    {
+        scale = std::max(MIN_SCALE, scale * (float) std::max(sqrt(1.0 / ratio), 0.9));
+        settle = SETTLE_FRAMES;
+    }
+    else if ((ratio < 0.8) && (scale < 1.0f))
+    {
+        scale = std::min(1.0f, scale * 1.05f);
+        settle = SETTLE_FRAMES;
+    }
+    //! The quality only moves when the scale cannot.
+    overFrames = ((ratio > 1.05) && (scale <= MIN_SCALE)) ? overFrames + 1 : 0;
+    underFrames = ((ratio < 0.7) && (scale >= 1.0f)) ? underFrames + 1 : 0;
+    if ((overFrames >= DROP_FRAMES) && (level > 0))
+    {
+        level--;
+        overFrames = 0;
+    }
+    if ((underFrames >= RAISE_FRAMES) && (level < NUM_LEVELS - 1))
+    {
+        level++;
+        underFrames = 0;
+    }
+}
+
+void QualityGovernor::apply(FrameParams &params)
+{
+    params.renderScale = scale;
+    params.lightCount = levels[level].lights;
+    params.textureLod = levels[level].textureLod;
+    params.fogScale = levels[level].fogScale;
+}
+
+float QualityGovernor::getScale()
+{
+    return scale;
+}
+
+int QualityGovernor::getLevel()
+{
+    return level;
+}
+
+double QualityGovernor::getAverage()
+{
+    return average;
+}
@@ -0,0 +1,85 @@
+/*******************************************************************
+ * QualityGovernor:  A class to hold the frame time to a budget
+ * by drawing the frame at a lower resolution, and under load
+ * that lasts, with fewer lights, coarser textures and nearer
+ * fog.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef QUALITYGOVERNOR_H
+#define QUALITYGOVERNOR_H
+
+#include "commonheader.h"
+
+/** \class QualityGovernor
+ * Keeps a running average of the frame time.  Over budget
+ * the resolution scale comes down first, since it answers
+ * within a few frames.  If the scale is at its floor and
+ * the frames are still over budget for a second or so, the
+ * quality drops one level:  first the texture detail, then
+ * the light count, then the fog distance.  With time to
+ * spare the scale goes back up first and the quality last.
+ * The scale only moves every few frames, so the average
+ * has time to show what the last move did.  A budget of
+ * zero leaves everything at full quality.
+ */
+class QualityGovernor
+{
+public:
+    QualityGovernor(double budgetMs = 0.0);
+    ~QualityGovernor();
+
+    /** \brief frameDone
+     * Adds the time the last frame took in milliseconds.
+     */
+    void frameDone(double ms);
+
+    /** \brief apply
+     * Sets the resolution and the quality in a frame.
+     */
+    void apply(FrameParams &params);
+
+    /** \brief getScale
+     * The resolution scale, from MIN_SCALE to 1.
+     */
+    float getScale();
+
+    /** \brief getLevel
+     * The quality level, from 0 to NUM_LEVELS - 1, the
+     * highest being full quality.
+     */
+    int getLevel();
+
+    /** \brief getAverage
+     * The running average frame time.
+     */
+    double getAverage();
+
+    //! The number of quality levels.
+    static const int NUM_LEVELS = 4;
+    //! The lowest resolution scale.
+    constexpr static float MIN_SCALE = 0.5f;
+
+protected:
+    //! What each quality level draws with.
+    struct Level {
+        int lights;
+        float textureLod;
+        float fogScale;
+    };
+    static const Level levels[NUM_LEVELS];
+    //! Frames between moves of the scale, frames over budget
+    //! at the lowest scale before the quality drops, and
+    //! frames with time to spare at full scale before it
+    //! comes back.
+    static const int SETTLE_FRAMES = 10;
+    static const int DROP_FRAMES = 60;
+    static const int RAISE_FRAMES = 180;
+    double budget, average;
+    float scale;
+    int level;
+    int settle, overFrames, underFrames;
+    bool started;
+};
+
+#endif // QUALITYGOVERNOR_H
@@ -0,0 +1,47 @@
+/*******************************************************************
+ * RandomStream:  A fast, seedable, counter based random number
+ * generator.  Every value is a hash of the seed, a stream number
+ * and a counter, so streams are independent of each other and
+ * of the order or thread they are drawn on.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "randomstream.h"
+
+RandomStream::RandomStream(uint64_t seed, uint64_t stream)
+{
+    this->seed = seed;
+    this->stream = stream;
+    counter = 0;
+}
+
+RandomStream::~RandomStream()
+{
+}
+
+void RandomStream::fillUniform(float *out, size_t n, uint64_t seed,
+    uint64_t firstStream, uint64_t counter, float low, float high)
+{
+    //! No element depends on another, so this loop vectorizes.
+    const float range = high - low;
+    for (size_t k = 0; k < n; k++)
+    {
+        out[k] = low + range * toUnit(mix(seed, firstStream + k, counter));
+    }
+}
+
+uint64_t RandomStream::next()
+{
+    return mix(seed, stream, counter++);
+}
+
+float RandomStream::uniform(float low, float high)
+{
+    return low + (high - low) * toUnit(next());
+}
+
+unsigned int RandomStream::below(unsigned int n)
+{
+    //! Multiply and shift rather than a biased modulus.
+    return (unsigned int) (((next() >> 32) * (uint64_t) n) >> 32);
+}
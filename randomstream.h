@@ -0,0 +1,82 @@
+/*******************************************************************
+ * RandomStream:  A fast, seedable, counter based random number
+ * generator.  Every value is a hash of the seed, a stream number
+ * and a counter, so streams are independent of each other and
+ * of the order or thread they are drawn on.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef RANDOMSTREAM_H
+#define RANDOMSTREAM_H
+
+#include "commonheader.h"
+
+/** \class RandomStream
+ * The generator is the SplitMix64 finalizer applied twice to
+ * (seed, stream, counter).  Used as an object it walks the
+ * counter of one stream.  Used through fillUniform it fills
+ * an array with one value from each of a run of streams at
+ * the same counter, a loop with no dependencies between
+ * elements that the compiler can vectorize.
+ */
+class RandomStream
+{
+public:
+    RandomStream(uint64_t seed = 1, uint64_t stream = 0);
+    ~RandomStream();
+
+    /** \brief mix
+     * The value of a stream at a counter.
+     */
+    static inline uint64_t mix(uint64_t seed, uint64_t stream, uint64_t counter)
+    {
+        uint64_t z = seed ^ (stream * 0x9E3779B97F4A7C15ULL);
+        z = finalize(z) + (counter + 1) * 0xD1B54A32D192ED03ULL;
+        return finalize(z);
+    }
+
+    /** \brief toUnit
+     * Turns the top 24 bits into a float from 0 up to 1.
+     */
+    static inline float toUnit(uint64_t bits)
+    {
+        return (float) (bits >> 40) * (1.0f / 16777216.0f);
+    }
+
+    /** \brief fillUniform
+     * Fills out[k] with the value of stream firstStream + k
+     * at the counter, scaled from low up to high.
+     */
+    static void fillUniform(float *out, size_t n, uint64_t seed,
+    uint64_t firstStream, uint64_t counter, float low, float high);
+
+    /** \brief next
+     * The next 64 bits of this stream.
+     */
+    uint64_t next();
+
+    /** \brief uniform
+     * The next value from low up to high.
+     */
+    float uniform(float low, float high);
+
+    /** \brief below
+     * The next whole number from 0 up to n.
+     */
+    unsigned int below(unsigned int n);
+
+protected:
+    /** \brief finalize
+     * The SplitMix64 output function.
+     */
+    static inline uint64_t finalize(uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    uint64_t seed, stream, counter;
+};
+
+#endif // RANDOMSTREAM_H
@@ -0,0 +1,1123 @@
+/*******************************************************************
+ * RenderCore:  A class to hold the OpenGL side of the cloud of
+ * cubes:  shaders, textures, buffers and the per frame drawing.
+ * It knows nothing about the window or the input so it can be
+ * driven by the ClanLib program or by the headless benchmark.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "rendercore.h"
+
+RenderCore::RenderCore(int count)
+{
+    LOG_DEBUG(STARTUP, "Creating RenderCore.");
+    cloud = new CubeCloud(count);
+    variants = NULL;
+    shader = NULL;
+    depthVariants = NULL;
+    depthShader = NULL;
+    skyBoxShader = NULL;
+    dynamicShaders = false;
+    gpuCulling = false;
+    gpuCull = NULL;
+    mesh = NULL;
+    meshBuffers[0] = meshBuffers[1] = 0;
+    streaming = false;
+    streamer = NULL;
+    loaderContext = NULL;
+    launch = chrono::steady_clock::now();
+    firstFrameSeconds = loadedSeconds = -1.0;
+    streamedBytes = 0;
+    highPrecision = false;
+    skyEnabled = false;
+    skyVAO = 0;
+    skyTexture = 0;
+    sceneFBO = 0;
+    sceneColor = 0;
+    sceneDepth = 0;
+    targetWidth = targetHeight = 0;
+    viewWidth = viewHeight = 0;
+    oit = false;
+    compositeShader = NULL;
+    sumFBO = 0;
+    sumColor = 0;
+    sumWeight = 0;
+    compositeVAO = 0;
+    sumWidth = sumHeight = 0;
+    textureLod = 0.0f;
+    hud = NULL;
+    drawCalls = 0;
+    uploadBytes = 0;
+    cpuMs = 0.0;
+    image = NULL;
+    configureViews(1);
+    /**  The cloud of cubes goes from -25 to 25 on
+     * all three axis.  There is a light at each corner.
+     * The first four are every other corner, so when the
+     * quality governor lights with only four they still
+     * come from all sides.
+     */
+    lighting[0].lightPos = vec3(25.0, 25.0, 25.0);
+    lighting[1].lightPos = vec3(-25.0, 25.0, -25.0);
+    lighting[2].lightPos = vec3(-25.0, -25.0, 25.0);
+    lighting[3].lightPos = vec3(25.0, -25.0, -25.0);
+    lighting[4].lightPos = vec3(-25.0, 25.0, 25.0);
+    lighting[5].lightPos = vec3(25.0, 25.0, -25.0);
+    lighting[6].lightPos = vec3(25.0, -25.0, 25.0);
+    lighting[7].lightPos = vec3(-25.0, -25.0, -25.0);
+    for (int x = 0; x < NUM_LIGHTS; x++)
+    {
+        lighting[x].lightColor = vec4(1.0f, 1.0f, 1.0f, 1.0f);
+    }
+    //! The lights as seen from the middle of the corners.
+    SphericalHarmonics harmonics;
+    for (int x = 0; x < NUM_LIGHTS; x++)
+    {
+        harmonics.addLight(lighting[x].lightPos, vec3(lighting[x].lightColor));
+    }
+    harmonics.irradiance(shCoeffs);
+    harmonics.dominant(domLightDir, domLightColor);
+}
+
+RenderCore::~RenderCore()
+{
+    LOG_DEBUG(STARTUP, "Destroying RenderCore.");
+    //! The loader may still be sending to the textures.
+    delete streamer;
+    delete hud;
+    delete image;
+    delete skyBoxShader;
+    delete compositeShader;
+    delete gpuCull;
+    delete mesh;
+    delete depthVariants;
+    delete variants;
+    delete cloud;
+}
+
+bool RenderCore::initGL()
+{
+    //! Set this to true so GLEW knows to use a modern approach to retrieving function pointers and extensions
+    glewExperimental = GL_TRUE;
+    chrono::steady_clock::time_point since = chrono::steady_clock::now();
+    GLenum err;
+    {
+        TRACE_SCOPE("glewInit");
+        err = glewInit();
+    }
+    phaseDone("glew", since);
+    /** GLEW built for GLX reports a missing GLX display when
+     * the context comes from EGL, but by then the OpenGL
+     * functions have already been loaded.
+     */
+    if ((GLEW_OK != err) && (GLEW_ERROR_NO_GLX_DISPLAY != err))
+    {
+        LOG_ERROR(STARTUP, "Failed to initialize GLEW.");
+        return false;
+    }
+    LOG_INFO(STARTUP, "Using GLEW Version: {}", glewGetString(GLEW_VERSION));
+    LOG_INFO(STARTUP, "OpenGL Renderer: {}", glGetString(GL_RENDERER));
+    glEnable(GL_DEPTH_TEST);
+    bool enabled = glIsEnabled(GL_DEPTH_TEST);
+    if (enabled)
+    {
+        LOG_DEBUG(STARTUP, "Depth Test Enabled");
+    }
+    else
+    {
+        LOG_WARN(STARTUP, "Depth Test Not Enabled");
+    }
+    glDepthFunc(GL_LESS);
+    //!glFrontFace(GL_CCW);
+    glEnable(GL_CULL_FACE);
+    enabled = glIsEnabled(GL_CULL_FACE);
+    if (enabled)
+    {
+        LOG_DEBUG(STARTUP, "Cull Face Enabled");
+    }
+    else
+    {
+        LOG_WARN(STARTUP, "Cull Face Not Enabled");
+    }
+    glCullFace(GL_BACK);
+    glDepthRange(0.1f, 1000.0f);
+    return true;
+}
+
+void RenderCore::configureShaders(bool dynamic, bool highPrecision)
+{
+    dynamicShaders = dynamic;
+    this->highPrecision = highPrecision;
+}
+
+void RenderCore::configureViews(int count)
+{
+    viewCount = glm::clamp(count, 1, MAX_VIEWS);
+    int columns, rows;
+    Camera::ViewGrid(viewCount, columns, rows);
+    for (int v = 0; v < viewCount; v++)
+    {
+        viewRects[v] = vec4(1.0f / columns, 1.0f / rows,
+        (2.0f * (v % columns) + 1.0f) / columns - 1.0f,
+        1.0f - (2.0f * (v / columns) + 1.0f) / rows);
+    }
+}
+
+void RenderCore::configureTransparency(bool oit)
+{
+    this->oit = oit;
+}
+
+void RenderCore::configureGpuCull(bool enable)
+{
+    gpuCulling = enable;
+}
+
+void RenderCore::configureMesh(string path)
+{
+    meshPath = path;
+}
+
+void RenderCore::configureStreaming(bool enable, chrono::steady_clock::time_point launch,
+HeadlessContext *loader)
+{
+    streaming = enable;
+    this->launch = launch;
+    loaderContext = loader;
+}
+
+void RenderCore::enableSkybox(bool enable)
+{
+    skyEnabled = enable;
+}
+
+bool RenderCore::createScene(unsigned int seed, int threads, string scenePath)
+{
+    TRACE_SCOPE("createScene");
+    chrono::steady_clock::time_point since = chrono::steady_clock::now();
+    if (gpuCulling && !GpuCull::supported())
+    {
+        LOG_WARN(RENDER, "The GPU cull needs OpenGL 4.5, or 4.3 with ES 3.1 shaders, "
+        "and storage buffers in the vertex shader.  Culling on the CPU.");
+        gpuCulling = false;
+    }
+    //! The GPU cull's programs tell the side from the
+    //! vertex, so the mesh comes before them.
+    if (!meshPath.empty())
+    {
+        mesh = new MeshImport();
+        if (!mesh->load(meshPath))
+        {
+            return false;
+        }
+        phaseDone("mesh", since);
+    }
+    //! Every program reads the cubes from binding point 0,
+    //! unless it reads them from the GPU cull.
+    auto prepare = [](Shader *program)
+    {
+        GLuint block = glGetUniformBlockIndex(program->Program, "itemData");
+        if (block != GL_INVALID_INDEX)
+        {
+            glUniformBlockBinding(program->Program, block, 0);
+        }
+    };
+    //! Define and compile the shaders, one program for each
+    //! combination of features, with the constants from here.
+    variants = new ShaderVariants(string("fogvec.glsl"),
+    string("fogfrag.glsl"), string("objshader"));
+    variants->setConstant("NUM_IMAGES", to_string(NUM_IMAGES));
+    variants->setConstant("NUM_INSTANCES", to_string(NUM_INSTANCES));
+    variants->setConstant("NUM_LIGHTS", to_string(NUM_LIGHTS));
+    variants->setConstant("FLOAT_PRECISION", highPrecision ? "highp" : "mediump");
+    variants->setConstant("VIEW_COUNT", to_string(viewCount));
+    variants->setConstant("OIT", oit ? "1" : "0");
+    variants->setDynamic(dynamicShaders);
+    variants->setPrepare(prepare);
+    //! The storage buffers the GPU cull writes need ES 3.1.
+    if (gpuCulling)
+    {
+        variants->setVersion("310 es");
+        variants->setConstant("GPU_CULL", "1");
+        if (mesh != NULL)
+        {
+            variants->setConstant("SIDE_STARTS", mesh->sideStarts());
+        }
+    }
+    //! The reflecting programs are no use without a sky.
+    unsigned int allowed = ShaderVariants::FEATURE_FOG | ShaderVariants::FEATURE_SH_LIGHTING;
+    if (skyEnabled)
+    {
+        allowed |= ShaderVariants::FEATURE_REFLECTION;
+    }
+    {
+        TRACE_SCOPE("buildAll");
+        variants->buildAll(allowed);
+    }
+    shader = variants->get(ShaderVariants::FEATURE_FOG);
+    //! The depth pass reads the same block with nothing
+    //! but the positions.
+    depthVariants = new ShaderVariants(string("depthvec.glsl"),
+    string("depthfrag.glsl"), string("depthshader"));
+    depthVariants->setConstant("NUM_IMAGES", to_string(NUM_IMAGES));
+    depthVariants->setConstant("NUM_INSTANCES", to_string(NUM_INSTANCES));
+    depthVariants->setConstant("VIEW_COUNT", to_string(viewCount));
+    depthVariants->setPrepare(prepare);
+    if (gpuCulling)
+    {
+        depthVariants->setVersion("310 es");
+        depthVariants->setConstant("GPU_CULL", "1");
+    }
+    depthShader = depthVariants->get(0);
+    /** A packed block may be laid out differently in a
+     * program that uses less of it, and then the depth
+     * pass would read the wrong matrices.
+     */
+    if (modelOffset(depthShader) != modelOffset(shader))
+    {
+        LOG_WARN(SHADER, "The depth pass program lays out the cubes "
+        "differently, the depth pass is disabled.");
+        depthShader = NULL;
+    }
+    phaseDone("shaders", since);
+    //! Set the background image.
+    image = new CreateImage();
+    if (streaming && !TextureStreamer::supported())
+    {
+        LOG_WARN(RENDER, "Loading the pictures in the background needs immutable "
+        "textures and fences.  Loading them first.");
+        streaming = false;
+    }
+    if (streaming)
+    {
+        if (!streamTextures())
+        {
+            return false;
+        }
+    }
+    else
+    {
+        image->setImage("container.png");
+        texture1 = image->textureObject();
+        //! Set the foreground images.
+        image->create2DTexArray(texImages, imageNames);
+    }
+    phaseDone("textures", since);
+    //! Define the locations and image indices.
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    if (!scenePath.empty())
+    {
+        if (!cloud->loadScene(scenePath))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        cloud->seed(seed);
+        cloud->setThreads(threads);
+        cloud->permLoc();
+    }
+    LOG_INFO(SCENE, "Scene of {} cubes {} in {} ms.", cloud->getCount(),
+    scenePath.empty() ? "generated" : "loaded",
+    chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count());
+    phaseDone("scene", since);
+    if (gpuCulling)
+    {
+        gpuCull = new GpuCull();
+        gpuCull->create(cloud, viewCount, (mesh != NULL) ? (int) mesh->indices.size() : 0);
+    }
+    //! Generate the object.
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(4, VBO);
+    //! 1. Bind the Vertex Array Object.
+    glBindVertexArray(VAO);
+    //! 2. copy our vertices arrays into the buffers for OpenGL to use.
+    //! Position attribute
+    glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(cloud->calcCube), cloud->calcCube, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    //! Normal attribute.
+    glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(cloud->calcNorm), cloud->calcNorm, GL_STATIC_DRAW);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(1);
+    //! Texture attribute.
+    glBindBuffer(GL_ARRAY_BUFFER, VBO[2]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(cloud->calcTex), cloud->calcTex, GL_STATIC_DRAW);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(2);
+    //! The mesh takes the cube's place in the cube programs,
+    //! and the sky keeps the cube's positions.
+    if (mesh != NULL)
+    {
+        glGenBuffers(2, meshBuffers);
+        glBindBuffer(GL_ARRAY_BUFFER, meshBuffers[0]);
+        glBufferData(GL_ARRAY_BUFFER, mesh->vertices.size() * sizeof(MeshImport::Vertex),
+        mesh->vertices.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(MeshImport::Vertex),
+        (void*) offsetof(MeshImport::Vertex, position));
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(MeshImport::Vertex),
+        (void*) offsetof(MeshImport::Vertex, normal));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(MeshImport::Vertex),
+        (void*) offsetof(MeshImport::Vertex, texCoord));
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshBuffers[1]);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh->indices.size() * sizeof(uint32_t),
+        mesh->indices.data(), GL_STATIC_DRAW);
+    }
+    //! Uniform buffer to feed the uniform.
+    dataIndex = glGetUniformBlockIndex(shader->Program, "itemData");
+    glBindBuffer(GL_UNIFORM_BUFFER, VBO[3]);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(InstData), (void*)&cloud->itemData[0], GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindVertexArray(0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0, dataIndex);
+    glBindBufferRange(GL_UNIFORM_BUFFER, 0, VBO[3], 0, sizeof(InstData));
+    phaseDone("buffers", since);
+    if (skyEnabled)
+    {
+        skyBoxShader = new Shader();
+        skyBoxShader->initShader("skyboxvec.glsl", "skyboxfrag.glsl", "skyboxshader.bin");
+        phaseDone("shaders", since);
+        if (!streaming)
+        {
+            image->createSkyBoxTex(skyTexture, skyNames);
+            phaseDone("textures", since);
+        }
+        //! The sky is one more cube, seen from inside, so
+        //! it shares the positions of the cubes.
+        glGenVertexArrays(1, &skyVAO);
+        glBindVertexArray(skyVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glBindVertexArray(0);
+    }
+    if (oit)
+    {
+        compositeShader = new Shader();
+        compositeShader->initShader("oitvec.glsl", "oitfrag.glsl", "oitshader.bin");
+        //! The triangle is made from the vertex number, but
+        //! a vertex array must still be bound.
+        glGenVertexArrays(1, &compositeVAO);
+    }
+    //! The display is cheap to make, and may be wanted at
+    //! any time.
+    hud = new Hud();
+    hud->create();
+    phaseDone("shaders", since);
+    if (!streaming)
+    {
+        loadedSeconds = chrono::duration<double>(chrono::steady_clock::now() - launch).count();
+    }
+    return true;
+}
+
+bool RenderCore::streamTextures()
+{
+    //! The pictures are the size of the crate, and the sky
+    //! faces all the size of the first.
+    GLsizei crateWidth, crateHeight, width, height, skyWidth = 0, skyHeight = 0;
+    if ((!image->imageSize("container.png", crateWidth, crateHeight))
+    || (!image->imageSize(imageNames[0], width, height))
+    || (skyEnabled && !image->imageSize(skyNames[0], skyWidth, skyHeight)))
+    {
+        return false;
+    }
+    //! A gray crate, no pictures, and a sky the color of
+    //! the fog until they come.
+    const unsigned char crate[4] = { 128, 128, 128, 255 };
+    const unsigned char picture[4] = { 0, 0, 0, 0 };
+    const unsigned char sky[4] = { 77, 77, 77, 255 };
+    streamer = new TextureStreamer();
+    texture1 = TextureStreamer::createTexture(GL_TEXTURE_2D, crateWidth, crateHeight, 1, crate);
+    streamer->add("container.png", texture1, GL_TEXTURE_2D, 0, crateWidth, crateHeight);
+    streamedBytes += (size_t) crateWidth * crateHeight * 4 * 4 / 3;
+    texImages = TextureStreamer::createTexture(GL_TEXTURE_2D_ARRAY, width, height, NUM_IMAGES, picture);
+    for (int x = 0; x < NUM_IMAGES; x++)
+    {
+        streamer->add(imageNames[x], texImages, GL_TEXTURE_2D_ARRAY, x, width, height);
+    }
+    streamedBytes += (size_t) width * height * 4 * NUM_IMAGES * 4 / 3;
+    if (skyEnabled)
+    {
+        skyTexture = TextureStreamer::createTexture(GL_TEXTURE_CUBE_MAP, skyWidth, skyHeight, 6, sky);
+        //! The faces in the order createSkyBoxTex gives them.
+        for (int x = 0; x < 6; x++)
+        {
+            streamer->add(skyNames[5 - x], skyTexture, GL_TEXTURE_CUBE_MAP, x, skyWidth, skyHeight);
+        }
+        streamedBytes += (size_t) skyWidth * skyHeight * 4 * 6 * 4 / 3;
+    }
+    //! The pictures load while the cloud and the buffers
+    //! are made.
+    streamer->start(loaderContext);
+    return true;
+}
+
+void RenderCore::renderFrame(const FrameParams &params)
+{
+    /** Below full scale the frame is drawn into the corner
+     * of an offscreen target and stretched over the window
+     * at the end.  The target is the size of the window so
+     * a new scale needs no new buffers.
+     */
+    AllocScope scope(AllocTracker::SUBSYSTEM_RENDER);
+    TRACE_SCOPE("renderFrame");
+    chrono::steady_clock::time_point frameBegin = chrono::steady_clock::now();
+    drawCalls = 0;
+    uploadBytes = 0;
+    //! Any picture now in place shows from this frame on.
+    if ((streamer != NULL) && (loadedSeconds < 0.0))
+    {
+        streamer->update();
+        uploadBytes += streamer->getUploadBytes();
+        if (streamer->done())
+        {
+            loadedSeconds = chrono::duration<double>(chrono::steady_clock::now() - launch).count();
+            LOG_INFO(RENDER, "Every picture in place {} s after launch.", loadedSeconds);
+        }
+    }
+    if (params.hud)
+    {
+        hud->beginGpu();
+    }
+    arena.reset();
+    GLint window = 0;
+    bool scaled = (params.renderScale < 1.0f) && (viewWidth > 0);
+    int width = std::max(1, (int) (viewWidth * params.renderScale));
+    int height = std::max(1, (int) (viewHeight * params.renderScale));
+    if (scaled)
+    {
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &window);
+        bindTarget();
+        glViewport(0, 0, width, height);
+    }
+    //! Coarser textures cost less to sample.
+    if (params.textureLod != textureLod)
+    {
+        textureLod = params.textureLod;
+        glBindTexture(GL_TEXTURE_2D, texture1);
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, textureLod);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texImages);
+        glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_LOD, textureLod);
+    }
+    //! Use the shaders.
+    vec4 color = vec4(0.3f, 0.3f, 0.3f, 0.5f);
+    vec4 fogColor = vec4(0.3f, 0.3f, 0.3f, 1.0f);
+    bool sky = skyEnabled && params.skybox;
+    bool reflection = sky && params.reflection;
+    //! The sky covers every pixel the cubes leave, so there
+    //! is no color to clear.
+    if (sky)
+    {
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+    else
+    {
+        glClearColor(color.r, color.g, color.b, color.a);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+    //! Seen through the cubes, the sky goes down first.
+    if (sky && oit)
+    {
+        drawSkybox(params, fogColor, width, height);
+    }
+    //! Switch to the program for the fog and lighting
+    //! rather than branching in every fragment.
+    unsigned int features = (params.foggy ? ShaderVariants::FEATURE_FOG : 0)
+    | (params.shLighting ? ShaderVariants::FEATURE_SH_LIGHTING : 0)
+    | (reflection ? ShaderVariants::FEATURE_REFLECTION : 0);
+    shader = variants->get(features);
+    shader->Use();
+    //! We have a fog toggle on the space key.  Only the
+    //! dynamic program reads these three.
+    shader->setBool("foggy", params.foggy);
+    shader->setBool("reflection", reflection);
+    //! Start feeding in the buffer data.
+    glBindVertexArray(VAO);
+    //! Initialize the lighting system, the lights one by
+    //! one or all together as spherical harmonics.
+    shader->setBool("shLighting", params.shLighting);
+    shader->setInt("lightCount", glm::clamp(params.lightCount, 1, (int) NUM_LIGHTS));
+    if (params.shLighting)
+    {
+        for (unsigned int i = 0; i < 9; i++)
+        {
+            shader->setVec3(arena.print("shCoeffs[%u]", i), shCoeffs[i]);
+        }
+        shader->setVec3("domLightDir", domLightDir);
+        shader->setVec3("domLightColor", domLightColor);
+    }
+    else
+    {
+        for(unsigned int i = 0; i < NUM_LIGHTS; i++)
+        {
+            shader->setVec3(arena.print("lighting[%u].lightPos", i), lighting[i].lightPos);
+            shader->setVec4(arena.print("lighting[%u].lightColor", i), lighting[i].lightColor);
+        }
+    }
+    if (params.drift)
+    {
+        AllocScope scope(AllocTracker::SUBSYSTEM_DRIFT);
+        TRACE_SCOPE("drift");
+        cloud->advanceDrift(params.seconds);
+        if (gpuCull != NULL)
+        {
+            uploadBytes += gpuCull->uploadPositions(cloud);
+        }
+    }
+    //! The quality governor may pull the fog in, so more
+    //! cubes are lost in it and cost nothing to light.
+    float fogMaxDist = std::max(params.maxfog * params.fogScale, params.minfog + 1.0f);
+    float fogDistance = cullDistance(params);
+    if (gpuCull != NULL)
+    {
+        //! The GPU culls, turns and packs the cubes, in no
+        //! order, so there is nothing left to sort.
+        AllocScope scope(AllocTracker::SUBSYSTEM_CULL);
+        TRACE_SCOPE("cull");
+        gpuCull->cull(params, fogDistance, params.cull);
+    }
+    else if (params.cull)
+    {
+        AllocScope scope(AllocTracker::SUBSYSTEM_CULL);
+        TRACE_SCOPE("cull");
+        if (viewCount > 1)
+        {
+            mat4 viewProjections[MAX_VIEWS];
+            for (int v = 0; v < viewCount; v++)
+            {
+                viewProjections[v] = params.projections[v] * params.views[v];
+            }
+            cloud->cull(viewProjections, params.viewPositions, viewCount, fogDistance);
+        }
+        else
+        {
+            cloud->cull(params.projection * params.view, params.viewPos, fogDistance);
+        }
+    }
+    //! Sort the locations based on the current camera
+    //! position.  The weighted sums come out the same in
+    //! any order, so they are only packed.
+    if (gpuCull == NULL)
+    {
+        AllocScope scope(AllocTracker::SUBSYSTEM_SORT);
+        TRACE_SCOPE("sort");
+        cloud->sortDists(params.viewPos, params.degrees, !oit);
+    }
+    //! Lay down the depth of every cube first, with no
+    //! color, so each pixel is shaded once below.  A see
+    //! through cube hides nothing, so there is no use for
+    //! it then.
+    bool prepass = params.depthPrepass && (depthShader != NULL) && !oit;
+    if (prepass)
+    {
+        TRACE_SCOPE("prepass");
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        depthShader->Use();
+        setCamera(depthShader, params);
+        drawCubes(depthShader, 1, true);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        //! Only the nearest cube at each pixel passes.
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+        shader->Use();
+    }
+    //! Set the crate background.
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture1);
+    shader->setInt("cratetex", 0);
+    //! Set the foreground images.
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texImages);
+    shader->setInt("tex", 1);
+    //! The sky for the reflections.  The sampler has a unit
+    //! of its own even when nothing is bound to it, since
+    //! two sampler types may not share a unit.
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, skyTexture);
+    shader->setInt("skybox", 2);
+    shader->setFloat("reflectivity", REFLECTIVITY);
+    //! Pass in the necessary uniforms.
+    setCamera(shader, params);
+    shader->setVec4("fogColor", fogColor);
+    //! Fog is variable based on the right arrow
+    //! and left arrow keys.
+    shader->setFloat("fogMinDist", params.minfog);
+    shader->setFloat("fogMaxDist", fogMaxDist);
+    if (oit)
+    {
+        TRACE_SCOPE("cubes");
+        drawTranslucent();
+    }
+    else
+    {
+        TRACE_SCOPE("cubes");
+        //! With a single block the depth pass left it in the
+        //! buffer already.
+        drawCubes(shader, 6, !prepass || (cloud->getDrawnChunks() > 1));
+    }
+    if (prepass)
+    {
+        glDepthMask(GL_TRUE);
+        glDepthFunc(GL_LESS);
+    }
+    //! Uncomment this to get a listing of the
+    //! uniforms recognized by the shaders.
+    //!UniformPrinter printer2(shader->Program);
+    glBindVertexArray(0);
+    if (sky && !oit)
+    {
+        drawSkybox(params, fogColor, width, height);
+    }
+    if (scaled)
+    {
+        TRACE_SCOPE("blit");
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, window);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, viewWidth, viewHeight,
+        GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        glBindFramebuffer(GL_FRAMEBUFFER, window);
+        glViewport(0, 0, viewWidth, viewHeight);
+    }
+    cpuMs = chrono::duration<double, milli>(chrono::steady_clock::now() - frameBegin).count();
+    if (firstFrameSeconds < 0.0)
+    {
+        firstFrameSeconds = chrono::duration<double>(chrono::steady_clock::now() - launch).count();
+        if (streamer != NULL)
+        {
+            LOG_INFO(RENDER, "First frame {} s after launch, {} pictures in place.",
+            firstFrameSeconds, streamer->getReady());
+        }
+        else
+        {
+            LOG_INFO(RENDER, "First frame {} s after launch.", firstFrameSeconds);
+        }
+    }
+    //! The display goes over the whole window, at full
+    //! scale, and is not counted in the frame.
+    if (params.hud)
+    {
+        TRACE_SCOPE("hud");
+        hud->endGpu();
+        Hud::Stats stats;
+        stats.cpuMs = cpuMs;
+        stats.total = cloud->getCount();
+        stats.drawn = hud->countsDue() ? getDrawn() : -1;
+        stats.drawCalls = drawCalls;
+        stats.uploadBytes = uploadBytes;
+        hud->frameDone(stats);
+        hud->draw(std::max(1, viewWidth), std::max(1, viewHeight));
+    }
+}
+
+void RenderCore::bindTarget()
+{
+    if ((sceneFBO == 0) || (targetWidth != viewWidth) || (targetHeight != viewHeight))
+    {
+        if (sceneFBO != 0)
+        {
+            glDeleteFramebuffers(1, &sceneFBO);
+            glDeleteRenderbuffers(1, &sceneColor);
+            glDeleteRenderbuffers(1, &sceneDepth);
+        }
+        targetWidth = viewWidth;
+        targetHeight = viewHeight;
+        glGenFramebuffers(1, &sceneFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, sceneFBO);
+        glGenRenderbuffers(1, &sceneColor);
+        glBindRenderbuffer(GL_RENDERBUFFER, sceneColor);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, targetWidth, targetHeight);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, sceneColor);
+        glGenRenderbuffers(1, &sceneDepth);
+        glBindRenderbuffer(GL_RENDERBUFFER, sceneDepth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, targetWidth, targetHeight);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, sceneDepth);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            LOG_ERROR(RENDER, "The scaled framebuffer is not complete.");
+        }
+        return;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFBO);
+}
+
+void RenderCore::drawTranslucent()
+{
+    GLint target = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+    bindSums();
+    const GLenum buffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, buffers);
+    //! No color, and all of the background left.
+    const GLfloat clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    const GLfloat clearWeight[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    glClearBufferfv(GL_COLOR, 0, clearColor);
+    glClearBufferfv(GL_COLOR, 1, clearWeight);
+    /** Every face counts, the back ones too, in any order,
+     * so there is no culling and no depth.  The colors and
+     * weights add up, and each face multiplies what is left
+     * of the background, in the alpha, by one less its
+     * alpha.  One blend function does both, so no blending
+     * per target is needed.
+     */
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_BLEND);
+    glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+    shader->setFloat("opacity", OPACITY);
+    drawCubes(shader, 6, true);
+    //! The average color over the background, by what
+    //! is left of it.
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+    glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+    compositeShader->Use();
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, sumColor);
+    compositeShader->setInt("accum", 3);
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_2D, sumWeight);
+    compositeShader->setInt("weights", 4);
+    glBindVertexArray(compositeVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    drawCalls++;
+    glDisable(GL_BLEND);
+    glEnable(GL_CULL_FACE);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void RenderCore::bindSums()
+{
+    //! The frame may be drawn scaled into the corner, so
+    //! the sums are the size of the window like the target.
+    int width = std::max(1, viewWidth), height = std::max(1, viewHeight);
+    if ((sumFBO != 0) && (sumWidth == width) && (sumHeight == height))
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, sumFBO);
+        return;
+    }
+    if (sumFBO != 0)
+    {
+        glDeleteFramebuffers(1, &sumFBO);
+        glDeleteTextures(1, &sumColor);
+        glDeleteTextures(1, &sumWeight);
+    }
+    sumWidth = width;
+    sumHeight = height;
+    glGenFramebuffers(1, &sumFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, sumFBO);
+    //! The sums go well past one, so they are floats.
+    unsigned int *textures[2] = { &sumColor, &sumWeight };
+    GLenum formats[2] = { GL_RGBA16F, GL_R16F };
+    GLenum layouts[2] = { GL_RGBA, GL_RED };
+    for (int x = 0; x < 2; x++)
+    {
+        glGenTextures(1, textures[x]);
+        glBindTexture(GL_TEXTURE_2D, *textures[x]);
+        glTexImage2D(GL_TEXTURE_2D, 0, formats[x], sumWidth, sumHeight, 0, layouts[x],
+        GL_HALF_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + x, GL_TEXTURE_2D,
+        *textures[x], 0);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        LOG_ERROR(RENDER, "The transparency framebuffer is not complete.");
+    }
+}
+
+void RenderCore::setCamera(Shader *program, const FrameParams &params)
+{
+    if (viewCount > 1)
+    {
+        program->setMat4Array("views", params.views, viewCount);
+        program->setMat4Array("projections", params.projections, viewCount);
+        program->setVec3Array("viewPositions", params.viewPositions, viewCount);
+        program->setVec4Array("viewRects", viewRects, viewCount);
+        return;
+    }
+    program->setMat4("projection", params.projection);
+    program->setMat4("view", params.view);
+    program->setVec3("viewPos", params.viewPos);
+}
+
+void RenderCore::drawCubes(Shader *program, int sides, bool upload)
+{
+    if (gpuCull != NULL)
+    {
+        gpuCull->draw();
+        drawCalls++;
+        return;
+    }
+    //! The cubes go to the shaders one uniform block at a time,
+    //! furthest block first.
+    int remaining = cloud->getDrawn();
+    int vertices = 36 / sides;
+    for (int chunk = 0; chunk < cloud->getDrawnChunks(); chunk++)
+    {
+        if (upload)
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, VBO[3]);
+            //! Pass the image indices and cube distances.
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(InstData), (void*) &cloud->itemData[chunk]);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            uploadBytes += sizeof(InstData);
+        }
+        //! Use the instancing feature to create
+        //! multiple copies of each set of images.
+        for (int x = 0; x < NUM_IMAGES; x++)
+        {
+            //! The last block may only be partly filled.
+            int instances = std::min(remaining - (x * NUM_INSTANCES), NUM_INSTANCES);
+            if (instances <= 0)
+            {
+                break;
+            }
+            program->setInt("repetition", x);
+            int beginvert = 0;
+            //! Call for each image one side at a time, when
+            //! the sides have images of their own.
+            for (int side = 0; side < sides; side++)
+            {
+                if (sides > 1)
+                {
+                    program->setInt("side", side);
+                }
+                //! Each cube once for every view.
+                if (mesh != NULL)
+                {
+                    uint32_t first = mesh->sideFirst[(sides > 1) ? side : 0];
+                    uint32_t end = mesh->sideFirst[(sides > 1) ? side + 1 : MeshImport::SIDES];
+                    if (end > first)
+                    {
+                        glDrawElementsInstanced(GL_TRIANGLES, end - first, GL_UNSIGNED_INT,
+                        (void*) (first * sizeof(uint32_t)), instances * viewCount);
+                        drawCalls++;
+                    }
+                    continue;
+                }
+                glDrawArraysInstanced(GL_TRIANGLES, beginvert, vertices, instances * viewCount);
+                drawCalls++;
+                beginvert += vertices;
+            }
+        }
+        remaining -= NUM_IMAGES * NUM_INSTANCES;
+    }
+}
+
+int RenderCore::modelOffset(Shader *program)
+{
+    const GLchar *name = "instModel[0]";
+    GLuint index = GL_INVALID_INDEX;
+    glGetUniformIndices(program->Program, 1, &name, &index);
+    if (index == GL_INVALID_INDEX)
+    {
+        return -1;
+    }
+    GLint offset = -1;
+    glGetActiveUniformsiv(program->Program, 1, &index, GL_UNIFORM_OFFSET, &offset);
+    return offset;
+}
+
+void RenderCore::drawSkybox(const FrameParams &params, vec4 fogColor, int width, int height)
+{
+    TRACE_SCOPE("sky");
+    /** The sky sits at a depth of 1.0, which the cleared
+     * depth buffer passes with less or equal and every
+     * cube fails, so the covered pixels are thrown out
+     * before they are shaded.  It writes no depth and is
+     * seen from inside, so culling is off.
+     */
+    glDepthFunc(GL_LEQUAL);
+    glDepthMask(GL_FALSE);
+    glDisable(GL_CULL_FACE);
+    skyBoxShader->Use();
+    skyBoxShader->setBool("foggy", params.foggy);
+    skyBoxShader->setVec4("fogColor", fogColor);
+    skyBoxShader->setFloat("skyFog", SKY_FOG);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, skyTexture);
+    skyBoxShader->setInt("skybox", 2);
+    glBindVertexArray(skyVAO);
+    if (viewCount > 1)
+    {
+        //! Thirty six vertices a view cost less than the
+        //! clipping in the cube programs would.
+        int columns, rows;
+        Camera::ViewGrid(viewCount, columns, rows);
+        for (int v = 0; v < viewCount; v++)
+        {
+            int left = (v % columns) * width / columns;
+            int bottom = (rows - 1 - v / columns) * height / rows;
+            glViewport(left, bottom, (v % columns + 1) * width / columns - left,
+            (rows - v / columns) * height / rows - bottom);
+            skyBoxShader->setMat4("projection", params.projections[v]);
+            //! Only the turn of the camera moves the sky.
+            skyBoxShader->setMat4("view", mat4(mat3(params.views[v])));
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+            drawCalls++;
+        }
+        glViewport(0, 0, width, height);
+    }
+    else
+    {
+        skyBoxShader->setMat4("projection", params.projection);
+        //! Only the turn of the camera moves the sky.
+        skyBoxShader->setMat4("view", mat4(mat3(params.view)));
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+        drawCalls++;
+    }
+    glBindVertexArray(0);
+    glEnable(GL_CULL_FACE);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+}
+
+int RenderCore::getDrawn()
+{
+    return (gpuCull != NULL) ? gpuCull->readDrawn() : cloud->getDrawn();
+}
+
+int RenderCore::getDrawCalls()
+{
+    return drawCalls;
+}
+
+size_t RenderCore::getUploadBytes()
+{
+    return uploadBytes;
+}
+
+double RenderCore::getCpuMs()
+{
+    return cpuMs;
+}
+
+size_t RenderCore::getTextureBytes()
+{
+    size_t bytes = ((image != NULL) ? image->getTextureBytes() : 0) + streamedBytes;
+    //! RGBA8 and a 24 bit depth, padded to 32.
+    if (sceneFBO != 0)
+    {
+        bytes += (size_t) targetWidth * targetHeight * 8;
+    }
+    //! RGBA16F and R16F.
+    if (sumFBO != 0)
+    {
+        bytes += (size_t) sumWidth * sumHeight * 10;
+    }
+    return bytes;
+}
+
+const vector<StartupPhase> &RenderCore::getPhases()
+{
+    return phases;
+}
+
+double RenderCore::getFirstFrameSeconds()
+{
+    return firstFrameSeconds;
+}
+
+double RenderCore::getLoadedSeconds()
+{
+    return loadedSeconds;
+}
+
+void RenderCore::finishLoading()
+{
+    if ((streamer == NULL) || (loadedSeconds >= 0.0))
+    {
+        return;
+    }
+    streamer->finish();
+    loadedSeconds = chrono::duration<double>(chrono::steady_clock::now() - launch).count();
+    LOG_INFO(RENDER, "Every picture in place {} s after launch.", loadedSeconds);
+}
+
+MeshImport *RenderCore::getMesh()
+{
+    return mesh;
+}
+
+void RenderCore::phaseDone(const char *name, chrono::steady_clock::time_point &since)
+{
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    double seconds = chrono::duration<double>(now - since).count();
+    since = now;
+    for (unsigned int x = 0; x < phases.size(); x++)
+    {
+        if (strcmp(phases[x].name, name) == 0)
+        {
+            phases[x].seconds += seconds;
+            return;
+        }
+    }
+    StartupPhase phase = { name, seconds };
+    phases.push_back(phase);
+}
+
+float RenderCore::cullDistance(const FrameParams &params)
+{
+    float fogMaxDist = std::max(params.maxfog * params.fogScale, params.minfog + 1.0f);
+    /** A cube past the fog is drawn in the fog color,
+     * which is the clear color but not the sky, so it
+     * is only left out when there is no sky.
+     */
+    return (params.foggy && !(skyEnabled && params.skybox)) ? fogMaxDist : FLT_MAX;
+}
+
+int RenderCore::cullUnion(const FrameParams &params)
+{
+    float fogDistance = cullDistance(params);
+    vector<uint8_t> seen(cloud->getCount(), 0);
+    for (int v = 0; v < params.viewCount; v++)
+    {
+        cloud->cull(params.projections[v] * params.views[v], params.viewPositions[v], fogDistance);
+        const vector<uint8_t> &marks = cloud->getVisible();
+        for (unsigned int x = 0; x < seen.size(); x++)
+        {
+            seen[x] |= marks[x];
+        }
+    }
+    return (int) std::count(seen.begin(), seen.end(), 1);
+}
+
+int RenderCore::pick(const FrameParams &params, float x, float y, float &distance)
+{
+    //! The window counts rows from the top, OpenGL from
+    //! the bottom.
+    vec4 viewport = vec4(0.0f, 0.0f, (float) viewWidth, (float) viewHeight);
+    mat4 view = params.view, projection = params.projection;
+    vec3 eye = params.viewPos;
+    if (viewCount > 1)
+    {
+        //! Through the view the point is in.
+        int columns, rows;
+        Camera::ViewGrid(viewCount, columns, rows);
+        int column = glm::clamp((int) (x * columns / std::max(1, viewWidth)), 0, columns - 1);
+        int row = glm::clamp((int) (y * rows / std::max(1, viewHeight)), 0, rows - 1);
+        int v = std::min(row * columns + column, viewCount - 1);
+        float width = (float) viewWidth / columns, height = (float) viewHeight / rows;
+        viewport = vec4(column * width, (rows - 1 - row) * height, width, height);
+        view = params.views[v];
+        projection = params.projections[v];
+        eye = params.viewPositions[v];
+    }
+    vec3 far = unProject(vec3(x, (float) viewHeight - y, 1.0f), view, projection, viewport);
+    return cloud->pick(eye, normalize(far - eye), params.degrees, distance);
+}
+
+void RenderCore::framebufferSize(int width, int height)
+{
+    //! make sure the viewport matches the new window dimensions; note that width and
+    //! height will be significantly larger than specified on retina displays.
+    glViewport(0, 0, width, height);
+    viewWidth = width;
+    viewHeight = height;
+}
@@ -0,0 +1,372 @@
+/*******************************************************************
+ * RenderCore:  A class to hold the OpenGL side of the cloud of
+ * cubes:  shaders, textures, buffers and the per frame drawing.
+ * It knows nothing about the window or the input so it can be
+ * driven by the ClanLib program or by the headless benchmark.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef RENDERCORE_H
+#define RENDERCORE_H
+
+#include "commonheader.h"
+#include "shader.h"
+#include "createimage.h"
+#include "cubecloud.h"
+#include "sphericalharmonics.h"
+#include "shadervariants.h"
+#include "uniformprinter.h"
+#include "logger.h"
+#include "framearena.h"
+#include "alloctracker.h"
+#include "camera.h"
+#include "gpucull.h"
+#include "tracer.h"
+#include "hud.h"
+#include "meshimport.h"
+#include "texturestreamer.h"
+
+/** \class RenderCore
+ * Creates the OpenGL resources for the cloud of cubes and
+ * draws one frame at a time from the values handed to it
+ * in a FrameParams structure.  A current OpenGL context
+ * is required before any of the functions are called.
+ */
+class RenderCore
+{
+public:
+    /** \brief RenderCore
+     * Creates the render core for a cloud of count cubes.
+     */
+    RenderCore(int count = NUM_IMAGES * NUM_INSTANCES);
+    ~RenderCore();
+
+    /** \brief initGL
+     * Initializes GLEW and sets the depth and culling state.
+     * Returns false if GLEW could not be initialized.
+     */
+    bool initGL();
+
+    /** \brief configureShaders
+     * Chooses one program per feature combination, or one
+     * dynamic program that branches on uniforms, and the
+     * fragment precision.  Call it before createScene.
+     */
+    void configureShaders(bool dynamic, bool highPrecision);
+
+    /** \brief configureViews
+     * Draws count views side by side in each frame, in one
+     * pass:  each cube is drawn once for every view, moved
+     * into that view's part of the frame and cut to it.
+     * The cull, the sort and the upload serve all the views
+     * at once.  Every frame then needs count views, see
+     * Camera::GetViews.  Call it before createScene.
+     */
+    void configureViews(int count);
+
+    /** \brief configureTransparency
+     * Draws the cubes see through, with weighted blended
+     * transparency:  every face adds its color, weighted
+     * by how near it is, to one target and takes its share
+     * of the background from another, in any order, and
+     * one pass at the end puts the sum over the sky.  The
+     * cubes then need no sort, and the depth pass is not
+     * used.  Call it before createScene.
+     */
+    void configureTransparency(bool oit);
+
+    /** \brief configureGpuCull
+     * Culls and packs the cubes on the GPU and draws them
+     * with one indirect draw, in place of the cull and the
+     * sort on the CPU, see GpuCull.  Falls back to the CPU
+     * when the context cannot.  Call it before createScene.
+     */
+    void configureGpuCull(bool enable);
+
+    /** \brief configureMesh
+     * Draws the mesh in an OBJ or PLY file in place of each
+     * cube, fit to it and ordered for the GPU, see
+     * MeshImport.  Call it before createScene.
+     */
+    void configureMesh(string path);
+
+    /** \brief configureStreaming
+     * Loads the pictures of the cubes and the sky on a thread
+     * of its own while the frames are drawn, plain until
+     * each is in place, see TextureStreamer.  The loader
+     * sends them on the shared context loader when there is
+     * one, or hands them to the drawing thread.  The times
+     * to the first frame and to every picture in place are
+     * counted from launch.  Call it before createScene.
+     */
+    void configureStreaming(bool enable, chrono::steady_clock::time_point launch,
+    HeadlessContext *loader = NULL);
+
+    /** \brief enableSkybox
+     * Loads the skybox and its shaders in createScene, and
+     * builds the programs that reflect it.  Call it before
+     * createScene.
+     */
+    void enableSkybox(bool enable);
+
+    /** \brief createScene
+     * Compiles the shaders, loads the textures, generates
+     * the cloud from the seed on the given number of
+     * threads, or loads it from a scene file if one is
+     * named, and fills the buffers.  Returns false if the
+     * scene file cannot be loaded.
+     */
+    bool createScene(unsigned int seed, int threads = 0, string scenePath = "");
+
+    /** \brief renderFrame
+     * Draws one frame into the currently bound framebuffer.
+     */
+    void renderFrame(const FrameParams &params);
+
+    /** \brief getDrawn
+     * The cubes drawn in the last frame.  With the cull on
+     * the GPU it waits for the frame to count them.
+     */
+    int getDrawn();
+
+    /** \brief getDrawCalls
+     * The draw calls of the last frame.
+     */
+    int getDrawCalls();
+
+    /** \brief getUploadBytes
+     * The bytes the last frame sent to buffers.
+     */
+    size_t getUploadBytes();
+
+    /** \brief getCpuMs
+     * The time the CPU took on the last frame, without the
+     * performance display.
+     */
+    double getCpuMs();
+
+    /** \brief getTextureBytes
+     * The memory of the textures and the offscreen targets.
+     */
+    size_t getTextureBytes();
+
+    /** \brief getPhases
+     * How long the parts of initGL and createScene took.
+     */
+    const vector<StartupPhase> &getPhases();
+
+    /** \brief getFirstFrameSeconds
+     * The seconds from launch to the end of the first
+     * frame, or -1 before it.
+     */
+    double getFirstFrameSeconds();
+
+    /** \brief getLoadedSeconds
+     * The seconds from launch until every picture was in
+     * place, or -1 while they are loading.
+     */
+    double getLoadedSeconds();
+
+    /** \brief finishLoading
+     * Waits for every picture to be in place.
+     */
+    void finishLoading();
+
+    /** \brief getMesh
+     * The mesh drawn in place of the cubes, or NULL.
+     */
+    MeshImport *getMesh();
+
+    /** \brief cullUnion
+     * Culls the cubes for each view of params alone and
+     * counts those any of them sees, to check the cull of
+     * every view at once against.  The cull on the CPU
+     * only.
+     */
+    int cullUnion(const FrameParams &params);
+
+    /** \brief pick
+     * Finds the cube under a point of the window, counted
+     * from the top left, in the frame drawn with params.
+     * Returns the cube's place in the order it was made in,
+     * or -1, and how far it is from the camera.
+     */
+    int pick(const FrameParams &params, float x, float y, float &distance);
+
+    /** \brief framebufferSize
+     * Calls the OpenGl function to size the framebuffer.
+     */
+    void framebufferSize(int width, int height);
+
+    /** \brief drawSkybox
+     * Draws the skybox at the far plane, after the cubes,
+     * so only the pixels nothing else covers are shaded.
+     * The frame is width by height, for the views.
+     */
+    void drawSkybox(const FrameParams &params, vec4 fogColor, int width, int height);
+
+    /** \brief setCamera
+     * Sets the view and projection of a program, or those
+     * of every view.
+     */
+    void setCamera(Shader *program, const FrameParams &params);
+
+    /** \brief drawCubes
+     * Draws every chunk of cubes with the program in use,
+     * one side at a time when sides is six, or whole when
+     * it is one, the mesh's sides in place of the cube's
+     * when there is one.  The chunks are sent to the
+     * uniform buffer first when upload is true.  With the
+     * cull on the GPU it is the one indirect draw either
+     * way.
+     */
+    void drawCubes(Shader *program, int sides, bool upload);
+
+    /** \brief drawTranslucent
+     * Draws the cubes with the program in use into the
+     * weighted sums, then puts them over what is in the
+     * bound framebuffer.
+     */
+    void drawTranslucent();
+
+    /** \brief bindSums
+     * Binds the targets of the weighted sums, making them
+     * first if the window has changed size.
+     */
+    void bindSums();
+
+    /** \brief bindTarget
+     * Binds the offscreen target for frames drawn below
+     * full scale, making it first if the window has
+     * changed size.
+     */
+    void bindTarget();
+
+    /** \brief phaseDone
+     * Adds the time since since to a part of the startup,
+     * and starts the next part.
+     */
+    void phaseDone(const char *name, chrono::steady_clock::time_point &since);
+
+    /** \brief streamTextures
+     * Makes the textures plain at the size of their first
+     * pictures and starts loading the pictures into them.
+     * Returns false if a size cannot be read.
+     */
+    bool streamTextures();
+
+    /** \brief cullDistance
+     * How near a cube's center must be to be kept by the
+     * cull, past the fog only when there is no sky.
+     */
+    float cullDistance(const FrameParams &params);
+
+    /** \brief modelOffset
+     * Where a program reads the first cube matrix in the
+     * itemData block, or -1 if it does not.
+     */
+    int modelOffset(Shader *program);
+
+    //! The cloud of cubes.
+    CubeCloud *cloud;
+
+protected:
+    //! We have a light at each corner of the cloud of cubes.
+    static const unsigned int NUM_LIGHTS = 8;
+    //! The programs for the cubes, and the one in use.
+    ShaderVariants *variants;
+    Shader *shader, *skyBoxShader;
+    //! The position only program for the depth pass.
+    ShaderVariants *depthVariants;
+    Shader *depthShader;
+    bool dynamicShaders, highPrecision;
+    //! The cull on the GPU, when it is wanted and works.
+    bool gpuCulling;
+    GpuCull *gpuCull;
+    //! The mesh in place of the cube, its file, and its
+    //! vertex and index buffers.
+    string meshPath;
+    MeshImport *mesh;
+    unsigned int meshBuffers[2];
+    //! The pictures loading in the background, the context
+    //! they are sent on, the launch they are timed from and
+    //! what the textures made for them take.
+    bool streaming;
+    TextureStreamer *streamer;
+    HeadlessContext *loaderContext;
+    chrono::steady_clock::time_point launch;
+    double firstFrameSeconds, loadedSeconds;
+    size_t streamedBytes;
+    //! The skybox, loaded only when it is wanted.
+    bool skyEnabled;
+    unsigned int skyVAO, skyVBO, skyTexture;
+    //! The offscreen target for frames drawn below full
+    //! scale, and the size of the window.
+    unsigned int sceneFBO, sceneColor, sceneDepth;
+    int targetWidth, targetHeight;
+    int viewWidth, viewHeight;
+    //! The weighted blended transparency:  the color sums
+    //! with what is left of the background, the weight
+    //! sums, and the program putting them over it.
+    bool oit;
+    Shader *compositeShader;
+    unsigned int sumFBO, sumColor, sumWeight, compositeVAO;
+    int sumWidth, sumHeight;
+    //! The finest texture level in use.
+    float textureLod;
+    //! The performance display, and what the frame cost
+    //! so far for it.
+    Hud *hud;
+    int drawCalls;
+    size_t uploadBytes;
+    double cpuMs;
+    //! The parts of the startup, in order.
+    vector<StartupPhase> phases;
+    //! The temporaries of a frame, such as uniform names.
+    FrameArena arena;
+    //! The views in a frame, and where each goes in clip
+    //! space, the scale in xy and the offset in zw.
+    int viewCount;
+    vec4 viewRects[MAX_VIEWS];
+    //! How much of the sky the cubes reflect.
+    constexpr static float REFLECTIVITY = 0.25f;
+    //! How much of the fog color covers the sky.
+    constexpr static float SKY_FOG = 0.7f;
+    //! How opaque a see through cube is where its picture
+    //! is, half that on the bare crate.
+    constexpr static float OPACITY = 0.6f;
+    //! The CreateImage class to create textures.
+    CreateImage *image;
+    //! Define the lights for the shaders.
+    Lights lighting[NUM_LIGHTS];
+    //! The same lights as spherical harmonics, worked out
+    //! once since the lights never move.
+    vec3 shCoeffs[9];
+    vec3 domLightDir, domLightColor;
+    unsigned int VBO[4], VAO;
+    unsigned int texture1, dataIndex;
+    //! The pointer for the texture2DArray.
+    unsigned int texImages;
+    //! The skybox faces, back to front in the order
+    //! createSkyBoxTex reverses.
+    string skyNames[6] =
+    {
+        "skybox/back.jpg", "skybox/front.jpg",
+        "skybox/bottom.jpg", "skybox/top.jpg",
+        "skybox/left.jpg", "skybox/right.jpg"
+    };
+    //! The images used in the images directory.
+    string imageNames[NUM_IMAGES] =
+    {
+        "awesomeface.png", "eucharist.png",
+        "palette.png", "panda.png",
+        "seahorse.png", "sparkle.png",
+        "star.png", "sunflowers.png",
+        "superman.png", "paris.png",
+        "grapes.png", "lemon.png",
+        "sun.png", "mexican.png",
+        "abstract.png", "suites.png"
+    };
+};
+
+#endif // RENDERCORE_H
@@ -0,0 +1,205 @@
+/*******************************************************************
+ * SceneFile:  A class to write and read the cloud of cubes as a
+ * compact binary file, so a scene can be reloaded exactly and
+ * without generating it again.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "scenefile.h"
+
+static_assert(sizeof(SceneFile::Header) == 64, "The scene header must be 64 bytes.");
+static_assert(sizeof(SceneFile::Record) == 48, "A scene record must be 48 bytes.");
+
+SceneFile::SceneFile()
+{
+    written = 0;
+    outSeed = 0;
+    outSeeded = false;
+    fd = -1;
+    mapped = NULL;
+    mappedSize = 0;
+    released = 0;
+    memset(&header, 0, sizeof(header));
+}
+
+SceneFile::~SceneFile()
+{
+    close();
+    if (out.is_open())
+    {
+        out.close();
+    }
+}
+
+bool SceneFile::create(string path, uint64_t seed, bool seeded)
+{
+    out.open(path.c_str(), ios::out | ios::binary | ios::trunc);
+    if (!out)
+    {
+        LOG_ERROR(FILE, "Error creating scene file {}.", path);
+        return false;
+    }
+    outPath = path;
+    written = 0;
+    outSeed = seed;
+    outSeeded = seeded;
+    //! The count is filled in by finish.
+    Header blank;
+    memset(&blank, 0, sizeof(blank));
+    out.write((const char*) &blank, sizeof(blank));
+    return (bool) out;
+}
+
+bool SceneFile::append(const Record *records, size_t n)
+{
+    out.write((const char*) records, n * sizeof(Record));
+    written += n;
+    return (bool) out;
+}
+
+bool SceneFile::finish()
+{
+    Header head;
+    memset(&head, 0, sizeof(head));
+    memcpy(head.magic, "SFCSCENE", 8);
+    head.byteOrder = BYTE_ORDER_MARK;
+    head.version = VERSION;
+    head.headerSize = sizeof(Header);
+    head.recordSize = sizeof(Record);
+    head.count = written;
+    head.seed = outSeed;
+    head.flags = outSeeded ? FLAG_SEEDED : 0;
+    out.seekp(0);
+    out.write((const char*) &head, sizeof(head));
+    out.close();
+    if (!out)
+    {
+        LOG_ERROR(FILE, "Error writing scene file {}.", outPath);
+        return false;
+    }
+    return true;
+}
+
+bool SceneFile::open(string path)
+{
+    close();
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        LOG_ERROR(FILE, "Error opening scene file {}.", path);
+        return false;
+    }
+    struct stat info;
+    if ((fstat(fd, &info) != 0) || ((size_t) info.st_size < sizeof(Header)))
+    {
+        LOG_ERROR(FILE, "Scene file {} is too short.", path);
+        close();
+        return false;
+    }
+    mappedSize = (size_t) info.st_size;
+    void *address = mmap(NULL, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED)
+    {
+        LOG_ERROR(FILE, "Error mapping scene file {}.", path);
+        mappedSize = 0;
+        close();
+        return false;
+    }
+    mapped = (const uint8_t*) address;
+    released = 0;
+    //! The records are read front to back once.
+    madvise(address, mappedSize, MADV_SEQUENTIAL);
+    memcpy(&header, mapped, sizeof(Header));
+    string problem;
+    if (memcmp(header.magic, "SFCSCENE", 8) != 0)
+    {
+        problem = "is not a scene file";
+    }
+    else if (header.byteOrder != BYTE_ORDER_MARK)
+    {
+        problem = "was written with the other byte order";
+    }
+    else if ((header.version < 1) || (header.version > VERSION))
+    {
+        problem = "has a version this program does not read";
+    }
+    else if ((header.headerSize < sizeof(Header)) || (header.recordSize < sizeof(Record)))
+    {
+        problem = "has a header or record smaller than version 1";
+    }
+    else if ((header.count > (mappedSize - header.headerSize) / header.recordSize)
+    || (header.headerSize > mappedSize))
+    {
+        problem = "is shorter than its record count";
+    }
+    if (!problem.empty())
+    {
+        LOG_ERROR(FILE, "Scene file {} {}.", path, problem);
+        close();
+        return false;
+    }
+    return true;
+}
+
+size_t SceneFile::read(uint64_t first, Record *out, size_t n)
+{
+    if ((mapped == NULL) || (first >= header.count))
+    {
+        return 0;
+    }
+    n = (size_t) std::min((uint64_t) n, header.count - first);
+    const uint8_t *source = mapped + header.headerSize + first * header.recordSize;
+    if (header.recordSize == sizeof(Record))
+    {
+        memcpy(out, source, n * sizeof(Record));
+    }
+    else
+    {
+        //! A later version with longer records.
+        for (size_t k = 0; k < n; k++)
+        {
+            memcpy(&out[k], source + k * header.recordSize, sizeof(Record));
+        }
+    }
+    //! Hand back the whole pages behind the read.
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    size_t done = (size_t) (source - mapped) + n * header.recordSize;
+    done -= done % page;
+    if (done > released)
+    {
+        madvise((void*) (mapped + released), done - released, MADV_DONTNEED);
+        released = done;
+    }
+    return n;
+}
+
+void SceneFile::close()
+{
+    if (mapped != NULL)
+    {
+        munmap((void*) mapped, mappedSize);
+        mapped = NULL;
+    }
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+    mappedSize = 0;
+    released = 0;
+}
+
+uint64_t SceneFile::getCount()
+{
+    return header.count;
+}
+
+uint64_t SceneFile::getSeed()
+{
+    return header.seed;
+}
+
+bool SceneFile::isSeeded()
+{
+    return (header.flags & FLAG_SEEDED) != 0;
+}
@@ -0,0 +1,139 @@
+/*******************************************************************
+ * SceneFile:  A class to write and read the cloud of cubes as a
+ * compact binary file, so a scene can be reloaded exactly and
+ * without generating it again.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef SCENEFILE_H
+#define SCENEFILE_H
+
+#include "commonheader.h"
+#include "logger.h"
+
+/** \class SceneFile
+ * The file is a 64 byte header followed by one fixed size
+ * record per cube, in the byte order of the machine that
+ * wrote it (little endian on x86 and ARM), with no compression
+ * so it can be memory mapped and read in place:
+ *
+ *     offset  size  header field
+ *          0     8  magic "SFCSCENE"
+ *          8     4  byte order mark 0x01020304
+ *         12     4  version, 1
+ *         16     4  header size, 64 or more
+ *         20     4  record size, 48 or more
+ *         24     8  number of records
+ *         32     8  seed the cubes were generated from
+ *         40     4  flags, 1 if the seed is meaningful
+ *         44    20  reserved, zero
+ *
+ *     offset  size  record field
+ *          0    12  position x, y, z
+ *         12    12  first spin axis x, y, z
+ *         24    12  second spin axis x, y, z
+ *         36     4  spin rate in radians per degree
+ *         40     6  image index of each face, 0 to 15
+ *         46     2  reserved, zero
+ *
+ * Readers skip any header or record bytes past the ones they
+ * know, so later versions may grow either.  Reading maps the
+ * file and copies records out a chunk at a time, handing the
+ * pages back as it goes, so files with millions of cubes are
+ * never held in memory whole.  Files written by other programs
+ * are welcome so long as they follow the layout.
+ */
+class SceneFile
+{
+public:
+    //! One cube as it is stored in the file.
+    struct Record {
+        float position[3];
+        float xaxis[3];
+        float yaxis[3];
+        float rate;
+        uint8_t faces[6];
+        uint8_t reserved[2];
+    };
+
+    //! The start of the file.
+    struct Header {
+        char magic[8];
+        uint32_t byteOrder;
+        uint32_t version;
+        uint32_t headerSize;
+        uint32_t recordSize;
+        uint64_t count;
+        uint64_t seed;
+        uint32_t flags;
+        char reserved[20];
+    };
+
+    constexpr static uint32_t VERSION = 1;
+    constexpr static uint32_t BYTE_ORDER_MARK = 0x01020304;
+    constexpr static uint32_t FLAG_SEEDED = 1;
+
+    SceneFile();
+    ~SceneFile();
+
+    /** \brief create
+     * Starts a new file.  The seed is recorded if seeded
+     * is true.  Returns false if the file cannot be opened.
+     */
+    bool create(string path, uint64_t seed, bool seeded);
+
+    /** \brief append
+     * Writes records to the end of a file being created.
+     */
+    bool append(const Record *records, size_t n);
+
+    /** \brief finish
+     * Writes the record count in the header and closes
+     * the file.
+     */
+    bool finish();
+
+    /** \brief open
+     * Maps an existing file and checks the header and the
+     * file size.  Returns false, saying why, if the file
+     * cannot be read.
+     */
+    bool open(string path);
+
+    /** \brief read
+     * Copies up to n records starting at first and hands
+     * back the pages read so far.  Returns the number copied.
+     */
+    size_t read(uint64_t first, Record *out, size_t n);
+
+    /** \brief close
+     * Unmaps the file.
+     */
+    void close();
+
+    /** \brief getCount
+     * The number of records in an open file.
+     */
+    uint64_t getCount();
+
+    /** \brief getSeed
+     * The seed of an open file, if isSeeded is true.
+     */
+    uint64_t getSeed();
+    bool isSeeded();
+
+protected:
+    //! The file being written.
+    std::ofstream out;
+    string outPath;
+    uint64_t written, outSeed;
+    bool outSeeded;
+    //! The mapping of the file being read.
+    int fd;
+    const uint8_t *mapped;
+    size_t mappedSize;
+    size_t released;
+    Header header;
+};
+
+#endif // SCENEFILE_H
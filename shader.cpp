@@ -14,22 +14,25 @@
 
 Shader::Shader()
 {
-    cout << "\n\n\tCreating Shader.\n\n";
+    LOG_DEBUG(STARTUP, "Creating Shader.");
 }
 
 Shader::~Shader()
 {
-    cout << "\n\n\tDestroying Shader.\n\n";
+    LOG_DEBUG(STARTUP, "Destroying Shader.");
 }
 
 void Shader::initShader(string vertexPath, string fragmentPath, 
-    string outputFile)
+    string outputFile, string defines)
 {
+    TRACE_SCOPE_DETAIL("initShader", outputFile.c_str());
     //! Where the program is created.
-    outputFile = "/usr/share/openglresources/shaders/" + outputFile;
-    vertexPath = "/usr/share/openglresources/shaders/" + vertexPath;
-    fragmentPath = "/usr/share/openglresources/shaders/" + fragmentPath;
+    outputFile = fullPath(outputFile);
+    vertexPath = fullPath(vertexPath);
+    fragmentPath = fullPath(fragmentPath);
     this->outputFile = outputFile;
+    this->defines = defines;
+    locations.clear();
     int numFormats = 0;
     GLenum *valFormats;
     /** Before a binary can be loaded a binary format has
@@ -45,23 +48,24 @@ void Shader::initShader(string vertexPath, string fragmentPath,
         glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, (int*)valFormats);
         for (int x = 0; x < numFormats; x++)
         {
-            cout << "\n\nFormat " << x << " : " << valFormats[x];
+            LOG_DEBUG(SHADER, "Format {} : {}", x, valFormats[x]);
         }
         format = valFormats[0];
-        cout << "\n\n";
     }
     else
     {
-        valFormats = new GLenum(0);
+        valFormats = new GLenum[1];
+        valFormats[0] = 0;
         glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, (int*) valFormats);
         format = *valFormats;
     }
+    delete [] valFormats;
     FILE *shaderFile;
     unsigned char c;
     shaderFile = fopen(outputFile.c_str(), "rb");
     if (!shaderFile)
     {
-        cout << "\n\n\tError opening file " << outputFile << ".\n\n";
+        LOG_WARN(FILE, "Error opening file {}.", outputFile);
         response = false;
     }
     else
@@ -72,13 +76,13 @@ void Shader::initShader(string vertexPath, string fragmentPath,
         { //! standard C I/O file reading loop
             shaderBinary[x] = fgetc(shaderFile);
         }
+        fclose(shaderFile);
         /** This is the spot where the format is used to turn
          * the loaded binary into an OpenGL shader program.
          */
         glProgramBinary(Program, format, (GLvoid*) shaderBinary, fileSize);
-        cout << "\n\n\tSuccessfully loaded pre-compiled agregate "
-        << "program binary.\n\tThe program has binary format " 
-        << format << " and size " << fileSize << " bytes.\n\n";
+        LOG_INFO(SHADER, "Successfully loaded pre-compiled agregate program binary, "
+        "binary format {} and size {} bytes.", format, fileSize);
         glValidateProgram(Program);
         /** If the shader program does not load, the Shader
          * class will go through the usual process of 
@@ -88,7 +92,7 @@ void Shader::initShader(string vertexPath, string fragmentPath,
         glGetProgramiv(Program, GL_VALIDATE_STATUS, &response);
         if (!response)
         {
-            cout << "\n\n\tInvalid program, recompile initiated.\n\n";
+            LOG_WARN(SHADER, "Invalid program, recompile initiated.");
         }
     }
     if (!response)
@@ -98,13 +102,17 @@ void Shader::initShader(string vertexPath, string fragmentPath,
         {
             char infoLog[response];
             glGetProgramInfoLog(Program, response, NULL, infoLog);
-            cout << "\n\n\tError loading shader program binary:  " << infoLog << "\n\n";
+            LOG_WARN(SHADER, "Error loading shader program binary:");
+            //! The driver's log runs over many lines, so it is
+            //! printed as it is, after the messages before it.
+            Logger::instance().flush();
+            cout << infoLog << "\n\n";
         }
         vertex = createShader(GL_VERTEX_SHADER, vertexPath);
         fragment = createShader(GL_FRAGMENT_SHADER, fragmentPath);
         if ((!vertex) || (!fragment))
         {
-            cout << "\n\n\tError compiling shaders.\n\n";
+            LOG_ERROR(SHADER, "Error compiling shaders.");
             exit(1);
         }
         glProgramParameteri(Program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
@@ -118,48 +126,90 @@ void Shader::initShader(string vertexPath, string fragmentPath,
         {
             char infoLog[infoLength];
             glGetProgramInfoLog(Program, infoLength, NULL, infoLog);
-            cout << "\n\nShader Program Link Error\n" << infoLog << endl;
+            LOG_ERROR(SHADER, "Shader Program Link Error");
+            Logger::instance().flush();
+            cout << infoLog << endl;
         }
         else
         {
-            cout << "\n\n\tShader agregate binary program created "
-            << "and the program has length " << progLength 
-            << " bytes.\n\n";
+            LOG_INFO(SHADER, "Shader agregate binary program created "
+            "and the program has length {} bytes.", progLength);
         }
         //! Delete the shaders as they're linked into our program now and no longer necessery
         glDeleteShader(vertex);
         glDeleteShader(fragment);
         if(createBinary())
         {
-            cout << "\n\n\tShader program binary " << outputFile 
-            << " compiled and saved.\n\n";
+            LOG_INFO(SHADER, "Shader program binary {} compiled and saved.", outputFile);
         }
         else
         {
-            cout << "\n\n\tShader program binary " << outputFile 
-            << " failed to compile and save.\n\n";
+            LOG_ERROR(SHADER, "Shader program binary {} failed to compile and save.", outputFile);
         }
     }
 }
 
+void Shader::initCompute(string computePath, string defines)
+{
+    TRACE_SCOPE_DETAIL("initCompute", computePath.c_str());
+    computePath = fullPath(computePath);
+    this->defines = defines;
+    locations.clear();
+    Program = glCreateProgram();
+    GLuint compute = createShader(GL_COMPUTE_SHADER, computePath);
+    if (!compute)
+    {
+        LOG_ERROR(SHADER, "Error compiling the compute shader.");
+        exit(1);
+    }
+    glAttachShader(Program, compute);
+    glLinkProgram(Program);
+    //! Print linking errors if any
+    glGetProgramiv(Program, GL_INFO_LOG_LENGTH, &infoLength);
+    if(infoLength > 0)
+    {
+        char infoLog[infoLength];
+        glGetProgramInfoLog(Program, infoLength, NULL, infoLog);
+        LOG_ERROR(SHADER, "Compute Program Link Error");
+        Logger::instance().flush();
+        cout << infoLog << endl;
+    }
+    else
+    {
+        LOG_INFO(SHADER, "Compute program {} created.", computePath);
+    }
+    glDeleteShader(compute);
+}
+
 unsigned int Shader::createShader(unsigned int type, string fpath)
 {
     //! Where the individual shaders are compiled.
-    char c;
-    string shaderCode;
     unsigned int shaderobj;
-    FILE *shaderFile = fopen(fpath.c_str(), "r");
-    if (!shaderFile)
+    string shaderCode = readSource(fpath);
+    if (shaderCode.empty())
     {
-        cout << "\n\n\tError opening file " << fpath << ".\n\n";
+        LOG_ERROR(FILE, "Error opening file {}.", fpath);
         return 0;
     }
-    //! Read file's buffer contents into streams
-    while ((c = std::fgetc(shaderFile)) != EOF) 
-    { //! standard C I/O file reading loop
-        shaderCode += c;
+    //! The defines have to follow the #version line, or
+    //! replace it when they bring their own.
+    if (!defines.empty())
+    {
+        size_t version = shaderCode.find("#version");
+        size_t lineEnd = (version == string::npos) ? string::npos : shaderCode.find('\n', version);
+        if (lineEnd == string::npos)
+        {
+            shaderCode = defines + shaderCode;
+        }
+        else if (defines.compare(0, 8, "#version") == 0)
+        {
+            shaderCode.replace(version, lineEnd + 1 - version, defines);
+        }
+        else
+        {
+            shaderCode.insert(lineEnd + 1, defines);
+        }
     }
-    fclose(shaderFile);
     const GLchar* glShaderCode = shaderCode.c_str();
     //! Vertex Shader
     try
@@ -167,12 +217,12 @@ unsigned int Shader::createShader(unsigned int type, string fpath)
         shaderobj = glCreateShader(type);
         if (!shaderobj)
         {
-            cout << "\n\n\tUnable to create the shader object.\n\n";
+            LOG_ERROR(SHADER, "Unable to create the shader object.");
             return 0;
         }
         else
         {
-            cout << "\n\n\tCreated the shader object.\n\n";
+            LOG_DEBUG(SHADER, "Created the shader object.");
         }
         glShaderSource(shaderobj, 1, &glShaderCode, nullptr);
         glCompileShader(shaderobj);
@@ -182,23 +232,42 @@ unsigned int Shader::createShader(unsigned int type, string fpath)
         {
             char infoLog[infoLength];
             glGetShaderInfoLog(shaderobj, infoLength, NULL, infoLog);
-            cout << "\n\nShader compilation error: \n" << infoLog << endl;
+            LOG_ERROR(SHADER, "Shader compilation error:");
+            Logger::instance().flush();
+            cout << infoLog << endl;
             glDeleteShader(shaderobj);
             return 0;
         }
         else
         {
-             cout << "\n\n\tShader compiled.\n\n";
+             LOG_DEBUG(SHADER, "Shader compiled.");
         }
         return shaderobj;
     }
     catch(exception exc)
     {
-        cout << "\n\n\tError making shader:  " << exc.what() << "\n\n";
+        LOG_ERROR(SHADER, "Error making shader:  {}", exc.what());
         return 0;
     }
 }
 
+string Shader::fullPath(string name)
+{
+    return "/usr/share/openglresources/shaders/" + name;
+}
+
+string Shader::readSource(string fpath)
+{
+    std::ifstream in(fpath.c_str(), ios::in | ios::binary);
+    if (!in)
+    {
+        return "";
+    }
+    stringstream contents;
+    contents << in.rdbuf();
+    return contents.str();
+}
+
 void Shader::Use() 
 { 
     glUseProgram(Program); 
@@ -209,56 +278,93 @@ bool Shader::createBinary()
     //! Create the shader program binary for later use.
     if (progLength <= 0)
     {
-        cout << "\n\n\tShader program length less than one.\n\n";
+        LOG_WARN(SHADER, "Shader program length less than one.");
         progLength = 1000000;
     }
     binary = new unsigned char[progLength];
     glGetProgramBinary(Program, progLength, &progLenRet, &format, (GLvoid*) binary);
     if (progLength != progLenRet)
     {
-        cout << "\n\n\tWarning program length of " << progLength 
-        << " does not equal the size of the created binary "
-        << progLenRet << " with format " << format
-        << "\n\n";
+        LOG_WARN(SHADER, "Warning program length of {} does not equal the size of "
+        "the created binary {} with format {}", progLength, progLenRet, format);
     }
-    FILE *shaderFile = fopen(outputFile.c_str(), "wb");
+    //! Written aside and renamed, so a program started at
+    //! the same time, as the tile workers are, never reads
+    //! half a binary.
+    string partFile = outputFile + "." + to_string(getpid());
+    FILE *shaderFile = fopen(partFile.c_str(), "wb");
     if (!shaderFile)
     {
-        cout << "\n\n\tError opening file " << "shaders/cubeshader" << ".\n\n";
+        LOG_ERROR(FILE, "Error opening file shaders/cubeshader.");
+        delete [] binary;
         return false;
     }
     for (int x = 0; x < progLenRet; x++)
     { //! standard C I/O file reading loop
        fputc(binary[x], shaderFile);
     }
+    fclose(shaderFile);
+    delete [] binary;
+    if (std::rename(partFile.c_str(), outputFile.c_str()) != 0)
+    {
+        LOG_ERROR(FILE, "Error renaming {} to {}.", partFile, outputFile);
+        std::remove(partFile.c_str());
+        return false;
+    }
     return true;
 }
     
-void Shader::setBool(const std::string name, bool value) const
+GLint Shader::location(const char *name) const
+{
+    //! The names are looked up as given, with no string
+    //! made, and the driver is asked only the first time.
+    map<string, GLint, less<>>::const_iterator found = locations.find(name);
+    if (found != locations.end())
+    {
+        return found->second;
+    }
+    GLint place = glGetUniformLocation(Program, name);
+    locations.emplace(name, place);
+    return place;
+}
+
+void Shader::setBool(const char *name, bool value) const
 {         
-    glUniform1i(glGetUniformLocation(Program, name.c_str()), (int)value); 
+    glUniform1i(location(name), (int)value); 
 }
-void Shader::setInt(const std::string name, int value) const
+void Shader::setInt(const char *name, int value) const
 { 
-    glUniform1i(glGetUniformLocation(Program, name.c_str()), value); 
+    glUniform1i(location(name), value); 
 }
-void Shader::setFloat(const std::string name, float value) const
+void Shader::setFloat(const char *name, float value) const
+{ 
+    glUniform1f(location(name), value); 
+} 
+void Shader::setVec2(const char *name, vec2 value) const
+{ 
+    glUniform2fv(location(name), 1, value_ptr(value)); 
+} 
+void Shader::setVec3(const char *name, vec3 value) const
+{ 
+    glUniform3fv(location(name), 1, value_ptr(value)); 
+} 
+void Shader::setVec4(const char *name, vec4 value) const
 { 
-    glUniform1f(glGetUniformLocation(Program, name.c_str()), value); 
+    glUniform4fv(location(name), 1, value_ptr(value)); 
 } 
-void Shader::setVec2(const std::string name, vec2 value) const
+void Shader::setMat4(const char *name, const mat4 &value) const
 { 
-    glUniform2fv(glGetUniformLocation(Program, name.c_str()), 1, value_ptr(value)); 
+    glUniformMatrix4fv(location(name), 1, GL_FALSE, &value[0][0]); 
 } 
-void Shader::setVec3(const std::string name, vec3 value) const
+void Shader::setVec3Array(const char *name, const vec3 *values, int count) const
 { 
-    glUniform3fv(glGetUniformLocation(Program, name.c_str()), 1, value_ptr(value)); 
+    glUniform3fv(location(name), count, value_ptr(values[0])); 
 } 
-void Shader::setVec4(const std::string name, vec4 value) const
+void Shader::setVec4Array(const char *name, const vec4 *values, int count) const
 { 
-    glUniform4fv(glGetUniformLocation(Program, name.c_str()), 1, value_ptr(value)); 
+    glUniform4fv(location(name), count, value_ptr(values[0])); 
 } 
-void Shader::setMat4(const std::string name, mat4 value) const
+void Shader::setMat4Array(const char *name, const mat4 *values, int count) const
 { 
-    glUniformMatrix4fv(glGetUniformLocation(Program, name.c_str()), 1, GL_FALSE, &value[0][0]); 
+    glUniformMatrix4fv(location(name), count, GL_FALSE, value_ptr(values[0])); 
 } 
@@ -14,6 +14,8 @@
 #define SHADER_H
 
 #include "commonheader.h"
+#include "logger.h"
+#include "tracer.h"
 
 /** \class Shader
  * A class to encapsulate the uploading, compiling, linking
@@ -30,15 +32,35 @@ public:
     ~Shader();
    
     /** \brief initShader
-     * Read and build the shader from two files.
+     * Read and build the shader from two files.  Any
+     * defines given go in after the #version line of each,
+     * or in place of it when they begin with a #version
+     * line of their own.
      */
     void initShader(string vertexPath, string fragmentPath, 
-    string outputFile);
+    string outputFile, string defines = "");
+
+    /** \brief initCompute
+     * Read and build a compute program from one file, with
+     * the defines as for initShader.  It is small enough to
+     * compile every time, so no binary is kept.
+     */
+    void initCompute(string computePath, string defines = "");
     
     /** \brief createShader
      * Create the vertex or fragment shader from a file.
      */
     unsigned int createShader(unsigned int type, string fpath);
+
+    /** \brief fullPath
+     * Where a file in the shaders directory is installed.
+     */
+    static string fullPath(string name);
+
+    /** \brief readSource
+     * Reads a whole shader file, empty if it cannot be read.
+     */
+    static string readSource(string fpath);
     
     /** \brief Use
      * Use the program.
@@ -49,48 +71,69 @@ public:
      * Create the shader program binary and save it to a file.
      */
     bool createBinary();
+
+    /** \brief location
+     * The location of a uniform, asked of the driver once
+     * and kept.
+     */
+    GLint location(const char *name) const;
     
     /** \brief  setBool
      * A Utility uniform function that sets a value in 
      * the shader(s).
      */
-    void setBool(const string name, bool value) const;  
+    void setBool(const char *name, bool value) const;  
 
     /** \brief  setInt
      * A Utility uniform function that sets a value in 
      * the shader(s).
      */
-    void setInt(const string name, int value) const;   
+    void setInt(const char *name, int value) const;   
 
     /** \brief  setFloat
      * A Utility uniform function that sets a value in 
      * the shader(s).
      */
-    void setFloat(const string name, float value) const;
+    void setFloat(const char *name, float value) const;
     
     /** \brief  setVec2
      * A Utility uniform function that sets a value in 
      * the shader(s).
      */
-    void setVec2(const std::string name, vec2 value) const;
+    void setVec2(const char *name, vec2 value) const;
 
     /** \brief  setVec3
      * A Utility uniform function that sets a value in 
      * the shader(s).
      */
-    void setVec3(const std::string name, vec3 value) const;
+    void setVec3(const char *name, vec3 value) const;
 
     /** \brief  setVec4
      * A Utility uniform function that sets a value in 
      * the shader(s).
      */
-    void setVec4(const string name, vec4 value) const; 
+    void setVec4(const char *name, vec4 value) const; 
 
     /** \brief  setMat4
      * A Utility uniform function that sets a value in 
      * the shader(s).
      */
-    void setMat4(const string name, mat4 value) const;    
+    void setMat4(const char *name, const mat4 &value) const;    
+
+    /** \brief  setVec3Array
+     * Sets count values of a uniform array, from the first.
+     */
+    void setVec3Array(const char *name, const vec3 *values, int count) const;
+
+    /** \brief  setVec4Array
+     * Sets count values of a uniform array, from the first.
+     */
+    void setVec4Array(const char *name, const vec4 *values, int count) const;
+
+    /** \brief  setMat4Array
+     * Sets count values of a uniform array, from the first.
+     */
+    void setMat4Array(const char *name, const mat4 *values, int count) const;
     GLuint Program;
 protected:
     //! Class global variables.
@@ -104,6 +147,9 @@ protected:
     int response = 0;
     unsigned char *binary;
     string outputFile;
+    string defines;
+    //! The uniform locations asked for so far.
+    mutable map<string, GLint, less<>> locations;
 
 };
   
@@ -0,0 +1,119 @@
+/*******************************************************************
+ * ShaderVariants:  A class to build one shader program for each
+ * combination of features from a single pair of shader files,
+ * by putting #defines at the top, so each program holds only
+ * the code it runs.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "shadervariants.h"
+
+ShaderVariants::ShaderVariants(string vertexPath, string fragmentPath, string binaryName)
+{
+    LOG_DEBUG(STARTUP, "Creating ShaderVariants.");
+    this->vertexPath = vertexPath;
+    this->fragmentPath = fragmentPath;
+    this->binaryName = binaryName;
+    dynamic = false;
+}
+
+ShaderVariants::~ShaderVariants()
+{
+    LOG_DEBUG(STARTUP, "Destroying ShaderVariants.");
+    for (map<unsigned int, Shader*>::iterator item = programs.begin(); item != programs.end(); item++)
+    {
+        delete item->second;
+    }
+}
+
+void ShaderVariants::setConstant(string name, string value)
+{
+    for (unsigned int x = 0; x < constants.size(); x++)
+    {
+        if (constants[x].first == name)
+        {
+            constants[x].second = value;
+            return;
+        }
+    }
+    constants.push_back(make_pair(name, value));
+}
+
+void ShaderVariants::setVersion(string version)
+{
+    this->version = version;
+}
+
+void ShaderVariants::setDynamic(bool dynamic)
+{
+    this->dynamic = dynamic;
+}
+
+void ShaderVariants::setPrepare(function<void(Shader *)> prepare)
+{
+    this->prepare = prepare;
+}
+
+string ShaderVariants::defines(unsigned int features)
+{
+    stringstream text;
+    //! Shader puts this in place of the files' own line.
+    if (!version.empty())
+    {
+        text << "#version " << version << "\n";
+    }
+    for (unsigned int x = 0; x < constants.size(); x++)
+    {
+        text << "#define " << constants[x].first << " " << constants[x].second << "\n";
+    }
+    if (dynamic)
+    {
+        text << "#define DYNAMIC_BRANCHES 1\n";
+    }
+    else
+    {
+        text << "#define USE_FOG " << ((features & FEATURE_FOG) ? 1 : 0) << "\n"
+        << "#define SH_LIGHTING " << ((features & FEATURE_SH_LIGHTING) ? 1 : 0) << "\n"
+        << "#define REFLECTION " << ((features & FEATURE_REFLECTION) ? 1 : 0) << "\n";
+    }
+    return text.str();
+}
+
+Shader *ShaderVariants::get(unsigned int features)
+{
+    //! One program serves every combination in dynamic mode.
+    unsigned int key = dynamic ? (unsigned int) NUM_FEATURE_SETS : (features % NUM_FEATURE_SETS);
+    map<unsigned int, Shader*>::iterator found = programs.find(key);
+    if (found != programs.end())
+    {
+        return found->second;
+    }
+    string text = defines(key);
+    //! Name the binary after everything that goes into it.
+    stringstream source;
+    source << text << Shader::readSource(Shader::fullPath(vertexPath))
+    << Shader::readSource(Shader::fullPath(fragmentPath))
+    << glGetString(GL_RENDERER) << glGetString(GL_VERSION);
+    stringstream name;
+    name << binaryName << "-" << hex << setw(16) << setfill('0')
+    << (uint64_t) hash<string>()(source.str()) << ".bin";
+    Shader *shader = new Shader();
+    shader->initShader(vertexPath, fragmentPath, name.str(), text);
+    if (prepare)
+    {
+        prepare(shader);
+    }
+    programs[key] = shader;
+    return shader;
+}
+
+void ShaderVariants::buildAll(unsigned int allowed)
+{
+    for (unsigned int features = 0; features < NUM_FEATURE_SETS; features++)
+    {
+        if ((features & ~allowed) == 0)
+        {
+            get(features);
+        }
+    }
+}
@@ -0,0 +1,95 @@
+/*******************************************************************
+ * ShaderVariants:  A class to build one shader program for each
+ * combination of features from a single pair of shader files,
+ * by putting #defines at the top, so each program holds only
+ * the code it runs.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef SHADERVARIANTS_H
+#define SHADERVARIANTS_H
+
+#include "commonheader.h"
+#include "shader.h"
+
+/** \class ShaderVariants
+ * The constants, such as the light count and the precision,
+ * are the same for every program.  The features, such as the
+ * fog, change from frame to frame, and each combination has
+ * a program of its own, built the first time it is asked for
+ * and kept.  Each program binary is saved under a name made
+ * from a hash of the defines, both shader files and the
+ * driver, so a change to any of them builds a new binary
+ * rather than loading a stale one.
+ *
+ * In dynamic mode there is one program for every feature
+ * combination, which reads the features from uniforms and
+ * branches on them per fragment, for comparison.
+ */
+class ShaderVariants
+{
+public:
+    //! The features, one bit each.
+    enum Shader_Feature {
+        FEATURE_FOG = 1,
+        FEATURE_SH_LIGHTING = 2,
+        FEATURE_REFLECTION = 4,
+        NUM_FEATURE_SETS = 8
+    };
+
+    ShaderVariants(string vertexPath, string fragmentPath, string binaryName);
+    ~ShaderVariants();
+
+    /** \brief setConstant
+     * Defines name as value in every program.  Call it
+     * before the first program is built.
+     */
+    void setConstant(string name, string value);
+
+    /** \brief setVersion
+     * Builds every program as the given GLSL version, such
+     * as "310 es", in place of the one in the files.  Call
+     * it before the first program is built.
+     */
+    void setVersion(string version);
+
+    /** \brief setDynamic
+     * Builds one program that branches on uniforms in place
+     * of one program per feature combination.
+     */
+    void setDynamic(bool dynamic);
+
+    /** \brief setPrepare
+     * A function run on each new program, to bind its
+     * uniform blocks and the like.
+     */
+    void setPrepare(function<void(Shader *)> prepare);
+
+    /** \brief get
+     * The program for a combination of features.
+     */
+    Shader *get(unsigned int features);
+
+    /** \brief buildAll
+     * Builds every combination of the allowed features up
+     * front so switching never stalls a frame.
+     */
+    void buildAll(unsigned int allowed = NUM_FEATURE_SETS - 1);
+
+    /** \brief defines
+     * The #define lines for a combination of features.
+     */
+    string defines(unsigned int features);
+
+protected:
+    string vertexPath, fragmentPath, binaryName;
+    //! The GLSL version, or empty for the files' own.
+    string version;
+    //! The constants in the order they were set.
+    vector<pair<string, string>> constants;
+    bool dynamic;
+    function<void(Shader *)> prepare;
+    map<unsigned int, Shader*> programs;
+};
+
+#endif // SHADERVARIANTS_H
@@ -9,109 +9,130 @@
 
 SideFogCube::SideFogCube()
 {
-    cout << "\n\n\tCreating SideFogCube\n\n";
+    LOG_DEBUG(STARTUP, "Creating SideFogCube.");
     quit = false;
     add = false;
     firstMouse = true;
+    pickWanted = false;
     xpos = ypos = lastX = lastY = 0;
-    genMatrices();
-    /**  The cloud of cubes goes from -25 to 25 on
-     * all three axis.  There is a light at each corner.
-     */
-    lighting[0].lightPos = vec3(25.0, 25.0, 25.0);
-    lighting[1].lightPos = vec3(-25.0, 25.0, 25.0);
-    lighting[2].lightPos = vec3(25.0, 25.0, -25.0);
-    lighting[3].lightPos = vec3(-25.0, 25.0, -25.0);
-    lighting[4].lightPos = vec3(25.0, -25.0, 25.0);
-    lighting[5].lightPos = vec3(-25.0, -25.0, 25.0);
-    lighting[6].lightPos = vec3(25.0, -25.0, -25.0);
-    lighting[7].lightPos = vec3(-25.0, -25.0, -25.0);
-    for (int x = 0; x < NUM_LIGHTS; x++)
-    {
-        lighting[x].lightColor = vec4(1.0f, 1.0f, 1.0f, 1.0f);
-    }
+    core = NULL;
+    sim = NULL;
+    capture = NULL;
+    metrics = NULL;
 }
 
 SideFogCube::~SideFogCube()
 {
-    cout << "\n\n\tDestroying SideFogCube\n\n";
-    delete image;
-    delete shader;
-    delete camera;
+    LOG_DEBUG(STARTUP, "Destroying SideFogCube.");
+    delete metrics;
+    delete capture;
+    delete sim;
+    delete core;
 }
 
-void SideFogCube::debug()
+int SideFogCube::main(int argc, char **argv)
 {
-    cout << "\n\n\t\tVertices\n\n\n\t";
-    for (int x = 0; x < 108; x++)
+    //!ClanLib uses a class internal main, nice for c++.
+    if (!options.parse(argc, argv))
     {
-        if (((x % 3) == 0) && (x > 0))
+        options.usage();
+        return 1;
+    }
+    Logger::setLevel(options.logLevel);
+    if (!options.trace.empty())
+    {
+        //! Each tile worker keeps a trace of its own.
+        if (options.tileWorker >= 0)
         {
-            cout << "\n\t";
-            if (((x % 9) == 0) && (x > 0))
-            {
-                cout << "\n\t";
-            }
+            options.trace += ".tile" + to_string(options.tileWorker);
         }
-        cout << calcCube[x] << ", "; 
+        if (!Tracer::start(options.trace))
+        {
+            return 1;
+        }
+        Tracer::nameThread("main");
     }
-    cout << "\n\n\t\tNormals\n\n\n\t";
-    for (int x = 0; x < 108; x++)
+    //! Without a window the benchmark does all the work.
+    if (options.headless)
     {
-        if (((x % 3) == 0) && (x > 0))
+        if (!options.seedSet)
         {
-            cout << "\n\t";
-            if (((x % 9) == 0) && (x > 0))
-            {
-                cout << "\n\t";
-            }
+            options.seed = 1;
+        }
+        if (options.tileWorker >= 0)
+        {
+            TileRenderer worker(options);
+            return worker.runWorker();
         }
-        cout << calcNorm[x] << ", "; 
+        if (options.tiles > 0)
+        {
+            TileRenderer tiles(options);
+            return tiles.run();
+        }
+        HeadlessBench bench(options);
+        return bench.run();
     }
-    cout << "\n\n\tTextures\n\n\n\t";
-    for (int x = 0; x < 72; x++)
+    
+    //! A play back starts from the recorded settings.
+    if (!options.replay.empty())
     {
-        if (((x % 2) == 0) && (x > 0))
+        if (!recording.open(options.replay))
         {
-            cout << "\n\t";
-            if (((x % 6) == 0) && (x > 0))
-            {
-                cout << "\n\t";
-            }
+            return 1;
         }
-        cout << calcTex[x] << ", ";
+        options.useRecording(recording.getHeader());
     }
-    cout << "\n\n";
-}
-
-int SideFogCube::main(int argc, char **argv)
-{
-    //!ClanLib uses a class internal main, nice for c++.
     
     //! Create a console window for text-output if not available
     CL_ConsoleWindow console("Console");
     console.redirect_stdio();
     
     quit = false;
+    //! The startup phases are kept only when they are served.
+    if (options.metricsPort > 0)
+    {
+        metrics = new MetricsServer();
+    }
+    //! The first frame and the pictures are timed from here.
+    chrono::steady_clock::time_point launch = chrono::steady_clock::now();
+    chrono::steady_clock::time_point since = launch;
     try
     {
         //! Initialize ClanLib base components
-        setup_core = new CL_SetupCore();
-        setup_core->init();
+        {
+            TRACE_SCOPE("CL_SetupCore");
+            setup_core = new CL_SetupCore();
+            setup_core->init();
+        }
         //! Initialize the ClanLib display component
-        setup_display = new CL_SetupDisplay();
-        setup_display->init();
+        {
+            TRACE_SCOPE("CL_SetupDisplay");
+            setup_display = new CL_SetupDisplay();
+            setup_display->init();
+        }
         //! Initilize the OpenGL drivers
-        setup_gl = new CL_SetupGL();
-        setup_gl->init();
-        glState = new CL_OpenGLState();
-        glState->set_active();
+        {
+            TRACE_SCOPE("CL_SetupGL");
+            setup_gl = new CL_SetupGL();
+            setup_gl->init();
+            glState = new CL_OpenGLState();
+            glState->set_active();
+        }
+        if (metrics != NULL)
+        {
+            metrics->addPhase({ "clanlib", chrono::duration<double>(
+            chrono::steady_clock::now() - since).count() });
+        }
+        since = chrono::steady_clock::now();
         //! Removing the true on this function will
         //! stop the program from using fullscreen.
-        window = new CL_OpenGLWindow(string("ClanLib Learn OpenGL Example"), SCR_WIDTH, SCR_HEIGHT, false);
+        {
+            TRACE_SCOPE("CL_OpenGLWindow");
+            window = new CL_OpenGLWindow(string("ClanLib Learn OpenGL Example"), SCR_WIDTH, SCR_HEIGHT, false);
+        }
         if (window == NULL)
         {
-            std::cout << "Failed to create ClanLib window" << std::endl;
+            LOG_ERROR(STARTUP, "Failed to create ClanLib window");
             setup_gl->deinit();
             setup_display->deinit();
             setup_core->deinit();
@@ -128,6 +149,7 @@ int SideFogCube::main(int argc, char **argv)
         slot_input_up = keyboardID->sig_key_up().connect(this, &SideFogCube::processInput);
         slot_input_down = keyboardID->sig_key_down().connect(this, &SideFogCube::keyDown);
         slot_mouse = mouseID->sig_pointer_move().connect(this, &SideFogCube::mouseMove);
+        slot_click = mouseID->sig_key_down().connect(this, &SideFogCube::mouseDown);
         gl_state = new CL_OpenGLState(window->get_gc()); 
         gl_state->set_active();
         if (gl_state->is_active() > 0)
@@ -138,339 +160,258 @@ int SideFogCube::main(int argc, char **argv)
         {
             value = "False";
         }
-        //! Set this to true so GLEW knows to use a modern approach to retrieving function pointers and extensions
-        glewExperimental = GL_TRUE;
-        cout << "\n\n\tThe GL state is active:  " << value << "\n";
-        GLenum err = glewInit();
-        framebufferSize(SCR_WIDTH, SCR_HEIGHT);
-        if (GLEW_OK != err)
+        LOG_DEBUG(STARTUP, "The GL state is active:  {}", value);
+        if (metrics != NULL)
+        {
+            metrics->addPhase({ "window", chrono::duration<double>(
+            chrono::steady_clock::now() - since).count() });
+        }
+        core = new RenderCore(options.count);
+        if (!core->initGL())
         {
-            cout << "\n\n\tFailed to initialize GLEW.\n";
             setup_gl->deinit();
             setup_display->deinit();
             setup_core->deinit();
             return 1;
         }
-        cout << "\n\n\tUsing GLEW Version: " << glewGetString(GLEW_VERSION) << "\n\n";
-        glEnable(GL_DEPTH_TEST);  
-        bool enabled = glIsEnabled(GL_DEPTH_TEST);
-        if (enabled)
-        {
-            cout << "\n\n\tDepth Test Enabled\n\n";
-        }
-        else
+        framebufferSize(SCR_WIDTH, SCR_HEIGHT);
+    }
+    catch(exception exc)
+    {
+        LOG_ERROR(STARTUP, "Program Initialization Error:  {}", exc.what());
+    }
+    //! Take the seed from the clock unless one was given.
+    if (!options.seedSet)
+    {
+        options.seed = (unsigned int) 
+        chrono::system_clock::now().time_since_epoch().count();
+    }
+    LOG_INFO(SCENE, "Scene seed:  {}", options.seed);
+    core->configureShaders(options.dynamicShaders, options.highPrecision);
+    core->configureViews(options.views);
+    core->configureTransparency(options.oit);
+    core->configureGpuCull(options.gpuCull);
+    core->configureMesh(options.mesh);
+    //! ClanLib makes the one context, so the drawing thread
+    //! sends the pictures the loader reads.
+    core->configureStreaming(options.streaming, launch);
+    core->enableSkybox(true);
+    if (!core->createScene(options.seed, options.threads, options.loadScene))
+    {
+        setup_core->deinit();
+        setup_display->deinit();
+        setup_gl->deinit();
+        return 1;
+    }
+    if (!options.saveScene.empty())
+    {
+        core->cloud->saveScene(options.saveScene);
+    }
+    if (metrics != NULL)
+    {
+        const vector<StartupPhase> &phases = core->getPhases();
+        for (unsigned int x = 0; x < phases.size(); x++)
         {
-            cout << "\n\n\tDepth Test Not Enabled\n\n";
+            metrics->addPhase(phases[x]);
         }
-        glDepthFunc(GL_LESS);
-        //!glFrontFace(GL_CCW);
-        glEnable(GL_CULL_FACE);
-        enabled = glIsEnabled(GL_CULL_FACE);
-        if (enabled)
+        if (!metrics->start(options.metricsPort))
         {
-            cout << "\n\n\tCull Face Enabled\n\n";
+            delete metrics;
+            metrics = NULL;
         }
-        else
+    }
+    //! The simulation runs at its own rate from here on.
+    sim = new Simulation(1000, 900, initPos, options.tickRate);
+    sim->setFeatures(options.shLighting, options.skybox, options.reflection,
+    options.depthPrepass, options.drift, options.hud);
+    sim->setViews(options.views, options.viewSpacing);
+    if (!options.replay.empty())
+    {
+        sim->setPlayer(&recording);
+    }
+    else if (!options.record.empty())
+    {
+        InputRecord::Header header = options.recordingHeader(initPos);
+        header.cubes = (uint32_t) core->cloud->getCount();
+        if (recording.create(options.record, header))
         {
-            cout << "\n\n\tCull Face Not Enabled\n\n";
+            sim->setRecorder(&recording);
         }
-        glCullFace(GL_BACK);
-        glDepthRange(0.1f, 1000.0f);
     }
-    catch(exception exc)
+    bool replaying = !options.replay.empty();
+    latency.reset(4096);
+    unsigned long lastSerial = 0;
+    governor = QualityGovernor(options.budget);
+    if (!options.capture.empty())
     {
-        cout << "\n\n\tProgram Initialization Error:  " << exc.what() << "\n\n";
+        capture = new FrameCapture(options.capture, options.captureRaw
+        ? FrameCapture::FORMAT_RAW : FrameCapture::FORMAT_PNG,
+        options.captureFirst, options.captureCount);
     }
-    camera = new Camera(1000, 900, initPos);
-    //! Define and compile the shaders.
-    shader = new Shader();
-    shader->initShader(string("fogvec.glsl"),
-    string("fogfrag.glsl"), string("objshader.bin"));
-    //! Set the background image.
-    image = new CreateImage();
-    image->setImage("container.png");
-    texture1 = image->textureObject();
-    //! Set the foreground images.
-    image->create2DTexArray(texImages, imageNames);
-    //! Define the locations and image indices.
-    permLoc();
-    //! Generate the object.
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(4, VBO);
-    //! 1. Bind the Vertex Array Object.
-    glBindVertexArray(VAO);
-    //! 2. copy our vertices arrays into the buffers for OpenGL to use.
-    //! Position attribute
-    glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(calcCube), calcCube, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    //! Normal attribute.
-    glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(calcNorm), calcNorm, GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    //! Texture attribute.
-    glBindBuffer(GL_ARRAY_BUFFER, VBO[2]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(calcTex), calcTex, GL_STATIC_DRAW);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(2);
-    //! Uniform buffer to feed the uniform.
-    dataIndex = glGetUniformBlockIndex(shader->Program, "itemData");   
-    glUniformBlockBinding(shader->Program, dataIndex, 0);
-    glBindBuffer(GL_UNIFORM_BUFFER, VBO[3]);
-    glBufferData(GL_UNIFORM_BUFFER, sizeof(itemData), (void*)&itemData, GL_DYNAMIC_DRAW);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-    glBindVertexArray(0);
-    glBindBufferBase(GL_UNIFORM_BUFFER, 0, dataIndex);
-    glBindBufferRange(GL_UNIFORM_BUFFER, 0, VBO[3], 0, sizeof(itemData));
-    //! Variables for the event loop.
-    int degrees = 0;
-    degrees = (int)
-    //! Initialize the random number generator.
-    chrono::system_clock::now().time_since_epoch().count();
-    degrees = abs(degrees);
-    srand(degrees);
-    //! Grab a time to count degrees by the clock.
-    start = chrono::system_clock::now();
+    long frameNumber = 0;
+    chrono::steady_clock::time_point lastFrame = chrono::steady_clock::now();
+    sim->start();
     //! render loop
     //! ----------
-    float radius = 10.0f;
-    int count = 0;
     while (!CL_Keyboard::get_keycode(CL_KEY_ESCAPE) && !quit)
     {
-        //! Grab a time to adjust camera speed.
-        intbegin  = chrono::system_clock::now();
-        //! Reset the model.
-        model = mat4(1.0f);
-        //! Find the camera.
-        projection = camera->GetPerspective();
-        view = camera->GetViewMatrix(); //! render
-        viewPos = camera->GetPosition();
-
-        float camX = sin((double)degrees * onedegree) * radius * 1.5f;
-        float camZ = cos((double)degrees * onedegree) * radius * 1.5f;
-        //! ------ Count degrees rotated.
-        end = chrono::system_clock::now();
-        degrees = (int) chrono::duration_cast<chrono::milliseconds>(end - start).count();
-        degrees /= 10;
-        degrees %= 360;
-        //! Use the shaders.
-        vec4 color = vec4(0.3f, 0.3f, 0.3f, 0.5f); 
-        glClearColor(color.r, color.g, color.b, color.a);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        shader->Use();
-        //! We have a fog toggle on the space key.
-        shader->setBool("foggy", foggy);
-        //! Start feeding in the buffer data.
-        glBindVertexArray(VAO);
-        //! Initialize the lighting system.
-        string uniname = "";
-        string index = "";
-        for(unsigned int i = 0; i < NUM_LIGHTS; i++)
-        {
-            stringstream ss;
-            ss << i; 
-            index = ss.str(); 
-            uniname = "lighting[" + index + "].lightPos";
-            shader->setVec3(uniname.c_str(), lighting[i].lightPos);
-            uniname = "lighting[" + index + "].lightColor";
-            shader->setVec4(uniname.c_str(), lighting[i].lightColor);
-        }  
-
-        viewPos = camera->GetPosition();
-        //! Sort the locations based on the current camera
-        //! position.
-        sortDists(degrees);
-        //! Set the crate background.
-        glActiveTexture(GL_TEXTURE0); 
-        glBindTexture(GL_TEXTURE_2D, texture1);
-        shader->setInt("cratetex", 0);
-        //! Set the foreground images.
-        glActiveTexture(GL_TEXTURE1); 
-        glBindTexture(GL_TEXTURE_2D_ARRAY, texImages);
-        shader->setInt("tex", 1);
-        //! Pass in the necessary uniforms.
-        shader->setMat4("projection", projection);
-        shader->setMat4("view", view);
-        shader->setVec3("viewPos", viewPos);
-        shader->setVec4("fogColor", vec4(0.3f, 0.3f, 0.3f, 1.0f));
-        //! Fog is variable based on the right arrow 
-        //! and left arrow keys.
-        shader->setFloat("fogMinDist", minfog);
-        shader->setFloat("fogMaxDist", maxfog);
-        glBindBuffer(GL_UNIFORM_BUFFER, VBO[3]);
-        //! Pass the image indices and cube distances.
-        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(itemData), (void*) &itemData); 
-        glBindBuffer(GL_UNIFORM_BUFFER, 0);    
-        //! Use the instancing feature to create 
-        //! multiple copies of each set of images.
-        for (int x = 0; x < NUM_IMAGES; x++)
-        {
-            shader->setInt("repetition", x);
-            int beginvert = 0;
-            int sides = 6;
-            //! Call for each image one side at a time.
-            for (int side = 0; side < 6; side++)
+        TRACE_SCOPE("loop");
+        //! Blend the newest simulation states for now.
+        FrameParams params;
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        sim->interpolate(now, params);
+        params.cull = options.cull;
+        //! The whole loop counts against the budget,
+        //! the flip included.
+        double frameMs = chrono::duration<double, milli>(now - lastFrame).count();
+        governor.frameDone(frameMs);
+        lastFrame = now;
+        governor.apply(params);
+        core->renderFrame(params);
+        //! The cubes drawn wait on the GPU cull, so they are
+        //! counted only a few times a second.
+        if (metrics != NULL)
+        {
+            metrics->loadTimes(core->getFirstFrameSeconds(), core->getLoadedSeconds());
+            metrics->frameDone(frameMs, core->getCpuMs(),
+            metrics->countsDue() ? core->getDrawn() : -1, core->cloud->getCount(),
+            core->getDrawCalls(), core->getUploadBytes(), core->getTextureBytes());
+        }
+        //! The cube under the cursor, in the frame just drawn.
+        if (pickWanted)
+        {
+            pickWanted = false;
+            float distance = 0.0f;
+            chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+            int cube = core->pick(params, xpos, ypos, distance);
+            double us = chrono::duration<double, micro>(chrono::steady_clock::now() - begin).count();
+            if (cube < 0)
             {
-                shader->setInt("side", side);
-                glDrawArraysInstanced(GL_TRIANGLES, beginvert, sides, NUM_INSTANCES);
-                beginvert += sides;
-            
+                LOG_INFO(INPUT, "No cube under the cursor, found in {} us.", us);
             }
-        }
-        //! Uncomment this to get a listing of the 
-        //! uniforms recognized by the shaders.
-        //!UniformPrinter printer2(shader->Program);
-        glBindVertexArray(0); 
-        intend = chrono::system_clock::now();
-        //! Swap buffers
-        CL_Display::flip();
-        CL_System::keep_alive();
-    }
-
-    //! ------------------------------------------------------------------
-    setup_core->deinit();
-    setup_display->deinit();
-    setup_gl->deinit();
-    return 0;
-}
-
-void SideFogCube::permLoc()
-{
-    //! Calculate the location and indices.
-    PosOrient *locItem;
-    //! Random angle for each instance, compute the MVP later
-    for (int x = 0; x < NUM_IMAGES * NUM_INSTANCES; x++)
-    {
-        loc[x] = vec3(calcRand(x), calcRand(x), calcRand(x) - 15.0f);
-    
-        for (int y = 0; y < x; y++)
-        {
-            //! Check for collision and correct if necessary.
-            if (distance(loc[x], loc[y]) < 1.50)
+            else
             {
-                loc[x] = vec3(calcRand(x), calcRand(x), calcRand(x) - 15.0f);
-                //! Reset the loop so the system can check  
-                //! if it is an acceptable location.
-                y = 0;
+                LOG_INFO(INPUT, "Picked cube {}, {} away, found in {} us.", cube, distance, us);
             }
         }
-        //! Find the spin axis.
-        xaxis[x] = vec3(calcRand(1), calcRand(1), calcRand(1));
-        normalize(xaxis[x]);
-        yaxis[x] = vec3(calcRand(1), calcRand(1), calcRand(1));
-        normalize(yaxis[x]);
-        angles[x] = randAxis();
-        //! Create a new data item.
-        locItem = new PosOrient();
-        locItem->locon = loc[x];
-        locItem->angles = angles[x];
-        locItem->xaxis = xaxis[x];
-        locItem->yaxis = yaxis[x];
-        locItem->dist = 0;
-        //! Calculate six image indices.
-        for (int y = 0; y < 6; y++)
+        //! The back buffer is read before it is swapped.
+        if (capture != NULL)
         {
-            locItem->index[y] = rand() % NUM_IMAGES;
+            capture->frameDone(frameNumber, SCR_WIDTH, SCR_HEIGHT);
         }
-        //! Add the item to the collection.
-        distVals.push_back(*locItem);
-    }
-}
-
-//! ---------------------------------------------------------------------------------------------------------
-void SideFogCube::keyDown(const CL_InputEvent &key)
-{
-    int delta = (int)
-    //! Use timing to create a cameraSpeed variable.
-    chrono::duration_cast<chrono::nanoseconds>(intend -
-    intbegin).count();
-    float deltaTime = (float)delta / 10000000.0f;
-    float cameraSpeed = 0.5f * deltaTime;
-    //! Toggle the fog.
-    if (key.id == CL_KEY_SPACE)
-    {
-        foggy = !foggy;
-        if (foggy)
+        frameNumber++;
+        //! Swap buffers
         {
-            shader->setInt("foggy", foggy);
+            TRACE_SCOPE("flip");
+            CL_Display::flip();
         }
-        else
+        //! The first frame after new input shows it.
+        const Simulation::Snapshot &snap = sim->snapshot();
+        if (replaying && (snap.tick >= recording.getHeader().ticks))
         {
-            shader->setInt("foggy", foggy);
+            LOG_INFO(INPUT, "The recorded session is over.");
+            replaying = false;
         }
+        if (snap.inputSerial != lastSerial)
+        {
+            lastSerial = snap.inputSerial;
+            latency.addFrame(chrono::duration<double, milli>(
+            chrono::steady_clock::now() - snap.inputStamp).count());
+        }
+        CL_System::keep_alive();
     }
-    //! Motion keys.
-    if (key.id == CL_KEY_W)
-    {
-        camera->ProcessKeyboard(Camera::Camera_Movement::FORWARD, cameraSpeed);
-    }
-    if (key.id == CL_KEY_S)
-    {
-        camera->ProcessKeyboard(Camera::Camera_Movement::BACKWARD, cameraSpeed);
-    }
-    if (key.id == CL_KEY_A)
-    {
-        camera->ProcessKeyboard(Camera::Camera_Movement::LEFT, cameraSpeed);
-    }
-    if (key.id == CL_KEY_D)
-    {
-        camera->ProcessKeyboard(Camera::Camera_Movement::RIGHT, cameraSpeed);
-    }
-    if (key.id == CL_KEY_R)
-    {
-        camera->ProcessKeyboard(Camera::Camera_Movement::UP, cameraSpeed);
-    }
-    if (key.id == CL_KEY_F)
+    sim->stop();
+    if (metrics != NULL)
     {
-        camera->ProcessKeyboard(Camera::Camera_Movement::DOWN, cameraSpeed);
+        metrics->stop();
     }
-    //! Reset the camera.
-    if (key.id == CL_KEY_Z)
+    //! The reports follow the messages before them.
+    Logger::instance().flush();
+    if (capture != NULL)
     {
-        camera->resetCamera();
-        
+        capture->finish();
     }
-    //! Zoom keys.
-    if (key.id == CL_KEY_UP)
+    if (!options.record.empty())
     {
-        camera->ProcessMouseScroll(Camera::Camera_Movement::CLOSER);
+        recording.finish(sim->ticks());
     }
-    if (key.id == CL_KEY_DOWN)
+    if (latency.count() > 0)
     {
-        camera->ProcessMouseScroll(Camera::Camera_Movement::AWAY);
+        cout << fixed << setprecision(3)
+        << "\n\n\tInput to display latency, " << latency.count() << " inputs"
+        << "\n\tMean ms:      " << latency.mean()
+        << "\n\tp50 ms:       " << latency.percentile(50.0)
+        << "\n\tp99 ms:       " << latency.percentile(99.0)
+        << "\n\tMax ms:       " << latency.percentile(100.0)
+        << "\n\tDropped:      " << sim->dropped() << "\n\n";
+        cout.unsetf(ios_base::floatfield);
     }
-    //! Fog distance keys.
-    if (key.id == CL_KEY_RIGHT)
+
+    //! ------------------------------------------------------------------
+    setup_core->deinit();
+    setup_display->deinit();
+    setup_gl->deinit();
+    return 0;
+}
+
+//! ---------------------------------------------------------------------------------------------------------
+void SideFogCube::keyDown(const CL_InputEvent &key)
+{
+    postKey(key, Simulation::ACTION_DOWN);
+}    
+
+void SideFogCube::postKey(const CL_InputEvent &key, Simulation::Event_Type type)
+{
+    Simulation::InputEvent event;
+    event.type = type;
+    event.xoffset = event.yoffset = 0.0f;
+    event.stamp = chrono::steady_clock::now();
+    switch (key.id)
     {
-        minfog += 1.0f;
-        maxfog += 1.0f;
-        if (maxfog > 60.0f)
-        {
-            maxfog = 60.0f;
-            minfog = 35.0f;
-        }
+        //! Toggle the fog.
+        case CL_KEY_SPACE: event.action = Simulation::TOGGLE_FOG; break;
+        //! Toggle the performance display.
+        case CL_KEY_H: event.action = Simulation::TOGGLE_HUD; break;
+        //! Motion keys.
+        case CL_KEY_W: event.action = Simulation::FORWARD; break;
+        case CL_KEY_S: event.action = Simulation::BACKWARD; break;
+        case CL_KEY_A: event.action = Simulation::LEFT; break;
+        case CL_KEY_D: event.action = Simulation::RIGHT; break;
+        case CL_KEY_R: event.action = Simulation::UP; break;
+        case CL_KEY_F: event.action = Simulation::DOWN; break;
+        //! Toggle the spherical harmonic lighting.
+        case CL_KEY_L: event.action = Simulation::TOGGLE_LIGHTING; break;
+        //! Toggle the skybox, and its reflection in the cubes.
+        case CL_KEY_K: event.action = Simulation::TOGGLE_SKYBOX; break;
+        case CL_KEY_M: event.action = Simulation::TOGGLE_REFLECTION; break;
+        //! Toggle the depth pass before the shading.
+        case CL_KEY_P: event.action = Simulation::TOGGLE_PREPASS; break;
+        //! Toggle the drift of the cubes.
+        case CL_KEY_B: event.action = Simulation::TOGGLE_DRIFT; break;
+        //! Reset the camera.
+        case CL_KEY_Z: event.action = Simulation::RESET_CAMERA; break;
+        //! Zoom keys.
+        case CL_KEY_UP: event.action = Simulation::ZOOM_IN; break;
+        case CL_KEY_DOWN: event.action = Simulation::ZOOM_OUT; break;
+        //! Fog distance keys.
+        case CL_KEY_RIGHT: event.action = Simulation::FOG_FARTHER; break;
+        case CL_KEY_LEFT: event.action = Simulation::FOG_NEARER; break;
+        default: return;
     }
-    if (key.id == CL_KEY_LEFT)
+    if (sim != NULL)
     {
-        minfog -= 1.0f;
-        maxfog -= 1.0f;
-        if (minfog < 0.1f)
-        {
-            minfog = 0.1f;
-            maxfog = 25.0f;
-        }
+        sim->post(event);
     }
-}    
+}
 
 void SideFogCube::processInput(const CL_InputEvent &key)
 {
-    cout << "\n\n\tIn processInput.  " << key.str << "\n\n";
+    LOG_TRACE(INPUT, "In processInput.  {}", key.str);
     if(key.id == CL_KEY_ESCAPE)
     {
         quit = true;
     }
+    postKey(key, Simulation::ACTION_UP);
 }
 
 void SideFogCube::mouseMove(const CL_InputEvent &key)
@@ -487,293 +428,41 @@ void SideFogCube::mouseMove(const CL_InputEvent &key)
         firstMouse = false;
     }
   
-    float xoffset = xpos - lastX;
-    float yoffset = lastY - ypos; 
+    Simulation::InputEvent event;
+    event.type = Simulation::LOOK;
+    event.action = 0;
+    event.xoffset = xpos - lastX;
+    event.yoffset = lastY - ypos; 
+    event.stamp = chrono::steady_clock::now();
     lastX = xpos;
     lastY = ypos;
-    camera->ProcessMouseMovement(xoffset, yoffset);
-    
-}    
-
-//! ---------------------------------------------------------------------------------------------
-void SideFogCube::framebufferSize(int width, int height)
-{
-    //! make sure the viewport matches the new window dimensions; note that width and 
-    //! height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
-    //! Set a videomode - 640x480
-}
-
-void SideFogCube::windowClose()
-{
-    cout << "\n\n\tIn on_window_close.\n\n";
-    quit = true;
-}
-
-void SideFogCube::genMatrices()
-{
-    //! We generate three matrices:  the vertices of the cube,
-    //! the normals and the texture coordinates.
-    vec3 triangle[3];
-    vec3 normal[3];
-    vec2 texture[3];
-    int countTex = 0, countNorm = 0;
-    for (int x = 0; x < 36; x+= 3)
+    if (sim != NULL)
     {
-        for (int y = 0; y < 3; y++)
-        {
-            triangle[y] = vec3(0.0f);
-            normal[y] = vec3(0.0f);
-            texture[y] = vec2(0.0f);
-        }
-        for (int y = 0; y < 3; y++)
-        {
-            triangle[0][y] = cube[(indices[x] * 3) + y];
-            triangle[1][y] = cube[((indices[x + 1] * 3) + y)];
-            triangle[2][y] = cube[((indices[x + 2]* 3) + y)];
-        }
-
-        if (((triangle[0].x == triangle[1].x)
-        && (triangle[0].x == triangle[2].x)
-        && (triangle[1].x == triangle[2].x)) 
-        && (triangle[0].x > 0.0f))
-        {
-            for (int y = 0; y < 3; y++)
-            {
-                normal[y] = normals[0];
-                texture[y] = genTexture(normal[y], triangle[y]);
-            }
-        }
-        else if (((triangle[0].x == triangle[1].x)
-        && (triangle[0].x == triangle[2].x)
-        && (triangle[1].x == triangle[2].x)) 
-        && (triangle[0].x < 0.0f))
-        {
-            for (int y = 0; y < 3; y++)
-            {
-                normal[y] = normals[3];
-                texture[y] = genTexture(normal[y], triangle[y]);
-            }
-        }
-        else if (((triangle[0].y == triangle[1].y)
-        && (triangle[0].y == triangle[2].y)
-        && (triangle[1].y == triangle[2].y)) 
-        && (triangle[0].y > 0.0f))
-        {
-            for (int y = 0; y < 3; y++)
-            {
-                normal[y] = normals[1];
-                texture[y] = genTexture(normal[y], triangle[y]);
-            }
-        }
-        else if (((triangle[0].y == triangle[1].y)
-        && (triangle[0].y == triangle[2].y)
-        && (triangle[1].y == triangle[2].y)) 
-        && (triangle[0].y < 0.0f))
-        {
-            for (int y = 0; y < 3; y++)
-            {
-                normal[y] = normals[4];
-                texture[y] = genTexture(normal[y], triangle[y]);
-            }
-        }
-        else if (((triangle[0].z == triangle[1].z)
-        && (triangle[0].z == triangle[2].z)
-        && (triangle[1].z == triangle[2].z)) 
-        && (triangle[0].z > 0.0f))
-        {
-            for (int y = 0; y < 3; y++)
-            {
-                normal[y] = normals[2];
-                texture[y] = genTexture(normal[y], triangle[y]);
-            }
-        }
-        else if (((triangle[0].z == triangle[1].z)
-        && (triangle[0].z == triangle[2].z)
-        && (triangle[1].z == triangle[2].z)) 
-        && (triangle[0].z < 0.0f))
-        {
-            for (int y = 0; y < 3; y++)
-            {
-                normal[y] = normals[5];
-                texture[y] = genTexture(normal[y], triangle[y]);
-            }
-        }
-/*
-        cout << "\n\n\t\tTriangle Vertices\n\n\t";
-        for (int z = 0; z < 3; z++)
-        {
-            cout << "\n\tTriangle " << z << " : " << triangle[z].x
-            << ", " << triangle[z].y << ", " << triangle[z].z;
-        }
-*/
-        int count = 0;
-        for (int z = 0; z < 3; z++)
-        {
-            //!cout << "\n\tTriangle x,y,z ";
-            //!cout << "\n\tNormal x,y,z  + Echo x,y,z ";
-            for (int y = 0; y < 3; y++)
-            {
-                calcNorm[countNorm] = normal[z][y];
-                calcCube[countNorm] = triangle[z][y];
-                //!cout << triangle[z][y] << ", ";
-                //!cout << normal[z][y] << ", " << calcNorm[countNorm] 
-                //!<< " : " << countNorm << " : ";
-                countNorm++;
-            }
-            for (int y = 0; y < 2; y++)
-            {
-                calcTex[countTex] = texture[z][y];
-                countTex++;
-            }
-        }
-        //!cout << "\n\n";
+        sim->post(event);
     }
-}
-vec2 SideFogCube::genTexture(vec3 normal, vec3 triangle)
-{
-    //!Texture coordinates are generated seperately.
-    vec2 texture;
-    if (normal.x != 0.0f)
-    {
-        if (triangle.y > 0.0f)
-        {   
-            texture.x = 1.0f;
-        }
-        else
-        {
-            texture.x = 0.0f;
-        }
-        if (triangle.z > 0.0f)
-        {   
-            texture.y = 1.0f;
-        }
-        else
-        {
-            texture.y = 0.0f;
-        }
-    }
-    else if (normal.y != 0.0f)
-    {
     
-        if (triangle.x > 0.0f)
-        {   
-            texture.x = 1.0f;
-        }
-        else
-        {
-            texture.x = 0.0f;
-        }
-        if (triangle.z > 0.0f)
-        {   
-            texture.y = 1.0f;
-        }
-        else
-        {
-            texture.y = 0.0f;
-        }
-    }
-    else if (normal.z != 0.0f)
-    {
-        if (triangle.x > 0.0f)
-        {   
-            texture.x = 1.0f;
-        }
-        else
-        {
-            texture.x = 0.0f;
-        }
-        if (triangle.y > 0.0f)
-        {   
-            texture.y = 1.0f;
-        }
-        else
-        {
-            texture.y = 0.0f;
-        }
-    }
-    return texture;
-}
+}    
 
-float SideFogCube::calcRand(int x)
+void SideFogCube::mouseDown(const CL_InputEvent &key)
 {
-    //! Random number for x,y,z values for cube location.
-    const float MAXLOC = 25.0f;
-    float item = 1000.0f;
-    if (x == 0) 
+    //! The next frame finds the cube under the cursor.
+    if (key.id == CL_MOUSE_LEFT)
     {
-        x = 1;
+        pickWanted = true;
     }
-    while ((item < -MAXLOC) || (item > MAXLOC) || (item == 0))
-    {
-        float dividend = (float) (rand() % 100);
-        float divisor = float(rand() % 100);
-        while (divisor == 0.0f)
-        {
-            divisor = float(rand() % 100);
-        }
-        float scalar = dividend / (divisor + 1.0f);
-        float sign = rand() % 10;
-        if (sign < 5)
-        {
-            sign = -1.0f;
-        }
-        else
-        {
-            sign = 1.0f;
-        }
-        item = sign * scalar * (float)(rand() % (int)MAXLOC);
-        while (abs(item) > MAXLOC)
-        {
-            item /= 2.0f;
-        }
-    }
-    return item;
 }
 
-float SideFogCube::randAxis()
+//! ---------------------------------------------------------------------------------------------
+void SideFogCube::framebufferSize(int width, int height)
 {
-    //! a random axis for cube rotation.
-        float onedegree = 3.14159 / 180.0f;
-        float result = (float)(rand() % 5);
-        while (result == 0)
-        {
-            result = (float)(rand() % 5);
-        }
-        result *= onedegree;
-        return result;
-}
-
-//! Less than operator for stable_sort.
-bool SideFogCube::cmp(const PosOrient &a, const PosOrient &b)
-{   
-    return a.dist > b.dist;
+    //! The viewport belongs to the render core.
+    core->framebufferSize(width, height);
 }
 
-
-void SideFogCube::sortDists(int degrees)
+void SideFogCube::windowClose()
 {
-    for (int x = 0; x < NUM_INSTANCES * NUM_IMAGES; x++)
-    {
-        distVals[x].dist = distance(distVals[x].locon, viewPos);
-        //!cout << "\n\n\tDistance: " << x << " : " << distVals[x].dist;
-    }
-    //! Sort uses the algorithm library.
-    sort(distVals.begin(), distVals.end(), cmp);
-    //! Create the data for the distVals data structure.
-    for (int x = 0; x < NUM_IMAGES * NUM_INSTANCES; x++)
-    {
-        mat4 model = mat4(1.0f);
-        model = translate(model, distVals[x].locon)
-        * rotate(model, (float) degrees * distVals[x].angles * 2.0f, distVals[x].xaxis) 
-        * rotate(model, (float) degrees * distVals[x].angles, distVals[x].yaxis);
-        itemData.instModel[x] = model;
-        //! Pass the uniform buffer data to the 
-        //! itemData data structure.
-        itemData.instIndex1[x] = vec4(distVals[x].index[0], distVals[x].index[1], distVals[x].index[2], distVals[x].index[3]);
-        itemData.instIndex2[x] = vec2(distVals[x].index[4], distVals[x].index[5]);
-        itemData.distance[x].x = distVals[x].dist;
-    }
+    LOG_DEBUG(INPUT, "In on_window_close.");
+    quit = true;
 }
 
 //! A peculiarity of ClanLib, the class creates itself.
@@ -8,10 +8,17 @@
 #define SIDEFOGCUBE_H
 
 #include "commonheader.h"
-#include "shader.h"
-#include "createimage.h"
-#include "camera.h"
-#include "uniformprinter.h"
+#include "options.h"
+#include "rendercore.h"
+#include "headlessbench.h"
+#include "tilerenderer.h"
+#include "framestats.h"
+#include "qualitygovernor.h"
+#include "simulation.h"
+#include "framecapture.h"
+#include "metricsserver.h"
+#include "logger.h"
+#include "tracer.h"
 
 /** \class SideFogCube 
  * The class that creates a cloud of 
@@ -38,37 +45,32 @@ private:
     CL_InputDevice *mouseID;
     CL_OpenGLState *glState;
     
-    //! The Shader class to manage the shaders.
-    Shader *shader, *skyBoxShader;
+    //! The OpenGL resources and drawing of the cubes.
+    RenderCore *core;
     
-    //! The CreateImage class to create textures.
-    CreateImage *image;
+    //! The command line arguments.
+    Options options;
     
-    //! The Camera class to manage frustum and camera
-    //! movement.
-    Camera *camera;
+    //! Moves the camera and spins the cubes on a thread
+    //! of its own.
+    Simulation *sim;
     
-    /** \brief debug
-     * Allows for examination of the generated
-     * cube data.
-     */
-    void debug();
+    //! Time from an input event to the first frame
+    //! showing it.
+    FrameStats latency;
     
-    /** \brief permLoc 
-     * Creates the location, orientation, spin and 
-     * image index information.
-     */
-    void permLoc();
+    //! Holds the frame time to the --budget.
+    QualityGovernor governor;
     
-    /** \brief genMatrices 
-     * Generates the cube object.
-     */
-    void genMatrices();
+    //! The session being recorded or played back.
+    InputRecord recording;
     
-    /** \brief genTexture 
-     * Generates the texture coodinates.
-     */
-    vec2 genTexture(vec3 normal, vec3 triangle);
+    //! Saves the frames asked for with --capture.
+    FrameCapture *capture;
+    
+    //! Serves the render statistics asked for with
+    //! --metrics-port.
+    MetricsServer *metrics;
     
     /** \brief frameBufferSize 
      * Calls the OpenGl function to size the framebuffer.
@@ -85,60 +87,38 @@ private:
      */
     void keyDown(const CL_InputEvent &key);
     
+    /** \brief postKey
+     * Sends the action for a key to the simulation.
+     */
+    void postKey(const CL_InputEvent &key, Simulation::Event_Type type);
+    
     /** \brief mouseMove
      * Handles mouse motion.
      */
 	void mouseMove(const CL_InputEvent &key);
     
+    /** \brief mouseDown
+     * Picks the cube under the cursor on a left click.
+     */
+    void mouseDown(const CL_InputEvent &key);
+    
     /** \brief windowClose
      * Handles when you click the little box one the corner
      * of the window.  But this program is set to be fullscreen.
      */
     void windowClose();
     
-    /** \brief calcRand
-     * Calculates a random variable to be part of a 
-     * location coordinate for a cube.
-     */
-    float calcRand(int x);
-    
-    /** \brief randAxis
-     * Calculates a random axis for the cube to spin on.
-     */
-    float randAxis();
-    
-    /** \brief sortDists
-     * Sorts the distances from the camera so the furthest
-     * are drawn first and the nearest are drawn last.
-     * Also packs the data arrays going to the shaders.
-     */
-    void sortDists(int degrees);
-    
-    /** \brief cmp
-     * A function to define what is greater than and 
-     * what is less than for our data structure (sorted 
-     * on distance).
-     */
-    static bool cmp(const PosOrient &a, const PosOrient &b);
     //! settings
     //! Change this to suite your monitor.
     const unsigned int SCR_WIDTH = 1280;
     const unsigned int SCR_HEIGHT = 1024;
-    //! We have a light at each corner of the cloud of cubes.
-    static const unsigned int NUM_LIGHTS = 8;
     //! Various booleans.
-    bool quit, add, firstMouse, foggy = true;
+    bool quit, add, firstMouse, pickWanted;
     string value;
-    vec3 viewPos;
     const vec3 initPos = vec3(0.0f, 0.0f, 20.0f);
-    mat4 model, view, projection;
     float xpos, ypos, lastX, lastY;
-    //! For  conversion from degrees to radians.
-    const float onedegree = (float) acos(-1) / 180.0f;
-    unsigned int VBO[4], VAO, minfog = 0.1f, maxfog = 25.0f; 
-    unsigned int texture1, texture2, dataIndex;
     CL_Slot slot_quit, slot_input_up, slot_input_down, 
-    slot_mouse, slot_roll;
+    slot_mouse, slot_roll, slot_click;
     //! Initialize ClanLib base components
     CL_SetupCore *setup_core;
 
@@ -148,84 +128,6 @@ private:
     //! Initialize the OpenGL drivers
     CL_SetupGL *setup_gl;
     CL_OpenGLState *gl_state;
-    //! Define the lights for the shaders.
-    Lights lighting[NUM_LIGHTS];
-    //! A vector to hold the array of location data.
-    vector<PosOrient>distVals;
-    /** The individual arrays that go into distVals.
-     * The items must all be moved together for
-     * each cube, which is why they are placed in 
-     * distVals.
-     */
-    vec3 loc[NUM_INSTANCES * NUM_IMAGES];
-    vec3 xaxis[NUM_INSTANCES * NUM_IMAGES];
-    vec3 yaxis[NUM_INSTANCES * NUM_IMAGES];
-    float angles[NUM_INSTANCES * NUM_IMAGES];
-    //! The data for the shader uniform. For
-    //! it's definition see commonheader.h.
-    InstData itemData;
-    //! The calculated information for the cube.
-    float calcTex[72];
-    float calcNorm[108];
-    float calcCube[108];
-    //! The pointer for the texture2DArray.
-    unsigned int texImages;
-    //! The images used in the images directory.
-    string imageNames[NUM_IMAGES] =
-    {
-        "awesomeface.png", "eucharist.png", 
-        "palette.png", "panda.png",
-        "seahorse.png", "sparkle.png", 
-        "star.png", "sunflowers.png",
-        "superman.png", "paris.png",
-        "grapes.png", "lemon.png",
-        "sun.png", "mexican.png",
-        "abstract.png", "suites.png"
-    };
-    //! Timing for the animation and the camera.
-    chrono::_V2::system_clock::time_point end, start;
-    chrono::_V2::system_clock::time_point intbegin, intend;
-    
-    //!---------------------------------------------------------
-    //! set up vertex data (and buffer(s)) and configure 
-    //! vertex attributes
-    //!---------------------------------------------------------
-            // Vertex        //Color
-    float cube[56] = {
-         0.5f,  0.5f,  0.5f, //0
-        -0.5f,  0.5f,  0.5f, //1
-        -0.5f, -0.5f,  0.5f, //2
-         0.5f, -0.5f,  0.5f, //3
-         0.5f, -0.5f, -0.5f, //4
-         0.5f,  0.5f, -0.5f, //5
-        -0.5f,  0.5f, -0.5f, //6
-        -0.5f, -0.5f, -0.5f  //7
-    };
-    vec3 normals[6] {
-         vec3( 1.0f,   0.0f,  0.0f),
-         vec3( 0.0f,   1.0f,  0.0f),
-         vec3( 0.0f,   0.0f,  1.0f),
-         vec3(-1.0f,   0.0f,  0.0f),
-         vec3( 0.0f,  -1.0f,  0.0f),
-         vec3( 0.0f,   0.0f, -1.0f)
-    };
-    
-    /** This array shows the order of processing
-     * for each vertex in the cube array.  The cube 
-     * array defines each corner of the cube.  The
-     * indices array allows the genMatrices function 
-     * to generate a cube from the eight vertices. 
-     * Each face of the cube has two triangles
-     * or six vertices and there are six faces.
-     */
-    unsigned int indices[NUM_VERTICES] = {
-        0, 1, 2, 0, 2, 3,
-        0, 3, 4, 0, 4, 5,
-        0, 5, 6, 0, 6, 1,
-        7, 1, 6, 7, 2, 1,
-        7, 5, 4, 7, 6, 5,
-        7, 3, 2, 7, 4, 3
-    };
 };
 
 #endif // SIDEFOGCUBE_H
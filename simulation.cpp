@@ -0,0 +1,398 @@
+/*******************************************************************
+ * Simulation:  A class to advance the spin of the cubes and the
+ * camera at a fixed rate on a thread of its own, apart from
+ * the drawing.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "simulation.h"
+
+Simulation::Simulation(int width, int height, vec3 position, double tickRate)
+{
+    LOG_DEBUG(STARTUP, "Creating Simulation.");
+    simCamera = new Camera(width, height, position);
+    viewCamera = new Camera(width, height, position);
+    tickSeconds = 1.0 / tickRate;
+    tickLength = chrono::duration_cast<chrono::steady_clock::duration>(
+    chrono::duration<double>(tickSeconds));
+    running.store(false);
+    lost.store(0);
+    tick = 0;
+    inputSerial = 0;
+    recorder = NULL;
+    player = NULL;
+    epoch = chrono::steady_clock::time_point();
+    for (int x = 0; x < NUM_ACTIONS; x++)
+    {
+        held[x] = false;
+    }
+    foggy = true;
+    minfog = 0.1f;
+    maxfog = 25.0f;
+    shLighting = false;
+    skybox = true;
+    reflection = false;
+    depthPrepass = false;
+    drift = false;
+    hud = false;
+    viewCount = 1;
+    viewSpacing = 0.0f;
+}
+
+Simulation::~Simulation()
+{
+    LOG_DEBUG(STARTUP, "Destroying Simulation.");
+    stop();
+    delete simCamera;
+    delete viewCamera;
+}
+
+void Simulation::setFeatures(bool shLighting, bool skybox, bool reflection, bool depthPrepass,
+bool drift, bool hud)
+{
+    this->shLighting = shLighting;
+    this->skybox = skybox;
+    this->reflection = reflection;
+    this->depthPrepass = depthPrepass;
+    this->drift = drift;
+    this->hud = hud;
+}
+
+void Simulation::setViews(int count, float spacing)
+{
+    viewCount = count;
+    viewSpacing = spacing;
+}
+
+void Simulation::start()
+{
+    if (running.load())
+    {
+        return;
+    }
+    //! The first snapshot is ready before the first frame.
+    publishFirst(chrono::steady_clock::now());
+    running.store(true);
+    worker = thread(&Simulation::run, this);
+}
+
+void Simulation::startStepped()
+{
+    publishFirst(epoch);
+}
+
+void Simulation::advance(double seconds)
+{
+    //! Counting from the epoch keeps the ticks from
+    //! drifting against the frames.
+    while ((double) (tick + 1) * tickSeconds <= seconds)
+    {
+        publishTick(epoch + tickLength * (tick + 1));
+    }
+}
+
+chrono::steady_clock::time_point Simulation::simulatedTime(double seconds)
+{
+    return epoch + chrono::duration_cast<chrono::steady_clock::duration>(
+    chrono::duration<double>(seconds));
+}
+
+void Simulation::setRecorder(InputRecord *recorder)
+{
+    this->recorder = recorder;
+}
+
+void Simulation::setPlayer(InputRecord *player)
+{
+    this->player = player;
+}
+
+unsigned long Simulation::ticks()
+{
+    return tick;
+}
+
+void Simulation::publishFirst(chrono::steady_clock::time_point due)
+{
+    Snapshot &first = snapshots.writeBuffer();
+    first.tick = tick;
+    capture(first.current);
+    first.previous = first.current;
+    first.due = due;
+    first.inputSerial = inputSerial;
+    first.inputStamp = due;
+    snapshots.publish();
+}
+
+void Simulation::publishTick(chrono::steady_clock::time_point due)
+{
+    Snapshot &snap = snapshots.writeBuffer();
+    capture(snap.previous);
+    step();
+    capture(snap.current);
+    snap.tick = tick;
+    snap.due = due;
+    snap.inputSerial = inputSerial;
+    snap.inputStamp = inputStamp;
+    snapshots.publish();
+}
+
+void Simulation::stop()
+{
+    running.store(false);
+    if (worker.joinable())
+    {
+        worker.join();
+    }
+}
+
+bool Simulation::post(const InputEvent &event)
+{
+    if (!inputs.push(event))
+    {
+        lost.fetch_add(1, memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void Simulation::interpolate(chrono::steady_clock::time_point now, FrameParams &params)
+{
+    snapshots.update();
+    const Snapshot &snap = snapshots.readBuffer();
+    //! How far the frame is past the tick, from 0 to 1.
+    float alpha = (float) (chrono::duration<double>(now - snap.due).count() / tickSeconds);
+    alpha = glm::clamp(alpha, 0.0f, 1.0f);
+    const State &from = snap.previous;
+    const State &to = snap.current;
+    viewCamera->SetPosition(mix(from.position, to.position, alpha));
+    viewCamera->SetOrientation(mix(from.yaw, to.yaw, alpha), mix(from.pitch, to.pitch, alpha));
+    viewCamera->Zoom = mix(from.zoom, to.zoom, alpha);
+    //! The spin wraps at 360 degrees.
+    float turn = to.spin - from.spin;
+    if (turn < 0.0f)
+    {
+        turn += 360.0f;
+    }
+    params.projection = viewCamera->GetPerspective();
+    params.view = viewCamera->GetViewMatrix();
+    params.viewPos = viewCamera->GetPosition();
+    params.viewCount = viewCount;
+    viewCamera->GetViews(viewCount, viewSpacing, params.views, params.projections,
+    params.viewPositions);
+    params.degrees = fmod(from.spin + turn * alpha, 360.0f);
+    params.foggy = to.foggy;
+    params.minfog = to.minfog;
+    params.maxfog = to.maxfog;
+    params.shLighting = to.shLighting;
+    params.skybox = to.skybox;
+    params.reflection = to.reflection;
+    params.depthPrepass = to.depthPrepass;
+    params.drift = to.drift;
+    params.hud = to.hud;
+    //! The snapshot runs from the tick before to its own.
+    params.seconds = std::max(0.0, ((double) snap.tick - 1.0 + alpha) * tickSeconds);
+}
+
+const Simulation::Snapshot &Simulation::snapshot()
+{
+    return snapshots.readBuffer();
+}
+
+unsigned long Simulation::dropped()
+{
+    return lost.load(memory_order_relaxed);
+}
+
+void Simulation::run()
+{
+    Tracer::nameThread("simulation");
+    AllocScope scope(AllocTracker::SUBSYSTEM_SIMULATION);
+    chrono::steady_clock::time_point due = chrono::steady_clock::now();
+    while (running.load())
+    {
+        //! A tick is published when it is due, so the frames
+        //! until the next one move from it toward the next.
+        due += tickLength;
+        this_thread::sleep_until(due);
+        {
+            TRACE_SCOPE("tick");
+            publishTick(due);
+        }
+        //! After a long stall, such as a debugger, do not
+        //! race through the missed ticks.
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        if (now > due + tickLength * MAX_BEHIND)
+        {
+            due = now;
+        }
+    }
+}
+
+void Simulation::step()
+{
+    InputEvent event;
+    while (inputs.pop(event))
+    {
+        //! A play back ignores the live input.
+        if (player == NULL)
+        {
+            apply(event);
+        }
+    }
+    if (player != NULL)
+    {
+        const InputRecord::Record *record;
+        while ((record = player->next(tick)) != NULL)
+        {
+            if (record->type > LOOK)
+            {
+                continue;
+            }
+            event.type = (Event_Type) record->type;
+            event.action = record->action;
+            event.xoffset = record->xoffset;
+            event.yoffset = record->yoffset;
+            event.stamp = chrono::steady_clock::now();
+            apply(event);
+        }
+    }
+    float distance = MOVE_RATE * (float) tickSeconds;
+    if (held[FORWARD])
+    {
+        simCamera->ProcessKeyboard(Camera::Camera_Movement::FORWARD, distance);
+    }
+    if (held[BACKWARD])
+    {
+        simCamera->ProcessKeyboard(Camera::Camera_Movement::BACKWARD, distance);
+    }
+    if (held[LEFT])
+    {
+        simCamera->ProcessKeyboard(Camera::Camera_Movement::LEFT, distance);
+    }
+    if (held[RIGHT])
+    {
+        simCamera->ProcessKeyboard(Camera::Camera_Movement::RIGHT, distance);
+    }
+    if (held[UP])
+    {
+        simCamera->ProcessKeyboard(Camera::Camera_Movement::UP, distance);
+    }
+    if (held[DOWN])
+    {
+        simCamera->ProcessKeyboard(Camera::Camera_Movement::DOWN, distance);
+    }
+    tick++;
+}
+
+void Simulation::apply(const InputEvent &event)
+{
+    inputSerial++;
+    inputStamp = event.stamp;
+    if (recorder != NULL)
+    {
+        InputRecord::Record record;
+        memset(&record, 0, sizeof(record));
+        record.tick = (uint32_t) tick;
+        record.type = (uint8_t) event.type;
+        record.action = (uint8_t) event.action;
+        record.xoffset = event.xoffset;
+        record.yoffset = event.yoffset;
+        recorder->append(record);
+    }
+    if (event.type == LOOK)
+    {
+        simCamera->ProcessMouseMovement(event.xoffset, event.yoffset);
+        return;
+    }
+    if ((event.action < 0) || (event.action >= NUM_ACTIONS))
+    {
+        return;
+    }
+    if (event.type == ACTION_UP)
+    {
+        held[event.action] = false;
+        return;
+    }
+    held[event.action] = true;
+    //! The once per press actions.
+    if (event.action == TOGGLE_FOG)
+    {
+        foggy = !foggy;
+    }
+    if (event.action == TOGGLE_LIGHTING)
+    {
+        shLighting = !shLighting;
+    }
+    if (event.action == TOGGLE_SKYBOX)
+    {
+        skybox = !skybox;
+    }
+    if (event.action == TOGGLE_REFLECTION)
+    {
+        reflection = !reflection;
+    }
+    if (event.action == TOGGLE_PREPASS)
+    {
+        depthPrepass = !depthPrepass;
+    }
+    if (event.action == TOGGLE_DRIFT)
+    {
+        drift = !drift;
+    }
+    if (event.action == TOGGLE_HUD)
+    {
+        hud = !hud;
+    }
+    if (event.action == RESET_CAMERA)
+    {
+        simCamera->resetCamera();
+    }
+    if (event.action == ZOOM_IN)
+    {
+        simCamera->ProcessMouseScroll(Camera::Camera_Movement::CLOSER);
+    }
+    if (event.action == ZOOM_OUT)
+    {
+        simCamera->ProcessMouseScroll(Camera::Camera_Movement::AWAY);
+    }
+    if (event.action == FOG_FARTHER)
+    {
+        minfog += 1.0f;
+        maxfog += 1.0f;
+        if (maxfog > 60.0f)
+        {
+            maxfog = 60.0f;
+            minfog = 35.0f;
+        }
+    }
+    if (event.action == FOG_NEARER)
+    {
+        minfog -= 1.0f;
+        maxfog -= 1.0f;
+        if (minfog < 0.1f)
+        {
+            minfog = 0.1f;
+            maxfog = 25.0f;
+        }
+    }
+}
+
+void Simulation::capture(State &state)
+{
+    state.position = simCamera->Position;
+    state.yaw = simCamera->Yaw;
+    state.pitch = simCamera->Pitch;
+    state.zoom = simCamera->Zoom;
+    //! Counting from the tick keeps the spin from drifting.
+    state.spin = (float) fmod((double) tick * tickSeconds * SPIN_RATE, 360.0);
+    state.foggy = foggy;
+    state.minfog = minfog;
+    state.maxfog = maxfog;
+    state.shLighting = shLighting;
+    state.skybox = skybox;
+    state.reflection = reflection;
+    state.depthPrepass = depthPrepass;
+    state.drift = drift;
+    state.hud = hud;
+}
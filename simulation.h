@@ -0,0 +1,265 @@
+/*******************************************************************
+ * Simulation:  A class to advance the spin of the cubes and the
+ * camera at a fixed rate on a thread of its own, apart from
+ * the drawing.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "commonheader.h"
+#include "camera.h"
+#include "triplebuffer.h"
+#include "spscqueue.h"
+#include "inputrecord.h"
+#include "logger.h"
+#include "alloctracker.h"
+#include "tracer.h"
+
+/** \class Simulation
+ * The simulation thread wakes at a fixed tick, applies the
+ * input that has arrived, moves the camera and spins the
+ * cubes, and publishes a snapshot of the state before and
+ * after the tick.  The drawing thread takes the newest
+ * snapshot and blends the two states by how far it is into
+ * the next tick, so motion is smooth at any frame rate and
+ * the same at any frame rate.  Input reaches the simulation
+ * through a queue, and neither thread waits on the other.
+ *
+ * The input can be recorded with the tick it was applied in
+ * and played back at the same ticks in place of the live
+ * input.  Stepped, with no thread, the simulation advances
+ * only when told to, at simulated times, so a play back
+ * draws exactly the same frames every time.
+ */
+class Simulation
+{
+public:
+    /** \brief Sim_Action
+     * What the keys do, apart from the window system.
+     * The movement actions last while the key is held,
+     * the rest happen once each time the key goes down.
+     */
+    enum Sim_Action {
+        FORWARD,
+        BACKWARD,
+        LEFT,
+        RIGHT,
+        UP,
+        DOWN,
+        TOGGLE_FOG,
+        RESET_CAMERA,
+        ZOOM_IN,
+        ZOOM_OUT,
+        FOG_FARTHER,
+        FOG_NEARER,
+        TOGGLE_LIGHTING,
+        TOGGLE_SKYBOX,
+        TOGGLE_REFLECTION,
+        TOGGLE_PREPASS,
+        TOGGLE_DRIFT,
+        TOGGLE_HUD,
+        NUM_ACTIONS
+    };
+
+    //! The kinds of input event.
+    enum Event_Type {
+        ACTION_DOWN,
+        ACTION_UP,
+        LOOK
+    };
+
+    //! One input event and when it was received.
+    struct InputEvent {
+        Event_Type type;
+        int action;
+        float xoffset, yoffset;
+        chrono::steady_clock::time_point stamp;
+    };
+
+    //! Everything the drawing needs from one tick.
+    struct State {
+        vec3 position;
+        float yaw, pitch, zoom;
+        float spin;
+        bool foggy;
+        float minfog, maxfog;
+        bool shLighting;
+        bool skybox, reflection;
+        bool depthPrepass;
+        bool drift;
+        bool hud;
+    };
+
+    //! The states before and after a tick, when the tick
+    //! was due and the newest input it applied.
+    struct Snapshot {
+        unsigned long tick;
+        State previous, current;
+        chrono::steady_clock::time_point due;
+        unsigned long inputSerial;
+        chrono::steady_clock::time_point inputStamp;
+    };
+
+    Simulation(int width, int height, vec3 position, double tickRate);
+    ~Simulation();
+
+    /** \brief setFeatures
+     * Sets the lighting, the sky, the depth pass, the
+     * drift and the performance display the toggles start
+     * from.  Call it before start.
+     */
+    void setFeatures(bool shLighting, bool skybox, bool reflection, bool depthPrepass,
+    bool drift, bool hud);
+
+    /** \brief setViews
+     * The number of views interpolate gives, and how far
+     * apart their eyes are, see Camera::GetViews.
+     */
+    void setViews(int count, float spacing);
+
+    /** \brief start
+     * Publishes the first snapshot and starts the thread.
+     */
+    void start();
+
+    /** \brief stop
+     * Stops the thread and waits for it.
+     */
+    void stop();
+
+    /** \brief startStepped
+     * Publishes the first snapshot without starting the
+     * thread, for advance to move the simulation.
+     */
+    void startStepped();
+
+    /** \brief advance
+     * Runs every tick due by the given number of simulated
+     * seconds since startStepped, on the calling thread.
+     */
+    void advance(double seconds);
+
+    /** \brief simulatedTime
+     * The time to interpolate a stepped simulation at, the
+     * given number of seconds after startStepped.
+     */
+    chrono::steady_clock::time_point simulatedTime(double seconds);
+
+    /** \brief setRecorder
+     * Writes each input event to the record as it is
+     * applied.  Call it before start.
+     */
+    void setRecorder(InputRecord *recorder);
+
+    /** \brief setPlayer
+     * Plays the events in the record back at the ticks they
+     * were applied in, ignoring the live input.  Call it
+     * before start.
+     */
+    void setPlayer(InputRecord *player);
+
+    /** \brief ticks
+     * The number of ticks run.  Call it after stop, or from
+     * the thread calling advance.
+     */
+    unsigned long ticks();
+
+    /** \brief post
+     * Sends an input event to the simulation.  Call it from
+     * one thread only.  Returns false if the queue was full
+     * and the event was dropped.
+     */
+    bool post(const InputEvent &event);
+
+    /** \brief interpolate
+     * Takes the newest snapshot and fills in the camera,
+     * spin and fog for a frame drawn at the time given.
+     * Call it from the drawing thread only.
+     */
+    void interpolate(chrono::steady_clock::time_point now, FrameParams &params);
+
+    /** \brief snapshot
+     * The snapshot the last interpolate used.
+     */
+    const Snapshot &snapshot();
+
+    /** \brief dropped
+     * The number of input events lost to a full queue.
+     */
+    unsigned long dropped();
+
+    //! Degrees the cubes turn each second, and camera
+    //! movement per second in the units ProcessKeyboard
+    //! takes.
+    constexpr static float SPIN_RATE = 100.0f;
+    constexpr static float MOVE_RATE = 20.0f;
+    //! Ticks behind before the simulation gives up
+    //! catching up and starts counting from now.
+    const int MAX_BEHIND = 5;
+
+protected:
+    /** \brief run
+     * The body of the simulation thread.
+     */
+    void run();
+
+    /** \brief publishTick
+     * Runs one tick and publishes the states before and
+     * after it, with the time it was due.
+     */
+    void publishTick(chrono::steady_clock::time_point due);
+
+    /** \brief publishFirst
+     * Publishes the state before the first tick.
+     */
+    void publishFirst(chrono::steady_clock::time_point due);
+
+    /** \brief step
+     * Applies the waiting input and advances one tick.
+     */
+    void step();
+
+    /** \brief apply
+     * Applies one input event.
+     */
+    void apply(const InputEvent &event);
+
+    /** \brief capture
+     * Copies the simulation camera and settings to a state.
+     */
+    void capture(State &state);
+
+    //! The camera moved by the simulation and the
+    //! camera the drawing thread builds its matrices with.
+    Camera *simCamera;
+    Camera *viewCamera;
+    TripleBuffer<Snapshot> snapshots;
+    SpscQueue<InputEvent, 256> inputs;
+    thread worker;
+    atomic<bool> running;
+    atomic<unsigned long> lost;
+    chrono::steady_clock::duration tickLength;
+    double tickSeconds;
+    unsigned long tick, inputSerial;
+    chrono::steady_clock::time_point inputStamp;
+    //! Where stepped time starts.
+    chrono::steady_clock::time_point epoch;
+    //! The record being written and the one played back.
+    InputRecord *recorder, *player;
+    //! Which movement keys are down.
+    bool held[NUM_ACTIONS];
+    bool foggy;
+    float minfog, maxfog;
+    bool shLighting;
+    bool skybox, reflection;
+    bool depthPrepass;
+    bool drift;
+    bool hud;
+    //! The views drawn in one pass.
+    int viewCount;
+    float viewSpacing;
+};
+
+#endif // SIMULATION_H
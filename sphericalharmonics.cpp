@@ -0,0 +1,130 @@
+/*******************************************************************
+ * SphericalHarmonics:  A class to project fixed lights into
+ * second order spherical harmonics, so the diffuse light from
+ * all of them costs one short sum per fragment.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "sphericalharmonics.h"
+
+//! The real basis constants.
+static const float Y0 = 0.282095f;
+static const float Y1 = 0.488603f;
+static const float Y2 = 1.092548f;
+static const float Y20 = 0.315392f;
+static const float Y22 = 0.546274f;
+//! The cosine lobe for each band, over pi, so a light
+//! straight on gives its color as the plain lighting
+//! sum does.
+static const float A0 = 1.0f;
+static const float A1 = 2.0f / 3.0f;
+static const float A2 = 0.25f;
+static const float PI = 3.14159265f;
+
+SphericalHarmonics::SphericalHarmonics()
+{
+    clear();
+}
+
+SphericalHarmonics::~SphericalHarmonics()
+{
+}
+
+void SphericalHarmonics::clear()
+{
+    for (int x = 0; x < 9; x++)
+    {
+        coeffs[x] = vec3(0.0f);
+    }
+    brightDir = vec3(0.0f, 1.0f, 0.0f);
+    brightColor = vec3(0.0f);
+    brightness = -1.0f;
+}
+
+void SphericalHarmonics::basis(vec3 d, float out[9])
+{
+    out[0] = Y0;
+    out[1] = Y1 * d.y;
+    out[2] = Y1 * d.z;
+    out[3] = Y1 * d.x;
+    out[4] = Y2 * d.x * d.y;
+    out[5] = Y2 * d.y * d.z;
+    out[6] = Y20 * (3.0f * d.z * d.z - 1.0f);
+    out[7] = Y2 * d.x * d.z;
+    out[8] = Y22 * (d.x * d.x - d.y * d.y);
+}
+
+void SphericalHarmonics::addLight(vec3 direction, vec3 color)
+{
+    if (length(direction) <= 0.0f)
+    {
+        return;
+    }
+    direction = normalize(direction);
+    float y[9];
+    basis(direction, y);
+    for (int x = 0; x < 9; x++)
+    {
+        coeffs[x] += color * y[x];
+    }
+    float luma = dot(color, vec3(0.2126f, 0.7152f, 0.0722f));
+    if (luma > brightness)
+    {
+        brightness = luma;
+        brightDir = direction;
+        brightColor = color;
+    }
+}
+
+void SphericalHarmonics::irradiance(vec3 out[9])
+{
+    //! Convolve with the cosine, scaled so the result is
+    //! in the units of a single light, and fold in the
+    //! basis constants.
+    const float scale = PI;
+    out[0] = coeffs[0] * (scale * A0 * Y0);
+    out[1] = coeffs[1] * (scale * A1 * Y1);
+    out[2] = coeffs[2] * (scale * A1 * Y1);
+    out[3] = coeffs[3] * (scale * A1 * Y1);
+    out[4] = coeffs[4] * (scale * A2 * Y2);
+    out[5] = coeffs[5] * (scale * A2 * Y2);
+    out[6] = coeffs[6] * (scale * A2 * Y20);
+    out[7] = coeffs[7] * (scale * A2 * Y2);
+    out[8] = coeffs[8] * (scale * A2 * Y22);
+}
+
+vec3 SphericalHarmonics::evaluate(vec3 normal)
+{
+    vec3 c[9];
+    irradiance(c);
+    vec3 n = normalize(normal);
+    return c[0] + c[1] * n.y + c[2] * n.z + c[3] * n.x
+    + c[4] * (n.x * n.y) + c[5] * (n.y * n.z)
+    + c[6] * (3.0f * n.z * n.z - 1.0f) + c[7] * (n.x * n.z)
+    + c[8] * (n.x * n.x - n.y * n.y);
+}
+
+void SphericalHarmonics::dominant(vec3 &direction, vec3 &color)
+{
+    //! The first band of the brightness points toward
+    //! the light.
+    const vec3 luma = vec3(0.2126f, 0.7152f, 0.0722f);
+    vec3 axis = vec3(dot(coeffs[3], luma), dot(coeffs[1], luma), dot(coeffs[2], luma));
+    if (length(axis) < 1.0e-4f * std::max(dot(coeffs[0], luma), 1.0e-6f))
+    {
+        direction = brightDir;
+        color = brightColor;
+        return;
+    }
+    direction = normalize(axis);
+    //! The color of one light in that direction that
+    //! best matches the coefficients.
+    float y[9];
+    basis(direction, y);
+    vec3 sum = vec3(0.0f);
+    for (int x = 0; x < 9; x++)
+    {
+        sum += coeffs[x] * y[x];
+    }
+    color = glm::max(sum * (4.0f * PI / 9.0f), vec3(0.0f));
+}
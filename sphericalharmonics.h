@@ -0,0 +1,78 @@
+/*******************************************************************
+ * SphericalHarmonics:  A class to project fixed lights into
+ * second order spherical harmonics, so the diffuse light from
+ * all of them costs one short sum per fragment.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef SPHERICALHARMONICS_H
+#define SPHERICALHARMONICS_H
+
+#include "commonheader.h"
+
+/** \class SphericalHarmonics
+ * Holds nine color coefficients, bands 0 to 2, of the light
+ * arriving from every direction.  The lights are treated as
+ * directions seen from one point, which is close enough for
+ * lights well outside what they light.  The coefficients are
+ * handed to the shader already convolved with the cosine
+ * lobe and multiplied by the basis constants, so the shader
+ * only needs the polynomial in the normal:
+ *
+ *     c0 + c1 y + c2 z + c3 x + c4 xy + c5 yz
+ *     + c6 (3z^2 - 1) + c7 xz + c8 (x^2 - y^2)
+ *
+ * For the specular highlight the lights are stood in for by
+ * one light in the dominant direction.
+ */
+class SphericalHarmonics
+{
+public:
+    SphericalHarmonics();
+    ~SphericalHarmonics();
+
+    /** \brief clear
+     * Removes every light.
+     */
+    void clear();
+
+    /** \brief addLight
+     * Adds a light of the given color seen from the
+     * origin in the given direction.
+     */
+    void addLight(vec3 direction, vec3 color);
+
+    /** \brief irradiance
+     * Fills the nine coefficients for the shader.
+     */
+    void irradiance(vec3 out[9]);
+
+    /** \brief evaluate
+     * The diffuse light on a surface facing the normal,
+     * as the shader works it out.
+     */
+    vec3 evaluate(vec3 normal);
+
+    /** \brief dominant
+     * The single light that best stands in for the rest,
+     * found from the first band.  When the lights balance
+     * out, as the eight corner lights do, the first band is
+     * empty and the brightest light stands in instead.
+     */
+    void dominant(vec3 &direction, vec3 &color);
+
+protected:
+    /** \brief basis
+     * The nine basis functions in a direction.
+     */
+    static void basis(vec3 d, float out[9]);
+
+    //! The projected light, not yet convolved.
+    vec3 coeffs[9];
+    //! The brightest light, for when there is no
+    //! dominant direction.
+    vec3 brightDir, brightColor;
+    float brightness;
+};
+
+#endif // SPHERICALHARMONICS_H
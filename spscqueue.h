@@ -0,0 +1,70 @@
+/*******************************************************************
+ * SpscQueue:  A lock free, fixed size queue from one producing
+ * thread to one consuming thread.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include "commonheader.h"
+
+/** \class SpscQueue
+ * A ring of SIZE slots, SIZE a power of two.  The producer
+ * only writes the tail and the consumer only writes the head,
+ * so neither needs a lock.  The two counters sit on separate
+ * cache lines so the threads do not fight over one line.
+ */
+template <class T, size_t SIZE>
+class SpscQueue
+{
+    static_assert((SIZE & (SIZE - 1)) == 0, "SpscQueue size must be a power of two.");
+public:
+    SpscQueue()
+    {
+        head.store(0);
+        tail.store(0);
+    }
+    ~SpscQueue()
+    {
+    }
+
+    /** \brief push
+     * Adds an item.  Returns false, dropping the item,
+     * if the queue is full.
+     */
+    bool push(const T &item)
+    {
+        size_t back = tail.load(memory_order_relaxed);
+        if (back - head.load(memory_order_acquire) >= SIZE)
+        {
+            return false;
+        }
+        slots[back & (SIZE - 1)] = item;
+        tail.store(back + 1, memory_order_release);
+        return true;
+    }
+
+    /** \brief pop
+     * Takes the oldest item.  Returns false if the queue
+     * is empty.
+     */
+    bool pop(T &item)
+    {
+        size_t front = head.load(memory_order_relaxed);
+        if (front == tail.load(memory_order_acquire))
+        {
+            return false;
+        }
+        item = slots[front & (SIZE - 1)];
+        head.store(front + 1, memory_order_release);
+        return true;
+    }
+
+protected:
+    T slots[SIZE];
+    alignas(64) atomic<size_t> head;
+    alignas(64) atomic<size_t> tail;
+};
+
+#endif // SPSCQUEUE_H
@@ -0,0 +1,382 @@
+/*******************************************************************
+ * TextureStreamer:  A class to load the pictures of the cubes and
+ * the sky on a thread of its own while the frames are drawn, each
+ * picture taking the place of a plain one when it is ready.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "texturestreamer.h"
+
+TextureStreamer::TextureStreamer()
+{
+    LOG_DEBUG(STARTUP, "Creating TextureStreamer.");
+    loader = NULL;
+    created = 0;
+    running.store(false);
+    ready = 0;
+    failed.store(0);
+    pixelBuffer = 0;
+    uploadBytes = 0;
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    LOG_DEBUG(STARTUP, "Destroying TextureStreamer.");
+    stop();
+}
+
+bool TextureStreamer::supported()
+{
+    return (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage) && (GLEW_VERSION_3_2 || GLEW_ARB_sync);
+}
+
+GLuint TextureStreamer::createTexture(GLenum target, GLsizei width, GLsizei height, int layers,
+const unsigned char placeholder[4])
+{
+    TRACE_SCOPE("createTexture");
+    int levels = levelCount(width, height);
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(target, textureID);
+    if (target == GL_TEXTURE_2D_ARRAY)
+    {
+        glTexStorage3D(target, levels, GL_RGBA8, width, height, layers);
+    }
+    else
+    {
+        glTexStorage2D(target, levels, GL_RGBA8, width, height);
+    }
+    //! Immutable storage starts out undefined, so every
+    //! level of every layer gets the plain color.
+    vector<unsigned char> plain((size_t) width * height * 4);
+    for (size_t x = 0; x < plain.size(); x += 4)
+    {
+        memcpy(&plain[x], placeholder, 4);
+    }
+    for (int level = 0; level < levels; level++)
+    {
+        GLsizei levelWidth = std::max(1, width >> level);
+        GLsizei levelHeight = std::max(1, height >> level);
+        for (int layer = 0; layer < layers; layer++)
+        {
+            if (target == GL_TEXTURE_2D_ARRAY)
+            {
+                glTexSubImage3D(target, level, 0, 0, layer, levelWidth, levelHeight, 1,
+                GL_RGBA, GL_UNSIGNED_BYTE, plain.data());
+            }
+            else if (target == GL_TEXTURE_CUBE_MAP)
+            {
+                glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + layer, level, 0, 0,
+                levelWidth, levelHeight, GL_RGBA, GL_UNSIGNED_BYTE, plain.data());
+            }
+            else
+            {
+                glTexSubImage2D(target, level, 0, 0, levelWidth, levelHeight,
+                GL_RGBA, GL_UNSIGNED_BYTE, plain.data());
+            }
+        }
+    }
+    //! The crate repeats, the pictures and the sky do not.
+    GLint wrap = (target == GL_TEXTURE_2D) ? GL_REPEAT : GL_CLAMP_TO_EDGE;
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, wrap);
+    if (target != GL_TEXTURE_2D)
+    {
+        glTexParameteri(target, GL_TEXTURE_WRAP_R, wrap);
+    }
+    glBindTexture(target, 0);
+    return textureID;
+}
+
+void TextureStreamer::add(string file, GLuint texture, GLenum target, int layer,
+GLsizei width, GLsizei height)
+{
+    jobs.push_back({ file, texture, target, layer, width, height, levelCount(width, height) });
+}
+
+void TextureStreamer::start(HeadlessContext *loader)
+{
+    this->loader = loader;
+    if (loader != NULL)
+    {
+        created = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+    }
+    running.store(true);
+    worker = thread(&TextureStreamer::load, this);
+    LOG_INFO(FILE, "Loading {} pictures in the background, {}.", jobs.size(),
+    (loader != NULL) ? "on a shared context" : "sent from the drawing thread");
+}
+
+void TextureStreamer::stop()
+{
+    //! Under the lock, so the loader cannot miss it between
+    //! looking at running and waiting.
+    {
+        lock_guard<mutex> guard(lock);
+        running.store(false);
+    }
+    space.notify_all();
+    if (worker.joinable())
+    {
+        worker.join();
+    }
+    for (unsigned int x = 0; x < pending.size(); x++)
+    {
+        glDeleteSync(pending[x].fence);
+    }
+    pending.clear();
+    decoded.clear();
+    if (created != 0)
+    {
+        glDeleteSync(created);
+        created = 0;
+    }
+    if (pixelBuffer != 0)
+    {
+        glDeleteBuffers(1, &pixelBuffer);
+        pixelBuffer = 0;
+    }
+}
+
+void TextureStreamer::update()
+{
+    TRACE_SCOPE("streamTextures");
+    if (done())
+    {
+        return;
+    }
+    unique_lock<mutex> guard(lock);
+    //! A fence already passed costs nothing to ask about.
+    unsigned int kept = 0;
+    for (unsigned int x = 0; x < pending.size(); x++)
+    {
+        GLenum status = glClientWaitSync(pending[x].fence, 0, 0);
+        if ((status == GL_ALREADY_SIGNALED) || (status == GL_CONDITION_SATISFIED))
+        {
+            glDeleteSync(pending[x].fence);
+            ready++;
+        }
+        else
+        {
+            pending[kept++] = pending[x];
+        }
+    }
+    pending.resize(kept);
+    //! Without a shared context, one picture a frame.
+    if (decoded.empty())
+    {
+        return;
+    }
+    Decoded next = std::move(decoded.front());
+    decoded.pop_front();
+    guard.unlock();
+    space.notify_one();
+    if (pixelBuffer == 0)
+    {
+        glGenBuffers(1, &pixelBuffer);
+    }
+    upload(pixelBuffer, jobs[next.job], next.pixels);
+    uploadBytes += next.pixels.size();
+    ready++;
+}
+
+void TextureStreamer::finish()
+{
+    TRACE_SCOPE("finishTextures");
+    while (!done())
+    {
+        update();
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+}
+
+bool TextureStreamer::done()
+{
+    return ready + failed.load() >= (int) jobs.size();
+}
+
+int TextureStreamer::getReady()
+{
+    return ready;
+}
+
+size_t TextureStreamer::getUploadBytes()
+{
+    size_t bytes = uploadBytes;
+    uploadBytes = 0;
+    return bytes;
+}
+
+void TextureStreamer::load()
+{
+    Tracer::nameThread("loader");
+    AllocScope scope(AllocTracker::SUBSYSTEM_ASSETS);
+    bool shared = (loader != NULL) && loader->makeCurrent();
+    if ((loader != NULL) && !shared)
+    {
+        LOG_WARN(FILE, "Sending the pictures from the drawing thread instead.");
+    }
+    CreateImage image;
+    GLuint buffer = 0;
+    if (shared)
+    {
+        //! The plain colors go in first.
+        glWaitSync(created, 0, GL_TIMEOUT_IGNORED);
+        glGenBuffers(1, &buffer);
+    }
+    for (unsigned int x = 0; (x < jobs.size()) && running.load(); x++)
+    {
+        TRACE_SCOPE_DETAIL("loadPicture", jobs[x].file.c_str());
+        Decoded next;
+        next.job = (int) x;
+        if (!decode(image, jobs[x], next.pixels))
+        {
+            failed++;
+            continue;
+        }
+        if (shared)
+        {
+            upload(buffer, jobs[x], next.pixels);
+            //! The fence has to reach the GPU before the
+            //! drawing thread can see it pass.
+            GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();
+            lock_guard<mutex> guard(lock);
+            pending.push_back({ (int) x, fence });
+            continue;
+        }
+        unique_lock<mutex> guard(lock);
+        space.wait(guard, [this] { return ((int) decoded.size() < MAX_DECODED) || !running.load(); });
+        decoded.push_back(std::move(next));
+    }
+    if (shared)
+    {
+        glDeleteBuffers(1, &buffer);
+        //! The commands are on their way before the
+        //! context is let go.
+        glFlush();
+        loader->release();
+    }
+}
+
+bool TextureStreamer::decode(CreateImage &image, const Job &job, vector<unsigned char> &pixels)
+{
+    image.setImage(job.file);
+    if ((image.getWidth() != job.width) || (image.getHeight() != job.height))
+    {
+        LOG_ERROR(FILE, "Image file {} is {}x{}, not {}x{}, and is left out.", job.file,
+        image.getWidth(), image.getHeight(), job.width, job.height);
+        return false;
+    }
+    pixels.resize(levelBytes(job.width, job.height, job.levels));
+    memcpy(pixels.data(), image.getData(), (size_t) job.width * job.height * 4);
+    size_t offset = 0;
+    GLsizei width = job.width, height = job.height;
+    for (int level = 1; level < job.levels; level++)
+    {
+        size_t bytes = (size_t) width * height * 4;
+        halve(&pixels[offset], width, height, &pixels[offset + bytes]);
+        offset += bytes;
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    return true;
+}
+
+void TextureStreamer::upload(GLuint buffer, const Job &job, const vector<unsigned char> &pixels)
+{
+    //! A new store each time, so the copy never waits on
+    //! the GPU reading the last one.
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, pixels.size(), NULL, GL_STREAM_DRAW);
+    void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, pixels.size(),
+    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped != NULL)
+    {
+        memcpy(mapped, pixels.data(), pixels.size());
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        send(job);
+    }
+    else
+    {
+        LOG_ERROR(RENDER, "Cannot map the pixel buffer for {}.", job.file);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureStreamer::send(const Job &job)
+{
+    glBindTexture(job.target, job.texture);
+    size_t offset = 0;
+    for (int level = 0; level < job.levels; level++)
+    {
+        GLsizei width = std::max(1, job.width >> level);
+        GLsizei height = std::max(1, job.height >> level);
+        if (job.target == GL_TEXTURE_2D_ARRAY)
+        {
+            glTexSubImage3D(job.target, level, 0, 0, job.layer, width, height, 1,
+            GL_RGBA, GL_UNSIGNED_BYTE, (void*) offset);
+        }
+        else if (job.target == GL_TEXTURE_CUBE_MAP)
+        {
+            glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + job.layer, level, 0, 0,
+            width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*) offset);
+        }
+        else
+        {
+            glTexSubImage2D(job.target, level, 0, 0, width, height,
+            GL_RGBA, GL_UNSIGNED_BYTE, (void*) offset);
+        }
+        offset += (size_t) width * height * 4;
+    }
+    glBindTexture(job.target, 0);
+}
+
+int TextureStreamer::levelCount(GLsizei width, GLsizei height)
+{
+    int levels = 1;
+    for (GLsizei size = std::max(width, height); size > 1; size /= 2)
+    {
+        levels++;
+    }
+    return levels;
+}
+
+size_t TextureStreamer::levelBytes(GLsizei width, GLsizei height, int levels)
+{
+    size_t bytes = 0;
+    for (int level = 0; level < levels; level++)
+    {
+        bytes += (size_t) std::max(1, width >> level) * std::max(1, height >> level) * 4;
+    }
+    return bytes;
+}
+
+void TextureStreamer::halve(const unsigned char *in, GLsizei width, GLsizei height,
+unsigned char *out)
+{
+    GLsizei outWidth = std::max(1, width / 2);
+    GLsizei outHeight = std::max(1, height / 2);
+    for (GLsizei y = 0; y < outHeight; y++)
+    {
+        //! A side of one pixel is not halved.
+        GLsizei y0 = std::min(y * 2, height - 1);
+        GLsizei y1 = std::min(y * 2 + 1, height - 1);
+        for (GLsizei x = 0; x < outWidth; x++)
+        {
+            GLsizei x0 = std::min(x * 2, width - 1);
+            GLsizei x1 = std::min(x * 2 + 1, width - 1);
+            for (int c = 0; c < 4; c++)
+            {
+                int sum = in[((size_t) y0 * width + x0) * 4 + c]
+                + in[((size_t) y0 * width + x1) * 4 + c]
+                + in[((size_t) y1 * width + x0) * 4 + c]
+                + in[((size_t) y1 * width + x1) * 4 + c];
+                out[((size_t) y * outWidth + x) * 4 + c] = (unsigned char) ((sum + 2) / 4);
+            }
+        }
+    }
+}
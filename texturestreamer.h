@@ -0,0 +1,172 @@
+/*******************************************************************
+ * TextureStreamer:  A class to load the pictures of the cubes and
+ * the sky on a thread of its own while the frames are drawn, each
+ * picture taking the place of a plain one when it is ready.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef TEXTURESTREAMER_H
+#define TEXTURESTREAMER_H
+
+#include "commonheader.h"
+#include "createimage.h"
+#include "headlesscontext.h"
+#include "alloctracker.h"
+#include "tracer.h"
+#include "logger.h"
+
+/** \class TextureStreamer
+ * The textures are made at their full size up front, with
+ * immutable storage for every level, and filled with a
+ * plain color, so the first frame can be drawn at once.
+ * The loader thread reads each picture, makes its smaller
+ * levels itself, since glGenerateMipmap would redo every
+ * layer, and then:
+ *
+ *     With a context of its own sharing the textures, it
+ *     copies the levels to a pixel buffer, sends them to
+ *     the layer with glTexSubImage3D, and fences them.
+ *     The drawing thread counts the layer done once the
+ *     fence is passed, never waiting on it.
+ *
+ *     Without one, it hands the levels to the drawing
+ *     thread, which sends one picture a frame through a
+ *     pixel buffer of its own.
+ *
+ * The drawing thread binds the textures again each frame,
+ * which a context has to do to see what another sent.
+ */
+class TextureStreamer
+{
+public:
+    TextureStreamer();
+    ~TextureStreamer();
+
+    /** \brief supported
+     * Whether the context has immutable storage and fences.
+     * Call it with a current context.
+     */
+    static bool supported();
+
+    /** \brief createTexture
+     * Makes a 2D texture, a 2D array of layers or a cube
+     * map of width by height with storage for every level,
+     * filled with the color placeholder, and the filters
+     * and wrapping CreateImage gives them.
+     */
+    static GLuint createTexture(GLenum target, GLsizei width, GLsizei height, int layers,
+    const unsigned char placeholder[4]);
+
+    /** \brief add
+     * Adds a picture in the images directory to load into a
+     * layer of texture, or a face of a cube map.  Every
+     * picture must be the size of its texture.  Call it
+     * before start.
+     */
+    void add(string file, GLuint texture, GLenum target, int layer,
+    GLsizei width, GLsizei height);
+
+    /** \brief start
+     * Starts the loader thread, with the shared context
+     * loader when there is one.  The loader waits on a
+     * fence for the textures made so far to be in place
+     * before it sends anything over them.
+     */
+    void start(HeadlessContext *loader);
+
+    /** \brief update
+     * Counts the pictures the fences say are done, or
+     * sends the next picture read when there is no shared
+     * context.  Call it once a frame on the drawing thread.
+     */
+    void update();
+
+    /** \brief finish
+     * Updates until every picture is in place.
+     */
+    void finish();
+
+    /** \brief stop
+     * Stops the thread, leaving the pictures not yet done
+     * plain.
+     */
+    void stop();
+
+    /** \brief done
+     * Whether every picture is in place.
+     */
+    bool done();
+
+    /** \brief getReady
+     * The pictures in place so far.
+     */
+    int getReady();
+
+    /** \brief getUploadBytes
+     * The bytes the drawing thread sent since the last call.
+     */
+    size_t getUploadBytes();
+
+protected:
+    //! A picture and where it goes.
+    struct Job {
+        string file;
+        GLuint texture;
+        GLenum target;
+        int layer;
+        GLsizei width, height;
+        int levels;
+    };
+
+    //! A picture read, every level one after another.
+    struct Decoded {
+        int job;
+        vector<unsigned char> pixels;
+    };
+
+    //! A picture sent on the loader's context.
+    struct Pending {
+        int job;
+        GLsync fence;
+    };
+
+    //! The body of the loader thread.
+    void load();
+    //! Reads a picture and makes its levels.  Returns false
+    //! if it is not the size of its texture.
+    bool decode(CreateImage &image, const Job &job, vector<unsigned char> &pixels);
+    //! Sends the levels of a picture from the bound pixel
+    //! buffer, starting at offset 0.
+    void send(const Job &job);
+    //! Copies the levels to the pixel buffer and sends them.
+    void upload(GLuint buffer, const Job &job, const vector<unsigned char> &pixels);
+    //! The levels a picture has, and their bytes.
+    static int levelCount(GLsizei width, GLsizei height);
+    static size_t levelBytes(GLsizei width, GLsizei height, int levels);
+    //! Halves a level, averaging each two by two block.
+    static void halve(const unsigned char *in, GLsizei width, GLsizei height,
+    unsigned char *out);
+
+    vector<Job> jobs;
+    HeadlessContext *loader;
+    GLsync created;
+    thread worker;
+    atomic<bool> running;
+    //! What the loader thread hands over, under the lock.
+    mutex lock;
+    condition_variable space;
+    deque<Decoded> decoded;
+    vector<Pending> pending;
+    //! Pictures in place, those left plain as they could
+    //! not be read, and the drawing thread's pixel buffer
+    //! when it sends them itself.
+    int ready;
+    atomic<int> failed;
+    GLuint pixelBuffer;
+    size_t uploadBytes;
+    //! The loader reads no faster than this many pictures
+    //! ahead of a drawing thread that sends them.
+    static const int MAX_DECODED = 4;
+};
+
+#endif // TEXTURESTREAMER_H
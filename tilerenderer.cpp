@@ -0,0 +1,508 @@
+/*******************************************************************
+ * TileRenderer:  A class to draw the headless frame in bands,
+ * each in a worker process with a context of its own, and put
+ * the bands together from shared memory.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "tilerenderer.h"
+
+TileRenderer::TileRenderer(Options &options)
+{
+    LOG_DEBUG(STARTUP, "Creating TileRenderer.");
+    this->options = options;
+    //! A band is one view at full scale, with no display
+    //! drawn over it.
+    if ((this->options.views != 1) || (this->options.budget > 0.0) || this->options.hud)
+    {
+        LOG_WARN(STARTUP, "The tiles draw one view at full quality without the display.");
+    }
+    this->options.views = 1;
+    this->options.budget = 0.0;
+    this->options.hud = false;
+    context = NULL;
+    frameTexture = frameFBO = 0;
+    frame = NULL;
+    frameSize = (size_t) options.width * options.height * 4;
+    frameFd = -1;
+    capture = NULL;
+}
+
+TileRenderer::~TileRenderer()
+{
+    LOG_DEBUG(STARTUP, "Destroying TileRenderer.");
+    stopWorkers();
+    delete capture;
+    if (context != NULL)
+    {
+        glDeleteFramebuffers(1, &frameFBO);
+        glDeleteTextures(1, &frameTexture);
+    }
+    delete context;
+    if (frame != NULL)
+    {
+        munmap(frame, frameSize);
+    }
+    if (frameFd >= 0)
+    {
+        close(frameFd);
+    }
+}
+
+int TileRenderer::run()
+{
+    CameraPath::Path_Type type;
+    if (!CameraPath::fromName(options.cameraPath, type))
+    {
+        LOG_ERROR(STARTUP, "Unknown camera path {}.", options.cameraPath);
+        return 1;
+    }
+    if (!options.replay.empty())
+    {
+        LOG_ERROR(STARTUP, "A recorded session cannot be played back in tiles.");
+        return 1;
+    }
+    if (options.tiles * MIN_ROWS > options.height)
+    {
+        LOG_ERROR(STARTUP, "{} tiles need a height of {} rows or more.", options.tiles,
+        options.tiles * MIN_ROWS);
+        return 1;
+    }
+    //! A worker that is gone shows as a failed write, not
+    //! as the end of the program.
+    signal(SIGPIPE, SIG_IGN);
+    //! The frame is named only until it is open, and the
+    //! workers are handed the descriptor.
+    string name = "/sidefogcube-tiles-" + to_string(getpid());
+    frameFd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (frameFd < 0)
+    {
+        LOG_ERROR(STARTUP, "Cannot make the shared frame:  {}", strerror(errno));
+        return 1;
+    }
+    shm_unlink(name.c_str());
+    if (ftruncate(frameFd, (off_t) frameSize) != 0)
+    {
+        LOG_ERROR(STARTUP, "Cannot size the shared frame:  {}", strerror(errno));
+        return 1;
+    }
+    void *mapped = mmap(NULL, frameSize, PROT_READ | PROT_WRITE, MAP_SHARED, frameFd, 0);
+    if (mapped == MAP_FAILED)
+    {
+        LOG_ERROR(STARTUP, "Cannot map the shared frame:  {}", strerror(errno));
+        return 1;
+    }
+    frame = (unsigned char*) mapped;
+    //! The workers start before this process has a context
+    //! or anything else to copy.
+    if (!startWorkers())
+    {
+        return 1;
+    }
+    context = new HeadlessContext();
+    if (!context->create(options.width, options.height))
+    {
+        return 1;
+    }
+    glewExperimental = GL_TRUE;
+    GLenum err = glewInit();
+    if ((GLEW_OK != err) && (GLEW_ERROR_NO_GLX_DISPLAY != err))
+    {
+        LOG_ERROR(STARTUP, "Failed to initialize GLEW.");
+        return 1;
+    }
+    if (!context->createFramebuffer())
+    {
+        return 1;
+    }
+    //! The frame goes through a texture to be copied to the
+    //! framebuffer, where the capture reads it.
+    glGenTextures(1, &frameTexture);
+    glBindTexture(GL_TEXTURE_2D, frameTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, options.width, options.height, 0,
+    GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glGenFramebuffers(1, &frameFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, frameFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, frameTexture, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, context->getFramebuffer());
+    //! The bands start even.
+    for (int x = 0; x <= options.tiles; x++)
+    {
+        borders.push_back(options.height * x / options.tiles);
+    }
+    workerMs.assign(options.tiles, 0.0);
+    workerTotalMs.assign(options.tiles, 0.0);
+    workerDrawn.assign(options.tiles, 0);
+    //! Every worker has its scene before the first frame.
+    for (unsigned int x = 0; x < workers.size(); x++)
+    {
+        Result ready;
+        if (!readAll(workers[x].results, &ready, sizeof(ready)) || (ready.frame != -1))
+        {
+            LOG_ERROR(STARTUP, "Tile worker {} did not start.", x);
+            return 1;
+        }
+    }
+    LOG_INFO(STARTUP, "{} tile workers ready.", workers.size());
+    //! The borders settle while the caches warm.
+    for (int x = 0; x < options.warmup; x++)
+    {
+        TRACE_SCOPE("warmup");
+        if (!drawFrame(x, options.warmup))
+        {
+            return 1;
+        }
+        glFinish();
+    }
+    if (!options.capture.empty())
+    {
+        capture = new FrameCapture(options.capture, options.captureRaw
+        ? FrameCapture::FORMAT_RAW : FrameCapture::FORMAT_PNG,
+        options.captureFirst, options.captureCount);
+    }
+    stats.reset(options.frames);
+    workerTotalMs.assign(options.tiles, 0.0);
+    double drawn = 0.0;
+    for (int x = 0; x < options.frames; x++)
+    {
+        TRACE_SCOPE("frame");
+        chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+        if (!drawFrame(x, options.frames))
+        {
+            return 1;
+        }
+        if (capture != NULL)
+        {
+            capture->frameDone(x, options.width, options.height);
+        }
+        glFinish();
+        stats.addFrame(chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count());
+        for (int y = 0; y < options.tiles; y++)
+        {
+            drawn += workerDrawn[y];
+        }
+    }
+    stopWorkers();
+    Logger::instance().flush();
+    if (capture != NULL)
+    {
+        capture->finish();
+    }
+    stringstream title;
+    title << "Tiled headless " << options.width << "x" << options.height
+    << " tiles " << options.tiles
+    << " cubes " << options.count << " path " << options.cameraPath;
+    if (options.loadScene.empty())
+    {
+        title << " seed " << options.seed;
+    }
+    else
+    {
+        title << " scene " << options.loadScene;
+    }
+    title << " lighting " << (options.shLighting ? "sh" : "lights")
+    << " skybox " << (options.reflection ? "reflect" : (options.skybox ? "on" : "off"))
+    << " cull " << (options.gpuCull ? "gpu" : (options.cull ? "on" : "off"))
+    << " transparency " << (options.oit ? "oit" : "opaque")
+    << " renderer " << glGetString(GL_RENDERER);
+    stats.report(title.str(), options.count);
+    cout << fixed << setprecision(3)
+    << "\tCube draws:   " << drawn / std::max(1, options.frames)
+    << " a frame, a cube in two bands drawn in both\n";
+    for (int x = 0; x < options.tiles; x++)
+    {
+        cout << "\tTile " << setw(2) << x << ":      rows " << setw(5) << borders[x]
+        << " to " << setw(5) << borders[x + 1] << " at the end, "
+        << workerTotalMs[x] / std::max(1, options.frames) << " ms a frame\n";
+    }
+    cout << "\n";
+    cout.unsetf(ios_base::floatfield);
+    return 0;
+}
+
+bool TileRenderer::startWorkers()
+{
+    for (int x = 0; x < options.tiles; x++)
+    {
+        int commandPipe[2], resultPipe[2];
+        if ((pipe2(commandPipe, O_CLOEXEC) != 0) || (pipe2(resultPipe, O_CLOEXEC) != 0))
+        {
+            LOG_ERROR(STARTUP, "Cannot make the pipes of tile worker {}:  {}", x, strerror(errno));
+            return false;
+        }
+        //! The same arguments, and the worker's own ends.
+        stringstream worker;
+        worker << x << "," << commandPipe[0] << "," << resultPipe[1] << "," << frameFd;
+        vector<string> arguments;
+        arguments.push_back("sidefogcube");
+        arguments.insert(arguments.end(), options.arguments.begin(), options.arguments.end());
+        arguments.push_back("--tile-worker");
+        arguments.push_back(worker.str());
+        vector<char*> argv;
+        for (unsigned int y = 0; y < arguments.size(); y++)
+        {
+            argv.push_back((char*) arguments[y].c_str());
+        }
+        argv.push_back(NULL);
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            //! Only calls safe after a fork until the exec.
+            fcntl(commandPipe[0], F_SETFD, 0);
+            fcntl(resultPipe[1], F_SETFD, 0);
+            fcntl(frameFd, F_SETFD, 0);
+            execv("/proc/self/exe", argv.data());
+            _exit(127);
+        }
+        close(commandPipe[0]);
+        close(resultPipe[1]);
+        if (pid < 0)
+        {
+            LOG_ERROR(STARTUP, "Cannot start tile worker {}:  {}", x, strerror(errno));
+            close(commandPipe[1]);
+            close(resultPipe[0]);
+            return false;
+        }
+        workers.push_back({ pid, commandPipe[1], resultPipe[0] });
+    }
+    return true;
+}
+
+void TileRenderer::stopWorkers()
+{
+    Command stop = { -1, 0, 0, 0 };
+    for (unsigned int x = 0; x < workers.size(); x++)
+    {
+        writeAll(workers[x].commands, &stop, sizeof(stop));
+        close(workers[x].commands);
+    }
+    for (unsigned int x = 0; x < workers.size(); x++)
+    {
+        int status = 0;
+        waitpid(workers[x].pid, &status, 0);
+        close(workers[x].results);
+        if (!WIFEXITED(status) || (WEXITSTATUS(status) != 0))
+        {
+            LOG_WARN(STARTUP, "Tile worker {} ended badly.", x);
+        }
+    }
+    workers.clear();
+}
+
+bool TileRenderer::drawFrame(int frameNumber, int total)
+{
+    {
+        TRACE_SCOPE("tiles");
+        for (unsigned int x = 0; x < workers.size(); x++)
+        {
+            Command command = { frameNumber, total, borders[x], borders[x + 1] - borders[x] };
+            if (!writeAll(workers[x].commands, &command, sizeof(command)))
+            {
+                LOG_ERROR(RENDER, "Tile worker {} is gone.", x);
+                return false;
+            }
+        }
+        for (unsigned int x = 0; x < workers.size(); x++)
+        {
+            Result result;
+            if (!readAll(workers[x].results, &result, sizeof(result)))
+            {
+                LOG_ERROR(RENDER, "Tile worker {} is gone.", x);
+                return false;
+            }
+            workerMs[x] = result.ms;
+            workerTotalMs[x] += result.ms;
+            workerDrawn[x] = result.drawn;
+        }
+    }
+    {
+        TRACE_SCOPE("composite");
+        glBindTexture(GL_TEXTURE_2D, frameTexture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, options.width, options.height,
+        GL_RGBA, GL_UNSIGNED_BYTE, frame);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, frameFBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, context->getFramebuffer());
+        glBlitFramebuffer(0, 0, options.width, options.height, 0, 0, options.width, options.height,
+        GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, context->getFramebuffer());
+    }
+    rebalance();
+    return true;
+}
+
+void TileRenderer::rebalance()
+{
+    int count = (int) workers.size();
+    double total = 0.0;
+    for (int x = 0; x < count; x++)
+    {
+        total += workerMs[x];
+    }
+    if ((count < 2) || (total <= 0.0))
+    {
+        return;
+    }
+    /** The time of each band is taken as spread evenly over
+     * its rows.  Each border goes to where the time before
+     * it is its share of the whole, part of the way, so the
+     * bands do not swing from frame to frame.
+     */
+    int height = borders[count];
+    vector<int> next(borders);
+    int band = 0;
+    double before = 0.0;
+    for (int x = 1; x < count; x++)
+    {
+        double wanted = total * x / count;
+        while ((band < count - 1) && (before + workerMs[band] < wanted))
+        {
+            before += workerMs[band];
+            band++;
+        }
+        double inside = (workerMs[band] > 0.0) ? (wanted - before) / workerMs[band] : 0.5;
+        double balanced = borders[band]
+        + glm::clamp(inside, 0.0, 1.0) * (borders[band + 1] - borders[band]);
+        double moved = borders[x] + (balanced - borders[x]) * REBALANCE_RATE;
+        next[x] = (int) round(moved / ROW_ALIGN) * ROW_ALIGN;
+    }
+    for (int x = 1; x < count; x++)
+    {
+        next[x] = glm::clamp(next[x], next[x - 1] + MIN_ROWS, height - (count - x) * MIN_ROWS);
+    }
+    borders.swap(next);
+}
+
+mat4 TileRenderer::cropProjection(const mat4 &projection, int firstRow, int rows, int height)
+{
+    //! The band's rows in clip space, stretched to fill it.
+    float bottom = -1.0f + 2.0f * (float) firstRow / (float) height;
+    float top = -1.0f + 2.0f * (float) (firstRow + rows) / (float) height;
+    mat4 crop = mat4(1.0f);
+    crop[1][1] = 2.0f / (top - bottom);
+    crop[3][1] = -(top + bottom) / (top - bottom);
+    return crop * projection;
+}
+
+bool TileRenderer::writeAll(int fd, const void *data, size_t size)
+{
+    const char *bytes = (const char*) data;
+    while (size > 0)
+    {
+        ssize_t wrote = write(fd, bytes, size);
+        if ((wrote < 0) && (errno == EINTR))
+        {
+            continue;
+        }
+        if (wrote <= 0)
+        {
+            return false;
+        }
+        bytes += wrote;
+        size -= (size_t) wrote;
+    }
+    return true;
+}
+
+bool TileRenderer::readAll(int fd, void *data, size_t size)
+{
+    char *bytes = (char*) data;
+    while (size > 0)
+    {
+        ssize_t got = read(fd, bytes, size);
+        if ((got < 0) && (errno == EINTR))
+        {
+            continue;
+        }
+        if (got <= 0)
+        {
+            return false;
+        }
+        bytes += got;
+        size -= (size_t) got;
+    }
+    return true;
+}
+
+int TileRenderer::runWorker()
+{
+    CameraPath::Path_Type type;
+    if (!CameraPath::fromName(options.cameraPath, type))
+    {
+        return 1;
+    }
+    void *mapped = mmap(NULL, frameSize, PROT_READ | PROT_WRITE, MAP_SHARED, options.tileFrame, 0);
+    if (mapped == MAP_FAILED)
+    {
+        LOG_ERROR(STARTUP, "Tile worker {} cannot map the shared frame:  {}", options.tileWorker,
+        strerror(errno));
+        return 1;
+    }
+    frame = (unsigned char*) mapped;
+    frameFd = options.tileFrame;
+    context = new HeadlessContext();
+    if (!context->create(options.width, options.height))
+    {
+        return 1;
+    }
+    RenderCore *core = new RenderCore(options.count);
+    if ((!core->initGL()) || (!context->createFramebuffer()))
+    {
+        delete core;
+        return 1;
+    }
+    core->framebufferSize(options.width, options.height);
+    core->configureShaders(options.dynamicShaders, options.highPrecision);
+    core->configureViews(1);
+    core->configureTransparency(options.oit);
+    core->configureGpuCull(options.gpuCull);
+    core->configureMesh(options.mesh);
+    //! Every band shows every picture from the first frame.
+    core->configureStreaming(false, chrono::steady_clock::now());
+    core->enableSkybox(options.skybox);
+    if (!core->createScene(options.seed, options.threads, options.loadScene))
+    {
+        delete core;
+        return 1;
+    }
+    Camera camera(options.width, options.height);
+    CameraPath path(type);
+    Result ready = { -1, 0, 0.0 };
+    writeAll(options.tileResults, &ready, sizeof(ready));
+    int rows = options.height;
+    Command command;
+    while (readAll(options.tileCommands, &command, sizeof(command)) && (command.frame >= 0))
+    {
+        TRACE_SCOPE("tile");
+        chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+        //! The band is drawn at the bottom of the framebuffer.
+        if (command.rows != rows)
+        {
+            rows = command.rows;
+            core->framebufferSize(options.width, rows);
+        }
+        FrameParams params;
+        HeadlessBench::pathParams(options, camera, path, command.frame, command.total, params);
+        params.projection = cropProjection(params.projection, command.firstRow, rows,
+        options.height);
+        params.projections[0] = cropProjection(params.projections[0], command.firstRow, rows,
+        options.height);
+        core->renderFrame(params);
+        glReadPixels(0, 0, options.width, rows, GL_RGBA, GL_UNSIGNED_BYTE,
+        frame + (size_t) command.firstRow * options.width * 4);
+        Result result;
+        result.frame = command.frame;
+        result.drawn = core->getDrawn();
+        result.ms = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+        if (!writeAll(options.tileResults, &result, sizeof(result)))
+        {
+            break;
+        }
+    }
+    //! The OpenGL objects go before the context.
+    delete core;
+    return 0;
+}
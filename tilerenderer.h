@@ -0,0 +1,147 @@
+/*******************************************************************
+ * TileRenderer:  A class to draw the headless frame in bands,
+ * each in a worker process with a context of its own, and put
+ * the bands together from shared memory.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef TILERENDERER_H
+#define TILERENDERER_H
+
+#include "commonheader.h"
+#include "options.h"
+#include "headlesscontext.h"
+#include "headlessbench.h"
+#include "rendercore.h"
+#include "camera.h"
+#include "camerapath.h"
+#include "framestats.h"
+#include "framecapture.h"
+#include "logger.h"
+#include "tracer.h"
+
+/** \class TileRenderer
+ * Sort first:  the frame is cut into bands of rows, and each
+ * worker draws only its band, with the projection narrowed
+ * to it, so the cull leaves out the cubes that do not touch
+ * it.  The workers are the program run again, each with an
+ * EGL context of its own, which on a machine without a GPU
+ * is a software rasterizer of its own as well.  The frame is
+ * one block of shared memory each worker reads its band back
+ * into, and the commands and the results go through pipes:
+ *
+ *     The compositor sends every worker the frame number and
+ *     its band, and waits for them all.
+ *
+ *     Each worker draws the frame along the camera path,
+ *     reads its band into the shared frame and answers with
+ *     the time it took.
+ *
+ *     The compositor sends the whole frame to its own
+ *     context, where it can be captured, and moves the
+ *     borders of the bands for the next frame so each
+ *     takes the same time by the last frame's times.
+ */
+class TileRenderer
+{
+public:
+    TileRenderer(Options &options);
+    ~TileRenderer();
+
+    /** \brief run
+     * Starts the workers, runs the warm up and measured
+     * frames and prints the results.  Returns the program
+     * exit code.
+     */
+    int run();
+
+    /** \brief runWorker
+     * The body of a worker process.  Returns its exit code.
+     */
+    int runWorker();
+
+protected:
+    //! What the compositor asks of a worker.  A frame of -1
+    //! stops it.
+    struct Command {
+        int32_t frame;
+        int32_t total;
+        int32_t firstRow;
+        int32_t rows;
+    };
+
+    //! What a worker answers, -1 for the frame when it is
+    //! ready to draw.
+    struct Result {
+        int32_t frame;
+        int32_t drawn;
+        double ms;
+    };
+
+    //! A worker process and its pipes.
+    struct Worker {
+        pid_t pid;
+        int commands;
+        int results;
+    };
+
+    /** \brief startWorkers
+     * Runs the program again for each worker with the same
+     * arguments.  Returns false if one cannot be started.
+     */
+    bool startWorkers();
+
+    /** \brief stopWorkers
+     * Tells the workers to stop and waits for them.
+     */
+    void stopWorkers();
+
+    /** \brief drawFrame
+     * Has the workers draw a frame, waits for them and
+     * puts it together.  Returns false if a worker is gone.
+     */
+    bool drawFrame(int frame, int total);
+
+    /** \brief rebalance
+     * Moves the borders of the bands toward the rows that
+     * would have given each the same time last frame.
+     */
+    void rebalance();
+
+    /** \brief cropProjection
+     * Narrows a projection to the rows from firstRow, so
+     * the band fills the clip space.
+     */
+    static mat4 cropProjection(const mat4 &projection, int firstRow, int rows, int height);
+
+    //! Writes or reads all of a block on a pipe.
+    static bool writeAll(int fd, const void *data, size_t size);
+    static bool readAll(int fd, void *data, size_t size);
+
+    Options options;
+    //! The compositor's context and the texture the frame
+    //! goes through to it.
+    HeadlessContext *context;
+    GLuint frameTexture, frameFBO;
+    //! The shared frame, bottom row first as glReadPixels
+    //! gives it.
+    unsigned char *frame;
+    size_t frameSize;
+    int frameFd;
+    vector<Worker> workers;
+    //! The first row of each band, and the height at the
+    //! end, with the last times and cubes of each.
+    vector<int> borders;
+    vector<double> workerMs, workerTotalMs;
+    vector<int> workerDrawn;
+    FrameStats stats;
+    FrameCapture *capture;
+    //! How far the borders move toward the balanced ones
+    //! each frame, the rows they keep to and the least rows
+    //! in a band.
+    constexpr static double REBALANCE_RATE = 0.5;
+    static const int ROW_ALIGN = 4;
+    static const int MIN_ROWS = 16;
+};
+
+#endif // TILERENDERER_H
@@ -0,0 +1,208 @@
+/*******************************************************************
+ * Tracer:  Times scopes of the program on every thread and
+ * writes them out in the Chrome trace format, for
+ * chrome://tracing or the Perfetto UI.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#include "tracer.h"
+
+atomic<bool> Tracer::recording(false);
+
+//! A thread's scopes, and how many of them there are.
+struct TraceBuffer {
+    Tracer::Event events[Tracer::BUFFER_EVENTS];
+    atomic<int> used;
+};
+
+//! Every buffer made, the ones whose threads have ended,
+//! and the names of the threads.
+static mutex registry;
+static vector<TraceBuffer*> buffers, idle;
+static vector<pair<uint32_t, string>> threadNames;
+static atomic<uint32_t> nextThread(1);
+static atomic<unsigned long> dropped(0);
+static string tracePath;
+static chrono::steady_clock::time_point epoch;
+
+/** The calling thread's number and buffer.  The buffer goes
+ * back for the next thread when this one ends.
+ */
+struct ThreadTrace {
+    uint32_t id = 0;
+    TraceBuffer *buffer = NULL;
+    ~ThreadTrace()
+    {
+        if (buffer != NULL)
+        {
+            lock_guard<mutex> hold(registry);
+            idle.push_back(buffer);
+        }
+    }
+};
+static thread_local ThreadTrace threadTrace;
+
+bool Tracer::start(string path)
+{
+    std::ofstream test(path.c_str(), ios::out | ios::trunc);
+    if (!test)
+    {
+        LOG_ERROR(FILE, "Cannot write the trace to {}.", path);
+        return false;
+    }
+    tracePath = path;
+    epoch = chrono::steady_clock::now();
+    recording.store(true);
+    //! Every way out of the program writes the trace, the
+    //! failures at startup included.
+    atexit(Tracer::finish);
+    return true;
+}
+
+int64_t Tracer::now()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - epoch).count();
+}
+
+void Tracer::copyDetail(char *to, const char *from)
+{
+    if (from == NULL)
+    {
+        to[0] = '\0';
+        return;
+    }
+    size_t length = strlen(from);
+    if (length >= (size_t) DETAIL_LENGTH)
+    {
+        from += length - (DETAIL_LENGTH - 1);
+    }
+    strncpy(to, from, DETAIL_LENGTH - 1);
+    to[DETAIL_LENGTH - 1] = '\0';
+}
+
+void Tracer::record(const char *name, const char *detail, int64_t begin, int64_t end)
+{
+    ThreadTrace &trace = threadTrace;
+    if (trace.id == 0)
+    {
+        trace.id = nextThread.fetch_add(1);
+    }
+    if (trace.buffer == NULL)
+    {
+        lock_guard<mutex> hold(registry);
+        if (!idle.empty())
+        {
+            trace.buffer = idle.back();
+            idle.pop_back();
+        }
+        else
+        {
+            trace.buffer = new TraceBuffer();
+            buffers.push_back(trace.buffer);
+        }
+    }
+    TraceBuffer *buffer = trace.buffer;
+    int slot = buffer->used.load(memory_order_relaxed);
+    if (slot >= BUFFER_EVENTS)
+    {
+        dropped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+    Event &event = buffer->events[slot];
+    event.name = name;
+    event.begin = begin;
+    event.length = end - begin;
+    event.thread = trace.id;
+    memcpy(event.detail, detail, DETAIL_LENGTH);
+    //! The writer reads only the events counted.
+    buffer->used.store(slot + 1, memory_order_release);
+}
+
+void Tracer::nameThread(const char *name)
+{
+    if (!active())
+    {
+        return;
+    }
+    ThreadTrace &trace = threadTrace;
+    if (trace.id == 0)
+    {
+        trace.id = nextThread.fetch_add(1);
+    }
+    lock_guard<mutex> hold(registry);
+    threadNames.push_back(make_pair(trace.id, string(name)));
+}
+
+//! Quotes a string for JSON.
+static void writeString(ostream &out, const char *text)
+{
+    out << '"';
+    for (const char *c = text; *c != '\0'; c++)
+    {
+        if ((*c == '"') || (*c == '\\'))
+        {
+            out << '\\' << *c;
+        }
+        else if ((unsigned char) *c < 0x20)
+        {
+            out << ' ';
+        }
+        else
+        {
+            out << *c;
+        }
+    }
+    out << '"';
+}
+
+void Tracer::finish()
+{
+    if (!recording.exchange(false))
+    {
+        return;
+    }
+    lock_guard<mutex> hold(registry);
+    std::ofstream out(tracePath.c_str(), ios::out | ios::trunc);
+    if (!out)
+    {
+        LOG_ERROR(FILE, "Cannot write the trace to {}.", tracePath);
+        return;
+    }
+    //! The times are in microseconds.
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (unsigned int x = 0; x < threadNames.size(); x++)
+    {
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+        << threadNames[x].first << ",\"args\":{\"name\":";
+        writeString(out, threadNames[x].second.c_str());
+        out << "}}";
+        first = false;
+    }
+    unsigned long events = 0;
+    out << fixed << setprecision(3);
+    for (unsigned int b = 0; b < buffers.size(); b++)
+    {
+        int used = buffers[b]->used.load(memory_order_acquire);
+        for (int x = 0; x < used; x++)
+        {
+            const Event &event = buffers[b]->events[x];
+            out << (first ? "" : ",\n") << "{\"name\":";
+            writeString(out, event.name);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+            << ",\"ts\":" << event.begin / 1000.0 << ",\"dur\":" << event.length / 1000.0;
+            if (event.detail[0] != '\0')
+            {
+                out << ",\"args\":{\"detail\":";
+                writeString(out, event.detail);
+                out << "}";
+            }
+            out << "}";
+            first = false;
+            events++;
+        }
+    }
+    out << "\n]}\n";
+    LOG_INFO(FILE, "Wrote {} trace events on {} threads to {}, {} dropped.", events,
+    nextThread.load() - 1, tracePath, dropped.load());
+}
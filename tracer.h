@@ -0,0 +1,125 @@
+/*******************************************************************
+ * Tracer:  Times scopes of the program on every thread and
+ * writes them out in the Chrome trace format, for
+ * chrome://tracing or the Perfetto UI.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef TRACER_H
+#define TRACER_H
+
+#include "commonheader.h"
+#include "logger.h"
+
+//! The scope's variable is named after its line.
+#define TRACE_JOIN(a, b) TRACE_JOIN_AGAIN(a, b)
+#define TRACE_JOIN_AGAIN(a, b) a##b
+//! Times the rest of the block under a name, which must be
+//! a string that lasts, such as a literal.
+#define TRACE_SCOPE(name) TraceScope TRACE_JOIN(traceScope, __LINE__)(name)
+//! The same with a line of detail, copied, such as a file.
+#define TRACE_SCOPE_DETAIL(name, detail) \
+    TraceScope TRACE_JOIN(traceScope, __LINE__)(name, detail)
+
+/** \class Tracer
+ * Each thread writes the scopes it finishes to a buffer of
+ * its own, taken the first time it traces, with no lock and
+ * no allocation after that.  When a thread ends its buffer
+ * goes to the next new thread, so threads started over and
+ * over, such as the drift workers, do not use more and more
+ * memory.  A full buffer drops what comes after.  The
+ * buffers are written out when the program exits.  When
+ * tracing is off a scope costs one relaxed load.
+ */
+class Tracer
+{
+public:
+    //! The longest detail kept, the end of it if longer.
+    static const int DETAIL_LENGTH = 40;
+    //! Scopes a buffer holds.
+    static const int BUFFER_EVENTS = 32768;
+
+    //! One scope on one thread, in nanoseconds from start.
+    struct Event {
+        const char *name;
+        int64_t begin, length;
+        uint32_t thread;
+        char detail[DETAIL_LENGTH];
+    };
+
+    /** \brief start
+     * Starts tracing, to be written to path at exit.
+     * Returns false if the file cannot be written.
+     */
+    static bool start(string path);
+
+    /** \brief finish
+     * Stops tracing and writes the trace.  Called at exit,
+     * and does nothing the second time.
+     */
+    static void finish();
+
+    /** \brief active
+     * Whether scopes are being traced now.
+     */
+    static bool active()
+    {
+        return recording.load(memory_order_relaxed);
+    }
+
+    /** \brief now
+     * Nanoseconds since tracing started.
+     */
+    static int64_t now();
+
+    /** \brief record
+     * Keeps a finished scope of the calling thread.
+     */
+    static void record(const char *name, const char *detail, int64_t begin, int64_t end);
+
+    /** \brief nameThread
+     * Names the calling thread in the trace.
+     */
+    static void nameThread(const char *name);
+
+    /** \brief copyDetail
+     * Copies the end of a detail that may be too long, or
+     * nothing.
+     */
+    static void copyDetail(char *to, const char *from);
+
+protected:
+    static atomic<bool> recording;
+};
+
+/** \class TraceScope
+ * Traces the time from its making to the end of the block.
+ */
+class TraceScope
+{
+public:
+    TraceScope(const char *name, const char *detail = NULL)
+    {
+        this->name = NULL;
+        if (Tracer::active())
+        {
+            this->name = name;
+            Tracer::copyDetail(this->detail, detail);
+            begin = Tracer::now();
+        }
+    }
+    ~TraceScope()
+    {
+        if (name != NULL)
+        {
+            Tracer::record(name, detail, begin, Tracer::now());
+        }
+    }
+
+protected:
+    const char *name;
+    char detail[Tracer::DETAIL_LENGTH];
+    int64_t begin;
+};
+
+#endif // TRACER_H
@@ -0,0 +1,86 @@
+/*******************************************************************
+ * TripleBuffer:  A lock free hand off of the latest value from
+ * one writing thread to one reading thread.
+ * Edward C. Eberle <eberdeed@eberdeed.net>
+ * January 2020 San Diego, California USA
+ * ****************************************************************/
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include "commonheader.h"
+
+/** \class TripleBuffer
+ * Three copies of a value:  one the writer fills, one the
+ * reader holds and one in the middle.  Publishing swaps the
+ * writer's copy with the middle one and marks it new, reading
+ * swaps the middle one with the reader's copy if it is new.
+ * Neither side waits for the other, the writer never touches
+ * the copy being read, and the reader always gets the most
+ * recently published value, skipping any it was too slow for.
+ */
+template <class T>
+class TripleBuffer
+{
+public:
+    TripleBuffer()
+    {
+        writeIndex = 0;
+        middle.store(1);
+        readIndex = 2;
+    }
+    ~TripleBuffer()
+    {
+    }
+
+    /** \brief writeBuffer
+     * The copy the writer fills before publishing.
+     */
+    T &writeBuffer()
+    {
+        return buffers[writeIndex];
+    }
+
+    /** \brief publish
+     * Hands the written copy to the reader.
+     */
+    void publish()
+    {
+        int previous = middle.exchange(writeIndex | FRESH, memory_order_acq_rel);
+        writeIndex = previous & INDEX;
+    }
+
+    /** \brief update
+     * Takes the newest published copy, if there is one.
+     * Returns true if the copy read changed.
+     */
+    bool update()
+    {
+        if ((middle.load(memory_order_relaxed) & FRESH) == 0)
+        {
+            return false;
+        }
+        int previous = middle.exchange(readIndex, memory_order_acq_rel);
+        readIndex = previous & INDEX;
+        return true;
+    }
+
+    /** \brief readBuffer
+     * The copy the reader holds, unchanged until the next
+     * update.
+     */
+    const T &readBuffer() const
+    {
+        return buffers[readIndex];
+    }
+
+protected:
+    //! The low bits hold a copy, the fresh bit marks
+    //! the middle copy as not yet read.
+    constexpr static int INDEX = 3;
+    constexpr static int FRESH = 4;
+    T buffers[3];
+    int writeIndex, readIndex;
+    atomic<int> middle;
+};
+
+#endif // TRIPLEBUFFER_H